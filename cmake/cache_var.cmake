@@ -29,4 +29,11 @@ option(KANON_BUILD_PERF_TEST "Build performance test file" OFF)
 option(KANON_BUILD_PROTOBUF "Build protobuf module" OFF)
 option(KANON_BUILD_PROTOBUF_RPC "Build protobuf-rpc module" OFF)
 
-option(KANON_LINK_PROTOBUF "Link to the protobuf library provided by find_package" ON)
\ No newline at end of file
+option(KANON_LINK_PROTOBUF "Link to the protobuf library provided by find_package" ON)
+
+# The logs of kanon library(LOG_XXX_KANON) whose level is less than it are
+# compiled out, e.g. INFO strips the TRACE and DEBUG logs in the hot path.
+set(KANON_LOG_MIN_LEVEL "TRACE" CACHE STRING
+    "Minimum level of kanon library logs: TRACE/DEBUG/INFO/WARN/ERROR/SYS_ERROR")
+set(KANON_LOG_LEVELS TRACE DEBUG INFO WARN ERROR SYS_ERROR)
+set_property(CACHE KANON_LOG_MIN_LEVEL PROPERTY STRINGS ${KANON_LOG_LEVELS})
@@ -0,0 +1,21 @@
+// Merge the log files written by ThreadLogFile(or any LogFile)
+// into one by the timestamp of log.
+//
+// Usage: log_merge output_file input_files...
+//   e.g. log_merge server.log server.*.log
+#include <stdio.h>
+
+#include "kanon/log/log_merge.h"
+
+using namespace kanon;
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    ::fprintf(stderr, "Usage: %s output_file input_files...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::string> inputs(argv + 2, argv + argc);
+  return MergeLogFiles(inputs, argv[1]) ? 0 : 1;
+}
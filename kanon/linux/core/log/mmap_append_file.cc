@@ -0,0 +1,159 @@
+#include "kanon/log/mmap_append_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "kanon/log/logger.h"
+
+/* The size of a mapped window, also the unit of preallocation.
+ * Must be multiple of the page size */
+#define MMAP_WINDOW_SIZE (16 << 20)
+
+namespace kanon {
+
+MmapAppendFile::MmapAppendFile(StringArg filename)
+  : fd_(-1)
+  , window_(nullptr)
+  , window_end_(nullptr)
+  , cur_(nullptr)
+  , window_offset_(0)
+  , synced_offset_(0)
+  , writtenBytes_(0)
+{
+  while ((fd_ = ::open(filename.data(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) <
+         0)
+  {
+    if (errno != ENOENT) {
+      ::fprintf(stderr, "Failed to open file: %s\n", filename.data());
+      ::fflush(stderr);
+      ::abort();
+    }
+
+    auto filename_view = StringView(filename.data());
+    const std::string dir =
+        filename_view.substr(0, filename_view.rfind('/')).ToString();
+    if (::mkdir(dir.data(), 0755) != 0 && errno != EEXIST) {
+      ::fprintf(stderr, "Failed to create a directory: %s\n", dir.data());
+      ::fflush(stderr);
+      ::abort();
+    }
+  }
+
+  // Append to the existing content like "a" mode of fopen()
+  struct stat st;
+  if (::fstat(fd_, &st) != 0) {
+    ::fprintf(stderr, "Failed to stat file: %s\n", filename.data());
+    ::fflush(stderr);
+    ::abort();
+  }
+
+  window_offset_ = st.st_size & ~(off_t)(MMAP_WINDOW_SIZE - 1);
+  synced_offset_ = st.st_size;
+  if (!MapWindow()) {
+    ::fprintf(stderr, "Failed to map file: %s\n", filename.data());
+    ::fflush(stderr);
+    ::abort();
+  }
+  cur_ = window_ + (st.st_size - window_offset_);
+}
+
+MmapAppendFile::~MmapAppendFile() KANON_NOEXCEPT
+{
+  const auto size = GetOffset();
+  UnmapWindow();
+
+  // Remove the rest preallocated
+  if (::ftruncate(fd_, size) != 0) {
+    ::fprintf(stderr, "MmapAppendFile: failed to truncate file: %s\n",
+              strerror_tl(errno));
+  }
+  ::close(fd_);
+}
+
+void MmapAppendFile::_Append(char const *data, size_t num) KANON_NOEXCEPT
+{
+  while (num != 0) {
+    if (cur_ == window_end_) {
+      if (window_) {
+        UnmapWindow();
+        window_offset_ += MMAP_WINDOW_SIZE;
+      }
+
+      if (!MapWindow()) {
+        ::fprintf(stderr, "MmapAppendFile::Append() failed %s\n",
+                  strerror_tl(errno));
+        break;
+      }
+    }
+
+    const auto n = std::min(num, (size_t)(window_end_ - cur_));
+    ::memcpy(cur_, data, n);
+    cur_ += n;
+    data += n;
+    num -= n;
+    writtenBytes_ += n;
+  }
+}
+
+void MmapAppendFile::Flush() KANON_NOEXCEPT
+{
+  if (!window_) return;
+
+  const auto offset = GetOffset();
+  if (offset == synced_offset_) return;
+
+  // Don't wait the writeback of dirty pages.
+  // In linux, MS_ASYNC leaves it to the flusher threads of kernel, i.e.
+  // the content is in page cache like fflush(). sync_file_range() is not
+  // used since it submits the I/O in the calling thread.
+  // The address must be aligned to page
+  const auto page_mask = (off_t)::sysconf(_SC_PAGESIZE) - 1;
+  const auto start = synced_offset_ & ~page_mask;
+  ::msync(window_ + (start - window_offset_), offset - start, MS_ASYNC);
+  synced_offset_ = offset;
+}
+
+bool MmapAppendFile::MapWindow() KANON_NOEXCEPT
+{
+  // Preallocate the blocks of window to avoid the fragment and SIGBUS
+  // when disk is full
+#ifdef KANON_ON_LINUX
+  auto ret = ::fallocate(fd_, 0, window_offset_, MMAP_WINDOW_SIZE);
+  // Not supported by the file system, extend the size only
+  if (ret != 0 && errno == EOPNOTSUPP) {
+    ret = ::ftruncate(fd_, window_offset_ + MMAP_WINDOW_SIZE);
+  }
+#else
+  auto ret = ::ftruncate(fd_, window_offset_ + MMAP_WINDOW_SIZE);
+#endif
+  if (ret != 0) return false;
+
+  auto addr = ::mmap(nullptr, MMAP_WINDOW_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd_, window_offset_);
+  if (addr == MAP_FAILED) return false;
+
+  window_ = cur_ = static_cast<char *>(addr);
+  window_end_ = window_ + MMAP_WINDOW_SIZE;
+  return true;
+}
+
+void MmapAppendFile::UnmapWindow() KANON_NOEXCEPT
+{
+  if (!window_) return;
+
+  // The dirty pages are still written back after munmap(),
+  // flush here to keep synced_offset_ in the next window
+  Flush();
+  ::munmap(window_, MMAP_WINDOW_SIZE);
+  window_ = window_end_ = cur_ = nullptr;
+}
+
+} // namespace kanon
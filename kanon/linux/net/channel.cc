@@ -9,11 +9,39 @@
 
 using namespace kanon;
 
+struct Channel::CallbackHandler : ChannelHandler {
+  void OnChannelRead(TimeStamp receive_time) KANON_OVERRIDE
+  {
+    if (read_callback) read_callback(receive_time);
+  }
+
+  void OnChannelWrite() KANON_OVERRIDE
+  {
+    if (write_callback) write_callback();
+  }
+
+  void OnChannelError() KANON_OVERRIDE
+  {
+    if (error_callback) error_callback();
+  }
+
+  void OnChannelClose() KANON_OVERRIDE
+  {
+    if (close_callback) close_callback();
+  }
+
+  ReadEventCallback read_callback;
+  EventCallback write_callback;
+  EventCallback close_callback;
+  EventCallback error_callback;
+};
+
 Channel::Channel(EventLoop *loop, FdType fd)
   : fd_{fd}
   , events_{0}
   , revents_{0}
   , index_{-1}
+  , handler_{nullptr}
   , loop_(loop)
 #ifndef NDEBUG
   , events_handling_(false)
@@ -25,7 +53,7 @@ Channel::Channel(EventLoop *loop, FdType fd)
 Channel::~Channel() KANON_NOEXCEPT
 {
 #ifndef NDEBUG
-  // In the handling events phase, close_callback_ remove the connection(i.e.
+  // In the handling events phase, close handler remove the connection(i.e.
   // channel), it is unsafe, we should remove it in next phase(calling functor
   // phase)
   KANON_ASSERT(
@@ -35,6 +63,41 @@ Channel::~Channel() KANON_NOEXCEPT
 #endif
 }
 
+void Channel::SetHandler(ChannelHandler *handler) KANON_NOEXCEPT
+{
+  handler_ = handler;
+  callback_handler_.reset();
+}
+
+auto Channel::GetCallbackHandler() -> CallbackHandler *
+{
+  if (!callback_handler_) {
+    callback_handler_.reset(new CallbackHandler());
+    handler_ = callback_handler_.get();
+  }
+  return callback_handler_.get();
+}
+
+void Channel::SetReadCallback(ReadEventCallback cb)
+{
+  GetCallbackHandler()->read_callback = std::move(cb);
+}
+
+void Channel::SetWriteCallback(EventCallback cb)
+{
+  GetCallbackHandler()->write_callback = std::move(cb);
+}
+
+void Channel::SetErrorCallback(EventCallback cb)
+{
+  GetCallbackHandler()->error_callback = std::move(cb);
+}
+
+void Channel::SetCloseCallback(EventCallback cb)
+{
+  GetCallbackHandler()->close_callback = std::move(cb);
+}
+
 void Channel::Update()
 {
   // This must be called in a event loop
@@ -50,14 +113,20 @@ void Channel::Remove() KANON_NOEXCEPT
 
 void Channel::HandleEvents(TimeStamp receive_time)
 {
+  if (KANON_UNLIKELY(!handler_)) {
+    LOG_TRACE_KANON_HOT << "fd = " << fd_
+                        << " has no handler, events are ignored";
+    return;
+  }
+
 #ifndef NDEBUG
   events_handling_ = true;
 #endif
 
-  LOG_TRACE_KANON << "Event Receive Time: "
-                  << receive_time.ToFormattedString(true);
-  LOG_TRACE_KANON << "fd = " << fd_ << ", revent(result event) : {"
-                  << Revents2String() << "}";
+  LOG_TRACE_KANON_HOT << "Event Receive Time: "
+                      << receive_time.ToFormattedString(true);
+  LOG_TRACE_KANON_HOT << "fd = " << fd_ << ", revent(result event) : {"
+                      << Revents2String() << "}";
 
   /*
    * POLLHUP indicates the connection is closed in two direction
@@ -71,7 +140,7 @@ void Channel::HandleEvents(TimeStamp receive_time)
   if ((revents_ & POLLHUP) && !(revents_ & POLLIN)) {
     LOG_WARN_KANON << "fd = " << fd_ << " POLLHUP happened";
 
-    if (close_callback_) close_callback_();
+    handler_->OnChannelClose();
   }
 
   /*
@@ -91,18 +160,18 @@ void Channel::HandleEvents(TimeStamp receive_time)
     if (revents_ & POLLNVAL) {
       LOG_WARN_KANON << "fd = " << fd_ << " POLLNVAL(fd not open) happend";
     }
-    if (error_callback_) error_callback_();
+    handler_->OnChannelError();
   }
 
   // When revents_ == POLLIN, process message except FIN or RST
   // RDHUP indicates peer half-close in write direction(but we don't
   // distinguish, also close) So, we can continue receive message
   if (revents_ & (POLLIN | POLLPRI | POLLRDHUP)) {
-    if (read_callback_) read_callback_(receive_time);
+    handler_->OnChannelRead(receive_time);
   }
 
   if (revents_ & POLLOUT) {
-    if (write_callback_) write_callback_();
+    handler_->OnChannelWrite();
   }
 
 #ifndef NDEBUG
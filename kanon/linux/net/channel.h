@@ -2,6 +2,7 @@
 #define KANON_LINUX_NET_CHANNEL_H__
 
 #include <functional>
+#include <memory>
 #include <string>
 
 #include "kanon/util/noncopyable.h"
@@ -12,6 +13,7 @@
 #include "kanon/net/macro.h"
 #include "kanon/net/event.h"
 #include "kanon/net/type.h"
+#include "kanon/net/channel_handler.h"
 
 namespace kanon {
 
@@ -32,6 +34,10 @@ class EventLoop;
  * Call the APIs can resgister interested events and
  * handler of event.
  *
+ * The handler is a ChannelHandler which is implemented by the
+ * owner of channel, or the std::function callbacks for custom
+ * channel(adapted to a ChannelHandler internally).
+ *
  * when the events occurred, event loop will notify this
  * through the demultiplexer then this will dispatch
  * them to corresponseding event handler.
@@ -138,10 +144,20 @@ class Channel {
   //! \name events handler register
   //!@{
 
-  void SetReadCallback(ReadEventCallback cb) { read_callback_ = std::move(cb); }
-  void SetWriteCallback(EventCallback cb) { write_callback_ = std::move(cb); }
-  void SetErrorCallback(EventCallback cb) { error_callback_ = std::move(cb); }
-  void SetCloseCallback(EventCallback cb) { close_callback_ = std::move(cb); }
+  /**
+   * \brief Set the handler of all events
+   *
+   * The callbacks set by the Set*Callback() are dropped
+   */
+  void SetHandler(ChannelHandler *handler) KANON_NOEXCEPT;
+
+  ChannelHandler *GetHandler() const KANON_NOEXCEPT { return handler_; }
+
+  //! Adapter of SetHandler(), replace the handler set by it
+  void SetReadCallback(ReadEventCallback cb);
+  void SetWriteCallback(EventCallback cb);
+  void SetErrorCallback(EventCallback cb);
+  void SetCloseCallback(EventCallback cb);
 
   //!@} // events handler resgiter
 
@@ -183,6 +199,9 @@ class Channel {
    */
   void Update();
 
+  struct CallbackHandler;
+  CallbackHandler *GetCallbackHandler();
+
  private:
   FdType fd_;  //!< File descriptor that is being monitored
   int events_; //!< Events that fd interests
@@ -208,10 +227,13 @@ class Channel {
    */
   int index_;
 
-  ReadEventCallback read_callback_;
-  EventCallback write_callback_;
-  EventCallback close_callback_;
-  EventCallback error_callback_;
+  ChannelHandler *handler_; //!< Dispatch the events to
+
+  /**
+   * Store the std::function callbacks, created in the first call of
+   * Set*Callback() only.
+   */
+  std::unique_ptr<CallbackHandler> callback_handler_;
 
   /**
    * A channel must be tied with a event loop to
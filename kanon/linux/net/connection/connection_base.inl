@@ -38,8 +38,8 @@ void ConnectionBase<D>::HandleWrite()
 template <typename D>
 void ConnectionBase<D>::SendInLoopForBuf(InputBuffer &buffer)
 {
-  LOG_TRACE_KANON << "Connection: [" << name_
-                  << "], fd = " << channel_->GetFd();
+  LOG_TRACE_KANON_HOT << "Connection: [" << name_
+                      << "], fd = " << channel_->GetFd();
 
   if (state_ != kConnected) {
     LOG_WARN_KANON << "This connection[" << name_
@@ -65,26 +65,27 @@ void ConnectionBase<D>::SendInLoopForBuf(InputBuffer &buffer)
     }
 
     if (n > 0) {
-      LOG_TRACE_KANON << "Write length = " << n;
+      LOG_TRACE_KANON_HOT << "Write length = " << n;
       output_buffer_.AdvanceRead(n);
       if (output_buffer_.HasReadable()) {
 #ifdef PRINT_REMAIN
-        LOG_TRACE_KANON << "Remaining length = "
-                        << output_buffer_.GetReadableSize();
+        LOG_TRACE_KANON_HOT << "Remaining length = "
+                            << output_buffer_.GetReadableSize();
 #endif
 
         if (output_buffer_.GetReadableSize() >= high_water_mark_ &&
             high_water_mark_callback_)
         {
-          loop_->QueueToLoop(std::bind(high_water_mark_callback_,
-                                       this->shared_from_this(),
-                                       output_buffer_.GetReadableSize()));
+          loop_->QueueToLoop(
+              std::bind(&ConnectionBase<D>::CallHighWaterMarkCallback, this,
+                        output_buffer_.GetReadableSize()));
         }
         channel_->EnableWriting();
       } else {
         if (write_complete_callback_) {
-          loop_->QueueToLoop(
-              std::bind(write_complete_callback_, this->shared_from_this()));
+          loop_->QueueToLoop([this]() {
+            write_complete_callback_(self_);
+          });
         }
 
         if (channel_->IsWriting()) {
@@ -111,47 +112,68 @@ void ConnectionBase<D>::SendInLoopForChunkList(OutputBuffer &buffer)
   //     "The Send() for ChunkList must be called when output_buffer_ is
   //     empty");
 
-  int saved_errno = 0;
-  auto write_n = ChunkListWriteFd(buffer, channel_->GetFd(), saved_errno);
-
-  if (saved_errno && saved_errno != EAGAIN) {
-    LOG_SYSERROR_KANON << "write unexpected error occurred";
+  // The queued callbacks bind this, so must not be called after
+  // HandleClose()(e.g. Send() is called in other thread)
+  if (state_ != kConnected) {
+    LOG_WARN_KANON << "This connection[" << name_
+                   << "] is not connected, don't send any message";
+    return;
   }
 
-  if (write_n > 0) {
-    LOG_DEBUG_KANON << "Write " << write_n << " bytes";
-    buffer.AdvanceRead(write_n);
+  // Write directly only if there is no pending message,
+  // otherwise the message is out of order
+  if (!output_buffer_.HasReadable()) {
+    int saved_errno = 0;
+    // The single chunk is written by ::write() which may return -1
+    auto write_n =
+        (ssize_t)ChunkListWriteFd(buffer, channel_->GetFd(), saved_errno);
 
-    if (buffer.HasReadable()) {
-      if (high_water_mark_callback_ &&
-          buffer.GetReadableSize() > high_water_mark_)
-      {
-        loop_->QueueToLoop(std::bind(high_water_mark_callback_,
-                                     this->shared_from_this(),
-                                     high_water_mark_));
-      }
+    if (write_n < 0) {
+      saved_errno = errno;
+      write_n = 0;
+    }
 
-#if 1
-      if (output_buffer_.HasReadable()) {
-        output_buffer_.AppendChunkList(&buffer);
-      } else {
-        output_buffer_.swap(buffer);
-      }
-#else
-      output_buffer_.swap(buffer);
-#endif
-    } else {
-      LOG_DEBUG_KANON << "Write complete";
+    if (saved_errno && saved_errno != EAGAIN) {
+      LOG_SYSERROR_KANON << "write unexpected error occurred";
+    }
+
+    LOG_DEBUG_KANON_HOT << "Write " << write_n << " bytes";
+    buffer.AdvanceRead(write_n);
+
+    if (!buffer.HasReadable()) {
+      LOG_DEBUG_KANON_HOT << "Write complete";
       if (write_complete_callback_) {
-        loop_->QueueToLoop(std::bind(&ConnectionBase::CallWriteCompleteCallback,
-                                     this->shared_from_this()));
+        loop_->QueueToLoop(
+            std::bind(&ConnectionBase::CallWriteCompleteCallback, this));
       }
 
       if (channel_->IsWriting()) {
         channel_->DisableWriting();
       }
+      return;
     }
   }
+
+  // Short write happened or the previous message is pending,
+  // store the remaining message then HandleWrite() will write it
+  const auto readable_len = output_buffer_.GetReadableSize();
+  const auto remaining = buffer.GetReadableSize();
+  if (high_water_mark_callback_ && readable_len < high_water_mark_ &&
+      readable_len + remaining >= high_water_mark_)
+  {
+    loop_->QueueToLoop(std::bind(&ConnectionBase<D>::CallHighWaterMarkCallback,
+                                 this, readable_len + remaining));
+  }
+
+  if (output_buffer_.HasReadable()) {
+    output_buffer_.AppendChunkList(&buffer);
+  } else {
+    output_buffer_.swap(buffer);
+  }
+
+  if (!channel_->IsWriting()) {
+    channel_->EnableWriting();
+  }
 }
 
 template <typename D>
@@ -160,8 +182,8 @@ void ConnectionBase<D>::SendInLoop(void const *data, size_t len)
   ssize_t n = 0;
   size_t remaining = len;
 
-  LOG_TRACE_KANON << "Connection: [" << name_
-                  << "], fd = " << channel_->GetFd();
+  LOG_TRACE_KANON_HOT << "Connection: [" << name_
+                      << "], fd = " << channel_->GetFd();
   // Although Send() has checked state_ is kConnected
   // But connection also can be closed in the phase 2
   // when this is called in phase 3
@@ -240,17 +262,18 @@ void ConnectionBase<D>::SendInLoop(void const *data, size_t len)
     n = sock::Write(channel_->GetFd(), data, len);
 
     if (n >= 0) {
-      LOG_TRACE_KANON << "Write " << n << " bytes";
+      LOG_TRACE_KANON_HOT << "Write " << n << " bytes";
       if (static_cast<size_t>(n) != len) {
         remaining -= n;
       } else {
         if (write_complete_callback_) {
-          loop_->QueueToLoop(
-              std::bind(write_complete_callback_, this->shared_from_this()));
+          loop_->QueueToLoop([this]() {
+            write_complete_callback_(self_);
+          });
         }
 
         if (channel_->IsWriting()) {
-          LOG_TRACE_KANON << "Write complete but in writing";
+          LOG_TRACE_KANON_HOT << "Write complete but in writing";
           channel_->DisableWriting();
         }
 
@@ -274,17 +297,13 @@ void ConnectionBase<D>::SendInLoop(void const *data, size_t len)
       if (readable_len + remaining >= high_water_mark_ &&
           readable_len < high_water_mark_)
       {
-        loop_->QueueToLoop(std::bind(high_water_mark_callback_,
-                                     this->shared_from_this(),
-                                     readable_len + remaining));
-        // loop_->QueueToLoop([this, readable_len, remaining]() {
-        //   high_water_mark_callback_(this->shared_from_this(), readable_len +
-        //   remaining);
-        // });
+        loop_->QueueToLoop(
+            std::bind(&ConnectionBase<D>::CallHighWaterMarkCallback, this,
+                      readable_len + remaining));
       }
     }
 
-    LOG_TRACE_KANON << "Remaining content length = " << remaining;
+    LOG_TRACE_KANON_HOT << "Remaining content length = " << remaining;
     output_buffer_.Append(static_cast<char const *>(data) + n, remaining);
     if (!channel_->IsWriting()) {
       channel_->EnableWriting();
@@ -12,7 +12,9 @@ void Connector::Connect()
   /* Avoid call StartRun when connection in connecting or connected */
   if (state_ != kDisconnected) return;
 
-  FdType sockfd = sock::CreateNonBlockAndCloExecSocket(!serv_addr_.IsIpv4());
+  FdType sockfd = unix_addr_ ? sock::CreateNonBlockAndCloExecUnixSocket()
+                            : sock::CreateNonBlockAndCloExecSocket(
+                                  !serv_addr_.IsIpv4());
   // Poll to check connection if is established
   // If connection is established, we call CompleteConnect() to register write
   // callback, then write callback will call new_connection_callback_.
@@ -22,7 +24,9 @@ void Connector::Connect()
   // the connect() initiates TCP's three-way shake.
   // It return only when connection is established or error occurrs.
   // \see UNP 4.3 connect Function
-  auto ret = sock::Connect(sockfd, serv_addr_.ToSockaddr());
+  auto ret = unix_addr_ ? sock::Connect(sockfd, unix_addr_->ToSockaddr(),
+                                        unix_addr_->GetLength())
+                        : sock::Connect(sockfd, serv_addr_.ToSockaddr());
 
   auto saved_errno = (ret == 0) ? 0 : errno;
 
@@ -36,6 +40,8 @@ void Connector::Connect()
       break;
 
     case EAGAIN: // For tcp, there are insufficient entries in the routing cache
+                 // For unix domain socket, the backlog of server is full
+    case ENOENT: // The socket file of unix domain socket isn't created
     // case EADDRINUSE: // Local address is already in use
     case EADDRNOTAVAIL: // No port can be used(or enlarge port range?)
                         // Retry until there is a free port can be used
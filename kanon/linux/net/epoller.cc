@@ -54,7 +54,7 @@ TimeStamp Epoller::Poll(int ms, ChannelVec &active_channels)
   TimeStamp now{TimeStamp::Now()};
 
   if (ev_nums > 0) {
-    LOG_TRACE_KANON << ev_nums << " events are ready";
+    LOG_TRACE_KANON_HOT << ev_nums << " events are ready";
     FillActiveChannels(ev_nums, active_channels);
 
     // since epoll_wait does not expand space and
@@ -65,7 +65,7 @@ TimeStamp Epoller::Poll(int ms, ChannelVec &active_channels)
       events_.resize(ev_nums << 1);
     }
   } else if (ev_nums == 0) {
-    LOG_TRACE_KANON << "none events ready";
+    LOG_TRACE_KANON_HOT << "none events ready";
   } else {
     // use saved_errno to avoid misunderstand error
     if (saved_errno != EINTR) {
@@ -137,8 +137,8 @@ void Epoller::UpdateEpollEvent(int op, Channel *ch) KANON_NOEXCEPT
     ev.events |= EPOLLET;
   }
 
-  LOG_TRACE_KANON << "epoll_ctl op =" << detail::Op2Str(op) << " fd: " << fd
-                  << " {" << Channel::Ev2String(ev.events) << "}";
+  LOG_TRACE_KANON_HOT << "epoll_ctl op =" << detail::Op2Str(op) << " fd: " << fd
+                      << " {" << Channel::Ev2String(ev.events) << "}";
 
   // In this way, can get channel accroding to fd in O(1)
   ev.data.ptr = static_cast<void *>(ch);
@@ -29,7 +29,7 @@ TimeStamp Poller::Poll(int ms, ChannelVec &active_channels) KANON_NOEXCEPT
   TimeStamp now{TimeStamp::Now()};
 
   if (ret > 0) {
-    LOG_TRACE_KANON << ret << " events are ready";
+    LOG_TRACE_KANON_HOT << ret << " events are ready";
     uint32_t ev_num = ret;
 
     for (auto const &pollfd : pollfds_) {
@@ -52,7 +52,7 @@ TimeStamp Poller::Poll(int ms, ChannelVec &active_channels) KANON_NOEXCEPT
       }
     }
   } else if (ret == 0) {
-    LOG_TRACE_KANON << "none events are ready";
+    LOG_TRACE_KANON_HOT << "none events are ready";
   } else {
     if (ret != EINTR) {
       LOG_SYSERROR_KANON << "Poll() error occurred";
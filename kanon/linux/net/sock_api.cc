@@ -35,6 +35,25 @@ error_handle:
   return -1;
 }
 
+FdType sock::CreateNonBlockAndCloExecUnixSocket() KANON_NOEXCEPT
+{
+  FdType sockfd;
+#ifdef NO_SOCKTYPE
+  sockfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sockfd < 0) goto error_handle;
+  SetNonBlockAndCloExec(sockfd);
+#else
+  sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sockfd < 0) goto error_handle;
+#endif
+  return sockfd;
+
+error_handle:
+  LOG_SYSFATAL << "create new unix socket fd error";
+
+  return -1;
+}
+
 FdType sock::Accept(FdType fd, sockaddr_in6 *addr) KANON_NOEXCEPT
 {
   socklen_t socklen = sizeof(struct sockaddr_in6);
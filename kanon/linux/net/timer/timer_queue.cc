@@ -64,9 +64,9 @@ static KANON_INLINE void PrintItimerspec(struct itimerspec const &spec)
 {
   KANON_UNUSED(spec);
 #ifndef NDEBUG
-  LOG_DEBUG_KANON << "Reset the expiration(sec, nsec): ("
-                  << spec.it_value.tv_sec << ", " << spec.it_value.tv_nsec
-                  << ")";
+  LOG_DEBUG_KANON_HOT << "Reset the expiration(sec, nsec): ("
+                      << spec.it_value.tv_sec << ", " << spec.it_value.tv_nsec
+                      << ")";
 #endif
 }
 
@@ -90,7 +90,7 @@ static KANON_INLINE void SetTimerFd(int timerfd, Timer const &timer,
   if (::timerfd_settime(timerfd, 0, &new_value, NULL)) {
     LOG_SYSERROR_KANON << "::timerfd_settime() error occurred";
   } else {
-    LOG_TRACE_KANON << "Reset successfully";
+    LOG_TRACE_KANON_HOT << "Reset successfully";
   }
 }
 
@@ -102,7 +102,7 @@ static KANON_INLINE void ReadTimerFd(int timerfd) KANON_NOEXCEPT
   if ((n = ::read(timerfd, &dummy, sizeof dummy)) != sizeof dummy) {
     LOG_SYSERROR_KANON << "::read() of timerfd error occurred";
   } else {
-    LOG_TRACE_KANON << "Read " << n << " bytes";
+    LOG_TRACE_KANON_HOT << "Read " << n << " bytes";
   }
 }
 
@@ -113,16 +113,15 @@ TimerQueue::TimerQueue(EventLoop *loop)
   , timer_channel_{kanon::make_unique<Channel>(loop, detail::CreateTimerFd())}
   , calling_timer_{false}
 {
-  timer_channel_->SetReadCallback(
-      std::bind(&TimerQueue::ProcessAllExpiredTimers, this, _1));
-
-  timer_channel_->SetErrorCallback([]() {
-    LOG_SYSERROR_KANON << "Timer event handler error occurred";
-  });
-
+  timer_channel_->SetHandler(this);
   timer_channel_->EnableReading();
 }
 
+void TimerQueue::OnChannelError()
+{
+  LOG_SYSERROR_KANON << "Timer event handler error occurred";
+}
+
 TimerQueue::~TimerQueue() KANON_NOEXCEPT
 {
   for (auto &timer_seq : timers_) {
@@ -178,7 +177,7 @@ bool TimerQueue::Emplace(Timer *timer)
   }
 
   timers_.emplace(timer, timer->sequence());
-  LOG_TRACE_KANON << "Now total timer count = " << timers_.size();
+  LOG_TRACE_KANON_HOT << "Now total timer count = " << timers_.size();
   return ret;
 }
 
@@ -252,8 +251,8 @@ auto TimerQueue::GetExpiredTimers(TimeStamp time) -> TimerVector
                  });
 
   timers_.erase(timers_.begin(), expired_end);
-  LOG_DEBUG_KANON << "Expired time =  " << time.ToFormattedString(true);
-  LOG_DEBUG_KANON << "Expired timer count = " << expireds.size();
+  LOG_DEBUG_KANON_HOT << "Expired time =  " << time.ToFormattedString(true);
+  LOG_DEBUG_KANON_HOT << "Expired timer count = " << expireds.size();
 
   return expireds;
 }
@@ -278,7 +277,7 @@ void TimerQueue::ResetTimers(TimerVector &expireds, TimeStamp now)
     }
   }
 
-  LOG_DEBUG_KANON << "Reset timer_map size: " << timers_.size();
+  LOG_DEBUG_KANON_HOT << "Reset timer_map size: " << timers_.size();
 
   if (!timers_.empty()) {
     next_expire = timers_.begin()->first;
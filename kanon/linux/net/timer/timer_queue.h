@@ -13,7 +13,9 @@
 
 namespace kanon {
 
-class TimerQueue : public ITimerQueuePlatform {
+class TimerQueue
+  : public ITimerQueuePlatform
+  , ChannelHandler {
  public:
   using Base = ITimerQueuePlatform;
 
@@ -100,6 +102,15 @@ class TimerQueue : public ITimerQueuePlatform {
   /** The read callback of timerfd */
   void ProcessAllExpiredTimers(TimeStamp recv_time);
 
+  //! \name timerfd handler
+  //!@{
+  void OnChannelRead(TimeStamp recv_time) KANON_OVERRIDE
+  {
+    ProcessAllExpiredTimers(recv_time);
+  }
+  void OnChannelError() KANON_OVERRIDE;
+  //!@}
+
   /** Helper of ProcessAllExpiredTimers() */
   TimerVector GetExpiredTimers(TimeStamp time);
   void ResetTimers(TimerVector &, TimeStamp now);
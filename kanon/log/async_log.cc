@@ -1,12 +1,226 @@
 #include "kanon/log/async_log.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
 #include "kanon/util/time_stamp.h"
+#include "kanon/thread/current_thread.h"
 
 #include "kanon/log/log_file.h"
+#include "kanon/log/mmap_append_file.h"
+#include "kanon/log/binary_log.h"
 
 using namespace kanon;
 
-#define BUFFER_BOUND 16
+AsyncLog *kanon::g_binary_log_output = nullptr;
+
+/* The default size of the buffer of each front thread, must be power of 2,
+ * i.e. the size of LargeFixedBuffer */
+#define THREAD_BUFFER_SIZE (1 << 22)
+#define CACHE_LINE_SIZE    64
+
+namespace kanon {
+namespace detail {
+
+/**
+ * Header of a message in thread buffer, the message follows it and
+ * the total size is aligned to sizeof(RecordHeader)
+ */
+struct RecordHeader {
+  int64_t time;
+  uint32_t len;
+  uint32_t binary;
+};
+
+//! The rest of ring is skipped, the next message is at the beginning
+#define WRAP_RECORD_LEN UINT32_MAX
+
+/**
+ * \brief Single producer(front thread) and single consumer(back thread) ring
+ *
+ * write_pos and read_pos increase monotonically and are masked to index,
+ * they are placed in the different cache lines to avoid false sharing.
+ * In kDropOldest, the front thread also advances read_pos to discard the
+ * oldest messages, it and the back thread reading the messages exclude each
+ * other by discard_lock, then the back thread never reads the bytes being
+ * overwritten.
+ */
+struct AsyncLogThreadBuffer : noncopyable {
+  explicit AsyncLogThreadBuffer(size_t size)
+    : data(new char[size])
+    , capacity(size)
+    , mask(size - 1)
+    , write_pos(0)
+    , cached_read_pos(0)
+    , discarded_lines(0)
+    , discarded_bytes(0)
+    , wakeup_pending(false)
+    , reserved_pos(0)
+    , reserving(false)
+    , tid(CurrentThread::tid())
+    , name(CurrentThread::t_name ? CurrentThread::t_name : "Unnamed")
+    , exited(false)
+    , discard_lock(false)
+    , read_pos(0)
+    , reported_discarded_lines(0)
+  {
+    // Don't warm up, the memory of the thread logging rarely isn't touched
+  }
+
+  RecordHeader *GetHeader(uint64_t pos) const KANON_NOEXCEPT
+  {
+    return reinterpret_cast<RecordHeader *>(data.get() + (pos & mask));
+  }
+
+  //! The bytes from pos to the end of ring
+  uint64_t GetRest(uint64_t pos) const KANON_NOEXCEPT
+  {
+    return capacity - (pos & mask);
+  }
+
+  //! Called in the back thread, the front thread holds it briefly
+  void LockDiscard() KANON_NOEXCEPT
+  {
+    while (discard_lock.exchange(true, std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  //! Called in the front thread, don't wait the back thread
+  bool TryLockDiscard() KANON_NOEXCEPT
+  {
+    return !discard_lock.exchange(true, std::memory_order_acquire);
+  }
+
+  void UnlockDiscard() KANON_NOEXCEPT
+  {
+    discard_lock.store(false, std::memory_order_release);
+  }
+
+  //! Only called in front thread
+  void AddDiscarded(uint64_t bytes) KANON_NOEXCEPT
+  {
+    discarded_lines.store(discarded_lines.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    discarded_bytes.store(discarded_bytes.load(std::memory_order_relaxed) +
+                              bytes,
+                          std::memory_order_relaxed);
+  }
+
+  std::unique_ptr<char[]> data;
+  uint64_t const capacity;
+  uint64_t const mask;
+  char padding0[CACHE_LINE_SIZE];
+
+  // Front thread
+  std::atomic<uint64_t> write_pos;
+  uint64_t cached_read_pos;
+  std::atomic<uint64_t> discarded_lines;
+  std::atomic<uint64_t> discarded_bytes;
+  std::atomic<bool> wakeup_pending;
+  uint64_t reserved_pos;
+  bool reserving; //!< Reserve() is called but not committed
+  int tid;
+  std::string name;
+  std::atomic<bool> exited;
+  char padding1[CACHE_LINE_SIZE];
+
+  // Back thread
+  //! Used in kDropOldest only, see above
+  std::atomic<bool> discard_lock;
+  std::atomic<uint64_t> read_pos;
+  uint64_t reported_discarded_lines;
+  char padding2[CACHE_LINE_SIZE];
+};
+
+} // namespace detail
+} // namespace kanon
+
+namespace {
+
+KANON_INLINE uint64_t RecordSize(size_t len) KANON_NOEXCEPT
+{
+  constexpr uint64_t align = sizeof(detail::RecordHeader);
+  return (sizeof(detail::RecordHeader) + len + align - 1) & ~(align - 1);
+}
+
+/**
+ * Mark the buffer of this thread exited when the thread exits,
+ * then back thread can remove it
+ */
+struct ThreadBufferHolder {
+  ~ThreadBufferHolder() KANON_NOEXCEPT
+  {
+    if (buffer) buffer->exited.store(true, std::memory_order_release);
+  }
+
+  uint64_t owner = 0;
+  std::shared_ptr<detail::AsyncLogThreadBuffer> buffer;
+};
+
+thread_local ThreadBufferHolder t_holder;
+
+std::atomic<uint64_t> g_async_log_id(1);
+
+/**
+ * The cursor of back thread in a thread buffer
+ */
+struct Cursor {
+  detail::AsyncLogThreadBuffer *buffer;
+  uint64_t committed; //!< The read_pos of buffer
+  uint64_t read_pos;  //!< The position of header, i.e. the wrapped part skipped
+  uint64_t write_pos;
+  /**
+   * The copy of the header of current message.
+   * In kDropOldest, the message may be discarded after the discard_lock is
+   * released, the copy is used to order the cursors in the meantime.
+   */
+  detail::RecordHeader header;
+
+  /**
+   * Skip the wrapped part and locate the header of current message
+   * \note In kDropOldest, must be called with the discard_lock held
+   * \return false if no message
+   */
+  bool Locate() KANON_NOEXCEPT
+  {
+    while (read_pos < write_pos) {
+      header = *buffer->GetHeader(read_pos);
+      if (header.len != WRAP_RECORD_LEN) return true;
+      read_pos += buffer->GetRest(read_pos);
+    }
+    return false;
+  }
+
+  /**
+   * Catch up with the front thread if the message is discarded
+   * \note In kDropOldest, must be called with the discard_lock held
+   * \return false if no message
+   */
+  bool Resync() KANON_NOEXCEPT
+  {
+    const auto new_read_pos =
+        buffer->read_pos.load(std::memory_order_relaxed);
+    if (new_read_pos != committed) committed = read_pos = new_read_pos;
+    return Locate();
+  }
+
+  char const *GetData() const KANON_NOEXCEPT
+  {
+    return reinterpret_cast<char const *>(buffer->GetHeader(read_pos) + 1);
+  }
+};
+
+struct CursorGreater {
+  bool operator()(Cursor const &x, Cursor const &y) const KANON_NOEXCEPT
+  {
+    return x.header.time > y.header.time;
+  }
+};
+
+} // namespace
 
 AsyncLog::AsyncLog(StringView basename, size_t roll_size, StringView prefix,
                    size_t log_file_num, size_t roll_interval,
@@ -18,23 +232,36 @@ AsyncLog::AsyncLog(StringView basename, size_t roll_size, StringView prefix,
   , roll_interval_(roll_interval)
   , flush_interval_{flush_interval}
   , running_{false}
-  , current_buffer_{kanon::make_unique<Buffer>()}
-  , next_buffer_{kanon::make_unique<Buffer>()}
+  , id_(g_async_log_id.fetch_add(1, std::memory_order_relaxed))
+  , policy_(kDropNewest)
+  , thread_buffer_size_(THREAD_BUFFER_SIZE)
+  , mmap_output_(false)
+  , compress_bytes_per_second_(0)
   , mutex_{}
+  , wakeup_{false}
+  , blocked_{false}
+  , removed_discarded_lines_(0)
+  , removed_discarded_bytes_(0)
   , not_empty_{mutex_}
+  , not_full_{mutex_}
+  , max_pending_bytes_(0)
+  , write_count_(0)
+  , write_time_us_(0)
+  , max_write_time_us_(0)
   , back_thr_{"AsyncLog"}
   , latch_{1}
 {
-  // warm up
-  current_buffer_->zero();
-  next_buffer_->zero();
-  buffers_.reserve(16);
+  thread_buffers_.reserve(16);
 
   Logger::SetColor(false);
 }
 
 AsyncLog::~AsyncLog() KANON_NOEXCEPT
 {
+  if (g_binary_log_output == this) {
+    g_binary_log_output = nullptr;
+  }
+
   if (running_) {
     Stop();
   }
@@ -46,141 +273,427 @@ void AsyncLog::StartRun()
 
   running_ = true;
 
-  buffers_dup_.reserve(16);
-
   back_thr_.StartRun([this]() {
     latch_.Countdown();
 
-    // In back thread, we also can set two buffer for front threads using,
-    BufferUPtr buffer1{kanon::make_unique<Buffer>()};
-    BufferUPtr buffer2{kanon::make_unique<Buffer>()};
-
-    // Warm up
-    buffer1->zero();
-    buffer2->zero();
-
     // write to disk
     // Not thread-safe is OK here.
+#ifdef KANON_ON_UNIX
+    if (mmap_output_) {
+      LogFile<false, MmapAppendFile> output(basename_, roll_size_, prefix_,
+                                            log_file_num_, roll_interval_,
+                                            flush_interval_);
+      if (compressor_) {
+        output.SetCompressor(std::move(compressor_),
+                             compress_bytes_per_second_);
+      }
+      BackThreadLoop(output);
+      return;
+    }
+#endif // KANON_ON_UNIX
+
     LogFile<> output(basename_, roll_size_, prefix_, log_file_num_,
                      roll_interval_, flush_interval_);
+    if (compressor_) {
+      output.SetCompressor(std::move(compressor_), compress_bytes_per_second_);
+    }
+    BackThreadLoop(output);
+  });
 
-    // back thread do long loop
-    while (running_) {
-      assert(buffer1 && buffer1->len() == 0);
-      assert(buffer2 && buffer2->len() == 0);
-      assert(buffers_dup_.empty());
+  // Main thread wait until back thread runs
+  latch_.Wait();
+}
 
-      {
-        MutexGuard guard{mutex_};
-        // \warning
-        //   You shouldn't use while.
-        //   Otherwise, it will wait infinitly
-        //   when current message accumulation
-        //   does not reach a buffer size.
-        // \note
-        //   This is not a classic use,
-        //   but there is one cosumer, use if here is safe
-        if (buffers_.empty()) {
-          // If front thread log message is so short,
-          // we also awake and write
-          // To ensure real time message
-          not_empty_.WaitForSeconds(flush_interval_);
-          // not_empty_.Wait();
-        }
+template <typename Output>
+void AsyncLog::BackThreadLoop(Output &output)
+{
+  // Merge the short messages to a large buffer before writing
+  std::unique_ptr<Buffer> batch{kanon::make_unique<Buffer>()};
+  // Warm up
+  batch->zero();
+
+  ThreadBuffers buffers;
+  buffers.reserve(16);
+
+  // back thread do long loop
+  while (running_) {
+    {
+      MutexGuard guard{mutex_};
+      // \note
+      //   This is not a classic use,
+      //   but there is one cosumer, use if here is safe
+      if (!wakeup_) {
+        // If front thread log message is so short,
+        // we also awake and write
+        // To ensure real time message
+        not_empty_.WaitForSeconds(flush_interval_);
+      }
+      wakeup_ = false;
 
-        // Although current_buffer_ have space to fill
-        // we also push it to buffers_
-        buffers_.emplace_back(std::move(current_buffer_));
+      buffers = thread_buffers_;
+    }
 
-        buffers_dup_.swap(buffers_);
+    const auto start = TimeStamp::Now().GetMicroseconds();
+    WriteBuffers(buffers, *batch, output);
+    // The content of MmapAppendFile is visible without flushing,
+    // LogFile starts its writeback in flush interval
+    if (!mmap_output_) output.Flush();
+    const auto cost = (uint64_t)(TimeStamp::Now().GetMicroseconds() - start);
+
+    write_count_.fetch_add(1, std::memory_order_relaxed);
+    write_time_us_.fetch_add(cost, std::memory_order_relaxed);
+    if (cost > max_write_time_us_.load(std::memory_order_relaxed)) {
+      max_write_time_us_.store(cost, std::memory_order_relaxed);
+    }
 
-        current_buffer_ = std::move(buffer1);
-        if (!next_buffer_) {
-          next_buffer_ = std::move(buffer2);
-        }
-      }
+    // Wake up the front threads blocked by kBlock
+    MutexGuard guard{mutex_};
+    if (blocked_) {
+      blocked_ = false;
+      not_full_.NotifyAll();
+    }
+  }
 
-      // If buffer total size over 64M,
-      // we discard these part to avoid accumulation
-      if (buffers_dup_.size() > BUFFER_BOUND) {
-        char buf[64];
-        ::snprintf(buf, sizeof buf, "Discard %lu large buffer at %s\n",
-                   buffers_dup_.size() - BUFFER_BOUND,
-                   TimeStamp::Now().ToFormattedString().c_str());
-        // ::fputs(buf, stderr);
-        output.Append(buf, strlen(buf));
-
-        buffers_dup_.erase(buffers_dup_.begin() + BUFFER_BOUND,
-                           buffers_dup_.end());
-      }
+  // Write the messages appended before stopping
+  {
+    MutexGuard guard{mutex_};
+    buffers = thread_buffers_;
+  }
+  WriteBuffers(buffers, *batch, output);
 
-      for (auto &buffer : buffers_dup_) {
-        output.Append(buffer->data(), buffer->len());
-      }
+  // Flush output buffer(the last)
+  output.Flush();
+}
 
-      // only leave the two warmed buffer
-      // and move to buffer1 and buffer2
-      if (buffers_dup_.size() > 2) buffers_dup_.resize(2);
+void AsyncLog::Stop() KANON_NOEXCEPT
+{
+  assert(running_);
 
-      if (!buffer1) {
-        buffer1 = std::move(buffers_dup_.back());
-        // reuse buffer
-        buffer1->reset();
-        buffers_dup_.pop_back();
-      }
+  {
+    MutexGuard guard{mutex_};
+    running_ = false;
+    not_empty_.Notify();
+    not_full_.NotifyAll();
+  }
+  back_thr_.Join();
+}
 
-      if (!buffer2) {
-        buffer2 = std::move(buffers_dup_.back());
-        buffer2->reset();
-        buffers_dup_.pop_back();
-      }
+void AsyncLog::Append(char const *data, size_t len) KANON_NOEXCEPT
+{
+  auto buf = Reserve(len, Logger::GetOutputLogLevel());
+  if (buf) {
+    ::memcpy(buf, data, len);
+    Commit(len);
+  }
+}
+
+char *AsyncLog::Reserve(size_t len, Logger::LogLevel level) KANON_NOEXCEPT
+{
+  auto buffer = GetThreadBuffer();
+
+  // The nested one(e.g. log in the formatting of a message) can't be
+  // placed since the length of the outer one is unknown
+  if (KANON_UNLIKELY(buffer->reserving)) {
+    buffer->AddDiscarded(len);
+    return nullptr;
+  }
+
+  const auto record_size = RecordSize(len);
+
+  auto write_pos = buffer->write_pos.load(std::memory_order_relaxed);
+  auto rest = buffer->GetRest(write_pos);
+  // The message must be contiguous, skip the rest if no space for it
+  auto need = rest < record_size ? rest + record_size : record_size;
 
-      buffers_dup_.clear();
+  if (write_pos + need - buffer->cached_read_pos > buffer->capacity) {
+    buffer->cached_read_pos =
+        buffer->read_pos.load(std::memory_order_acquire);
 
-      output.Flush();
+    if (write_pos + need - buffer->cached_read_pos > buffer->capacity) {
+      // Give back thread a chance to run if they are in the same CPU
+      NotifyBackThread(buffer);
+      std::this_thread::yield();
+      buffer->cached_read_pos =
+          buffer->read_pos.load(std::memory_order_acquire);
     }
 
-    // Flush output buffer(the last)
-    output.Flush();
-  });
+    if (write_pos + need - buffer->cached_read_pos > buffer->capacity &&
+        !HandleOverflow(buffer, write_pos, need, level))
+    {
+      buffer->AddDiscarded(len);
+      NotifyBackThread(buffer);
+      return nullptr;
+    }
+  }
 
-  // Main thread wait until back thread runs
-  latch_.Wait();
+  if (rest < record_size) {
+    // Published together with the message in Commit()
+    buffer->GetHeader(write_pos)->len = WRAP_RECORD_LEN;
+    write_pos += rest;
+  }
+
+  buffer->reserved_pos = write_pos;
+  buffer->reserving = true;
+  return reinterpret_cast<char *>(buffer->GetHeader(write_pos) + 1);
 }
 
-void AsyncLog::Stop() KANON_NOEXCEPT
+void AsyncLog::Commit(size_t len, bool binary, int64_t time) KANON_NOEXCEPT
 {
-  assert(running_);
-
-  running_ = false;
-  not_empty_.Notify();
-  back_thr_.Join();
+  // Reserve() has called GetThreadBuffer()
+  auto buffer = t_holder.buffer.get();
+  auto write_pos = buffer->reserved_pos;
+  buffer->reserving = false;
+
+  auto header = buffer->GetHeader(write_pos);
+  header->time = time ? time : TimeStamp::Now().GetMicroseconds();
+  header->len = static_cast<uint32_t>(len);
+  header->binary = binary;
+
+  write_pos += RecordSize(len);
+  buffer->write_pos.store(write_pos, std::memory_order_release);
+
+  // Wake up back thread earlier than flush interval if
+  // the buffer is over half full
+  if (write_pos - buffer->cached_read_pos > buffer->capacity / 2) {
+    NotifyBackThread(buffer);
+  }
 }
 
-void AsyncLog::Append(char const *data, size_t len) KANON_NOEXCEPT
+bool AsyncLog::HandleOverflow(ThreadBuffer *buffer, uint64_t write_pos,
+                              uint64_t need,
+                              Logger::LogLevel level) KANON_NOEXCEPT
 {
-  MutexGuard guard{mutex_};
+  // The message is larger than the buffer
+  if (need > buffer->capacity) return false;
 
-  // If there are no space for data in @var current_buffer_,
-  // swap with @var next_buffer_, and append new buffer
-  // then notify @var back_thr_ to log message
-  if (len < current_buffer_->avali()) {
-    current_buffer_->Append(data, (unsigned)len);
-  } else {
-    buffers_.emplace_back(std::move(current_buffer_));
+  if (policy_ == kDropNewest ||
+      (policy_ == kDropBelowWarn && level < Logger::KANON_LL_WARN))
+  {
+    return false;
+  }
 
-    if (!next_buffer_) {
-      next_buffer_.reset(new Buffer{});
+  if (policy_ == kDropOldest) {
+    // The back thread is reading the oldest message, discard the newest
+    // instead of overwriting it or waiting
+    if (!buffer->TryLockDiscard()) return false;
+
+    auto read_pos = buffer->read_pos.load(std::memory_order_relaxed);
+    while (write_pos + need - read_pos > buffer->capacity) {
+      // The header is written by this thread
+      const auto len = buffer->GetHeader(read_pos)->len;
+      if (len != WRAP_RECORD_LEN) buffer->AddDiscarded(len);
+      read_pos += len == WRAP_RECORD_LEN ? buffer->GetRest(read_pos)
+                                         : RecordSize(len);
     }
+    buffer->read_pos.store(read_pos, std::memory_order_relaxed);
+    buffer->UnlockDiscard();
 
-    current_buffer_ = std::move(next_buffer_);
-    assert(!next_buffer_);
-    current_buffer_->Append(data, (unsigned)len);
+    buffer->cached_read_pos = read_pos;
+    return true;
+  }
+
+  // kBlock, or the level of kDropBelowWarn is not below WARN
+  MutexGuard guard{mutex_};
+  // Don't block if the back thread isn't running
+  while (running_) {
+    buffer->cached_read_pos = buffer->read_pos.load(std::memory_order_acquire);
+    if (write_pos + need - buffer->cached_read_pos <= buffer->capacity) {
+      return true;
+    }
+
+    blocked_ = true;
+    wakeup_ = true;
     not_empty_.Notify();
+    not_full_.Wait();
   }
+  return false;
 }
 
 void AsyncLog::Flush() KANON_NOEXCEPT
 {
   // The flush operation is called in back thread
 }
+
+auto AsyncLog::GetStats() const KANON_NOEXCEPT -> Stats
+{
+  Stats stats;
+  ::memset(&stats, 0, sizeof stats);
+
+  {
+    MutexGuard guard{mutex_};
+    stats.discarded_lines = removed_discarded_lines_;
+    stats.discarded_bytes = removed_discarded_bytes_;
+    for (auto const &buffer : thread_buffers_) {
+      stats.discarded_lines +=
+          buffer->discarded_lines.load(std::memory_order_relaxed);
+      stats.discarded_bytes +=
+          buffer->discarded_bytes.load(std::memory_order_relaxed);
+      stats.pending_bytes +=
+          buffer->write_pos.load(std::memory_order_relaxed) -
+          buffer->read_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  stats.max_pending_bytes = max_pending_bytes_.load(std::memory_order_relaxed);
+  stats.write_count = write_count_.load(std::memory_order_relaxed);
+  stats.write_time_us = write_time_us_.load(std::memory_order_relaxed);
+  stats.max_write_time_us = max_write_time_us_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+auto AsyncLog::GetThreadBuffer() -> ThreadBuffer *
+{
+  if (KANON_LIKELY(t_holder.owner == id_)) {
+    return t_holder.buffer.get();
+  }
+
+  if (t_holder.buffer) {
+    t_holder.buffer->exited.store(true, std::memory_order_release);
+  }
+
+  t_holder.owner = id_;
+  t_holder.buffer = std::make_shared<ThreadBuffer>(thread_buffer_size_);
+
+  MutexGuard guard{mutex_};
+  thread_buffers_.emplace_back(t_holder.buffer);
+  return t_holder.buffer.get();
+}
+
+void AsyncLog::NotifyBackThread(ThreadBuffer *buffer) KANON_NOEXCEPT
+{
+  // Reset by back thread after the buffer is written
+  if (buffer->wakeup_pending.load(std::memory_order_relaxed)) return;
+  buffer->wakeup_pending.store(true, std::memory_order_relaxed);
+
+  MutexGuard guard{mutex_};
+  wakeup_ = true;
+  not_empty_.Notify();
+}
+
+template <typename Output>
+void AsyncLog::WriteBuffers(ThreadBuffers const &buffers, Buffer &batch,
+                            Output &output)
+{
+  // In kDropOldest, the message is read with the discard_lock held,
+  // it is skipped if the front thread has discarded it
+  const bool drop_oldest = policy_ == kDropOldest;
+
+  std::vector<Cursor> cursors;
+  cursors.reserve(buffers.size());
+  bool has_exited = false;
+  uint64_t pending_bytes = 0;
+
+  for (auto const &buffer : buffers) {
+    // Check exited before loading write_pos, then all messages of the
+    // exited thread must be written in this turn
+    if (buffer->exited.load(std::memory_order_acquire)) has_exited = true;
+
+    buffer->wakeup_pending.store(false, std::memory_order_relaxed);
+
+    Cursor cursor;
+    cursor.buffer = buffer.get();
+    cursor.committed = cursor.read_pos =
+        buffer->read_pos.load(std::memory_order_acquire);
+    cursor.write_pos = buffer->write_pos.load(std::memory_order_acquire);
+    pending_bytes += cursor.write_pos - cursor.read_pos;
+    if (drop_oldest) buffer->LockDiscard();
+    if (cursor.Resync()) cursors.push_back(cursor);
+    if (drop_oldest) buffer->UnlockDiscard();
+
+    const auto discarded_lines =
+        buffer->discarded_lines.load(std::memory_order_relaxed);
+    if (discarded_lines != buffer->reported_discarded_lines) {
+      char buf[128];
+      const auto n = ::snprintf(
+          buf, sizeof buf, "Discard %llu log messages of thread %d at %s\n",
+          (unsigned long long)(discarded_lines -
+                               buffer->reported_discarded_lines),
+          buffer->tid, TimeStamp::Now().ToFormattedString().c_str());
+      output.Append(buf, (size_t)n);
+      buffer->reported_discarded_lines = discarded_lines;
+    }
+  }
+
+  if (pending_bytes > max_pending_bytes_.load(std::memory_order_relaxed)) {
+    max_pending_bytes_.store(pending_bytes, std::memory_order_relaxed);
+  }
+
+  // Merge the messages by timestamp, the cursor of the earliest message
+  // is the top of min-heap
+  std::make_heap(cursors.begin(), cursors.end(), CursorGreater());
+
+  while (!cursors.empty()) {
+    std::pop_heap(cursors.begin(), cursors.end(), CursorGreater());
+    auto &cursor = cursors.back();
+
+    auto buffer = cursor.buffer;
+    if (drop_oldest) {
+      buffer->LockDiscard();
+      // Discarded by the front thread after it is located
+      if (buffer->read_pos.load(std::memory_order_relaxed) != cursor.committed)
+      {
+        if (cursor.Resync()) {
+          std::push_heap(cursors.begin(), cursors.end(), CursorGreater());
+        } else {
+          cursors.pop_back();
+        }
+        buffer->UnlockDiscard();
+        continue;
+      }
+    }
+
+    const auto len = cursor.header.len;
+    auto data = cursor.GetData();
+
+    // The binary log is formatted to a line in Logger's format whose
+    // length is limited by LogStream like the text one
+    if (std::max<size_t>(len, kSmallStreamSize) >= (size_t)batch.avali()) {
+      output.Append(batch.data(), batch.len());
+      batch.reset();
+    }
+
+    if (cursor.header.binary) {
+      detail::FormatBinaryLog(batch, cursor.header.time, buffer->tid,
+                              buffer->name, data, len);
+    } else {
+      batch.Append(data, len);
+    }
+
+    // Release the space to front thread as soon as possible
+    cursor.committed = cursor.read_pos += RecordSize(len);
+    buffer->read_pos.store(cursor.committed, std::memory_order_release);
+
+    const bool located = cursor.Locate();
+    if (drop_oldest) buffer->UnlockDiscard();
+
+    if (located) {
+      std::push_heap(cursors.begin(), cursors.end(), CursorGreater());
+    } else {
+      cursors.pop_back();
+    }
+  }
+
+  if (batch.len() > 0) {
+    output.Append(batch.data(), batch.len());
+    batch.reset();
+  }
+
+  if (has_exited) {
+    MutexGuard guard{mutex_};
+    // Unlike std::remove_if(), the removed ones are kept to collect stats
+    auto removed = std::partition(
+        thread_buffers_.begin(), thread_buffers_.end(),
+        [](ThreadBufferPtr const &buffer) {
+          return !buffer->exited.load(std::memory_order_relaxed) ||
+                 buffer->read_pos.load(std::memory_order_relaxed) !=
+                     buffer->write_pos.load(std::memory_order_relaxed);
+        });
+    for (auto iter = removed; iter != thread_buffers_.end(); ++iter) {
+      removed_discarded_lines_ +=
+          (*iter)->discarded_lines.load(std::memory_order_relaxed);
+      removed_discarded_bytes_ +=
+          (*iter)->discarded_bytes.load(std::memory_order_relaxed);
+    }
+    thread_buffers_.erase(removed, thread_buffers_.end());
+  }
+}
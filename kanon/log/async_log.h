@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <vector>
 #include <atomic>
+#include <memory>
 #include <limits.h>
 
 #include "kanon/util/noncopyable.h"
@@ -20,11 +21,29 @@
 #include "kanon/thread/count_down_latch.h"
 
 #include "kanon/log/logger.h"
+#include "kanon/log/log_compress_thread.h"
 
 namespace kanon {
 
+namespace detail {
+
+struct AsyncLogThreadBuffer;
+
+} // namespace detail
+
 /**
  * \brief Log message to specified devices or files asynchronously
+ *
+ * Each front thread appends to its own lock-free buffer(SPSC ring)
+ * which is registered to this when the thread appends at the first time.
+ * The back thread collects the buffers, merges the messages in them
+ * by timestamp and writes to LogFile, i.e. the messages are ordered
+ * in each turn of the back thread.
+ * If the buffer of a thread is still full after yielding to the back thread,
+ * the OverflowPolicy is applied, and the count of discarded messages
+ * is logged by the back thread. The memory is bounded by the size of
+ * thread buffer * the number of front threads.
+ *
  * \warning
  *   If main thread exits, then backthread which write message to disk will also
  * stop. Therefore, it is best that this used for such service which is
@@ -33,6 +52,27 @@ namespace kanon {
  */
 class KANON_CORE_API AsyncLog : noncopyable {
  public:
+  /**
+   * The policy when the buffer of a front thread is full
+   */
+  enum OverflowPolicy {
+    kDropNewest = 0, //!< Discard the message appended(default)
+    kDropOldest,     //!< Discard the oldest messages in the buffer, the newest
+                     //!< one is discarded if the back thread is reading
+    kBlock,          //!< Block the front thread until there is space
+    kDropBelowWarn,  //!< kDropNewest if the level is below WARN, otherwise kBlock
+  };
+
+  struct Stats {
+    uint64_t discarded_lines;
+    uint64_t discarded_bytes; //!< The length reserved if discarded in Reserve()
+    uint64_t pending_bytes;     //!< The bytes in thread buffers, i.e. queue depth
+    uint64_t max_pending_bytes; //!< The maximum seen by back thread
+    uint64_t write_count;       //!< The turns of back thread writing
+    uint64_t write_time_us;     //!< Total time spent in writing and flushing
+    uint64_t max_write_time_us;
+  };
+
   /**
    *
    * \see LogFile
@@ -43,18 +83,114 @@ class KANON_CORE_API AsyncLog : noncopyable {
 
   ~AsyncLog() KANON_NOEXCEPT;
 
+  /**
+   * The level of message is Logger::GetOutputLogLevel()
+   */
   void Append(char const *data, size_t num) KANON_NOEXCEPT;
   void Flush() KANON_NOEXCEPT;
 
+  /**
+   * Reserve space in the buffer of this thread to write a message in place,
+   * then Commit() it.
+   * \param len The maximum length of the message
+   * \param level Used for kDropBelowWarn
+   * \return NULL if the buffer is full, i.e. the message is discarded
+   */
+  char *Reserve(size_t len,
+                Logger::LogLevel level = Logger::KANON_LL_INFO) KANON_NOEXCEPT;
+
+  /**
+   * Commit the message written in the space returned by Reserve()
+   * \param len The length of message, not greater than the reserved length
+   * \param binary The message is a binary log record(see binary_log.h)
+   *               which is formatted in back thread
+   * \param time The timestamp of message in microseconds, 0 means now
+   */
+  void Commit(size_t len, bool binary = false, int64_t time = 0) KANON_NOEXCEPT;
+
   void StartRun();
   void Stop() KANON_NOEXCEPT;
 
+  /**
+   * \warning Must be called before StartRun()
+   */
+  void SetOverflowPolicy(OverflowPolicy policy) KANON_NOEXCEPT
+  {
+    assert(!running_);
+    policy_ = policy;
+  }
+
+  /**
+   * \param size The size of the buffer of each front thread(default: 4MiB),
+   *             must be power of 2 and much larger than kSmallStreamSize
+   *             since Logger reserves the maximum length of a message
+   * \warning Must be called before any message is appended
+   */
+  void SetThreadBufferSize(size_t size) KANON_NOEXCEPT
+  {
+    assert(size > 0 && (size & (size - 1)) == 0);
+    thread_buffer_size_ = size;
+  }
+
+  /**
+   * Write the log files by MmapAppendFile, i.e. the flush doesn't block
+   * the back thread
+   * \note Ignored in windows since MmapAppendFile is unix only
+   * \warning Must be called before StartRun()
+   */
+  void SetMmapOutput(bool on) KANON_NOEXCEPT
+  {
+    assert(!running_);
+#ifdef KANON_ON_UNIX
+    mmap_output_ = on;
+#else
+    KANON_UNUSED(on);
+#endif
+  }
+
+  /**
+   * Compress the rolled files in background
+   * \see LogFile::SetCompressor()
+   * \warning Must be called before StartRun()
+   */
+  void SetCompressor(std::unique_ptr<LogCompressor> compressor,
+                     size_t max_bytes_per_second =
+                         LogCompressThread::kDefaultMaxBytesPerSecond)
+  {
+    assert(!running_);
+    compressor_ = std::move(compressor);
+    compress_bytes_per_second_ = max_bytes_per_second;
+  }
+
+  Stats GetStats() const KANON_NOEXCEPT;
+
  private:
+  typedef detail::AsyncLogThreadBuffer ThreadBuffer;
+  typedef std::shared_ptr<ThreadBuffer> ThreadBufferPtr;
+  typedef std::vector<ThreadBufferPtr> ThreadBuffers;
   typedef detail::LargeFixedBuffer Buffer;
 
-  // Don't expose the FixedBuffer
-  typedef std::unique_ptr<Buffer> BufferUPtr;
-  typedef std::vector<BufferUPtr> Buffers;
+  ThreadBuffer *GetThreadBuffer();
+  void NotifyBackThread(ThreadBuffer *buffer) KANON_NOEXCEPT;
+
+  /**
+   * Apply the overflow policy when there is no space for \p need bytes
+   * \return true if there is space now
+   */
+  bool HandleOverflow(ThreadBuffer *buffer, uint64_t write_pos, uint64_t need,
+                      Logger::LogLevel level) KANON_NOEXCEPT;
+
+  //! Write the thread buffers to \p output until stopped
+  template <typename Output>
+  void BackThreadLoop(Output &output);
+
+  /**
+   * Write the messages in \p buffers to \p output in the order of timestamp
+   * \param batch The buffer to merge the messages to
+   */
+  template <typename Output>
+  void WriteBuffers(ThreadBuffers const &buffers, Buffer &batch,
+                    Output &output);
 
   // Forward parameter to LogFile
   std::string basename_;
@@ -66,21 +202,46 @@ class KANON_CORE_API AsyncLog : noncopyable {
 
   std::atomic<bool> running_;
 
-  /**
-   * use "Multiplex Buffering" technique
-   * \see "Multiplex Buffering" entry of Wikipedia
-   */
-  BufferUPtr current_buffer_;
-  BufferUPtr next_buffer_;
-  Buffers buffers_;
-  Buffers buffers_dup_;
+  //! Distinguish the thread buffers of the different AsyncLog
+  uint64_t const id_;
+
+  OverflowPolicy policy_;
+  size_t thread_buffer_size_;
+  bool mmap_output_;
+  std::unique_ptr<LogCompressor> compressor_;
+  size_t compress_bytes_per_second_;
+
+  // mutexlock used to synchronize the registration of thread buffers
+  // and the notification of back thread
+  mutable MutexLock mutex_;
+
+  //! The buffers of the front threads, a thread exited is removed
+  //! by back thread after its buffer is written
+  ThreadBuffers thread_buffers_;
+
+  //! Some thread buffer is over half full
+  bool wakeup_;
+
+  //! Some front thread is blocked by kBlock
+  bool blocked_;
 
-  // mutexlock used to synchronize front threads(i.e. writers)
-  MutexLock mutex_;
+  //! The discarded count of the buffers removed
+  uint64_t removed_discarded_lines_;
+  uint64_t removed_discarded_bytes_;
 
-  // If buffers_ is empty, back thread sleeping
+  // If no thread buffer is over half full, back thread sleeping
   Condition not_empty_;
 
+  // Front threads blocked by kBlock are sleeping until back thread
+  // writes the buffers
+  Condition not_full_;
+
+  // Stats of back thread
+  std::atomic<uint64_t> max_pending_bytes_;
+  std::atomic<uint64_t> write_count_;
+  std::atomic<uint64_t> write_time_us_;
+  std::atomic<uint64_t> max_write_time_us_;
+
   // back thread log buffer to disk
   Thread back_thr_;
 
@@ -89,6 +250,13 @@ class KANON_CORE_API AsyncLog : noncopyable {
 };
 
 /**
+ * The AsyncLog the binary log(BIN_LOG_XXX) writes to, set by SetupAsyncLog().
+ * If it is NULL, the binary log is formatted by Logger in the calling thread.
+ */
+KANON_CORE_API extern AsyncLog *g_binary_log_output;
+
+/**
+ * \param mmap_output \see AsyncLog::SetMmapOutput()
  * \warning
  *  -- construct before any logic, e.g. the first statement in main()
  */
@@ -96,10 +264,12 @@ KANON_INLINE void SetupAsyncLog(StringView basename, size_t roll_size,
                                 StringView prefix = "",
                                 size_t log_file_num = UINT_MAX,
                                 size_t roll_interval = 86400,
-                                size_t flush_interval = 3)
+                                size_t flush_interval = 3,
+                                bool mmap_output = false)
 {
   static AsyncLog al(basename, roll_size, prefix, log_file_num, roll_interval,
                      flush_interval);
+  al.SetMmapOutput(mmap_output);
 
   Logger::SetFlushCallback([]() {
     al.Flush();
@@ -109,7 +279,17 @@ KANON_INLINE void SetupAsyncLog(StringView basename, size_t roll_size,
     al.Append(data, len);
   });
 
+  // Logger formats the message in the buffer of AsyncLog directly
+  Logger::SetReserveCallback(
+      [](size_t len, Logger::LogLevel level) {
+        return al.Reserve(len, level);
+      },
+      [](size_t len, int64_t time) {
+        al.Commit(len, false, time);
+      });
+
   al.StartRun();
+  g_binary_log_output = &al;
 }
 
 } // namespace kanon
@@ -0,0 +1,148 @@
+#include "kanon/log/binary_log.h"
+
+#include <stdio.h>
+#include <time.h>
+
+namespace kanon {
+namespace detail {
+
+// The back thread cache the second like Logger
+static KANON_TLS time_t t_lastSecond = 0;
+static KANON_TLS char t_timebuf[64] = {0};
+
+static void FormatTime(LargeFixedBuffer &buffer, int64_t time) KANON_NOEXCEPT
+{
+  const time_t seconds = static_cast<time_t>(time / 1000000);
+  const auto microseconds = static_cast<int>(time % 1000000);
+
+  if (seconds != t_lastSecond) {
+    t_lastSecond = seconds;
+    struct tm tm;
+#ifdef KANON_ON_UNIX
+    ::localtime_r(&t_lastSecond, &tm);
+#else
+    ::localtime_s(&tm, &t_lastSecond);
+#endif
+
+    ::snprintf(t_timebuf, sizeof t_timebuf, "%04d%02d%02d:%02d%02d%02d.",
+               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+               tm.tm_min, tm.tm_sec);
+  }
+
+  // "YYYYmmdd:HHMMSS." + 6 digits of microseconds
+  buffer.Append(t_timebuf, 16);
+  char us_buf[7];
+  int us = microseconds;
+  for (int i = 5; i >= 0; --i) {
+    us_buf[i] = static_cast<char>('0' + us % 10);
+    us /= 10;
+  }
+  us_buf[6] = ' ';
+  buffer.Append(us_buf, sizeof us_buf);
+}
+
+template <typename T>
+static KANON_INLINE T DecodeBinaryLogValue(char const *&data) KANON_NOEXCEPT
+{
+  T x;
+  ::memcpy(&x, data, sizeof x);
+  data += sizeof x;
+  return x;
+}
+
+/**
+ * Decode an argument and append it to \p buffer
+ * \return false if the argument is broken
+ */
+static bool AppendBinaryLogArg(LargeFixedBuffer &buffer, char const *&data,
+                               char const *end) KANON_NOEXCEPT
+{
+  if (data == end) return false;
+  const auto type = static_cast<BinaryLogArgType>(*data++);
+
+  switch (type) {
+    case BLA_INT:
+      if (end - data < (ptrdiff_t)sizeof(int64_t)) return false;
+      buffer.appendInt(DecodeBinaryLogValue<int64_t>(data));
+      break;
+    case BLA_UINT:
+      if (end - data < (ptrdiff_t)sizeof(uint64_t)) return false;
+      buffer.appendInt(DecodeBinaryLogValue<uint64_t>(data));
+      break;
+    case BLA_DOUBLE:
+      if (end - data < (ptrdiff_t)sizeof(double)) return false;
+      buffer.appendFloat(DecodeBinaryLogValue<double>(data));
+      break;
+    case BLA_BOOL:
+      if (end - data < (ptrdiff_t)sizeof(bool)) return false;
+      buffer.appendBool(DecodeBinaryLogValue<bool>(data));
+      break;
+    case BLA_CHAR:
+      if (end - data < (ptrdiff_t)sizeof(char)) return false;
+      buffer.appendChar(DecodeBinaryLogValue<char>(data));
+      break;
+    case BLA_PTR:
+      if (end - data < (ptrdiff_t)sizeof(void const *)) return false;
+      buffer.appendPtr(DecodeBinaryLogValue<void const *>(data));
+      break;
+    case BLA_STRING: {
+      if (end - data < (ptrdiff_t)sizeof(uint32_t)) return false;
+      const auto len = DecodeBinaryLogValue<uint32_t>(data);
+      if (end - data < (ptrdiff_t)len) return false;
+      buffer.Append(data, len);
+      data += len;
+    } break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+void FormatBinaryLog(LargeFixedBuffer &buffer, int64_t time, int tid,
+                     StringView thread_name, char const *data, size_t len)
+{
+  auto end = data + len;
+  BinaryLogSite const *site;
+  ::memcpy(&site, data, sizeof site);
+  data += sizeof site;
+
+  // Same with the format of Logger(without color)
+  FormatTime(buffer, time);
+  buffer.appendInt(tid);
+  buffer.appendChar(' ');
+  buffer.Append(thread_name);
+  buffer.Append(" [", 2);
+  buffer.Append(Logger::GetLogLevelName(site->level));
+  buffer.Append("] ", 2);
+  if (site->level <= Logger::KANON_LL_DEBUG) {
+    buffer.Append(site->func);
+    buffer.Append("() ", 3);
+  }
+
+  // Same with the parsing of FmtStream
+  StringView fmt(site->fmt);
+  for (auto pos = fmt.find('%'); pos != StringView::npos; pos = fmt.find('%')) {
+    buffer.Append(fmt.data(), (unsigned)pos);
+
+    if (pos + 1 < fmt.size() && fmt[pos + 1] == '%') {
+      buffer.appendChar('%');
+      fmt.remove_prefix(pos + 2);
+      continue;
+    }
+
+    // The number of argument is less than the placeholder
+    if (!AppendBinaryLogArg(buffer, data, end)) buffer.appendChar('%');
+    fmt.remove_prefix(pos + 1);
+  }
+  buffer.Append(fmt);
+
+  buffer.Append(" - ", 3);
+  buffer.Append(Logger::SourceFile(site->file).basename_);
+  buffer.appendChar(':');
+  buffer.appendInt(site->line);
+  buffer.appendChar('\n');
+}
+
+} // namespace detail
+} // namespace kanon
@@ -0,0 +1,273 @@
+#ifndef KANON_LOG_BINARY_LOG_H
+#define KANON_LOG_BINARY_LOG_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+#include "kanon/util/macro.h"
+#include "kanon/string/string_view.h"
+#include "kanon/string/stream_common.h"
+
+#include "kanon/log/logger.h"
+#include "kanon/log/async_log.h"
+
+namespace kanon {
+
+/**
+ * \brief The static information of a binary log statement
+ *
+ * The address of it is the call-site id recorded in the binary log record,
+ * i.e. the format string and source location are not copied per log.
+ */
+struct BinaryLogSite {
+  constexpr BinaryLogSite(Logger::LogLevel lv, char const *f,
+                          char const *source_file, int source_line,
+                          char const *function) KANON_NOEXCEPT
+    : level(lv)
+    , fmt(f)
+    , file(source_file)
+    , line(source_line)
+    , func(function)
+  {
+  }
+
+  Logger::LogLevel level;
+  char const *fmt; //!< Same with FmtStream, i.e. '%' is the placeholder
+  char const *file;
+  int line;
+  char const *func;
+};
+
+namespace detail {
+
+enum BinaryLogArgType : uint8_t {
+  BLA_INT = 0,
+  BLA_UINT,
+  BLA_DOUBLE,
+  BLA_BOOL,
+  BLA_CHAR,
+  BLA_PTR,
+  BLA_STRING,
+};
+
+// Convert the argument to the type encoded
+template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  std::is_signed<T>::value,
+                                              int>::type = 0>
+KANON_INLINE int64_t ToBinaryLogArg(T x) KANON_NOEXCEPT
+{
+  return x;
+}
+
+template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  std::is_unsigned<T>::value,
+                                              char>::type = 0>
+KANON_INLINE uint64_t ToBinaryLogArg(T x) KANON_NOEXCEPT
+{
+  return x;
+}
+
+KANON_INLINE double ToBinaryLogArg(double x) KANON_NOEXCEPT { return x; }
+KANON_INLINE double ToBinaryLogArg(float x) KANON_NOEXCEPT { return x; }
+KANON_INLINE bool ToBinaryLogArg(bool x) KANON_NOEXCEPT { return x; }
+KANON_INLINE char ToBinaryLogArg(char x) KANON_NOEXCEPT { return x; }
+KANON_INLINE void const *ToBinaryLogArg(void const *x) KANON_NOEXCEPT
+{
+  return x;
+}
+KANON_INLINE StringView ToBinaryLogArg(char const *x) KANON_NOEXCEPT
+{
+  return x ? StringView(x) : StringView("(null)");
+}
+KANON_INLINE StringView ToBinaryLogArg(std::string const &x) KANON_NOEXCEPT
+{
+  return x;
+}
+KANON_INLINE StringView ToBinaryLogArg(StringView x) KANON_NOEXCEPT
+{
+  return x;
+}
+
+// The encoded size of the argument, i.e. type + value
+template <typename T>
+KANON_INLINE size_t BinaryLogArgSize(T) KANON_NOEXCEPT
+{
+  return 1 + sizeof(T);
+}
+
+KANON_INLINE size_t BinaryLogArgSize(StringView x) KANON_NOEXCEPT
+{
+  return 1 + sizeof(uint32_t) + x.size();
+}
+
+KANON_INLINE size_t BinaryLogArgsSize() KANON_NOEXCEPT { return 0; }
+
+template <typename Arg, typename... Args>
+KANON_INLINE size_t BinaryLogArgsSize(Arg arg, Args... args) KANON_NOEXCEPT
+{
+  return BinaryLogArgSize(arg) + BinaryLogArgsSize(args...);
+}
+
+template <typename T>
+KANON_INLINE char *EncodeBinaryLogValue(char *buf, BinaryLogArgType type,
+                                        T x) KANON_NOEXCEPT
+{
+  *buf++ = type;
+  ::memcpy(buf, &x, sizeof x);
+  return buf + sizeof x;
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, int64_t x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_INT, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, uint64_t x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_UINT, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, double x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_DOUBLE, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, bool x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_BOOL, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, char x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_CHAR, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, void const *x) KANON_NOEXCEPT
+{
+  return EncodeBinaryLogValue(buf, BLA_PTR, x);
+}
+
+KANON_INLINE char *EncodeBinaryLogArg(char *buf, StringView x) KANON_NOEXCEPT
+{
+  buf = EncodeBinaryLogValue(buf, BLA_STRING, (uint32_t)x.size());
+  ::memcpy(buf, x.data(), x.size());
+  return buf + x.size();
+}
+
+KANON_INLINE void EncodeBinaryLogArgs(char *) KANON_NOEXCEPT {}
+
+template <typename Arg, typename... Args>
+KANON_INLINE void EncodeBinaryLogArgs(char *buf, Arg arg,
+                                      Args... args) KANON_NOEXCEPT
+{
+  EncodeBinaryLogArgs(EncodeBinaryLogArg(buf, arg), args...);
+}
+
+/**
+ * Format the log in the calling thread by Logger
+ */
+template <typename... Args>
+void TextLogImpl(BinaryLogSite const &site, Args... args)
+{
+  if (site.level <= Logger::KANON_LL_DEBUG) {
+    Logger(site.file, site.line, site.level, site.func).stream()
+        << LogFmtStream(site.fmt, args...);
+  } else {
+    Logger(site.file, site.line, site.level).stream()
+        << LogFmtStream(site.fmt, args...);
+  }
+}
+
+template <typename... Args>
+void BinaryLogImpl(BinaryLogSite const &site, Args... args)
+{
+  auto output = g_binary_log_output;
+
+  // Log in the formatting of a Logger message is deferred by Logger
+  if (!output || Logger::IsReserving()) {
+    TextLogImpl(site, args...);
+    return;
+  }
+
+  // The arguments of a log line is limited by LogStream like the text one,
+  // the large one is formatted by Logger which truncates it
+  const auto args_size = BinaryLogArgsSize(args...);
+  if (args_size > (size_t)kSmallStreamSize) {
+    TextLogImpl(site, args...);
+    return;
+  }
+
+  const auto len = sizeof(BinaryLogSite const *) + args_size;
+  auto buf = output->Reserve(len, site.level);
+  if (!buf) return;
+
+  BinaryLogSite const *psite = &site;
+  ::memcpy(buf, &psite, sizeof psite);
+  EncodeBinaryLogArgs(buf + sizeof psite, args...);
+
+  output->Commit(len, true);
+}
+
+/**
+ * Format the binary log record to \p buffer in the format of Logger
+ *
+ * Called in the back thread of AsyncLog.
+ */
+void FormatBinaryLog(LargeFixedBuffer &buffer, int64_t time, int tid,
+                     StringView thread_name, char const *data, size_t len);
+
+} // namespace detail
+
+/**
+ * \brief Record the log with the arguments in binary
+ *
+ * The calling thread only records the call site and the arguments, and
+ * the back thread of AsyncLog formats them. Therefore, the cost of
+ * formatting(e.g. integer conversion, time formatting) is moved out from
+ * the calling thread.
+ *
+ * The arguments can be integer, floating point, bool, char, pointer and
+ * string(char const*, std::string, StringView), the string is copied.
+ *
+ * \see BIN_LOG_XXX, g_binary_log_output
+ */
+template <typename... Args>
+KANON_INLINE void BinaryLog(BinaryLogSite const &site, Args const &...args)
+{
+  detail::BinaryLogImpl(site, detail::ToBinaryLogArg(args)...);
+}
+
+// \note
+//   The fmt must be a string literal(or its lifetime is static)
+//   since it is formatted later.
+//   There is no FATAL since it must be flushed before abort.
+#define KANON_BIN_LOG(level, fmt, ...)                                         \
+  do {                                                                         \
+    if (kanon::Logger::GetLogLevel() <= level) {                               \
+      static constexpr kanon::BinaryLogSite kanon_bin_log_site(                \
+          level, fmt, __FILE__, __LINE__, __func__);                           \
+      kanon::BinaryLog(kanon_bin_log_site, ##__VA_ARGS__);                     \
+    }                                                                          \
+  } while (0)
+
+#define BIN_LOG_TRACE(fmt, ...)                                                \
+  KANON_BIN_LOG(kanon::Logger::KANON_LL_TRACE, fmt, ##__VA_ARGS__)
+
+#define BIN_LOG_DEBUG(fmt, ...)                                                \
+  KANON_BIN_LOG(kanon::Logger::KANON_LL_DEBUG, fmt, ##__VA_ARGS__)
+
+#define BIN_LOG_INFO(fmt, ...)                                                 \
+  KANON_BIN_LOG(kanon::Logger::KANON_LL_INFO, fmt, ##__VA_ARGS__)
+
+#define BIN_LOG_WARN(fmt, ...)                                                 \
+  KANON_BIN_LOG(kanon::Logger::KANON_LL_WARN, fmt, ##__VA_ARGS__)
+
+#define BIN_LOG_ERROR(fmt, ...)                                                \
+  KANON_BIN_LOG(kanon::Logger::KANON_LL_ERROR, fmt, ##__VA_ARGS__)
+
+} // namespace kanon
+
+#endif // KANON_LOG_BINARY_LOG_H
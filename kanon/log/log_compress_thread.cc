@@ -0,0 +1,193 @@
+#include "kanon/log/log_compress_thread.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#ifdef KANON_ON_UNIX
+#  include <fcntl.h>
+#endif
+
+#ifdef KANON_ON_LINUX
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include "kanon/thread/current_thread.h"
+
+#include "kanon/log/logger.h"
+
+/* The size of chunk read and compressed at once */
+#define LOG_COMPRESS_CHUNK_SIZE (64 * 1024)
+
+namespace kanon {
+
+constexpr size_t LogCompressThread::kDefaultMaxBytesPerSecond;
+
+LogCompressThread::LogCompressThread(std::unique_ptr<LogCompressor> compressor,
+                                     size_t max_bytes_per_second)
+  : compressor_(std::move(compressor))
+  , max_bytes_per_second_(max_bytes_per_second)
+  , cond_(mutex_)
+  , quit_(false)
+  , thr_("LogCompress")
+{
+  assert(compressor_ && max_bytes_per_second_ > 0);
+  thr_.StartRun([this]() {
+    Run();
+  });
+}
+
+LogCompressThread::~LogCompressThread() KANON_NOEXCEPT
+{
+  {
+    MutexGuard guard(mutex_);
+    quit_ = true;
+    cond_.Notify();
+  }
+  thr_.Join();
+}
+
+void LogCompressThread::Push(std::string filename)
+{
+  MutexGuard guard(mutex_);
+  files_.emplace_back(std::move(filename));
+  cond_.Notify();
+}
+
+void LogCompressThread::Run()
+{
+#ifdef KANON_ON_LINUX
+  // The priority of this thread only in linux
+  ::setpriority(PRIO_PROCESS, CurrentThread::tid(), 19);
+  // IOPRIO_WHO_PROCESS, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0)
+  ::syscall(SYS_ioprio_set, 1, CurrentThread::tid(), 3 << 13);
+#endif
+
+  for (;;) {
+    std::string filename;
+    {
+      MutexGuard guard(mutex_);
+      while (files_.empty() && !quit_) {
+        cond_.Wait();
+      }
+
+      if (quit_) break;
+      filename = std::move(files_.front());
+      files_.pop_front();
+    }
+
+    CompressFile(filename);
+  }
+}
+
+bool LogCompressThread::CompressFile(std::string const &filename)
+{
+  const std::string compressed_filename = filename + compressor_->GetSuffix();
+  // The incomplete one is not seen as the compressed file
+  const std::string tmp_filename = compressed_filename + ".tmp";
+
+  FILE *src = ::fopen(filename.c_str(), "rb");
+  if (!src) {
+    // Removed by LogFile
+    if (errno == ENOENT) return false;
+    ::fprintf(stderr, "LogCompressThread: failed to open %s: %s\n",
+              filename.c_str(), strerror_tl(errno));
+    return false;
+  }
+
+  FILE *dst = ::fopen(tmp_filename.c_str(), "wb");
+  if (!dst) {
+    ::fprintf(stderr, "LogCompressThread: failed to open %s: %s\n",
+              tmp_filename.c_str(), strerror_tl(errno));
+    ::fclose(src);
+    return false;
+  }
+
+#ifdef KANON_ON_UNIX
+  ::posix_fadvise(::fileno(src), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  compressor_->Reset();
+
+  std::unique_ptr<char[]> chunk(new char[LOG_COMPRESS_CHUNK_SIZE]);
+  std::string output;
+  size_t read_bytes = 0;
+  bool ok = true;
+  const auto start = std::chrono::steady_clock::now();
+
+  for (bool finish = false; !finish;) {
+    const auto n = ::fread(chunk.get(), 1, LOG_COMPRESS_CHUNK_SIZE, src);
+    finish = n < LOG_COMPRESS_CHUNK_SIZE;
+    if (finish && ::ferror(src)) {
+      ok = false;
+      break;
+    }
+
+#ifdef KANON_ON_UNIX
+    // Don't evict the pages of the live log file
+    ::posix_fadvise(::fileno(src), read_bytes, n, POSIX_FADV_DONTNEED);
+#endif
+    read_bytes += n;
+
+    output.clear();
+    compressor_->Compress(chunk.get(), n, finish, output);
+    if (::fwrite(output.data(), 1, output.size(), dst) != output.size()) {
+      ok = false;
+      break;
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (!Throttle(read_bytes, elapsed.count())) {
+      ok = false;
+      break;
+    }
+  }
+
+  ::fclose(src);
+  if (::fclose(dst) != 0) ok = false;
+
+  if (!ok) {
+    ::remove(tmp_filename.c_str());
+    return false;
+  }
+
+  if (::rename(tmp_filename.c_str(), compressed_filename.c_str()) != 0) {
+    ::remove(tmp_filename.c_str());
+    return false;
+  }
+
+  // If the file is removed by LogFile in compressing,
+  // the compressed one should be removed also
+  if (::remove(filename.c_str()) != 0 && errno == ENOENT) {
+    ::remove(compressed_filename.c_str());
+  }
+  return true;
+}
+
+bool LogCompressThread::Throttle(size_t read_bytes, double elapsed_seconds)
+{
+  const double expected_seconds =
+      (double)read_bytes / (double)max_bytes_per_second_;
+  if (expected_seconds <= elapsed_seconds) return true;
+
+  const auto deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(expected_seconds - elapsed_seconds));
+
+  // The cond_ is also notified by Push(), wait until the deadline
+  MutexGuard guard(mutex_);
+  while (!quit_) {
+    const std::chrono::duration<double> rest =
+        deadline - std::chrono::steady_clock::now();
+    if (rest.count() <= 0) break;
+    cond_.WaitForSeconds(rest.count());
+  }
+  return !quit_;
+}
+
+} // namespace kanon
@@ -0,0 +1,74 @@
+#ifndef KANON_LOG_LOG_COMPRESS_THREAD_H
+#define KANON_LOG_LOG_COMPRESS_THREAD_H
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "kanon/util/macro.h"
+#include "kanon/util/noncopyable.h"
+#include "kanon/thread/condition.h"
+#include "kanon/thread/mutex_lock.h"
+#include "kanon/thread/thread.h"
+
+#include "kanon/log/log_compressor.h"
+
+namespace kanon {
+
+/**
+ * \brief Compress the files in a background thread
+ *
+ * The file is compressed to filename + suffix of compressor, then it is
+ * removed. To not compete with the thread writing log:
+ *  - The thread is in the lowest priority(in linux, nice 19 and the idle
+ *    I/O class, i.e. it does I/O only when the disk is idle)
+ *  - The speed of reading file is limited
+ *  - The pages of the file read are dropped from page cache
+ *
+ * \note
+ *   The files are pushed by LogFile when it rolls(\see LogFile::SetCompressor())
+ *   The files pending are not compressed when stopped.
+ */
+class LogCompressThread : noncopyable {
+ public:
+  //! The default max speed of reading file in bytes per second
+  static constexpr size_t kDefaultMaxBytesPerSecond = 8 << 20;
+
+  KANON_CORE_API
+  LogCompressThread(std::unique_ptr<LogCompressor> compressor,
+                    size_t max_bytes_per_second = kDefaultMaxBytesPerSecond);
+
+  //! Stop the thread, the file being compressed is abandoned
+  KANON_CORE_API ~LogCompressThread() KANON_NOEXCEPT;
+
+  //! Compress the file(closed) in background
+  KANON_CORE_API void Push(std::string filename);
+
+  char const *GetSuffix() const KANON_NOEXCEPT
+  {
+    return compressor_->GetSuffix();
+  }
+
+ private:
+  void Run();
+
+  //! \return false if failed or stopped
+  bool CompressFile(std::string const &filename);
+
+  //! Sleep to keep the speed, \return false if stopped
+  bool Throttle(size_t read_bytes, double elapsed_seconds);
+
+  std::unique_ptr<LogCompressor> compressor_;
+  size_t max_bytes_per_second_;
+
+  MutexLock mutex_;
+  Condition cond_;
+  std::deque<std::string> files_;
+  bool quit_;
+
+  Thread thr_;
+};
+
+} // namespace kanon
+
+#endif // KANON_LOG_LOG_COMPRESS_THREAD_H
@@ -0,0 +1,302 @@
+#include "kanon/log/log_compressor.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+/* The size of LZ77 sliding window, also the max distance of match */
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_MIN_MATCH   3
+#define DEFLATE_MAX_MATCH   258
+#define DEFLATE_HASH_BITS   15
+
+namespace kanon {
+
+namespace {
+
+/**
+ * The tables of the fixed huffman codes(RFC 1951 3.2.6).
+ * The codes are reversed since the bits are packed from LSB but the huffman
+ * codes are packed from MSB.
+ */
+struct DeflateTables {
+  DeflateTables() KANON_NOEXCEPT;
+
+  uint16_t lit_code[288];
+  uint8_t lit_bits[288];
+  uint8_t dist_code[30];
+
+  uint8_t len_index[DEFLATE_MAX_MATCH + 1]; //!< Length -> index of length base
+  uint8_t dist_index[DEFLATE_WINDOW_SIZE + 1]; //!< Distance -> distance code
+
+  uint32_t crc[256];
+};
+
+static uint16_t const kLenBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static uint8_t const kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                      1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                      4, 4, 4, 4, 5, 5, 5, 5, 0};
+static uint16_t const kDistBase[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+static uint8_t const kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                       4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                       9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t ReverseBits(uint32_t code, int n) KANON_NOEXCEPT
+{
+  uint32_t ret = 0;
+  for (int i = 0; i < n; ++i) {
+    ret = (ret << 1) | (code & 1);
+    code >>= 1;
+  }
+  return ret;
+}
+
+DeflateTables::DeflateTables() KANON_NOEXCEPT
+{
+  for (int i = 0; i < 288; ++i) {
+    uint32_t code;
+    int bits;
+    if (i < 144) {
+      code = 0x30 + i;
+      bits = 8;
+    } else if (i < 256) {
+      code = 0x190 + (i - 144);
+      bits = 9;
+    } else if (i < 280) {
+      code = i - 256;
+      bits = 7;
+    } else {
+      code = 0xc0 + (i - 280);
+      bits = 8;
+    }
+    lit_code[i] = ReverseBits(code, bits);
+    lit_bits[i] = bits;
+  }
+
+  for (int i = 0; i < 30; ++i) {
+    dist_code[i] = ReverseBits(i, 5);
+  }
+
+  for (int i = 0; i < 29; ++i) {
+    const int end = i == 28 ? DEFLATE_MAX_MATCH + 1 : kLenBase[i + 1];
+    for (int len = kLenBase[i]; len < end; ++len) {
+      len_index[len] = i;
+    }
+  }
+
+  for (int i = 0; i < 30; ++i) {
+    const int end = i == 29 ? DEFLATE_WINDOW_SIZE + 1 : kDistBase[i + 1];
+    for (int dist = kDistBase[i]; dist < end; ++dist) {
+      dist_index[dist] = i;
+    }
+  }
+
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    }
+    crc[i] = c;
+  }
+}
+
+static DeflateTables const &GetDeflateTables() KANON_NOEXCEPT
+{
+  static DeflateTables tables;
+  return tables;
+}
+
+static uint32_t Crc32(uint32_t crc, char const *data, size_t len) KANON_NOEXCEPT
+{
+  auto const &tables = GetDeflateTables();
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = tables.crc[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+} // namespace
+
+GzipCompressor::GzipCompressor(int max_chain)
+  : max_chain_(max_chain)
+  , head_(1 << DEFLATE_HASH_BITS)
+  , prev_(DEFLATE_WINDOW_SIZE)
+{
+  Reset();
+}
+
+GzipCompressor::~GzipCompressor() KANON_NOEXCEPT = default;
+
+void GzipCompressor::Reset()
+{
+  window_.clear();
+  window_pos_ = 0;
+  // The stale positions must be cleared,
+  // otherwise they may be considered in the window
+  std::fill(head_.begin(), head_.end(), -1);
+  std::fill(prev_.begin(), prev_.end(), -1);
+  bit_buf_ = 0;
+  bit_count_ = 0;
+  crc_ = 0;
+  size_ = 0;
+  header_written_ = false;
+}
+
+void GzipCompressor::Compress(char const *data, size_t len, bool finish,
+                              std::string &output)
+{
+  if (!header_written_) {
+    // ID1 ID2 CM(deflate) FLG MTIME(4) XFL OS(unix)
+    static char const header[] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3};
+    output.append(header, sizeof header);
+    header_written_ = true;
+  }
+
+  crc_ = Crc32(crc_, data, len);
+  size_ += (uint32_t)len;
+
+  // Keep the history of 32K only
+  if (window_.size() > DEFLATE_WINDOW_SIZE) {
+    const auto drop = window_.size() - DEFLATE_WINDOW_SIZE;
+    window_.erase(0, drop);
+    window_pos_ += drop;
+  }
+
+  size_t i = window_.size();
+  window_.append(data, len);
+  const size_t end = window_.size();
+
+  // BFINAL, BTYPE = 01(fixed huffman)
+  PutBits(finish ? 1 : 0, 1, output);
+  PutBits(1, 2, output);
+
+  char const *const base = window_.data();
+  while (i < end) {
+    int best_len = 0;
+    int best_dist = 0;
+
+    if (end - i >= DEFLATE_MIN_MATCH) {
+      char const *p = base + i;
+      const int max_len = (int)std::min<size_t>(DEFLATE_MAX_MATCH, end - i);
+      const int64_t pos = window_pos_ + (int64_t)i;
+      int64_t candidate = head_[Hash(p)];
+
+      for (int chain = max_chain_;
+           candidate >= 0 && pos - candidate <= DEFLATE_WINDOW_SIZE &&
+           chain > 0;
+           --chain)
+      {
+        char const *q = base + (candidate - window_pos_);
+        // The match must be longer than the best one
+        if (q[best_len] == p[best_len] && q[0] == p[0]) {
+          int match_len = 1;
+          while (match_len < max_len && q[match_len] == p[match_len]) {
+            ++match_len;
+          }
+
+          if (match_len > best_len) {
+            best_len = match_len;
+            best_dist = (int)(pos - candidate);
+            if (match_len == max_len) break;
+          }
+        }
+        candidate = prev_[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+      }
+    }
+
+    if (best_len >= DEFLATE_MIN_MATCH) {
+      PutMatch(best_len, best_dist, output);
+      for (const size_t match_end = i + best_len; i < match_end; ++i) {
+        if (end - i >= DEFLATE_MIN_MATCH) InsertHash(window_pos_ + i);
+      }
+    } else {
+      PutLiteral(base[i], output);
+      if (end - i >= DEFLATE_MIN_MATCH) InsertHash(window_pos_ + i);
+      ++i;
+    }
+  }
+
+  // End of block
+  PutBits(GetDeflateTables().lit_code[256], GetDeflateTables().lit_bits[256],
+          output);
+
+  if (finish) {
+    // Pad the last byte
+    while (bit_count_ > 0) {
+      output.push_back((char)(bit_buf_ & 0xff));
+      bit_buf_ >>= 8;
+      bit_count_ -= std::min(bit_count_, 8);
+    }
+    bit_buf_ = 0;
+
+    // CRC32 ISIZE(little endian)
+    for (int k = 0; k < 4; ++k) {
+      output.push_back((char)((crc_ >> (8 * k)) & 0xff));
+    }
+    for (int k = 0; k < 4; ++k) {
+      output.push_back((char)((size_ >> (8 * k)) & 0xff));
+    }
+  }
+}
+
+void GzipCompressor::PutBits(uint32_t bits, int n, std::string &output)
+{
+  bit_buf_ |= (uint64_t)bits << bit_count_;
+  bit_count_ += n;
+  if (bit_count_ >= 32) {
+    char buf[4];
+    for (int k = 0; k < 4; ++k) {
+      buf[k] = (char)((bit_buf_ >> (8 * k)) & 0xff);
+    }
+    output.append(buf, 4);
+    bit_buf_ >>= 32;
+    bit_count_ -= 32;
+  }
+}
+
+void GzipCompressor::PutLiteral(unsigned char c, std::string &output)
+{
+  auto const &tables = GetDeflateTables();
+  PutBits(tables.lit_code[c], tables.lit_bits[c], output);
+}
+
+void GzipCompressor::PutMatch(int len, int dist, std::string &output)
+{
+  auto const &tables = GetDeflateTables();
+
+  const int len_index = tables.len_index[len];
+  const int len_sym = 257 + len_index;
+  PutBits(tables.lit_code[len_sym], tables.lit_bits[len_sym], output);
+  if (kLenExtra[len_index]) {
+    PutBits(len - kLenBase[len_index], kLenExtra[len_index], output);
+  }
+
+  const int dist_index = tables.dist_index[dist];
+  PutBits(tables.dist_code[dist_index], 5, output);
+  if (kDistExtra[dist_index]) {
+    PutBits(dist - kDistBase[dist_index], kDistExtra[dist_index], output);
+  }
+}
+
+uint32_t GzipCompressor::Hash(char const *p) const KANON_NOEXCEPT
+{
+  const uint32_t v = (uint32_t)(unsigned char)p[0] |
+                     ((uint32_t)(unsigned char)p[1] << 8) |
+                     ((uint32_t)(unsigned char)p[2] << 16);
+  return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+void GzipCompressor::InsertHash(int64_t pos) KANON_NOEXCEPT
+{
+  const auto h = Hash(window_.data() + (pos - window_pos_));
+  prev_[pos & (DEFLATE_WINDOW_SIZE - 1)] = head_[h];
+  head_[h] = pos;
+}
+
+} // namespace kanon
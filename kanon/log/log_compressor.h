@@ -0,0 +1,95 @@
+#ifndef KANON_LOG_LOG_COMPRESSOR_H
+#define KANON_LOG_LOG_COMPRESSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kanon/util/macro.h"
+#include "kanon/util/noncopyable.h"
+
+namespace kanon {
+
+/**
+ * \brief Compress a stream chunk by chunk
+ *
+ * Used by LogFile to compress the rolled files(\see LogFile::SetCompressor()).
+ * Implement it to plug another compression algorithm in.
+ */
+class KANON_CORE_API LogCompressor : noncopyable {
+ public:
+  LogCompressor() = default;
+  virtual ~LogCompressor() KANON_NOEXCEPT = default;
+
+  //! The suffix of the compressed file, e.g. ".gz"
+  virtual char const *GetSuffix() const KANON_NOEXCEPT = 0;
+
+  //! Start a new stream
+  virtual void Reset() = 0;
+
+  /**
+   * Compress the next chunk of stream
+   *
+   * \param data The chunk
+   * \param len The length of chunk, it can be zero
+   * \param finish true if this is the last chunk
+   * \param output The compressed data is appended to it
+   */
+  virtual void Compress(char const *data, size_t len, bool finish,
+                        std::string &output) = 0;
+};
+
+/**
+ * \brief The gzip(RFC 1952) compressor
+ *
+ * The deflate(RFC 1951) stream is compressed by LZ77 with the hash chain
+ * and the fixed huffman codes, i.e. no any dependency but the ratio is
+ * less than zlib. Each chunk is a block, and the history of 32K is kept
+ * between chunks.
+ *
+ * The output can be decompressed by gzip, zcat, etc.
+ */
+class KANON_CORE_API GzipCompressor : public LogCompressor {
+ public:
+  /**
+   * \param max_chain The max length of hash chain is searched to find the
+   *                  longest match, the larger, the better ratio but slower
+   */
+  explicit GzipCompressor(int max_chain = 16);
+  ~GzipCompressor() KANON_NOEXCEPT override;
+
+  char const *GetSuffix() const KANON_NOEXCEPT override { return ".gz"; }
+
+  void Reset() override;
+  void Compress(char const *data, size_t len, bool finish,
+                std::string &output) override;
+
+ private:
+  void PutBits(uint32_t bits, int n, std::string &output);
+  void PutLiteral(unsigned char c, std::string &output);
+  void PutMatch(int len, int dist, std::string &output);
+
+  uint32_t Hash(char const *p) const KANON_NOEXCEPT;
+  void InsertHash(int64_t pos) KANON_NOEXCEPT;
+
+  int max_chain_;
+
+  std::string window_;  //!< The history(at most 32K) + the current chunk
+  int64_t window_pos_;  //!< The position of window_[0] in the stream
+  std::vector<int64_t> head_; //!< Hash -> the latest position
+  std::vector<int64_t> prev_; //!< Position & (32K - 1) -> the previous one
+
+  uint64_t bit_buf_;
+  int bit_count_;
+
+  uint32_t crc_;
+  uint32_t size_; //!< The size of input modulo 2^32
+  bool header_written_;
+};
+
+} // namespace kanon
+
+#endif // KANON_LOG_LOG_COMPRESSOR_H
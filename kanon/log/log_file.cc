@@ -2,8 +2,8 @@
 
 namespace kanon {
 
-template <bool T>
-LogFile<T>::LogFile(StringView basename, size_t roll_size, StringView prefix,
+template <bool T, typename F>
+LogFile<T, F>::LogFile(StringView basename, size_t roll_size, StringView prefix,
                     size_t log_file_num, size_t roll_interval,
                     size_t flush_interval)
   : basename_(basename.ToString())
@@ -37,6 +37,9 @@ LogFile<T>::LogFile(StringView basename, size_t roll_size, StringView prefix,
 
         for (auto log_file : log_files_dup_) {
           ::remove(log_file.c_str());
+          if (compress_thr_) {
+            ::remove((log_file + compress_thr_->GetSuffix()).c_str());
+          }
         }
         log_files_dup_.clear();
       }
@@ -44,8 +47,8 @@ LogFile<T>::LogFile(StringView basename, size_t roll_size, StringView prefix,
   }
 }
 
-template <bool T>
-KANON_INLINE LogFile<T>::~LogFile() KANON_NOEXCEPT
+template <bool T, typename F>
+KANON_INLINE LogFile<T, F>::~LogFile() KANON_NOEXCEPT
 {
   if (log_file_num_ != UINT_MAX) {
     quit_remove_thr_ = true;
@@ -55,8 +58,8 @@ KANON_INLINE LogFile<T>::~LogFile() KANON_NOEXCEPT
   }
 }
 
-template <bool T>
-void LogFile<T>::Append(char const *data, size_t num) KANON_NOEXCEPT
+template <bool T, typename F>
+void LogFile<T, F>::Append(char const *data, size_t num) KANON_NOEXCEPT
 {
   KANON_MUTEX_LOCKTYPE_GUARD(MutexPolicy, lock_);
 
@@ -95,15 +98,15 @@ void LogFile<T>::Append(char const *data, size_t num) KANON_NOEXCEPT
   }
 }
 
-template <bool T>
-void LogFile<T>::Flush() KANON_NOEXCEPT
+template <bool T, typename F>
+void LogFile<T, F>::Flush() KANON_NOEXCEPT
 {
   MutexGuardT<MutexPolicy> guard(lock_);
   file_->Flush();
 }
 
-template <bool T>
-void LogFile<T>::RollFile()
+template <bool T, typename F>
+void LogFile<T, F>::RollFile()
 {
   time_t now = ::time(NULL);
   time_t new_start_period = now / roll_interval_;
@@ -114,13 +117,18 @@ void LogFile<T>::RollFile()
     last_flush_ = now;
     start_of_period_ = new_start_period;
 
-    file_.reset(new AppendFile(filename));
+    file_.reset(new F(filename));
+
+    // The previous file is closed now
+    if (compress_thr_ && !log_files_.empty()) {
+      compress_thr_->Push(log_files_.back());
+    }
     log_files_.emplace_back(filename);
   }
 }
 
-template <bool T>
-std::string LogFile<T>::GetLogFilename(time_t &now)
+template <bool T, typename F>
+std::string LogFile<T, F>::GetLogFilename(time_t &now)
 {
   // Log file name format:
   // basename.timestamp.pid.hostname.log
@@ -161,4 +169,13 @@ template class KANON_CORE_API LogFile<>;
 template KANON_CORE_API void SetupLogFile<true>(LogFile<true> &lf);
 template KANON_CORE_API void SetupLogFile<false>(LogFile<false> &lf);
 
+#ifdef KANON_ON_UNIX
+template class KANON_CORE_API LogFile<true, MmapAppendFile>;
+template class KANON_CORE_API LogFile<false, MmapAppendFile>;
+template KANON_CORE_API void
+SetupLogFile<true>(LogFile<true, MmapAppendFile> &lf);
+template KANON_CORE_API void
+SetupLogFile<false>(LogFile<false, MmapAppendFile> &lf);
+#endif
+
 } // namespace kanon
@@ -21,15 +21,19 @@
 
 #include "kanon/log/logger.h"
 #include "kanon/log/append_file.h"
+#include "kanon/log/mmap_append_file.h"
+#include "kanon/log/log_compress_thread.h"
 
 namespace kanon {
 
 /**
  * \brief Append log to file
  *
+ * \tparam File AppendFile(FILE* with buffer) or MmapAppendFile(the flush
+ *              doesn't block)
  * \note should be used by Logger
  */
-template <bool ThreadSafe = false>
+template <bool ThreadSafe = false, typename File = AppendFile>
 class LogFile : noncopyable {
  public:
   /**
@@ -51,6 +55,21 @@ class LogFile : noncopyable {
   void Append(char const *data, size_t num) KANON_NOEXCEPT;
   void Flush() KANON_NOEXCEPT;
 
+  /**
+   * Compress the rolled files in a background thread, the compressed file
+   * is filename + suffix of compressor(\see LogCompressThread)
+   * \param compressor e.g. GzipCompressor
+   * \param max_bytes_per_second The max speed of reading the rolled file
+   * \warning Must be called before any log is appended
+   */
+  void SetCompressor(std::unique_ptr<LogCompressor> compressor,
+                     size_t max_bytes_per_second =
+                         LogCompressThread::kDefaultMaxBytesPerSecond)
+  {
+    compress_thr_.reset(
+        new LogCompressThread(std::move(compressor), max_bytes_per_second));
+  }
+
  private:
   void RollFile();
   std::string GetLogFilename(time_t &now);
@@ -75,7 +94,7 @@ class LogFile : noncopyable {
       typename std::conditional<ThreadSafe, MutexLock, DummyMutexLock>::type;
 
   MutexPolicy lock_;
-  std::unique_ptr<AppendFile> file_;
+  std::unique_ptr<File> file_;
 
   std::string prefix_; //!< directory that store log file
 
@@ -87,11 +106,13 @@ class LogFile : noncopyable {
   MutexLock remove_mtx_;
   bool quit_remove_thr_;
 
+  std::unique_ptr<LogCompressThread> compress_thr_;
+
   static constexpr uint32_t kRollPerSeconds_ = 24 * 60 * 60; // or 86400
 };
 
-template <bool ThreadSafe>
-void SetupLogFile(LogFile<ThreadSafe> &lf)
+template <bool ThreadSafe, typename File>
+void SetupLogFile(LogFile<ThreadSafe, File> &lf)
 {
   Logger::SetOutputCallback([&lf](char const *data, size_t num) {
     lf.Append(data, num);
@@ -0,0 +1,180 @@
+#ifndef KANON_LOG_LOG_LIMIT_H
+#define KANON_LOG_LOG_LIMIT_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "kanon/util/macro.h"
+
+#include "kanon/log/logger.h"
+
+namespace kanon {
+namespace detail {
+
+/**
+ * \brief The state of a call site of LOG_RATE_LIMITED()
+ *
+ * At most n lines are emitted per second, the count of lines suppressed
+ * is put in the next line emitted.
+ * It is lock-free and the race of threads is tolerated, i.e. the limit
+ * is approximate in the boundary of second.
+ */
+class LogRateLimitSite {
+ public:
+  constexpr LogRateLimitSite() KANON_NOEXCEPT
+    : second_(0)
+    , count_(0)
+    , suppressed_(0)
+  {
+  }
+
+  //! \return true if the line can be emitted
+  bool Acquire(uint32_t n) KANON_NOEXCEPT
+  {
+    // time() is cheap in linux(vDSO and no syscall)
+    const int64_t now = ::time(nullptr);
+    auto second = second_.load(std::memory_order_relaxed);
+
+    if (KANON_UNLIKELY(now != second) &&
+        second_.compare_exchange_strong(second, now,
+                                        std::memory_order_relaxed))
+    {
+      const auto count = count_.exchange(0, std::memory_order_relaxed);
+      if (count > n) {
+        suppressed_.fetch_add(count - n, std::memory_order_relaxed);
+      }
+    }
+
+    return count_.fetch_add(1, std::memory_order_relaxed) < n;
+  }
+
+  //! The count of lines suppressed since last emitted
+  uint64_t TakeSuppressed() KANON_NOEXCEPT
+  {
+    return suppressed_.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> second_;
+  std::atomic<uint64_t> count_; //!< Including the suppressed in this second
+  std::atomic<uint64_t> suppressed_;
+};
+
+/**
+ * \brief The state of a call site of LOG_EVERY_N()
+ *
+ * The 1st, (n+1)th, (2n+1)th... lines are emitted
+ */
+class LogSampleSite {
+ public:
+  constexpr LogSampleSite() KANON_NOEXCEPT : count_(0) {}
+
+  bool Acquire(uint64_t n) KANON_NOEXCEPT
+  {
+    return count_.fetch_add(1, std::memory_order_relaxed) % n == 0;
+  }
+
+ private:
+  std::atomic<uint64_t> count_;
+};
+
+//! Output "(suppressed n lines) " if n > 0
+struct LogSuppressed {
+  explicit LogSuppressed(uint64_t n) KANON_NOEXCEPT : num(n) {}
+
+  uint64_t num;
+};
+
+KANON_INLINE LogStream &operator<<(LogStream &stream,
+                                   LogSuppressed suppressed) KANON_NOEXCEPT
+{
+  if (suppressed.num != 0) {
+    stream << "(suppressed " << suppressed.num << " lines) ";
+  }
+  return stream;
+}
+
+} // namespace detail
+} // namespace kanon
+
+// \note
+//   The state is the static variable of a lambda, i.e. per call site
+//   (per instantiation in the template), and it is initialized in
+//   compile time, i.e. no guard is checked.
+#define KANON_LOG_SITE(type)                                                   \
+  [] {                                                                         \
+    static type kanon_log_site_state;                                          \
+    return &kanon_log_site_state;                                              \
+  }()
+
+/**
+ * At most n lines per second are emitted by this call site,
+ * e.g. LOG_RATE_LIMITED(LOG_WARN, 10) << "xxx";
+ * \param log The logging macro, e.g. LOG_WARN, LOG_SYSERROR_KANON
+ */
+#define LOG_RATE_LIMITED(log, n)                                               \
+  if (kanon::detail::LogRateLimitSite *kanon_log_site =                        \
+          KANON_LOG_SITE(kanon::detail::LogRateLimitSite))                     \
+    if (kanon_log_site->Acquire(n))                                            \
+  log << kanon::detail::LogSuppressed(kanon_log_site->TakeSuppressed())
+
+/**
+ * 1 in n lines is emitted by this call site,
+ * e.g. LOG_EVERY_N(LOG_INFO, 100) << "xxx";
+ * \param log The logging macro, e.g. LOG_INFO, LOG_DEBUG_KANON
+ */
+#define LOG_EVERY_N(log, n)                                                    \
+  if (KANON_LOG_SITE(kanon::detail::LogSampleSite)->Acquire(n)) log
+
+// Check the log level first, then the disabled ones don't touch the state
+#define LOG_TRACE_RATE_LIMITED(n)                                              \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_TRACE)           \
+  LOG_RATE_LIMITED(LOG_TRACE, n)
+
+#define LOG_DEBUG_RATE_LIMITED(n)                                              \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_DEBUG)           \
+  LOG_RATE_LIMITED(LOG_DEBUG, n)
+
+#define LOG_INFO_RATE_LIMITED(n)                                               \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_INFO)            \
+  LOG_RATE_LIMITED(LOG_INFO, n)
+
+#define LOG_WARN_RATE_LIMITED(n)                                               \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_WARN)            \
+  LOG_RATE_LIMITED(LOG_WARN, n)
+
+#define LOG_ERROR_RATE_LIMITED(n)                                              \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_ERROR)           \
+  LOG_RATE_LIMITED(LOG_ERROR, n)
+
+#define LOG_SYSERROR_RATE_LIMITED(n)                                           \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_SYS_ERROR)       \
+  LOG_RATE_LIMITED(LOG_SYSERROR, n)
+
+#define LOG_TRACE_EVERY_N(n)                                                   \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_TRACE)           \
+  LOG_EVERY_N(LOG_TRACE, n)
+
+#define LOG_DEBUG_EVERY_N(n)                                                   \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_DEBUG)           \
+  LOG_EVERY_N(LOG_DEBUG, n)
+
+#define LOG_INFO_EVERY_N(n)                                                    \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_INFO)            \
+  LOG_EVERY_N(LOG_INFO, n)
+
+#define LOG_WARN_EVERY_N(n)                                                    \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_WARN)            \
+  LOG_EVERY_N(LOG_WARN, n)
+
+#define LOG_ERROR_EVERY_N(n)                                                   \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_ERROR)           \
+  LOG_EVERY_N(LOG_ERROR, n)
+
+#define LOG_SYSERROR_EVERY_N(n)                                                \
+  if (kanon::Logger::GetLogLevel() <= kanon::Logger::KANON_LL_SYS_ERROR)       \
+  LOG_EVERY_N(LOG_SYSERROR, n)
+
+#endif // KANON_LOG_LOG_LIMIT_H
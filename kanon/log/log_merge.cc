@@ -0,0 +1,134 @@
+#include "kanon/log/log_merge.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <memory>
+#include <queue>
+
+namespace kanon {
+
+// YYYYmmdd:HHMMSS.uuuuuu
+#define LOG_TIMESTAMP_LENGTH 22
+
+static bool StartsWithTimestamp(std::string const &line) KANON_NOEXCEPT
+{
+  if (line.size() < LOG_TIMESTAMP_LENGTH) return false;
+
+  for (int i = 0; i < LOG_TIMESTAMP_LENGTH; ++i) {
+    const char c = line[i];
+    if (i == 8) {
+      if (c != ':') return false;
+    } else if (i == 15) {
+      if (c != '.') return false;
+    } else if (!isdigit((unsigned char)c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+/**
+ * Read the logs of a file one by one
+ */
+class LogReader {
+ public:
+  explicit LogReader(std::string const &filename)
+    : in_(filename, std::ios::binary)
+    , has_line_(false)
+  {
+  }
+
+  bool IsOpen() const KANON_NOEXCEPT { return in_.is_open(); }
+
+  //! \return false if no more log
+  bool Next()
+  {
+    log_.clear();
+    if (!has_line_ && !std::getline(in_, line_)) return false;
+
+    log_ += line_;
+    log_ += '\n';
+    has_line_ = false;
+
+    // The following lines don't start with timestamp belong to this log
+    while (std::getline(in_, line_)) {
+      if (StartsWithTimestamp(line_)) {
+        has_line_ = true;
+        break;
+      }
+      log_ += line_;
+      log_ += '\n';
+    }
+    return true;
+  }
+
+  std::string const &log() const KANON_NOEXCEPT { return log_; }
+
+  //! The log without timestamp is less than others
+  StringView timestamp() const KANON_NOEXCEPT
+  {
+    return StartsWithTimestamp(log_)
+               ? StringView(log_.data(), LOG_TIMESTAMP_LENGTH)
+               : StringView();
+  }
+
+ private:
+  std::ifstream in_;
+  std::string log_;
+  std::string line_; //!< The first line of next log if has_line_ is true
+  bool has_line_;
+};
+
+} // namespace
+
+bool MergeLogFiles(std::vector<std::string> const &inputs, StringArg output)
+{
+  std::vector<std::unique_ptr<LogReader>> readers;
+  readers.reserve(inputs.size());
+
+  for (auto const &input : inputs) {
+    readers.emplace_back(new LogReader(input));
+    if (!readers.back()->IsOpen()) {
+      ::fprintf(stderr, "Failed to open log file: %s\n", input.c_str());
+      return false;
+    }
+  }
+
+  std::ofstream out(output.data(), std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    ::fprintf(stderr, "Failed to open output file: %s\n", output.data());
+    return false;
+  }
+
+  // The min heap of the index of readers,
+  // the index is compared if the timestamps are same to keep stable
+  auto greater = [&readers](size_t x, size_t y) {
+    const auto tx = readers[x]->timestamp();
+    const auto ty = readers[y]->timestamp();
+    return tx == ty ? x > y : tx > ty;
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(
+      greater);
+
+  for (size_t i = 0; i < readers.size(); ++i) {
+    if (readers[i]->Next()) heap.push(i);
+  }
+
+  while (!heap.empty()) {
+    const auto i = heap.top();
+    heap.pop();
+
+    auto const &log = readers[i]->log();
+    out.write(log.data(), log.size());
+
+    if (readers[i]->Next()) heap.push(i);
+  }
+
+  return out.good();
+}
+
+} // namespace kanon
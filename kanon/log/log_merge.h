@@ -0,0 +1,30 @@
+#ifndef KANON_LOG_LOG_MERGE_H
+#define KANON_LOG_LOG_MERGE_H
+
+#include <string>
+#include <vector>
+
+#include "kanon/util/macro.h"
+#include "kanon/string/string_view.h"
+
+namespace kanon {
+
+/**
+ * \brief Merge the log files into one by the timestamp of log
+ *
+ * The logs in each file must be ordered by the timestamp, e.g. the files
+ * written by ThreadLogFile. A log starts with the timestamp output by
+ * Logger(i.e. YYYYmmdd:HHMMSS.uuuuuu), the lines don't start with it
+ * belong to the previous log(e.g. the message contains '\n').
+ * The logs having the same timestamp are ordered by the order of inputs.
+ *
+ * \param inputs The log files
+ * \param output The merged file, it is truncated if exists
+ * \return false if failed to open a file
+ */
+KANON_CORE_API bool MergeLogFiles(std::vector<std::string> const &inputs,
+                                  StringArg output);
+
+} // namespace kanon
+
+#endif // KANON_LOG_LOG_MERGE_H
@@ -6,7 +6,11 @@
 
 namespace kanon {
 
-typedef SmallLexicalStream LogStream;
+/**
+ * The memory is provided by Logger, i.e. the message is formatted
+ * in the buffer of output directly if it supports(e.g. AsyncLog)
+ */
+typedef BasicLexicalStream<detail::ExternalFixedBuffer> LogStream;
 
 } // namespace kanon
 
@@ -6,6 +6,8 @@
 #include <string.h>
 #include <time.h>
 
+#include <string>
+
 #include "kanon/thread/current_thread.h"
 #include "kanon/util/time.h"
 #include "kanon/log/terminal_color.h"
@@ -19,8 +21,19 @@ namespace kanon {
 
 static KANON_TLS time_t t_lastSecond = 0;
 static KANON_TLS char t_timebuf[64] = {0};
+static KANON_TLS Logger::LogLevel t_outputLevel = Logger::KANON_LL_INFO;
+
+// The buffer of Logger if the output doesn't support writing in place
+static KANON_TLS char t_logBuf[kSmallStreamSize];
+static KANON_TLS bool t_logBufUsed = false;
+
+// A Logger of this thread is formatting in the space reserved,
+// the nested logging is deferred until it is committed
+static KANON_TLS bool t_reserving = false;
+static thread_local std::string t_deferredLogs;
 
 bool g_kanon_log = true;
+bool g_kanon_hot_log = false;
 bool g_all_log = true;
 
 bool Logger::need_color_ = true;
@@ -31,6 +44,18 @@ char const
         "ERROR", "SYS_ERROR", "FATAL", "SYS_FATAL",
 };
 
+Logger::LogLevel Logger::GetOutputLogLevel() KANON_NOEXCEPT
+{
+  return t_outputLevel;
+}
+
+bool Logger::IsReserving() KANON_NOEXCEPT { return t_reserving; }
+
+char const *Logger::GetLogLevelName(LogLevel level) KANON_NOEXCEPT
+{
+  return s_log_level_names_[level];
+}
+
 static char const *g_logLevelColor[] = {CYAN, BLUE,  GREEN, YELLOW,
                                         RED,  L_RED, RED,   L_RED};
 
@@ -42,6 +67,11 @@ static Logger::LogLevel initLogLevel() KANON_NOEXCEPT
     g_kanon_log = 0;
   }
 
+  auto hot_log_enable = ::getenv("KANON_LOG_HOT");
+  if (hot_log_enable && !StrCaseCompare(hot_log_enable, "1")) {
+    g_kanon_hot_log = 1;
+  }
+
   auto log_level = ::getenv("KANON_LOG");
   if (!log_level) return Logger::LogLevel::KANON_LL_INFO;
 
@@ -79,6 +109,8 @@ void DefaultFlush() { ::fflush(stdout); }
 
 Logger::OutputCallback Logger::output_callback_ = &DefaultOutput;
 Logger::FlushCallback Logger::flush_callback_ = &DefaultFlush;
+Logger::ReserveCallback Logger::reserve_callback_ = nullptr;
+Logger::CommitCallback Logger::commit_callback_ = nullptr;
 
 #define ERRNO_BUFFER_SIZE 1124
 #define TIME_BUFFER_SIZE  64
@@ -112,7 +144,30 @@ Logger::Logger(SourceFile file, size_t line, LogLevel level)
   : basename_(file.basename_)
   , cur_log_level_(level)
   , line_(line)
+  , reserved_(false)
+  , discarded_(false)
+  , heap_buf_(nullptr)
 {
+  char *buf = nullptr;
+  if (reserve_callback_ && !t_reserving) {
+    buf = reserve_callback_(kSmallStreamSize, level);
+    if (buf) {
+      reserved_ = t_reserving = true;
+    } else {
+      discarded_ = true;
+    }
+  }
+
+  if (!buf) {
+    if (!t_logBufUsed) {
+      t_logBufUsed = true;
+      buf = t_logBuf;
+    } else {
+      buf = heap_buf_ = new char[kSmallStreamSize];
+    }
+  }
+  stream_.buffer().SetStorage(buf, kSmallStreamSize);
+
   FormatTime();
   CurrentThread::tid();
   stream_ << StringView(CurrentThread::t_tidString,
@@ -157,7 +212,30 @@ Logger::Logger(SourceFile basefile, size_t line, LogLevel level, bool is_sys)
 Logger::~Logger() KANON_NOEXCEPT
 {
   stream_ << " - " << basename_ << ":" << line_ << "\n";
-  output_callback_(stream_.data(), stream_.size());
+
+  if (reserved_) {
+    commit_callback_(stream_.size(), time_);
+    t_reserving = false;
+
+    if (!t_deferredLogs.empty()) {
+      output_callback_(t_deferredLogs.data(), t_deferredLogs.size());
+      t_deferredLogs.clear();
+    }
+  } else {
+    if (t_reserving) {
+      t_deferredLogs.append(stream_.data(), stream_.size());
+    } else if (!discarded_) {
+      t_outputLevel = cur_log_level_;
+      output_callback_(stream_.data(), stream_.size());
+      t_outputLevel = KANON_LL_INFO;
+    }
+
+    if (heap_buf_) {
+      delete[] heap_buf_;
+    } else {
+      t_logBufUsed = false;
+    }
+  }
 
   if (cur_log_level_ == KANON_LL_FATAL || cur_log_level_ == KANON_LL_SYS_FATAL)
   {
@@ -173,6 +251,7 @@ void Logger::FormatTime() KANON_NOEXCEPT
 
   time_t nowSecond = tv.tv_sec;
   auto microsecond = (int)tv.tv_usec;
+  time_ = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 
   // Don't use TimeStamp::Now()
   // Cache second to decrease the count of calling sys API.
@@ -16,6 +16,7 @@ namespace kanon {
 // __thread char t_timebuf[64];
 
 KANON_CORE_API extern bool g_kanon_log;
+KANON_CORE_API extern bool g_kanon_hot_log;
 KANON_CORE_API extern bool g_all_log;
 
 /**
@@ -23,6 +24,16 @@ KANON_CORE_API extern bool g_all_log;
  */
 KANON_INLINE void SetKanonLog(bool val) KANON_NOEXCEPT { g_kanon_log = val; }
 
+/**
+ * Enable/Disable the logging in the hot path of kanon library,
+ * e.g. per event, per read/write(default: disabled)
+ * \see LOG_TRACE_KANON_HOT
+ */
+KANON_INLINE void SetKanonHotLog(bool val) KANON_NOEXCEPT
+{
+  g_kanon_hot_log = val;
+}
+
 /**
  * Control the logging of logger(i.e. All logs output by kanon)
  */
@@ -71,6 +82,18 @@ class Logger : noncopyable {
     KANON_LL_OFF,
   };
 
+  /**
+   * Reserve the space of \p len bytes in the output to format the message
+   * in place, return NULL if no space, i.e. the message is discarded
+   */
+  using ReserveCallback = std::function<char *(size_t len, LogLevel level)>;
+
+  /**
+   * Commit the message formatted in the space reserved
+   * \param time The timestamp of message in microseconds
+   */
+  using CommitCallback = std::function<void(size_t len, int64_t time)>;
+
   // Since __FIEL__ is fullname, including all parent path
   struct KANON_CORE_NO_API SourceFile {
     // user-defined conversion char const* --> SourceFile
@@ -128,6 +151,22 @@ class Logger : noncopyable {
 
   KANON_INLINE LogStream &stream() KANON_NOEXCEPT { return stream_; }
 
+  /**
+   * The level of the message being output, i.e. it is valid in
+   * OutputCallback, otherwise it is INFO
+   */
+  KANON_CORE_API static LogLevel GetOutputLogLevel() KANON_NOEXCEPT;
+
+  /**
+   * A Logger of this thread is formatting in the space reserved,
+   * i.e. the output can't be written in place until it is committed
+   */
+  KANON_CORE_API static bool IsReserving() KANON_NOEXCEPT;
+
+  //! The name of \p level, e.g. "INFO"
+  KANON_CORE_API static char const *GetLogLevelName(LogLevel level)
+      KANON_NOEXCEPT;
+
   KANON_INLINE static void SetColor(bool c) KANON_NOEXCEPT { need_color_ = c; }
   KANON_INLINE static LogLevel GetLogLevel() KANON_NOEXCEPT
   {
@@ -142,9 +181,29 @@ class Logger : noncopyable {
     return output_callback_;
   }
 
+  /**
+   * \note The ReserveCallback and CommitCallback are also cleared
+   */
   static void SetOutputCallback(OutputCallback output) KANON_NOEXCEPT
   {
     output_callback_ = output;
+    reserve_callback_ = nullptr;
+    commit_callback_ = nullptr;
+  }
+
+  /**
+   * If the output supports writing in place(e.g. AsyncLog), the message is
+   * formatted in the space reserved, i.e. the copy from the buffer of Logger
+   * to the output is avoided.
+   * The OutputCallback is still used for the nested logging(i.e. log in the
+   * formatting of a message).
+   * \warning Call this after SetOutputCallback()
+   */
+  static void SetReserveCallback(ReserveCallback reserve,
+                                 CommitCallback commit) KANON_NOEXCEPT
+  {
+    reserve_callback_ = reserve;
+    commit_callback_ = commit;
   }
   static FlushCallback GetFlushCallback() KANON_NOEXCEPT
   {
@@ -161,6 +220,14 @@ class Logger : noncopyable {
   StringView basename_; /** Filename(may including slash) */
   LogLevel cur_log_level_;
   size_t line_; /** Line number */
+  int64_t time_; /** Microseconds since epoch */
+
+  /** stream_ is in the space reserved by ReserveCallback */
+  bool reserved_;
+  /** ReserveCallback failed, i.e. the message is discarded */
+  bool discarded_;
+  /** Allocated if the thread local buffer is used by other Logger */
+  char *heap_buf_;
 
   LogStream stream_;
 
@@ -173,6 +240,8 @@ class Logger : noncopyable {
   KANON_CORE_API static bool need_color_;
   KANON_CORE_API static OutputCallback output_callback_;
   KANON_CORE_API static FlushCallback flush_callback_;
+  KANON_CORE_API static ReserveCallback reserve_callback_;
+  KANON_CORE_API static CommitCallback commit_callback_;
 };
 
 KANON_CORE_API char const *strerror_tl(int _errno);
@@ -250,23 +319,69 @@ KANON_CORE_API void DefaultOutput(char const *, size_t);
       .stream()
 
 // Kanon lib macro
-#define LOG_TRACE_KANON                                                        \
-  if (g_kanon_log) LOG_TRACE
+//
+// The logs of kanon library whose level is less than KANON_LOG_MIN_LEVEL
+// (the value of Logger::LogLevel, set by cmake -DKANON_LOG_MIN_LEVEL=XXX)
+// are compiled out, i.e. no any cost.
+// The statement is still compiled to check the error but it is dead code.
+#ifndef KANON_LOG_MIN_LEVEL
+#  define KANON_LOG_MIN_LEVEL 0 // TRACE
+#endif
 
-#define LOG_DEBUG_KANON                                                        \
-  if (g_kanon_log) LOG_DEBUG
+#define KANON_LOG_STRIPPED while (false)
 
-#define LOG_INFO_KANON                                                         \
-  if (g_kanon_log) LOG_INFO
+#if KANON_LOG_MIN_LEVEL > 0
+#  define LOG_TRACE_KANON KANON_LOG_STRIPPED LOG_TRACE
+#else
+#  define LOG_TRACE_KANON                                                      \
+    if (g_kanon_log) LOG_TRACE
+#endif
 
-#define LOG_WARN_KANON                                                         \
-  if (g_kanon_log) LOG_WARN
+#if KANON_LOG_MIN_LEVEL > 1
+#  define LOG_DEBUG_KANON KANON_LOG_STRIPPED LOG_DEBUG
+#else
+#  define LOG_DEBUG_KANON                                                      \
+    if (g_kanon_log) LOG_DEBUG
+#endif
+
+#if KANON_LOG_MIN_LEVEL > 2
+#  define LOG_INFO_KANON KANON_LOG_STRIPPED LOG_INFO
+#else
+#  define LOG_INFO_KANON                                                       \
+    if (g_kanon_log) LOG_INFO
+#endif
+
+#if KANON_LOG_MIN_LEVEL > 3
+#  define LOG_WARN_KANON KANON_LOG_STRIPPED LOG_WARN
+#else
+#  define LOG_WARN_KANON                                                       \
+    if (g_kanon_log) LOG_WARN
+#endif
+
+#if KANON_LOG_MIN_LEVEL > 4
+#  define LOG_ERROR_KANON KANON_LOG_STRIPPED LOG_ERROR
+#else
+#  define LOG_ERROR_KANON                                                      \
+    if (g_kanon_log) LOG_ERROR
+#endif
+
+#if KANON_LOG_MIN_LEVEL > 5
+#  define LOG_SYSERROR_KANON KANON_LOG_STRIPPED LOG_SYSERROR
+#else
+#  define LOG_SYSERROR_KANON                                                   \
+    if (g_kanon_log) LOG_SYSERROR
+#endif
 
-#define LOG_ERROR_KANON                                                        \
-  if (g_kanon_log) LOG_ERROR
+// The logs in the hot path of kanon library(per event, per message).
+// They are disabled in default, then only a load of g_kanon_hot_log and
+// a branch predicted not taken are needed, the logging code is moved
+// out of the hot path by compiler.
+// Call SetKanonHotLog(true) or set KANON_LOG_HOT=1 to enable them.
+#define LOG_TRACE_KANON_HOT                                                    \
+  if (KANON_UNLIKELY(g_kanon_hot_log)) LOG_TRACE_KANON
 
-#define LOG_SYSERROR_KANON                                                     \
-  if (g_kanon_log) LOG_SYSERROR
+#define LOG_DEBUG_KANON_HOT                                                    \
+  if (KANON_UNLIKELY(g_kanon_hot_log)) LOG_DEBUG_KANON
 
 // Format logging macros
 #define FMT_LOG_TRACE(fmt, ...)                                                \
@@ -0,0 +1,85 @@
+#ifndef KANON_LOG_MMAP_APPEND_FILE_H
+#define KANON_LOG_MMAP_APPEND_FILE_H
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "kanon/string/string_view.h"
+#include "kanon/util/noncopyable.h"
+#include "kanon/util/macro.h"
+
+#include "kanon/log/append_file.h"
+
+namespace kanon {
+
+#ifdef KANON_ON_UNIX
+
+/**
+ * \brief Append to file through a shared memory mapping
+ *
+ * The file is extended by fallocate() in windows, and each window is mapped,
+ * then append is just a memcpy(), i.e. no syscall in the most of time.
+ * Flush() is msync(MS_ASYNC) instead of write(), so it doesn't block
+ * the caller.
+ *
+ * The file is truncated to the size written when closed.
+ *
+ * \note
+ *   Same interface with AppendFile, used as the File of LogFile
+ * \warning
+ *   If the process crashes, the rest of last window is filled with '\0'.
+ * \warning
+ *   Only available in unix, the implementation is in linux/core which
+ *   is not built in windows(see kanon/CMakeLists.txt). The users must
+ *   check KANON_ON_UNIX, e.g. AsyncLog::SetMmapOutput() is ignored.
+ */
+class MmapAppendFile : noncopyable {
+ public:
+  KANON_CORE_API explicit MmapAppendFile(StringArg filename);
+  KANON_CORE_API ~MmapAppendFile() KANON_NOEXCEPT;
+
+  void Append(void const *data, size_t num) KANON_NOEXCEPT
+  {
+    if (KANON_LIKELY(num <= (size_t)(window_end_ - cur_))) {
+      ::memcpy(cur_, data, num);
+      cur_ += num;
+      writtenBytes_ += num;
+    } else {
+      _Append((char const *)data, num);
+    }
+  }
+
+  KANON_CORE_API void Flush() KANON_NOEXCEPT;
+
+  size_t writtenBytes() const KANON_NOEXCEPT { return writtenBytes_; }
+
+ private:
+  KANON_CORE_API void _Append(char const *data, size_t num) KANON_NOEXCEPT;
+
+  //! Map the window at the end of file
+  bool MapWindow() KANON_NOEXCEPT;
+  void UnmapWindow() KANON_NOEXCEPT;
+
+  //! The offset in file of cur_
+  off_t GetOffset() const KANON_NOEXCEPT
+  {
+    return window_offset_ + (cur_ - window_);
+  }
+
+  int fd_;
+  char *window_;     //!< The start of mapped window
+  char *window_end_; //!< The end of mapped window
+  char *cur_;        //!< The position to append
+  off_t window_offset_;
+  off_t synced_offset_; //!< The end of range starting writeback
+
+  // indicator of roll file
+  size_t writtenBytes_;
+};
+
+#endif // KANON_ON_UNIX
+
+} // namespace kanon
+
+#endif // KANON_LOG_MMAP_APPEND_FILE_H
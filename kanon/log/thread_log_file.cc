@@ -0,0 +1,115 @@
+#include "kanon/log/thread_log_file.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "kanon/thread/current_thread.h"
+
+namespace kanon {
+
+static std::atomic<uint64_t> g_threadLogFileId(0);
+static std::atomic<uint64_t> g_threadToken(0);
+
+// The file of the ThreadLogFile(whose id is t_logFileOwner) of this thread.
+// There is one ThreadLogFile in general, the others are looked up in
+// ThreadLogFile::files_.
+static KANON_TLS uint64_t t_logFileOwner = 0;
+static KANON_TLS void *t_logFile = nullptr;
+static KANON_TLS uint64_t t_threadToken = 0;
+
+template <typename F>
+ThreadLogFile<F>::ThreadLogFile(StringView basename, size_t roll_size,
+                                StringView prefix, size_t log_file_num,
+                                size_t roll_interval, size_t flush_interval)
+  : id_(++g_threadLogFileId)
+  , basename_(basename.ToString())
+  , roll_size_(roll_size)
+  , prefix_(prefix.ToString())
+  , log_file_num_(log_file_num)
+  , roll_interval_(roll_interval)
+  , flush_interval_(flush_interval)
+  , flush_thr_("ThreadLogFlush")
+  , flush_cond_(flush_mutex_)
+  , quit_flush_thr_(false)
+{
+  assert(basename.find('/') == StringView::npos);
+  Logger::SetColor(false);
+
+  flush_thr_.StartRun([this]() {
+    for (;;) {
+      {
+        MutexGuard guard(flush_mutex_);
+        if (!quit_flush_thr_) {
+          flush_cond_.WaitForSeconds(flush_interval_);
+        }
+        if (quit_flush_thr_) break;
+      }
+
+      Flush();
+    }
+  });
+}
+
+template <typename F>
+ThreadLogFile<F>::~ThreadLogFile() KANON_NOEXCEPT
+{
+  {
+    MutexGuard guard(flush_mutex_);
+    quit_flush_thr_ = true;
+    flush_cond_.Notify();
+  }
+  flush_thr_.Join();
+}
+
+template <typename F>
+void ThreadLogFile<F>::Flush() KANON_NOEXCEPT
+{
+  MutexGuard guard(mutex_);
+  for (auto &file : files_) {
+    file.second->Flush();
+  }
+}
+
+template <typename F>
+auto ThreadLogFile<F>::GetFile() KANON_NOEXCEPT -> FileType &
+{
+  if (KANON_UNLIKELY(t_logFileOwner != id_)) {
+    t_logFile = CreateFile();
+    t_logFileOwner = id_;
+  }
+
+  return *static_cast<FileType *>(t_logFile);
+}
+
+template <typename F>
+auto ThreadLogFile<F>::CreateFile() -> FileType *
+{
+  if (t_threadToken == 0) t_threadToken = ++g_threadToken;
+
+  MutexGuard guard(mutex_);
+  auto &file = files_[t_threadToken];
+  if (file) return file.get();
+
+  std::string thread_name =
+      CurrentThread::t_name ? CurrentThread::t_name : "Unnamed";
+  std::replace(thread_name.begin(), thread_name.end(), '/', '_');
+  if (!thread_names_.insert(thread_name).second) {
+    thread_name += '-';
+    thread_name += CurrentThread::tidString();
+    thread_names_.insert(thread_name);
+  }
+
+  file.reset(new FileType(basename_ + '.' + thread_name, roll_size_, prefix_,
+                          log_file_num_, roll_interval_, flush_interval_));
+  return file.get();
+}
+
+template class KANON_CORE_API ThreadLogFile<>;
+template KANON_CORE_API void SetupLogFile(ThreadLogFile<> &lf);
+
+#ifdef KANON_ON_UNIX
+template class KANON_CORE_API ThreadLogFile<MmapAppendFile>;
+template KANON_CORE_API void SetupLogFile(ThreadLogFile<MmapAppendFile> &lf);
+#endif
+
+} // namespace kanon
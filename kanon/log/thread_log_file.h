@@ -0,0 +1,110 @@
+#ifndef KANON_LOG_THREAD_LOG_FILE_H
+#define KANON_LOG_THREAD_LOG_FILE_H
+
+#include <limits.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "kanon/util/noncopyable.h"
+#include "kanon/util/macro.h"
+#include "kanon/string/string_view.h"
+#include "kanon/thread/condition.h"
+#include "kanon/thread/mutex_lock.h"
+#include "kanon/thread/thread.h"
+
+#include "kanon/log/logger.h"
+#include "kanon/log/log_file.h"
+
+namespace kanon {
+
+/**
+ * \brief Each thread appends log to its own LogFile
+ *
+ * The file of a thread is created when the thread logs at the first time,
+ * and its basename is basename.<thread-name>, i.e. the file name is
+ * basename.<thread-name>.<time>.<pid>.<hostname>.log(\see LogFile).
+ * Each file has own buffer, flush interval and roll policy, and there is
+ * no contention between threads in logging except the creation of file.
+ * A background thread flushes all files in the flush interval, then the
+ * content of the idle threads is also written in time.
+ *
+ * Use MergeLogFiles()(or the log_merge tool) to merge the files by
+ * the timestamp.
+ *
+ * \note
+ *   If the name of thread is used by another thread, the tid is appended.
+ *   The file of a thread is closed when ThreadLogFile is destroyed
+ *   even if the thread has exited.
+ * \warning
+ *   If log_file_num is specified, each file starts a thread to remove
+ *   the old files.
+ */
+template <typename File = AppendFile>
+class ThreadLogFile : noncopyable {
+  // The lock is only contended by the flush thread
+  using FileType = LogFile<true, File>;
+
+ public:
+  /**
+   * Same with LogFile
+   */
+  ThreadLogFile(StringView basename, size_t roll_size,
+                StringView prefix = StringView{},
+                size_t log_file_num = UINT_MAX,
+                size_t roll_interval = 24 * 60 * 60,
+                size_t flush_interval = 3);
+
+  ~ThreadLogFile() KANON_NOEXCEPT;
+
+  void Append(char const *data, size_t num) KANON_NOEXCEPT
+  {
+    GetFile().Append(data, num);
+  }
+
+  //! Flush the files of all threads
+  void Flush() KANON_NOEXCEPT;
+
+ private:
+  FileType &GetFile() KANON_NOEXCEPT;
+  FileType *CreateFile();
+
+  uint64_t id_; //!< Distinguish the ThreadLogFile cached by thread
+
+  std::string basename_;
+  size_t roll_size_;
+  std::string prefix_;
+  size_t log_file_num_;
+  size_t roll_interval_;
+  size_t flush_interval_;
+
+  MutexLock mutex_;
+  // The token of thread -> file.
+  // The tid is not used since it is reused by the new thread.
+  std::unordered_map<uint64_t, std::unique_ptr<FileType>> files_;
+  std::unordered_set<std::string> thread_names_;
+
+  Thread flush_thr_;
+  MutexLock flush_mutex_;
+  Condition flush_cond_;
+  bool quit_flush_thr_;
+};
+
+template <typename File>
+void SetupLogFile(ThreadLogFile<File> &lf)
+{
+  Logger::SetOutputCallback([&lf](char const *data, size_t num) {
+    lf.Append(data, num);
+  });
+
+  Logger::SetFlushCallback([&lf]() {
+    lf.Flush();
+  });
+}
+
+} // namespace kanon
+
+#endif // KANON_LOG_THREAD_LOG_FILE_H
@@ -1,5 +1,9 @@
 #include "kanon/net/acceptor.h"
 
+#ifdef KANON_ON_UNIX
+#  include <sys/stat.h>
+#endif
+
 #include "kanon/util/check.h"
 #include "kanon/util/time_stamp.h"
 
@@ -20,43 +24,8 @@ Acceptor::Acceptor(EventLoop *loop, InetAddr const &addr, bool reuseport)
   socket_.SetReusePort(reuseport);
   socket_.BindAddress(addr);
 
-  // set listen channel read callback(accept peer end)
-  // and start observing the read event
-  channel_.SetReadCallback([this](TimeStamp stamp) {
-    KANON_UNUSED(stamp);
-    loop_->AssertInThread();
-
-    InetAddr cli_addr;
-    auto cli_fd = socket_.Accpet(cli_addr);
-
-    if (cli_fd >= 0) {
-      if (new_connection_callback_) {
-        // dispatching connection to IO thread
-        new_connection_callback_(cli_fd, cli_addr);
-      } else {
-        sock::Close(cli_fd);
-      }
-    } else {
-      // if process limited open fd has reached,
-      // os also accept this fd and put to wait queue
-      // since we take level trigger policy,
-      // so it will cause busy loop
-      // so we should use dummy fd to accept and close it
-      if (errno == EMFILE) {
-// first close dummy fd, leave a space for fd in wait queue
-#ifdef KANON_ON_UNIX
-        ::close(dummyfd_);
-        // accept the fd
-        dummyfd_ = ::accept(socket_.GetFd(), NULL, NULL);
-        ::close(dummyfd_);
-        // create new dummy fd to use after
-        dummyfd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-#endif
-      }
-
-      // We don't handle error since sock::Accept() has handled
-    }
-  });
+  // set listen channel read handler(accept peer end)
+  channel_.SetHandler(this);
 
   // Can't call Channel::EnableReading() in the ctor
   // Construct a server in the other loop is allowed.
@@ -66,6 +35,57 @@ Acceptor::Acceptor(EventLoop *loop, InetAddr const &addr, bool reuseport)
   // server.StartRun();
 }
 
+#ifdef KANON_ON_UNIX
+/**
+ * Remove the socket file left by the server not exited normally
+ *
+ * The file is removed only if it is a socket and no server listens on it
+ * (i.e. connect() is refused). Otherwise, it is kept and the bind fails,
+ * then the address of a live server isn't taken and a regular file isn't
+ * deleted by mistake.
+ */
+static void RemoveStaleUnixSocket(UnixAddr const &addr) KANON_NOEXCEPT
+{
+  auto path = addr.GetPath();
+
+  struct stat st;
+  if (::lstat(path.c_str(), &st) != 0) return;
+  if (!S_ISSOCK(st.st_mode)) {
+    LOG_ERROR_KANON << path << " exists but is not a socket";
+    return;
+  }
+
+  const auto fd = sock::CreateNonBlockAndCloExecUnixSocket();
+  // Connecting the unix socket doesn't block even if it is nonblocking
+  const auto ret = sock::Connect(fd, addr.ToSockaddr(), addr.GetLength());
+  const auto saved_errno = errno;
+  sock::Close(fd);
+
+  if (ret != 0 && saved_errno == ECONNREFUSED) {
+    LOG_INFO_KANON << "Remove the stale socket file " << path;
+    ::unlink(path.c_str());
+  } else {
+    LOG_ERROR_KANON << path << " is used by a live server";
+  }
+}
+
+Acceptor::Acceptor(EventLoop *loop, UnixAddr const &addr)
+  : loop_{loop}
+  , socket_{sock::CreateNonBlockAndCloExecUnixSocket()}
+  , channel_{loop_, socket_.GetFd()}
+  , listening_{false}
+  , dummyfd_{::open("/dev/null", O_RDONLY | O_CLOEXEC)}
+{
+  // The file isn't removed if the last server is not exited normally
+  if (!addr.IsAbstract()) RemoveStaleUnixSocket(addr);
+  socket_.BindAddress(addr);
+  // Remove the file in dtor only if it is created by this
+  if (!addr.IsAbstract()) unix_path_ = addr.GetPath();
+
+  channel_.SetHandler(this);
+}
+#endif
+
 Acceptor::~Acceptor() KANON_NOEXCEPT
 {
   // FIXME
@@ -77,9 +97,47 @@ Acceptor::~Acceptor() KANON_NOEXCEPT
   channel_.Remove();
 #ifdef KANON_ON_UNIX
   ::close(dummyfd_);
+  if (!unix_path_.empty()) ::unlink(unix_path_.c_str());
 #endif
 }
 
+void Acceptor::OnChannelRead(TimeStamp stamp)
+{
+  KANON_UNUSED(stamp);
+  loop_->AssertInThread();
+
+  InetAddr cli_addr;
+  auto cli_fd = socket_.Accpet(cli_addr);
+
+  if (cli_fd >= 0) {
+    if (new_connection_callback_) {
+      // dispatching connection to IO thread
+      new_connection_callback_(cli_fd, cli_addr);
+    } else {
+      sock::Close(cli_fd);
+    }
+  } else {
+    // if process limited open fd has reached,
+    // os also accept this fd and put to wait queue
+    // since we take level trigger policy,
+    // so it will cause busy loop
+    // so we should use dummy fd to accept and close it
+    if (errno == EMFILE) {
+// first close dummy fd, leave a space for fd in wait queue
+#ifdef KANON_ON_UNIX
+      ::close(dummyfd_);
+      // accept the fd
+      dummyfd_ = ::accept(socket_.GetFd(), NULL, NULL);
+      ::close(dummyfd_);
+      // create new dummy fd to use after
+      dummyfd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+#endif
+    }
+
+    // We don't handle error since sock::Accept() has handled
+  }
+}
+
 void Acceptor::Listen() KANON_NOEXCEPT
 {
   assert(!listening_);
@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <atomic>
+#include <string>
 
 #include "kanon/util/macro.h"
 
@@ -14,6 +15,7 @@
 #include "kanon/net/socket.h"
 #include "kanon/net/channel.h"
 #include "kanon/net/inet_addr.h"
+#include "kanon/net/unix_addr.h"
 
 namespace kanon {
 
@@ -34,7 +36,9 @@ class EventLoop;
  *   Internal class
  *   Only used by TcpServer
  */
-class KANON_NET_NO_API Acceptor : noncopyable {
+class KANON_NET_NO_API Acceptor
+  : noncopyable
+  , ChannelHandler {
  public:
   using NewConnectionCallback =
       std::function<void(int cli_fd, InetAddr const &cli_addr)>;
@@ -49,6 +53,19 @@ class KANON_NET_NO_API Acceptor : noncopyable {
    * and start monitoring read event(i.e. new connection)
    */
   Acceptor(EventLoop *loop, InetAddr const &addr, bool reuseport = false);
+
+#ifdef KANON_ON_UNIX
+  /**
+   * \brief Construct a Acceptor in the unix domain socket \p addr
+   *
+   * The stale socket file of \p addr(i.e. no server listens on it) is
+   * removed before binding, and the file is removed in the destructor.
+   * If the path is a live socket or not a socket, the bind fails.
+   * The cli_addr of NewConnectionCallback is meaningless.
+   */
+  Acceptor(EventLoop *loop, UnixAddr const &addr);
+#endif
+
   ~Acceptor() KANON_NOEXCEPT;
 
   /**
@@ -73,6 +90,9 @@ class KANON_NET_NO_API Acceptor : noncopyable {
   }
 
  private:
+  //! Accept the new connection
+  void OnChannelRead(TimeStamp stamp) KANON_OVERRIDE;
+
   EventLoop *loop_; //!< Ensure "One loop per thread"
   Socket socket_;   //!< Accept socket
   Channel channel_; //!< Accept channel
@@ -80,6 +100,8 @@ class KANON_NET_NO_API Acceptor : noncopyable {
   std::atomic_bool listening_; //!< Whether start listening
 #ifdef KANON_ON_UNIX
   int dummyfd_; //!< Avoid busy loop
+
+  std::string unix_path_; //!< The socket file to remove
 #endif
 
   NewConnectionCallback new_connection_callback_;
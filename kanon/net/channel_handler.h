@@ -0,0 +1,52 @@
+#ifndef KANON_NET_CHANNEL_HANDLER_H
+#define KANON_NET_CHANNEL_HANDLER_H
+
+#include "kanon/util/macro.h"
+#include "kanon/util/time_stamp.h"
+
+namespace kanon {
+
+//! \ingroup net
+//! \addtogroup dispatcher
+//!@{
+
+/**
+ * \brief Event handler of Channel
+ *
+ * The owner of channel(e.g. connection, acceptor, timer queue,
+ * event loop) implements this and register itself by
+ * Channel::SetHandler().
+ *
+ * Compared with the std::function callbacks, the channel only
+ * stores a pointer and dispatches events through one virtual call,
+ * instead of four type-erased objects per channel.
+ *
+ * The default handlers do nothing, i.e. the event is ignored.
+ *
+ * \note
+ *   The handler must outlive the events handling of the channel.
+ */
+class ChannelHandler {
+ public:
+  //! Called when the fd is readable(IN, PRI, RDHUP)
+  virtual void OnChannelRead(TimeStamp receive_time) { KANON_UNUSED(receive_time); }
+
+  //! Called when the fd is writable(OUT)
+  virtual void OnChannelWrite() {}
+
+  //! Called when error occurred(ERR, NVAL)
+  virtual void OnChannelError() {}
+
+  //! Called when the connection is closed in two direction(HUP without IN)
+  virtual void OnChannelClose() {}
+
+ protected:
+  // Don't delete handler through this
+  ~ChannelHandler() = default;
+};
+
+//!@}
+
+} // namespace kanon
+
+#endif // KANON_NET_CHANNEL_HANDLER_H
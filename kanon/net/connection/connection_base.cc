@@ -5,6 +5,7 @@
 #include <atomic>
 
 #include "kanon/log/logger.h"
+#include "kanon/log/log_limit.h"
 #include "kanon/net/socket.h"
 #include "kanon/net/channel.h"
 #include "kanon/net/event_loop.h"
@@ -30,10 +31,7 @@ ConnectionBase<D>::ConnectionBase(EventLoop *loop, std::string const &name,
   // will disable all events when connection
   // become disconnectioned(later, it will
   // be destroyed)
-  channel_->SetReadCallback(std::bind(&ConnectionBase::HandleRead, this, _1));
-  channel_->SetWriteCallback(std::bind(&ConnectionBase::HandleWrite, this));
-  channel_->SetErrorCallback(std::bind(&ConnectionBase::HandleError, this));
-  channel_->SetCloseCallback(std::bind(&ConnectionBase::HandleClose, this));
+  channel_->SetHandler(this);
 }
 
 template <typename D>
@@ -63,8 +61,11 @@ void ConnectionBase<D>::ConnectionEstablished()
 #endif
   LOG_TRACE_KANON << "Connection [" << name_ << "] is established";
 
+  // Retain self until the connection is closed or destroyed
+  self_ = this->shared_from_this();
+
   assert(connection_callback_);
-  connection_callback_(this->shared_from_this());
+  connection_callback_(self_);
 }
 
 template <typename D>
@@ -82,9 +83,11 @@ void ConnectionBase<D>::ConnectionDestroyed()
     state_ = kDisconnected;
 
     LOG_TRACE_KANON << "Connection [" << name_ << "] has destroyed";
-    // Because ConnectionDestroyed maybe async call
-    // Don't pass raw pointer
-    connection_callback_(this->shared_from_this());
+    connection_callback_(self_);
+
+    // HandleClose() is not called, release self here.
+    // The queued functors may bind this, so delay it to the functor.
+    QueueReleaseSelf();
   }
 
   assert(state_ == kDisconnected);
@@ -92,6 +95,20 @@ void ConnectionBase<D>::ConnectionDestroyed()
   channel_->Remove();
 }
 
+template <typename D>
+void ConnectionBase<D>::QueueReleaseSelf()
+{
+  // Don't move the self_ here, it may be the reference passed to the
+  // running callback(e.g. ForceClose() is called in the message callback).
+  // The functor owns a copy and resets the self_ when it is called or
+  // destroyed(i.e. the loop quit early).
+  auto self = self_;
+  std::shared_ptr<void> releaser(nullptr, [this, self](void *) {
+    self_.reset();
+  });
+  loop_->QueueToLoop([releaser]() {});
+}
+
 template <typename D>
 void ConnectionBase<D>::HandleLtRead(TimeStamp recv_time)
 {
@@ -109,7 +126,7 @@ void ConnectionBase<D>::HandleLtRead(TimeStamp recv_time)
     errno = saved_errno;
 
     if (errno != EAGAIN) {
-      LOG_SYSERROR_KANON << "Read event handle error";
+      LOG_RATE_LIMITED(LOG_SYSERROR_KANON, 10) << "Read event handle error";
       HandleError();
     }
   } else if (n == 0) {
@@ -120,11 +137,11 @@ void ConnectionBase<D>::HandleLtRead(TimeStamp recv_time)
   } else {
     assert(n > 0 && n != static_cast<size_t>(-1));
 
-    LOG_DEBUG_KANON << "Read " << n << " bytes from [Connection: " << name_
-                    << ", fd: " << channel_->GetFd() << "]";
+    LOG_DEBUG_KANON_HOT << "Read " << n << " bytes from [Connection: " << name_
+                        << ", fd: " << channel_->GetFd() << "]";
 
     if (message_callback_) {
-      message_callback_(this->shared_from_this(), input_buffer_, recv_time);
+      message_callback_(self_, input_buffer_, recv_time);
     } else {
       input_buffer_.AdvanceAll();
       LOG_WARN_KANON << "If user want to process message from peer, should set "
@@ -160,15 +177,16 @@ void ConnectionBase<D>::HandleEtRead(TimeStamp recv_time)
 
     if (saved_errno != 0) {
       if (saved_errno != EAGAIN) {
-        LOG_SYSERROR_KANON << "Read event handle error";
+        LOG_RATE_LIMITED(LOG_SYSERROR_KANON, 10) << "Read event handle error";
         HandleError();
       } else {
         break;
       }
     }
 
-    LOG_DEBUG_KANON << "Read " << readn << " bytes from [Connection: " << name_
-                    << ", fd: " << channel_->GetFd() << "]";
+    LOG_DEBUG_KANON_HOT << "Read " << readn
+                        << " bytes from [Connection: " << name_
+                        << ", fd: " << channel_->GetFd() << "]";
     if (readn == 0) {
       LOG_DEBUG_KANON << "Peer close connection";
       HandleClose();
@@ -178,7 +196,7 @@ void ConnectionBase<D>::HandleEtRead(TimeStamp recv_time)
     // FIXME
     // message_callback_ should be called here?
     if (message_callback_) {
-      message_callback_(this->shared_from_this(), input_buffer_, recv_time);
+      message_callback_(self_, input_buffer_, recv_time);
     } else {
       input_buffer_.AdvanceAll();
       LOG_WARN_KANON << "If user want to process message from peer, should set "
@@ -206,8 +224,8 @@ void ConnectionBase<D>::HandleLtWrite()
   int saved_errno = 0;
   auto n = ChunkListWriteFd(output_buffer_, channel_->GetFd(), saved_errno);
 
-  LOG_TRACE_KANON << "Write " << n << " bytes to [Connection: " << name_
-                  << ", fd: " << channel_->GetFd() << "]";
+  LOG_TRACE_KANON_HOT << "Write " << n << " bytes to [Connection: " << name_
+                      << ", fd: " << channel_->GetFd() << "]";
 
   if (saved_errno && saved_errno != EAGAIN) {
     LOG_SYSERROR_KANON << "Write event handle error";
@@ -220,8 +238,8 @@ void ConnectionBase<D>::HandleLtWrite()
   if (n > 0) {
     output_buffer_.AdvanceRead(n);
 #ifdef PRINT_REMAIN
-    LOG_TRACE_KANON << "Output Buffer remaining = "
-                    << output_buffer_.GetReadableSize();
+    LOG_TRACE_KANON_HOT << "Output Buffer remaining = "
+                        << output_buffer_.GetReadableSize();
 #endif
     if (!output_buffer_.HasReadable()) {
       if (write_complete_callback_) {
@@ -240,12 +258,10 @@ void ConnectionBase<D>::HandleLtWrite()
         //   write_complete_callback_,
         //   this->shared_from_this()));
 
-        // Pass this is unsafe even thought this is in the
-        // phase of processing write event since there is a
-        // HandleClose() callback has register early
+        // Pass this is safe since self_ is released in the
+        // functor which is queued after this by HandleClose()
         loop_->QueueToLoop(
-            std::bind(&ConnectionBase<D>::CallWriteCompleteCallback,
-                      this->shared_from_this()));
+            std::bind(&ConnectionBase<D>::CallWriteCompleteCallback, this));
       } else {
         channel_->DisableWriting();
       }
@@ -263,18 +279,25 @@ void ConnectionBase<D>::HandleLtWrite()
 template <typename D>
 void ConnectionBase<D>::CallWriteCompleteCallback()
 {
-  if (write_complete_callback_(this->shared_from_this())) {
-    LOG_TRACE_KANON << "Last chunk in the pipeline write";
+  // The callback may be removed after the call is queued
+  if (!write_complete_callback_ || write_complete_callback_(self_)) {
+    LOG_TRACE_KANON_HOT << "Last chunk in the pipeline write";
     // The write_complete_callback_ maybe disable writing in the SendInLoop()
     if (channel_->IsWriting()) {
       channel_->DisableWriting();
     }
   } else {
-    LOG_TRACE_KANON
+    LOG_TRACE_KANON_HOT
         << "Not last chunk int the pipeline wirte()[don't disable wirting]";
   }
 }
 
+template <typename D>
+void ConnectionBase<D>::CallHighWaterMarkCallback(size_t size)
+{
+  high_water_mark_callback_(self_, size);
+}
+
 template <typename D>
 void ConnectionBase<D>::HandleEtWrite()
 {
@@ -298,8 +321,9 @@ void ConnectionBase<D>::HandleEtWrite()
       }
     }
 
-    LOG_TRACE_KANON << "Write " << writen << " bytes to [Connection: " << name_
-                    << ", fd: " << channel_->GetFd() << "]";
+    LOG_TRACE_KANON_HOT << "Write " << writen
+                        << " bytes to [Connection: " << name_
+                        << ", fd: " << channel_->GetFd() << "]";
 
     output_buffer_.AdvanceRead(writen);
 
@@ -317,8 +341,7 @@ void ConnectionBase<D>::HandleEtWrite()
     if (write_complete_callback_) {
       // No need to disable writing
       loop_->QueueToLoop(
-          std::bind(&ConnectionBase<D>::CallWriteCompleteCallback,
-                    this->shared_from_this()));
+          std::bind(&ConnectionBase<D>::CallWriteCompleteCallback, this));
     }
 
     if (state_ == kDisconnecting) {
@@ -355,14 +378,16 @@ void ConnectionBase<D>::HandleClose()
 
   // Prevent connection to be removed from TcpServer immediately(since
   // close_callback_) TcpServer::RemoveConnection need to call
-  // ConnectionBase<D>::ConnectionDestroyed Therefore, we must guard here
-  const auto guard = this->shared_from_this();
-  connection_callback_(guard);
+  // ConnectionBase<D>::ConnectionDestroyed Therefore, self_ is released
+  // in the functor calling phase
+  connection_callback_(self_);
 
   // TcpServer remove connection from its connections_
   if (close_callback_) {
-    close_callback_(guard);
+    close_callback_(self_);
   }
+
+  QueueReleaseSelf();
 }
 
 template <typename D>
@@ -522,10 +547,7 @@ void ConnectionBase<D>::SetChannel(std::unique_ptr<Channel> ch)
 {
   ch->SetEvents(channel_->GetEvents());
   channel_ = std::move(ch);
-  channel_->SetReadCallback(std::bind(&ConnectionBase::HandleRead, this, _1));
-  channel_->SetWriteCallback(std::bind(&ConnectionBase::HandleWrite, this));
-  channel_->SetErrorCallback(std::bind(&ConnectionBase::HandleError, this));
-  channel_->SetCloseCallback(std::bind(&ConnectionBase::HandleClose, this));
+  channel_->SetHandler(this);
 }
 #ifdef KANON_ON_WIN
 #  include "kanon/win/net/connection/connection_base.inl"
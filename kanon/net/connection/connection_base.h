@@ -16,6 +16,7 @@
 #include "kanon/net/buffer.h"
 #include "kanon/net/chunk_list.h"
 #include "kanon/net/event.h"
+#include "kanon/net/channel_handler.h"
 
 #ifdef KANON_ON_WIN
 #  include <winsock2.h>
@@ -35,6 +36,7 @@ using OutputBuffer = ChunkList;
 template <typename D>
 class ConnectionBase
   : noncopyable
+  , ChannelHandler
   , public std::enable_shared_from_this<D> {
   // Allow TcpServer and TcpClient call the private APIs
   // that we don't exposed to user
@@ -135,6 +137,14 @@ class ConnectionBase
     write_complete_callback_ = std::move(cb);
   }
 
+  /**
+   * Used for wrapping the callback set by others temporarily
+   */
+  WriteCompleteCallback const &GetWriteCompleteCallback() const KANON_NOEXCEPT
+  {
+    return write_complete_callback_;
+  }
+
   void SetHighWaterMarkCallback(HighWaterMarkCallback cb, size_t mark)
   {
     high_water_mark_ = mark;
@@ -198,6 +208,13 @@ class ConnectionBase
   }
   bool IsDisconnected() const KANON_NOEXCEPT { return state_ == kDisconnected; }
 
+  /**
+   * \brief Whether the connection retains itself, i.e. one of
+   *        use_count() is the self reference
+   * \note Must be called in the loop, the self_ is written in it
+   */
+  bool IsSelfRetained() const KANON_NOEXCEPT { return self_ != nullptr; }
+
   ContextType &GetContext() KANON_NOEXCEPT { return context_; }
 
   ContextType const &GetContext() const KANON_NOEXCEPT { return context_; }
@@ -207,6 +224,17 @@ class ConnectionBase
   InputBuffer *GetInputBuffer() KANON_NOEXCEPT { return &input_buffer_; }
 
   OutputBuffer *GetOutputBuffer() KANON_NOEXCEPT { return &output_buffer_; }
+
+  /**
+   * \brief Get a owning pointer of this connection
+   *
+   * The ConnectionPtr passed to the message, write complete and
+   * high watermark callback is borrowed from the connection itself,
+   * it is valid during the callback only.
+   * If you want keep the connection alive out of the callback
+   * (e.g. in the other thread), copy it or call this.
+   */
+  ConnectionPtr Retain() { return this->shared_from_this(); }
   //!@}
 
   void SetCloseCallback(CloseCallback cb) { close_callback_ = std::move(cb); }
@@ -236,7 +264,23 @@ class ConnectionBase
   void HandleError();
   void HandleClose();
 
+  //! \name channel handler
+  //!@{
+  void OnChannelRead(TimeStamp recv_time) KANON_OVERRIDE
+  {
+    HandleRead(recv_time);
+  }
+  void OnChannelWrite() KANON_OVERRIDE { HandleWrite(); }
+  void OnChannelError() KANON_OVERRIDE { HandleError(); }
+  void OnChannelClose() KANON_OVERRIDE { HandleClose(); }
+  //!@}
+
   void CallWriteCompleteCallback();
+  void CallHighWaterMarkCallback(size_t size);
+  /**
+   * Release the self_ in the functor calling phase
+   */
+  void QueueReleaseSelf();
   void SendInLoop(void const *data, size_t len);
   void SendInLoop(StringView data);
   void SendInLoopForStr(std::string &data);
@@ -304,6 +348,19 @@ class ConnectionBase
   RawAny context_;
   State state_; //!< Internal useage
 
+  /**
+   * The connection retain itself from ConnectionEstablished() to
+   * the functor calling phase after it is closed or destroyed.
+   * In the event handling phase, this is passed to the callbacks
+   * as borrowed reference instead of calling shared_from_this()
+   * for every message which cost atomic operations on the
+   * shared control block.
+   *
+   * The queued callbacks(write complete, high watermark) just bind
+   * this since it is released in the later functor.
+   */
+  ConnectionPtr self_;
+
 #ifdef KANON_ON_WIN
  public:
   std::vector<WSABUF> wsabufs;
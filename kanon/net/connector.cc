@@ -21,6 +21,18 @@ Connector::Connector(EventLoop *loop, InetAddr const &serv_addr)
   LOG_DEBUG_KANON << "Connector is constructed";
 }
 
+#ifdef KANON_ON_UNIX
+Connector::Connector(EventLoop *loop, UnixAddr const &serv_addr)
+  : loop_{loop}
+  , unix_addr_{new UnixAddr(serv_addr)}
+  , retry_interval_{INIT_RETRY_INTERVAL}
+  , state_{State::kDisconnected}
+  , connect_{true}
+{
+  LOG_DEBUG_KANON << "Connector is constructed";
+}
+#endif
+
 Connector::~Connector() KANON_NOEXCEPT
 {
   LOG_DEBUG_KANON << "Connector is destructed";
@@ -104,7 +116,7 @@ void Connector::Retry(FdType sockfd)
     double delay_sec =
         std::min<uint32_t>(retry_interval_, MAX_RETRY_INTERVAL) / 1000.0;
 
-    LOG_TRACE_KANON << "Client will reconnect to " << serv_addr_.ToIpPort()
+    LOG_TRACE_KANON << "Client will reconnect to " << GetServerName()
                     << " after " << delay_sec << " seconds";
 
     timer_ = loop_->RunAfter(
@@ -117,6 +129,14 @@ void Connector::Retry(FdType sockfd)
   }
 }
 
+std::string Connector::GetServerName() const
+{
+#ifdef KANON_ON_UNIX
+  if (unix_addr_) return unix_addr_->ToString();
+#endif
+  return serv_addr_.ToIpPort();
+}
+
 void Connector::ResetChannel()
 {
   // Ensure this is called in loop
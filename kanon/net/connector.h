@@ -11,6 +11,7 @@
 #include "kanon/util/optional.h"
 #include "kanon/util/ptr.h"
 #include "kanon/net/inet_addr.h"
+#include "kanon/net/unix_addr.h"
 
 namespace kanon {
 
@@ -53,6 +54,9 @@ class KANON_NET_NO_API Connector
 
  protected:
   Connector(EventLoop *loop, InetAddr const &serv_addr);
+#ifdef KANON_ON_UNIX
+  Connector(EventLoop *loop, UnixAddr const &serv_addr);
+#endif
 
  public:
   static std::shared_ptr<Connector> NewConnector(EventLoop *loop,
@@ -61,6 +65,18 @@ class KANON_NET_NO_API Connector
     return kanon::MakeSharedFromProtected<Connector>(loop, serv_addr);
   }
 
+#ifdef KANON_ON_UNIX
+  /**
+   * Connect to the unix domain socket \p serv_addr,
+   * GetServerAddr() is meaningless
+   */
+  static std::shared_ptr<Connector> NewConnector(EventLoop *loop,
+                                                 UnixAddr const &serv_addr)
+  {
+    return kanon::MakeSharedFromProtected<Connector>(loop, serv_addr);
+  }
+#endif
+
   ~Connector() KANON_NOEXCEPT;
 
   /**
@@ -107,6 +123,9 @@ class KANON_NET_NO_API Connector
  private:
   void SetState(State s) KANON_NOEXCEPT { state_ = s; }
 
+  //! Used for logging
+  std::string GetServerName() const;
+
   void Connect();
 
   /**
@@ -142,6 +161,9 @@ class KANON_NET_NO_API Connector
 
   EventLoop *loop_;
   InetAddr serv_addr_;
+#ifdef KANON_ON_UNIX
+  std::unique_ptr<UnixAddr> unix_addr_; //!< Not NULL if unix domain socket
+#endif
   uint32_t retry_interval_; //!< Time interval of retry connect
 
   std::unique_ptr<Channel> channel_;
@@ -115,23 +115,25 @@ EventLoop::EventLoop(bool is_poller)
 #endif
   , timer_queue_{kanon::make_unique<TimerQueue>(this)}
 {
+  ev_channel_->SetHandler(this);
+  ev_channel_->EnableReading();
+  LOG_TRACE_KANON << "EventLoop " << this << " created";
+}
 
-  ev_channel_->SetReadCallback([this](TimeStamp receive_time) {
-    LOG_TRACE_KANON << "EventFd receive_time: "
-                    << receive_time.ToFormattedString(true);
+void EventLoop::OnChannelRead(TimeStamp receive_time)
+{
+  LOG_TRACE_KANON_HOT << "EventFd receive_time: "
+                      << receive_time.ToFormattedString(true);
 #ifdef KANON_ON_UNIX
-    this->EvRead();
+  this->EvRead();
 #endif
-  });
+}
 
+void EventLoop::OnChannelWrite()
+{
 #ifdef KANON_ON_UNIX
-  ev_channel_->SetWriteCallback([this]() {
-    this->Wakeup();
-  });
+  this->Wakeup();
 #endif
-
-  ev_channel_->EnableReading();
-  LOG_TRACE_KANON << "EventLoop " << this << " created";
 }
 
 EventLoop::~EventLoop()
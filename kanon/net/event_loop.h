@@ -14,6 +14,7 @@
 
 #include "kanon/net/timer/timer_id.h"
 #include "kanon/net/callback.h"
+#include "kanon/net/channel_handler.h"
 
 namespace kanon {
 
@@ -38,7 +39,9 @@ class PollerBase;
  * They constrcut a loop to accept event and handle them,
  * and also handle the functors that user pushs.
  */
-class EventLoop : noncopyable {
+class EventLoop
+  : noncopyable
+  , ChannelHandler {
  public:
   using FunctorCallback = std::function<void()>;
 
@@ -231,6 +234,12 @@ class EventLoop : noncopyable {
    */
   KANON_NET_NO_API void EvRead() KANON_NOEXCEPT;
 
+  //! \name eventfd handler
+  //!@{
+  KANON_NET_NO_API void OnChannelRead(TimeStamp receive_time) KANON_OVERRIDE;
+  KANON_NET_NO_API void OnChannelWrite() KANON_OVERRIDE;
+  //!@}
+
   //! Abort the program if not satify the "One loop per thread" policy
   KANON_NET_NO_API void AbortNotInThread() KANON_NOEXCEPT;
 
@@ -192,6 +192,10 @@ bool sock::IsSelfConnect(FdType sockfd) KANON_NOEXCEPT
   // This is not a error of self-connect
   if (!local_ok || !peer_ok) return false;
 
+  // The unix domain socket can't connect to itself
+  if (local.sin6_family != AF_INET && local.sin6_family != AF_INET6)
+    return false;
+
   if (local.sin6_family == AF_INET) {
     auto local4 = sockaddr_cast<struct sockaddr_in const>(&local);
     auto peer4 = sockaddr_cast<struct sockaddr_in const>(&peer);
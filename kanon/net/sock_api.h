@@ -106,6 +106,11 @@ KANON_NET_NO_API FdType CreateNonBlockAndCloExecSocket(bool ipv6)
     KANON_NOEXCEPT;
 KANON_NET_NO_API FdType CreateOverlappedSocket(bool ipv6) KANON_NOEXCEPT;
 
+#ifdef KANON_ON_UNIX
+//! Create a unix domain stream socket
+KANON_NET_NO_API FdType CreateNonBlockAndCloExecUnixSocket() KANON_NOEXCEPT;
+#endif
+
 KANON_INLINE void Close(FdType fd) KANON_NOEXCEPT
 {
 #ifdef KANON_ON_WIN
@@ -141,6 +146,23 @@ KANON_INLINE int Connect(FdType fd, sockaddr const *addr) KANON_NOEXCEPT
   return ret;
 }
 
+//! \name The address whose length is variable, e.g. sockaddr_un
+//!@{
+KANON_INLINE void Bind(FdType fd, sockaddr const *addr,
+                       socklen_t len) KANON_NOEXCEPT
+{
+  if (::bind(fd, addr, len) < 0) {
+    LOG_SYSFATAL << "bind error";
+  }
+}
+
+KANON_INLINE int Connect(FdType fd, sockaddr const *addr,
+                         socklen_t len) KANON_NOEXCEPT
+{
+  return ::connect(fd, addr, len);
+}
+//!@}
+
 #ifdef KANON_ON_WIN
 KANON_NET_NO_API bool WinConnect(FdType fd, sockaddr const *addr,
                                  CompletionContext *ctx) KANON_NOEXCEPT;
@@ -9,6 +9,7 @@
 
 #include "kanon/log/logger.h"
 #include "kanon/net/inet_addr.h"
+#include "kanon/net/unix_addr.h"
 
 using namespace kanon;
 
@@ -19,6 +20,13 @@ void Socket::BindAddress(InetAddr const &addr) KANON_NOEXCEPT
   sock::Bind(fd_, addr.ToSockaddr());
 }
 
+#ifdef KANON_ON_UNIX
+void Socket::BindAddress(UnixAddr const &addr) KANON_NOEXCEPT
+{
+  sock::Bind(fd_, addr.ToSockaddr(), addr.GetLength());
+}
+#endif
+
 int Socket::Accpet(InetAddr &addr) KANON_NOEXCEPT
 {
   struct sockaddr_in6 addr6;
@@ -27,9 +35,10 @@ int Socket::Accpet(InetAddr &addr) KANON_NOEXCEPT
   if (cli_fd >= 0) {
     if (addr6.sin6_family == AF_INET) {
       new (&addr) InetAddr(*reinterpret_cast<sockaddr_in *>(&addr6));
-    } else {
+    } else if (addr6.sin6_family == AF_INET6) {
       new (&addr) InetAddr(addr6);
     }
+    // The peer of unix domain socket has no inet address
   }
 
   return cli_fd;
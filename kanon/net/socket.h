@@ -10,6 +10,7 @@
 namespace kanon {
 
 class InetAddr;
+class UnixAddr;
 
 //! \addtogroup net
 //!@{
@@ -36,6 +37,9 @@ class KANON_NET_NO_API Socket : noncopyable {
 
   // Must be called by server
   void BindAddress(InetAddr const &addr) KANON_NOEXCEPT;
+#ifdef KANON_ON_UNIX
+  void BindAddress(UnixAddr const &addr) KANON_NOEXCEPT;
+#endif
   int Accpet(InetAddr &addr) KANON_NOEXCEPT;
 
   void ShutdownWrite() KANON_NOEXCEPT;
@@ -7,6 +7,7 @@
 
 #include "kanon/net/event_loop.h"
 #include "kanon/net/inet_addr.h"
+#include "kanon/net/unix_addr.h"
 #include "kanon/net/connector.h"
 #include "kanon/net/connection/tcp_connection.h"
 #include "kanon/net/sock_api.h"
@@ -29,6 +30,22 @@ TcpClient::TcpClient(EventLoop *loop, InetAddr const &serv_addr,
                   << " is constructed";
 }
 
+#ifdef KANON_ON_UNIX
+TcpClient::TcpClient(EventLoop *loop, UnixAddr const &serv_addr,
+                     std::string const &name)
+  : loop_{loop}
+  , connector_{Connector::NewConnector(loop, serv_addr)}
+  , name_{name}
+  , connection_callback_{&DefaultConnectionCallback}
+  , retry_{false}
+  , conn_{nullptr}
+  , mutex_{}
+{
+  LOG_TRACE_KANON << "TcpClient-[" << name_ << "]"
+                  << " is constructed";
+}
+#endif
+
 InetAddr const &TcpClient::GetServerAddr() const KANON_NOEXCEPT
 {
   return connector_->GetServerAddr();
@@ -39,33 +56,31 @@ TcpClient::~TcpClient() KANON_NOEXCEPT
   LOG_TRACE_KANON << "TcpClient-[" << name_ << "]"
                   << " is destructed";
 
-  bool is_unique = false;
   TcpConnectionPtr conn;
   {
     MutexGuard guard{mutex_};
-
-    is_unique = (conn_.use_count() == 1); // not atomic
-
     // To write or read conn_ is not thread-safe,
-    // we can copy it first, for the duplication,
-    // it is thread-safe.
-    // Because conn_ if is not released, conn also.
-    // In the following operations, it is also alive
-    // since ref count is not 0(i.e. pinned). Otherwise,
-    // conn is released. we can't access it.
-    conn = conn_;
+    // take it first, then the client doesn't hold the connection
+    conn = std::move(conn_);
   }
 
-  LOG_INFO << "is_unique: " << is_unique;
-
   // Has established new connection
   if (conn) {
     assert(conn->GetLoop() == loop_);
     // Should not use old close callback
-    // may be other thread using it
-    if (is_unique) {
-      conn->ForceClose();
-    }
+    // may be other thread using it.
+    //
+    // The self reference is written in the loop, so decide the uniqueness
+    // in it. The functor owns the reference taken from the client, i.e.
+    // the connection is unique if there is no other one except the self.
+    loop_->RunInLoop(std::bind(
+        [](TcpConnectionPtr const &conn) {
+          const long self = conn->IsSelfRetained() ? 1 : 0;
+          if (conn.use_count() - self == 1) {
+            conn->ForceClose();
+          }
+        },
+        std::move(conn)));
   } else {
     // Disable the connector
     connector_->Stop();
@@ -115,8 +130,12 @@ void TcpClient::NewConnection(FdType sockfd, InetAddr const &serv_addr,
   LOG_DEBUG_KANON << "cli sc = " << cli.use_count();
 
   LOG_TRACE_KANON << " New connection fd = " << sockfd;
+  // The unix domain socket has no inet address
+  const auto local_addr = sock::GetLocalAddr(sockfd);
   auto new_conn = TcpConnection::NewTcpConnection(
-      cli->loop_, cli->name_, sockfd, sock::GetLocalAddr(sockfd), serv_addr);
+      cli->loop_, cli->name_, sockfd,
+      local_addr.sin6_family == AF_UNIX ? InetAddr() : InetAddr(local_addr),
+      serv_addr);
 
   LOG_TRACE_KANON << "New connection: " << new_conn.get();
   // Must copy callback instead of moving them
@@ -156,6 +175,19 @@ TcpClientPtr kanon::NewTcpClient(EventLoop *loop, InetAddr const &serv_addr,
   return ret;
 }
 
+#ifdef KANON_ON_UNIX
+TcpClientPtr kanon::NewTcpClient(EventLoop *loop, UnixAddr const &serv_addr,
+                                 std::string const &name, bool compact)
+{
+  auto ret =
+      compact
+          ? MakeSharedFromProtected<TcpClient>(loop, serv_addr, name)
+          : std::shared_ptr<TcpClient>(new TcpClient(loop, serv_addr, name));
+  ret->Init();
+  return ret;
+}
+#endif
+
 /*
  * Suppose `cli` is the object of `TcpClient` and `cli->conn` is the connection
  * member of it.
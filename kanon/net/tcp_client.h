@@ -18,6 +18,7 @@ namespace kanon {
 class Connector;
 class EventLoop;
 class InetAddr;
+class UnixAddr;
 class Channel;
 
 class TcpClient;
@@ -46,6 +47,14 @@ class TcpClient
   KANON_NET_NO_API TcpClient(EventLoop *loop, InetAddr const &serv_addr,
                              std::string const &name = {});
 
+#ifdef KANON_ON_UNIX
+  /**
+   * \param serv_addr The unix domain socket that server listening in
+   */
+  KANON_NET_NO_API TcpClient(EventLoop *loop, UnixAddr const &serv_addr,
+                             std::string const &name = {});
+#endif
+
  public:
   KANON_NET_API ~TcpClient() KANON_NOEXCEPT;
 
@@ -114,6 +123,10 @@ class TcpClient
  private:
   KANON_NET_API friend TcpClientPtr NewTcpClient(EventLoop *, InetAddr const &,
                                                  std::string const &, bool);
+#ifdef KANON_ON_UNIX
+  KANON_NET_API friend TcpClientPtr NewTcpClient(EventLoop *, UnixAddr const &,
+                                                 std::string const &, bool);
+#endif
 
   /* Register the callback
    * since can't do it in the ctor */
@@ -161,6 +174,19 @@ KANON_NET_API TcpClientPtr NewTcpClient(EventLoop *loop,
                                         std::string const &name = {},
                                         bool compact = true);
 
+#ifdef KANON_ON_UNIX
+/**
+ * \brief Create a client of the unix domain socket
+ *
+ * The connection is also TcpConnection, but the local and peer InetAddr
+ * of it are meaningless.
+ */
+KANON_NET_API TcpClientPtr NewTcpClient(EventLoop *loop,
+                                        UnixAddr const &serv_addr,
+                                        std::string const &name = {},
+                                        bool compact = true);
+#endif
+
 //!@}
 } // namespace kanon
 
@@ -4,6 +4,7 @@
 #include "kanon/util/ptr.h"
 
 #include "kanon/net/inet_addr.h"
+#include "kanon/net/unix_addr.h"
 #include "kanon/net/connection/tcp_connection.h"
 #include "kanon/net/event_loop.h"
 #include "kanon/net/event_loop_pool.h"
@@ -58,10 +59,27 @@ KANON_INLINE void SigTermHandler(int signo) KANON_NOEXCEPT
 
 TcpServer::TcpServer(EventLoop *loop, InetAddr const &listen_addr,
                      StringArg name, bool reuseport)
+  : TcpServer(loop, new Acceptor(loop, listen_addr, reuseport),
+              listen_addr.ToIpPort(), name, false)
+{
+}
+
+#ifdef KANON_ON_UNIX
+TcpServer::TcpServer(EventLoop *loop, UnixAddr const &listen_addr,
+                     StringArg name)
+  : TcpServer(loop, new Acceptor(loop, listen_addr), listen_addr.ToString(),
+              name, true)
+{
+}
+#endif
+
+TcpServer::TcpServer(EventLoop *loop, Acceptor *acceptor, std::string ip_port,
+                     StringArg name, bool unix_socket)
   : loop_{loop}
-  , ip_port_{listen_addr.ToIpPort()}
+  , ip_port_{std::move(ip_port)}
   , name_{name}
-  , acceptor_{kanon::make_unique<Acceptor>(loop_, listen_addr, reuseport)}
+  , unix_socket_{unix_socket}
+  , acceptor_{acceptor}
   , connection_callback_(&DefaultConnectionCallback)
   , next_conn_id{1}
   , pool_{kanon::make_unique<EventLoopPool>(loop,
@@ -89,7 +107,8 @@ TcpServer::TcpServer(EventLoop *loop, InetAddr const &listen_addr,
         auto conn_name = name_ + buf;
 
         auto io_loop = pool_->GetNextLoop();
-        auto local_addr = sock::GetLocalAddr(cli_sock);
+        auto local_addr =
+            unix_socket_ ? InetAddr() : InetAddr(sock::GetLocalAddr(cli_sock));
 
 #if 0
     TcpConnectionPtr conn;
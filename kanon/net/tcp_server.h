@@ -24,6 +24,7 @@ namespace kanon {
 
 class Acceptor;
 class InetAddr;
+class UnixAddr;
 class EventLoop;
 class EventLoopPool;
 
@@ -62,6 +63,17 @@ class TcpServer : noncopyable {
   KANON_NET_API TcpServer(EventLoop *loop, InetAddr const &listen_addr,
                           StringArg name, bool reuseport = false);
 
+#ifdef KANON_ON_UNIX
+  /**
+   * Listen in the unix domain socket \p listen_addr
+   *
+   * The connections are also TcpConnection, but the local and peer
+   * InetAddr of them are meaningless.
+   */
+  KANON_NET_API TcpServer(EventLoop *loop, UnixAddr const &listen_addr,
+                          StringArg name);
+#endif
+
   KANON_NET_API ~TcpServer() KANON_NOEXCEPT;
 
   //! Set the number of IO loop
@@ -183,9 +195,13 @@ class TcpServer : noncopyable {
   void ApplyAllPeers(ConnApplyCb cb);
 
  private:
+  TcpServer(EventLoop *loop, Acceptor *acceptor, std::string ip_port,
+            StringArg name, bool unix_socket);
+
   EventLoop *loop_;
-  std::string const ip_port_;
+  std::string const ip_port_; //!< Or "unix:path"
   std::string const name_;
+  bool const unix_socket_;
 
   std::unique_ptr<Acceptor> acceptor_;
 
@@ -0,0 +1,101 @@
+#ifndef KANON_NET_UNIX_ADDR_H
+#define KANON_NET_UNIX_ADDR_H
+
+#include "kanon/util/platform_macro.h"
+
+#ifdef KANON_ON_UNIX
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <string>
+
+#include "kanon/net/inet_addr.h"
+#include "kanon/string/string_view.h"
+#include "kanon/util/macro.h"
+
+namespace kanon {
+
+//! \addtogroup net
+//!@{
+
+/**
+ * \brief Represent a unix domain socket address(sockaddr_un)
+ *
+ * The path beginning with '@' is an address in the abstract namespace
+ * of Linux, i.e. no file is created in the file system.
+ *
+ * The stream connection of unix domain socket is also represented by
+ * TcpConnection, i.e. the same callbacks and upper layers(e.g. codec,
+ * rpc) can be used, but its local and peer InetAddr are meaningless.
+ */
+class UnixAddr {
+ public:
+  /**
+   * \param path
+   *   The path of socket file, or '@' + name in the abstract namespace
+   * \exception InetAddrException
+   *   The path is empty or too long
+   */
+  explicit UnixAddr(StringView path)
+  {
+    if (path.empty() || path.size() >= sizeof(addr_.sun_path)) {
+      throw InetAddrException("Invalid unix domain socket path: " +
+                              path.ToString());
+    }
+
+    ::memset(&addr_, 0, sizeof addr_);
+    addr_.sun_family = AF_UNIX;
+    ::memcpy(addr_.sun_path, path.data(), path.size());
+
+    // The name in the abstract namespace begins with '\0', isn't
+    // terminated by '\0', and its length is specified by the address length
+    const bool abstract = path[0] == '@';
+    if (abstract) addr_.sun_path[0] = '\0';
+    len_ = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) +
+                                  path.size() + (abstract ? 0 : 1));
+  }
+
+  //! The path passed to the constructor
+  std::string GetPath() const
+  {
+    if (IsAbstract()) {
+      return '@' + std::string(addr_.sun_path + 1, GetPathLength() - 1);
+    }
+    return addr_.sun_path;
+  }
+
+  //! Used for naming and logging, i.e. "unix:path"
+  std::string ToString() const { return "unix:" + GetPath(); }
+
+  bool IsAbstract() const KANON_NOEXCEPT
+  {
+    return addr_.sun_path[0] == '\0';
+  }
+
+  KANON_INLINE struct sockaddr const *ToSockaddr() const KANON_NOEXCEPT
+  {
+    return reinterpret_cast<sockaddr const *>(&addr_);
+  }
+
+  KANON_INLINE socklen_t GetLength() const KANON_NOEXCEPT { return len_; }
+
+ private:
+  size_t GetPathLength() const KANON_NOEXCEPT
+  {
+    return len_ - offsetof(struct sockaddr_un, sun_path) -
+           (IsAbstract() ? 0 : 1);
+  }
+
+  struct sockaddr_un addr_;
+  socklen_t len_;
+};
+
+//!@}
+
+} // namespace kanon
+
+#endif // KANON_ON_UNIX
+
+#endif // KANON_NET_UNIX_ADDR_H
@@ -3,6 +3,7 @@
 #include <google/protobuf/message.h>
 
 #include "chunk_stream.h"
+#include "input_stream.h"
 #include "kanon/protobuf/logger.h"
 #include "kanon/net/connection/tcp_connection.h"
 #include "kanon/net/endian_api.h"
@@ -62,38 +63,29 @@ void GenericPbCodec::Send(TcpConnectionPtr const &conn,
   LOG_DEBUG_KANON_PROTOBUF << "bytes = " << bytes;
   assert(buffer.GetReadableSize() == bytes + tag_.size());
 
-  auto state = XXH32_createState();
-  auto ok = XXH32_reset(state, 0) != XXH_ERROR;
-  KANON_ASSERT(ok, "XXH32_reset() error");
-
-  auto chunk_count = buffer.GetChunkSize() - 1;
-  auto beg = buffer.begin();
-  while (chunk_count--) {
-    beg->AdvanceWriteAll();
-    ok = XXH32_update(state, beg->GetReadBegin(), beg->GetReadableSize()) !=
-         XXH_ERROR;
-    KANON_ASSERT(ok, "XXH32_update() error");
-    ++beg;
-  }
-  assert(beg.next() == buffer.end());
-  ok = XXH32_update(state, beg->GetReadBegin(), beg->GetReadableSize()) !=
-       XXH_ERROR;
-  KANON_ASSERT(ok, "XXH32_update() error");
-  uint32_t check_sum = XXH32_digest(state);
-  XXH32_freeState(state);
-  LOG_DEBUG_KANON_PROTOBUF << "CheckSum = " << check_sum;
-
-  buffer.Prepend32(uint32_t(tag_.size() + bytes + kChecksumLength));
-  buffer.Append32(check_sum);
-
-  LOG_DEBUG_KANON_PROTOBUF << "buffer readable size = "
-                           << buffer.GetReadableSize();
+  SealFrame(buffer);
 #endif
   assert(buffer.GetReadableSize() ==
          tag_.size() + kSizeLength + bytes + kChecksumLength);
   conn->Send(buffer);
 }
 
+void GenericPbCodec::SealFrame(ChunkList &frame)
+{
+  // Checksum of (tag, body)
+  const auto size = frame.GetReadableSize();
+  uint32_t check_sum = 0;
+  {
+    ChunkInputStream stream(frame, size);
+    check_sum = ChecksumOfStream(&stream, size);
+  }
+  LOG_DEBUG_KANON_PROTOBUF << "CheckSum = " << check_sum;
+
+  // Don't count the size header
+  frame.Prepend32(uint32_t(size + kChecksumLength));
+  frame.Append32(check_sum);
+}
+
 void GenericPbCodec::OnMessage(TcpConnectionPtr const &conn, Buffer &buffer,
                                TimeStamp receive_time)
 {
@@ -127,12 +119,26 @@ void GenericPbCodec::OnMessage(TcpConnectionPtr const &conn, Buffer &buffer,
       error_callback_(conn, kInvalidLength);
       break;
     } else if (buffer.GetReadableSize() >= kSizeLength + size_header) {
+      char const *frame = buffer.GetReadBegin() + kSizeLength;
+      if (IsRawFrame(frame, size_header)) {
+        if (!CheckCheckSum(frame, size_header - kChecksumLength)) {
+          error_callback_(conn, kInvalidChecksum);
+          break;
+        }
+
+        raw_message_callback_(conn, frame + raw_tag_.size(),
+                              size_header - raw_tag_.size() - kChecksumLength,
+                              receive_time);
+        buffer.AdvanceRead(kSizeLength + size_header);
+        continue;
+      }
+
       // Coming a complete message
       // Message::New() is a virtual copy constructor(see prototype pattern)
       //
       // Don't call make_unique<>(), we just use the RAII property of
       // std::unique_ptr<>
-      auto message = std::unique_ptr<PROTOBUF::Message>(prototype_->New());
+      auto message = NewMessage();
 
       const auto error_code =
           Parse(buffer.GetReadBegin() + kSizeLength, size_header, *message);
@@ -183,6 +189,132 @@ auto GenericPbCodec::Parse(char const *buffer, uint32_t size,
   return ret;
 }
 
+void GenericPbCodec::OnMessage(TcpConnectionPtr const &conn, ChunkList &buffer,
+                               TimeStamp receive_time)
+{
+  // The same logic with the Buffer version,
+  // but the size header may be span chunks also
+  while (true) {
+    const auto readable_size = buffer.GetReadableSize();
+
+    if (readable_size >= kMaxMessageLength) {
+      LOG_WARN_KANON_PROTOBUF << "A single message too large, just discard";
+      buffer.AdvanceRead(readable_size);
+      error_callback_(conn, kInvalidLength);
+      return;
+    }
+
+    if (readable_size < kMinMessageLength) break;
+
+    uint32_t size_header = 0;
+    ChunkInputStream stream(buffer, kSizeLength);
+    ReadFromStream(&stream, &size_header, kSizeLength);
+    size_header = sock::ToHostByteOrder32(size_header);
+    LOG_DEBUG_KANON_PROTOBUF << "size_header = " << size_header;
+
+    if (size_header < kChecksumLength + tag_.size() ||
+        size_header >= kMaxMessageLength)
+    {
+      error_callback_(conn, kInvalidLength);
+      break;
+    } else if (readable_size >= kSizeLength + size_header) {
+      if (!raw_tag_.empty() &&
+          size_header >= raw_tag_.size() + kChecksumLength) {
+        ChunkInputStream tag_stream(buffer, kSizeLength + size_header);
+        tag_stream.Skip(kSizeLength);
+
+        if (CompareWithStream(&tag_stream, raw_tag_.data(), raw_tag_.size()))
+        {
+          // The raw frame is handled in contiguous memory
+          std::string frame(size_header, 0);
+          ChunkInputStream frame_stream(buffer, kSizeLength + size_header);
+          frame_stream.Skip(kSizeLength);
+          ReadFromStream(&frame_stream, &frame[0], size_header);
+
+          if (!CheckCheckSum(frame.data(), size_header - kChecksumLength)) {
+            error_callback_(conn, kInvalidChecksum);
+            break;
+          }
+
+          raw_message_callback_(conn, frame.data() + raw_tag_.size(),
+                                size_header - raw_tag_.size() -
+                                    kChecksumLength,
+                                receive_time);
+          buffer.AdvanceRead(kSizeLength + size_header);
+          continue;
+        }
+      }
+
+      auto message = NewMessage();
+
+      const auto error_code = Parse(buffer, size_header, *message);
+
+      if (error_code == kNoError) {
+        message_callback_(conn, GetPointer(message), receive_time);
+        buffer.AdvanceRead(kSizeLength + size_header);
+      } else {
+        error_callback_(conn, error_code);
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+}
+
+auto GenericPbCodec::Parse(ChunkList const &buffer, uint32_t size,
+                           PROTOBUF::Message &message) -> ErrorCode
+{
+  const uint32_t checked_size = size - kChecksumLength;
+
+  // 1. Compute the checksum of (tag, payload) chunk by chunk
+  ChunkInputStream stream(buffer, kSizeLength + size);
+  stream.Skip(kSizeLength);
+
+  const uint32_t new_checksum = ChecksumOfStream(&stream, checked_size);
+
+  uint32_t old_checksum = 0;
+  ReadFromStream(&stream, &old_checksum, kChecksumLength);
+  old_checksum = sock::ToHostByteOrder32(old_checksum);
+
+  LOG_DEBUG_KANON_PROTOBUF << "new_checksum = " << new_checksum;
+  LOG_DEBUG_KANON_PROTOBUF << "old_checksum = " << old_checksum;
+  if (new_checksum != old_checksum) return kInvalidChecksum;
+
+  // 2. Check the tag and parse the payload in place
+  ChunkInputStream payload_stream(buffer, kSizeLength + checked_size);
+  payload_stream.Skip(kSizeLength);
+
+  if (!CompareWithStream(&payload_stream, tag_.data(), tag_.size())) {
+    return kInvalidMessage;
+  }
+
+  if (!message.ParseFromZeroCopyStream(&payload_stream)) return kParseError;
+
+  LOG_DEBUG_KANON_PROTOBUF << "[parse message] = " << message.DebugString();
+  return kNoError;
+}
+
+bool GenericPbCodec::IsRawFrame(char const *frame, uint32_t size) const noexcept
+{
+  return !raw_tag_.empty() && size >= raw_tag_.size() + kChecksumLength &&
+         0 == ::memcmp(frame, raw_tag_.data(), raw_tag_.size());
+}
+
+auto GenericPbCodec::NewMessage() -> MessageUniquePtr
+{
+  auto arena = arena_callback_ ? arena_callback_() : nullptr;
+  return MessageUniquePtr(prototype_->New(arena),
+                          MessageDeleter{arena != nullptr});
+}
+
+void GenericPbCodec::MessageDeleter::operator()(
+    PROTOBUF::Message *message) const noexcept
+{
+  // The message in arena is freed by the arena owner
+  if (!in_arena) delete message;
+}
+
 bool GenericPbCodec::ParseFromBuffer(char const *buffer, int length,
                                      PROTOBUF::Message &message)
 {
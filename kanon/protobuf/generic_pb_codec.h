@@ -20,6 +20,7 @@ namespace protobuf {
 
 // fwd
 class Message;
+class Arena;
 
 } // namespace protobuf
 } // namespace google
@@ -70,6 +71,23 @@ class GenericPbCodec : noncopyable {
   using ErrorCallback =
       std::function<void(TcpConnectionPtr const &, ErrorCode)>;
 
+  /**
+   * Return the arena which the incoming message is created on,
+   * NULL indicates the heap.
+   *
+   * The message created on the arena is not deleted by codec,
+   * the arena owner should reset it after handling the message.
+   */
+  using ArenaCallback = std::function<PROTOBUF::Arena *()>;
+
+  /**
+   * Handle the body(i.e. the contents between tag and checksum)
+   * of the frame with raw tag, which is not a protobuf message
+   */
+  using RawMessageCallback =
+      std::function<void(TcpConnectionPtr const &, char const *body,
+                         size_t size, TimeStamp)>;
+
   GenericPbCodec(PROTOBUF::Message const *prototype, std::string const &tag);
 
   ~GenericPbCodec();
@@ -82,6 +100,16 @@ class GenericPbCodec : noncopyable {
    */
   void Send(TcpConnectionPtr const &conn, PROTOBUF::Message const *message);
 
+  /**
+   * Fill the size header and checksum of \p frame
+   *
+   * \param frame Contains the tag and the body of frame, then it is a
+   *              complete raw message that can be sent directly.
+   *              This allow user write custom body(e.g. serialize
+   *              message by ChunkStream directly) in the frame.
+   */
+  static void SealFrame(ChunkList &frame);
+
   /**
    * Decode the raw message, which is protobuf-format binary data
    * \param buffer Contains the raw binary data
@@ -89,6 +117,15 @@ class GenericPbCodec : noncopyable {
   void OnMessage(TcpConnectionPtr const &conn, Buffer &buffer,
                  TimeStamp receive_time);
 
+  /**
+   * Decode the raw message stored in the chunked input buffer
+   *
+   * The message span chunks is parsed through the ChunkInputStream,
+   * i.e. it is not flattened to a contiguous buffer.
+   */
+  void OnMessage(TcpConnectionPtr const &conn, ChunkList &buffer,
+                 TimeStamp receive_time);
+
   /**
    * Serialize @p message to @p buffer
    */
@@ -110,6 +147,13 @@ class GenericPbCodec : noncopyable {
   ErrorCode Parse(char const *buffer, uint32_t size,
                   PROTOBUF::Message &message);
 
+  /**
+   * Same as the above, but the message(skip the size header) is stored
+   * in the chunks of @p buffer
+   */
+  ErrorCode Parse(ChunkList const &buffer, uint32_t size,
+                  PROTOBUF::Message &message);
+
   // Setter
   void SetMessageCallback(MessageCallback cb) noexcept
   {
@@ -119,6 +163,24 @@ class GenericPbCodec : noncopyable {
   {
     error_callback_ = std::move(cb);
   }
+  void SetArenaCallback(ArenaCallback cb) noexcept
+  {
+    arena_callback_ = std::move(cb);
+  }
+
+  /**
+   * The frames with \p tag are passed to \p cb instead of parsing
+   * as message, i.e. the raw frames and message can be mixed in the
+   * same connection.
+   *
+   * \note
+   *   The length of \p tag should be same with the message tag
+   */
+  void SetRawMessageCallback(std::string const &tag, RawMessageCallback cb)
+  {
+    raw_tag_ = tag;
+    raw_message_callback_ = std::move(cb);
+  }
 
  private: /** Helper */
   /**
@@ -133,6 +195,28 @@ class GenericPbCodec : noncopyable {
 
   static char const *ErrorToString(ErrorCode err) noexcept;
 
+  /**
+   * Don't access the message to check the arena since the arena
+   * may be reset in the message callback.
+   */
+  struct MessageDeleter {
+    bool in_arena;
+    void operator()(PROTOBUF::Message *message) const noexcept;
+  };
+
+  using MessageUniquePtr = std::unique_ptr<PROTOBUF::Message, MessageDeleter>;
+
+  /**
+   * Check whether the \p frame(skip the size header) is a raw frame
+   * \param size The size header
+   */
+  bool IsRawFrame(char const *frame, uint32_t size) const noexcept;
+
+  /**
+   * Create a message from the prototype on the arena(if any)
+   */
+  MessageUniquePtr NewMessage();
+
   // For debugging
   void PrintRawMessage(kanon::Buffer &buffer);
 
@@ -156,6 +240,13 @@ class GenericPbCodec : noncopyable {
 
   /** Handle error occurred in parsing */
   ErrorCallback error_callback_;
+
+  /** Provide the arena of the incoming message(optional) */
+  ArenaCallback arena_callback_;
+
+  /** Identify the frame handled by raw_message_callback_(optional) */
+  std::string raw_tag_;
+  RawMessageCallback raw_message_callback_;
 };
 
 } // namespace internal
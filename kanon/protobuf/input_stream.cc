@@ -0,0 +1,178 @@
+#include "input_stream.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+
+// Allocate XXH32_state_t in stack
+#define XXH_STATIC_LINKING_ONLY
+#include <third-party/xxHash/xxhash.h>
+
+using namespace kanon::protobuf;
+using namespace ::google::protobuf::io;
+
+static constexpr size_t kMaxSegmentSize = INT_MAX;
+
+BufferInputStream::BufferInputStream(Buffer const &buffer, size_t limit)
+  : data_(buffer.GetReadBegin())
+  , size_(std::min(limit, buffer.GetReadableSize()))
+  , pos_(0)
+  , last_size_(0)
+{
+}
+
+bool BufferInputStream::Next(void const **data, int *size)
+{
+  if (pos_ >= size_) {
+    last_size_ = 0;
+    return false;
+  }
+
+  last_size_ = (int)std::min(size_ - pos_, kMaxSegmentSize);
+  *data = data_ + pos_;
+  *size = last_size_;
+  pos_ += last_size_;
+  return true;
+}
+
+void BufferInputStream::BackUp(int count)
+{
+  assert(count >= 0 && count <= last_size_);
+  pos_ -= count;
+  last_size_ = 0;
+}
+
+bool BufferInputStream::Skip(int count)
+{
+  assert(count >= 0);
+  last_size_ = 0;
+  if (size_ - pos_ < (size_t)count) {
+    pos_ = size_;
+    return false;
+  }
+
+  pos_ += count;
+  return true;
+}
+
+ChunkInputStream::ChunkInputStream(ChunkList const &buffer, size_t limit)
+  : chunk_(buffer.begin())
+  , end_(buffer.end())
+  , offset_(0)
+  , byte_count_(0)
+  , limit_(limit)
+  , last_size_(0)
+{
+}
+
+bool ChunkInputStream::Next(void const **data, int *size)
+{
+  last_size_ = 0;
+  while (chunk_ != end_ && byte_count_ < limit_) {
+    auto const readable = chunk_->GetReadableSize() - offset_;
+    if (readable == 0) {
+      ++chunk_;
+      offset_ = 0;
+      continue;
+    }
+
+    last_size_ = (int)std::min(std::min<size_t>(readable, limit_ - byte_count_),
+                               kMaxSegmentSize);
+    *data = chunk_->GetReadBegin() + offset_;
+    *size = last_size_;
+    offset_ += last_size_;
+    byte_count_ += last_size_;
+    return true;
+  }
+
+  return false;
+}
+
+void ChunkInputStream::BackUp(int count)
+{
+  // The last Next() don't move to the next chunk,
+  // just rewind the offset
+  assert(count >= 0 && count <= last_size_);
+  offset_ -= count;
+  byte_count_ -= count;
+  last_size_ = 0;
+}
+
+bool ChunkInputStream::Skip(int count)
+{
+  assert(count >= 0);
+  void const *data;
+  int size;
+
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+
+  return true;
+}
+
+bool kanon::protobuf::ReadFromStream(ZeroCopyInputStream *stream, void *data,
+                                     size_t len)
+{
+  auto out = static_cast<char *>(data);
+  void const *seg;
+  int size;
+
+  while (len > 0) {
+    if (!stream->Next(&seg, &size)) return false;
+    if ((size_t)size > len) {
+      ::memcpy(out, seg, len);
+      stream->BackUp(size - (int)len);
+      return true;
+    }
+    ::memcpy(out, seg, size);
+    out += size;
+    len -= size;
+  }
+
+  return true;
+}
+
+bool kanon::protobuf::CompareWithStream(ZeroCopyInputStream *stream,
+                                        void const *data, size_t len)
+{
+  auto cmp = static_cast<char const *>(data);
+  void const *seg;
+  int size;
+
+  while (len > 0) {
+    if (!stream->Next(&seg, &size)) return false;
+    const auto n = std::min<size_t>(size, len);
+    if (::memcmp(seg, cmp, n) != 0) return false;
+    if ((size_t)size > n) stream->BackUp(size - (int)n);
+    cmp += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+uint32_t kanon::protobuf::ChecksumOfStream(ZeroCopyInputStream *stream,
+                                           size_t len)
+{
+  XXH32_state_t state;
+  XXH32_reset(&state, 0);
+
+  void const *seg;
+  int size;
+  while (len > 0 && stream->Next(&seg, &size)) {
+    const auto n = std::min<size_t>(size, len);
+    XXH32_update(&state, seg, n);
+    if ((size_t)size > n) stream->BackUp(size - (int)n);
+    len -= n;
+  }
+
+  return XXH32_digest(&state);
+}
@@ -0,0 +1,132 @@
+#ifndef KANON_PROTOBUF_INPUT_STREAM_H_
+#define KANON_PROTOBUF_INPUT_STREAM_H_
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include "kanon/buffer/buffer.h"
+#include "kanon/buffer/chunk_list.h"
+
+namespace kanon {
+namespace protobuf {
+
+/**
+ * The counterpart of ChunkStream.
+ *
+ * Read the readable contents of the Buffer without copying
+ * them, i.e. protobuf can parse message from the buffer
+ * by ParseFromZeroCopyStream().
+ *
+ * The stream don't consume the buffer, caller should call
+ * Buffer::AdvanceRead() after parsing.
+ *
+ * \note
+ *   The buffer must not be modified when the stream is alive
+ * \see ZeroCopyInputStream
+ */
+class BufferInputStream : public ::google::protobuf::io::ZeroCopyInputStream {
+ public:
+  /**
+   * \param limit The maximum bytes can be read from the buffer,
+   *              -1 indicates all readable contents
+   */
+  explicit BufferInputStream(Buffer const &buffer, size_t limit = -1);
+
+  /**
+   * Return the remaining contents(in limit) at once
+   */
+  bool Next(void const **data, int *size) override;
+
+  /**
+   * Backs up a number of bytes returned by the last Next()
+   */
+  void BackUp(int count) override;
+
+  bool Skip(int count) override;
+
+  /**
+   * Get the bytes has been read
+   */
+  int64_t ByteCount() const override { return (int64_t)pos_; }
+
+ private:
+  char const *data_;
+  size_t size_;
+  size_t pos_;
+  int last_size_;
+};
+
+/**
+ * The counterpart of ChunkStream.
+ *
+ * Read the readable contents of the ChunkList chunk by chunk,
+ * the message span chunks can be parsed without flattening it
+ * into a contiguous buffer.
+ *
+ * The stream don't consume the chunk list, caller should call
+ * ChunkList::AdvanceRead() after parsing.
+ *
+ * \note
+ *   The chunk list must not be modified when the stream is alive
+ * \see ZeroCopyInputStream
+ */
+class ChunkInputStream : public ::google::protobuf::io::ZeroCopyInputStream {
+ public:
+  /**
+   * \param limit The maximum bytes can be read from the chunk list,
+   *              -1 indicates all readable contents
+   */
+  explicit ChunkInputStream(ChunkList const &buffer, size_t limit = -1);
+
+  /**
+   * Return the readable contents of current chunk(in limit)
+   */
+  bool Next(void const **data, int *size) override;
+
+  /**
+   * Backs up a number of bytes returned by the last Next()
+   */
+  void BackUp(int count) override;
+
+  bool Skip(int count) override;
+
+  /**
+   * Get the bytes has been read
+   */
+  int64_t ByteCount() const override { return (int64_t)byte_count_; }
+
+ private:
+  ChunkList::const_iterator chunk_;
+  ChunkList::const_iterator end_;
+  size_t offset_;     //!< Offset in the current chunk
+  size_t byte_count_; //!< Read bytes
+  size_t limit_;
+  int last_size_;
+};
+
+/**
+ * Copy \p len bytes to \p data from \p stream
+ * \return
+ *   false if the stream has no \p len bytes
+ */
+bool ReadFromStream(::google::protobuf::io::ZeroCopyInputStream *stream,
+                    void *data, size_t len);
+
+/**
+ * Compare the next \p len bytes of \p stream with \p data
+ * \return
+ *   false if not equal or the stream has no \p len bytes
+ */
+bool CompareWithStream(::google::protobuf::io::ZeroCopyInputStream *stream,
+                       void const *data, size_t len);
+
+/**
+ * Compute the XXH32 checksum(seed = 0) of the next \p len bytes
+ * of \p stream segment by segment
+ */
+uint32_t ChecksumOfStream(::google::protobuf::io::ZeroCopyInputStream *stream,
+                          size_t len);
+
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_PROTOBUF_INPUT_STREAM_H_
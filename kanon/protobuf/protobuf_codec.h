@@ -26,6 +26,8 @@ class ProtobufCodec : noncopyable {
     std::function<void(TcpConnectionPtr const&, ConcreteMessagePtr, TimeStamp)>;
 
   using ErrorCallback = Codec::ErrorCallback;
+  using ArenaCallback = Codec::ArenaCallback;
+  using RawMessageCallback = Codec::RawMessageCallback;
 public:
   /**
    * \warning 
@@ -48,12 +50,20 @@ public:
   
   void Send(TcpConnectionPtr const& conn, PROTOBUF::Message const* message)
   { generic_codec_.Send(conn, message); }
+
+  static void SealFrame(ChunkList& frame) { Codec::SealFrame(frame); }
   
   void SetErrorCallback(ErrorCallback cb) noexcept { generic_codec_.SetErrorCallback(std::move(cb)); }
   void SetMessageCallback(MessageCallback cb) noexcept { message_callback_ = std::move(cb); }
+  void SetArenaCallback(ArenaCallback cb) noexcept { generic_codec_.SetArenaCallback(std::move(cb)); }
+  void SetRawMessageCallback(std::string const& tag, RawMessageCallback cb)
+  { generic_codec_.SetRawMessageCallback(tag, std::move(cb)); }
 
   void OnMessage(TcpConnectionPtr const& conn, Buffer& buffer, TimeStamp receive_time)
   { generic_codec_.OnMessage(conn, buffer, receive_time); }
+
+  void OnMessage(TcpConnectionPtr const& conn, ChunkList& buffer, TimeStamp receive_time)
+  { generic_codec_.OnMessage(conn, buffer, receive_time); }
   
   ~ProtobufCodec() = default; 
 private:
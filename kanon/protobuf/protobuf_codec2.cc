@@ -1,8 +1,11 @@
 #include "kanon/protobuf/protobuf_codec2.h"
 
+#include <algorithm>
+
 #include <google/protobuf/message.h>
 
 #include "chunk_stream.h"
+#include "input_stream.h"
 #include "kanon/protobuf/logger.h"
 #include "kanon/buffer/chunk_list.h"
 #include "kanon/net/connection/tcp_connection.h"
@@ -123,6 +126,97 @@ void ProtobufCodec2::SetUpConnection(TcpConnectionPtr const &conn)
   });
 }
 
+void ProtobufCodec2::OnMessage(TcpConnectionPtr const &conn, ChunkList &buffer,
+                               TimeStamp receive_time)
+{
+  while (true) {
+    const auto readable_size = buffer.GetReadableSize();
+
+    // Discard too large buffer early to avoid making memory overflow
+    if (readable_size >= max_size_) {
+      LOG_WARN_KANON_PROTOBUF << "A single message too large, just discard";
+      buffer.AdvanceRead(readable_size);
+      error_callback_(conn, E_INVALID_SIZE_HEADER);
+      return;
+    }
+
+    // The size header may be span chunks, copy it
+    // (5 bytes at most for varint32)
+    char header_buf[5];
+    const auto header_buf_len =
+        std::min<size_t>(sizeof header_buf, readable_size);
+    {
+      ChunkInputStream stream(buffer, header_buf_len);
+      ReadFromStream(&stream, header_buf, header_buf_len);
+    }
+
+    uint32_t size_header = 0;
+    size_t size_header_len = 0;
+    switch (kvarint_decode32(header_buf, header_buf_len, &size_header_len,
+                             &size_header))
+    {
+      case KVARINT_OK:
+        break;
+      case KVARINT_DECODE_BUF_INVALID:
+        error_callback_(conn, E_INVALID_MESSAGE);
+        return;
+      case KVARINT_DECODE_BUF_SHORT:
+        return;
+    }
+
+    if (size_header < tag_.size() + CHECKSUM_LENGTH ||
+        size_header >= max_size_ - size_header_len)
+    {
+      error_callback_(conn, E_INVALID_SIZE_HEADER);
+      break;
+    }
+
+    // Waiting complete message
+    if (readable_size - size_header_len < size_header) break;
+
+    {
+      ChunkInputStream stream(buffer, size_header_len + size_header);
+      stream.Skip(size_header_len);
+
+      const auto calculated_check_sum =
+          ChecksumOfStream(&stream, size_header - CHECKSUM_LENGTH);
+      CheckSumType prepared_checksum = 0;
+      ReadFromStream(&stream, &prepared_checksum, CHECKSUM_LENGTH);
+      if (calculated_check_sum != sock::ToHostByteOrder32(prepared_checksum)) {
+        error_callback_(conn, E_INVALID_CHECKSUM);
+        break;
+      }
+    }
+
+    {
+      ChunkInputStream stream(buffer, size_header_len + tag_.size());
+      stream.Skip(size_header_len);
+      if (!CompareWithStream(&stream, tag_.data(), tag_.size())) {
+        error_callback_(conn, E_INVALID_MESSAGE);
+        break;
+      }
+    }
+
+    buffer.AdvanceRead(size_header_len + tag_.size());
+    const size_t payload_size = size_header - tag_.size() - CHECKSUM_LENGTH;
+    if (chunk_message_callback_) {
+      chunk_message_callback_(conn, buffer, payload_size, receive_time);
+    } else {
+      // Only the message callback is set, flatten the payload for it
+      Buffer payload;
+      payload.ReserveWriteSpace(payload_size);
+      {
+        ChunkInputStream stream(buffer, payload_size);
+        ReadFromStream(&stream, payload.GetWriteBegin(), payload_size);
+      }
+      payload.AdvanceWrite(payload_size);
+      buffer.AdvanceRead(payload_size);
+      message_callback_(conn, payload, payload_size, receive_time);
+    }
+    buffer.AdvanceRead(CHECKSUM_LENGTH);
+  }
+}
+
 void ProtobufCodec2::Send(TcpConnection *const conn,
                           ::google::protobuf::Message const *message)
 {
@@ -248,3 +342,22 @@ bool kanon::protobuf::ParsePartialFromBuffer(
   if (ret) buffer->AdvanceRead(payload_size);
   return ret;
 }
+
+bool kanon::protobuf::ParseFromChunkList(::google::protobuf::Message *message,
+                                         size_t payload_size, ChunkList *buffer)
+{
+  ChunkInputStream stream(*buffer, payload_size);
+  auto ret = message->ParseFromZeroCopyStream(&stream);
+  if (ret) buffer->AdvanceRead(payload_size);
+  return ret;
+}
+
+bool kanon::protobuf::ParsePartialFromChunkList(
+    ::google::protobuf::Message *message, size_t payload_size,
+    ChunkList *buffer)
+{
+  ChunkInputStream stream(*buffer, payload_size);
+  auto ret = message->ParsePartialFromZeroCopyStream(&stream);
+  if (ret) buffer->AdvanceRead(payload_size);
+  return ret;
+}
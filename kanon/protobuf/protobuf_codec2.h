@@ -23,6 +23,7 @@ class Message;
 namespace kanon {
 
 class Buffer;
+class ChunkList;
 
 namespace protobuf {
 
@@ -91,6 +92,15 @@ class ProtobufCodec2 : noncopyable {
       std::function<void(TcpConnectionPtr const &conn, Buffer &buffer,
                          size_t payload_size, TimeStamp recv_time)>;
 
+  /**
+   * Same as MessageCallback, but the payload is stored in the chunked
+   * input buffer(may be span chunks).
+   * \see ParseFromChunkList()
+   */
+  using ChunkMessageCallback =
+      std::function<void(TcpConnectionPtr const &conn, ChunkList &buffer,
+                         size_t payload_size, TimeStamp recv_time)>;
+
   /**
    * \param conn
    * \param errcode see \ref ProtobufCodec2::ErrorCode to get more information
@@ -112,6 +122,17 @@ class ProtobufCodec2 : noncopyable {
    */
   void SetUpConnection(TcpConnectionPtr const &conn);
 
+  /**
+   * Decode the messages stored in the chunked input buffer
+   * and call the chunk message callback
+   *
+   * The message span chunks is not flattened to a contiguous buffer.
+   * If the chunk message callback is not set, the payload is copied to
+   * a Buffer and the message callback is called instead.
+   */
+  void OnMessage(TcpConnectionPtr const &conn, ChunkList &buffer,
+                 TimeStamp recv_time);
+
   /**
    * Send @p message into @p conn
    *
@@ -147,6 +168,10 @@ class ProtobufCodec2 : noncopyable {
     message_callback_ = std::move(cb);
   }
   void SetErrorCallback(ErrorCallback cb) { error_callback_ = std::move(cb); }
+  void SetChunkMessageCallback(ChunkMessageCallback cb)
+  {
+    chunk_message_callback_ = std::move(cb);
+  }
 
  private:
   static KANON_INLINE uint32_t GetCheckSum(void const *buffer,
@@ -167,6 +192,9 @@ class ProtobufCodec2 : noncopyable {
   /** Handle message of payload */
   MessageCallback message_callback_;
 
+  /** Handle message of payload stored in chunks */
+  ChunkMessageCallback chunk_message_callback_;
+
   /** Handle error occurred in parsing */
   ErrorCallback error_callback_;
 };
@@ -176,6 +204,11 @@ bool ParseFromBuffer(::google::protobuf::Message *message, size_t payload_size,
 bool ParsePartialFromBuffer(::google::protobuf::Message *message,
                             size_t payload_size, Buffer *buffer);
 
+bool ParseFromChunkList(::google::protobuf::Message *message,
+                        size_t payload_size, ChunkList *buffer);
+bool ParsePartialFromChunkList(::google::protobuf::Message *message,
+                               size_t payload_size, ChunkList *buffer);
+
 #define DEF_SPECIFIC_TAG_PROTOBUF_CODEC(codec_name_, tag_, msize_)             \
   class codec_name_ : public ::kanon::protobuf::ProtobufCodec2 {               \
    public:                                                                     \
@@ -0,0 +1,52 @@
+#include "arena_pool.h"
+
+#include <google/protobuf/arena.h>
+
+using namespace kanon::protobuf::rpc;
+using PROTOBUF::Arena;
+
+struct ArenaPool::Entry {
+  explicit Entry(size_t block_size)
+    : block(new char[block_size])
+    , arena(new Arena(block.get(), block_size))
+  {
+  }
+
+  // arena must be destroyed before the block
+  std::unique_ptr<char[]> block;
+  std::unique_ptr<Arena> arena;
+};
+
+constexpr size_t ArenaPool::kDefaultBlockSize;
+
+ArenaPool::ArenaPool(size_t block_size)
+  : block_size_(block_size)
+{
+}
+
+ArenaPool::~ArenaPool() noexcept = default;
+
+Arena *ArenaPool::Get()
+{
+  if (!idle_arenas_.empty()) {
+    auto arena = idle_arenas_.back();
+    idle_arenas_.pop_back();
+    return arena;
+  }
+
+  entries_.emplace_back(new Entry(block_size_));
+  return entries_.back()->arena.get();
+}
+
+void ArenaPool::Put(Arena *arena)
+{
+  // The blocks except the initial block are freed
+  arena->Reset();
+  idle_arenas_.push_back(arena);
+}
+
+ArenaPool &ArenaPool::GetLoopPool()
+{
+  static thread_local ArenaPool pool;
+  return pool;
+}
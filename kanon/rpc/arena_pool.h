@@ -0,0 +1,76 @@
+#ifndef KANON_RPC_ARENA_POOL_H__
+#define KANON_RPC_ARENA_POOL_H__
+
+#include <memory>
+#include <vector>
+
+#include "kanon/util/noncopyable.h"
+
+#define PROTOBUF ::google::protobuf
+
+namespace google {
+namespace protobuf {
+
+class Arena;
+
+} // namespace protobuf
+} // namespace google
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Pool of the protobuf arena
+ *
+ * Each arena owns an initial block allocated by the pool,
+ * Arena::Reset() don't free it, i.e. the messages of a rpc call
+ * (request, response, RpcMessage, etc.) are allocated in the block
+ * without any heap allocation if the block is large enough.
+ *
+ * \note
+ *   Not thread-safe, should be used in the loop thread only
+ *   (see GetLoopPool())
+ */
+class ArenaPool : noncopyable {
+ public:
+  static constexpr size_t kDefaultBlockSize = 4096;
+
+  explicit ArenaPool(size_t block_size = kDefaultBlockSize);
+  ~ArenaPool() noexcept;
+
+  /**
+   * Get an idle arena, create a new one if there is no idle arena
+   */
+  PROTOBUF::Arena *Get();
+
+  /**
+   * Reset the \p arena and recycle it
+   * \param arena Must be got from this pool
+   */
+  void Put(PROTOBUF::Arena *arena);
+
+  size_t GetIdleSize() const noexcept { return idle_arenas_.size(); }
+  size_t GetSize() const noexcept { return entries_.size(); }
+
+  /**
+   * Get the pool of the current loop
+   *
+   * One loop per thread, the pool is a thread-local object,
+   * i.e. the pool is per loop.
+   */
+  static ArenaPool &GetLoopPool();
+
+ private:
+  struct Entry;
+
+  size_t block_size_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::vector<PROTOBUF::Arena *> idle_arenas_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_ARENA_POOL_H__
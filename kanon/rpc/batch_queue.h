@@ -0,0 +1,131 @@
+#ifndef KANON_RPC_BATCH_QUEUE_H__
+#define KANON_RPC_BATCH_QUEUE_H__
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "kanon/net/event_loop.h"
+#include "kanon/thread/mutex_lock.h"
+#include "kanon/util/noncopyable.h"
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Collect the items posted in a batch and flush them at once
+ *
+ * In the loop, the items posted between BeginBatch() and EndBatch()
+ * (e.g. the responses of the requests decoded from an input buffer) are
+ * flushed at EndBatch(), the items posted out of batch are flushed
+ * immediately.
+ *
+ * The items posted in the other threads are flushed in the loop in batch,
+ * i.e. only the first posting of a batch queues a functor to the loop, and
+ * the functor flushes all posted items.
+ *
+ * \note
+ *   Must be managed by std::shared_ptr since the functor queued
+ *   keeps it alive
+ */
+template <typename T>
+class BatchQueue
+  : noncopyable
+  , public std::enable_shared_from_this<BatchQueue<T>> {
+ public:
+  using Items = std::vector<T>;
+
+  /** Called in the loop, the items are cleared after it */
+  using FlushCallback = std::function<void(Items &items)>;
+
+  BatchQueue(EventLoop *loop, FlushCallback cb)
+    : loop_(loop)
+    , flush_callback_(std::move(cb))
+    , batching_(false)
+  {
+  }
+
+  /**
+   * Post the \p item to be flushed in the loop
+   * \note Thread-safe
+   */
+  void Post(T &&item)
+  {
+    if (loop_->IsLoopInThread()) {
+      // Don't need the lock
+      loop_items_.emplace_back(std::move(item));
+      if (!batching_) FlushLoopItems();
+      return;
+    }
+
+    bool need_queue = false;
+    {
+      MutexGuard guard(lock_);
+      need_queue = items_.empty();
+      items_.emplace_back(std::move(item));
+    }
+
+    if (need_queue) {
+      auto self = this->shared_from_this();
+      loop_->QueueToLoop([self]() {
+        self->Flush();
+      });
+    }
+  }
+
+  /** \note Must be called in the loop */
+  void BeginBatch() noexcept { batching_ = true; }
+
+  /** \note Must be called in the loop */
+  void EndBatch()
+  {
+    batching_ = false;
+    FlushLoopItems();
+  }
+
+ private:
+  void Flush()
+  {
+    {
+      MutexGuard guard(lock_);
+      for (auto &item : items_)
+        loop_items_.emplace_back(std::move(item));
+      items_.clear();
+    }
+
+    if (!batching_) FlushLoopItems();
+  }
+
+  void FlushLoopItems()
+  {
+    // The items posted in the callback are flushed in the next round
+    batching_ = true;
+    while (!loop_items_.empty()) {
+      flushing_items_.swap(loop_items_);
+      flush_callback_(flushing_items_);
+
+      // Reuse the memory
+      flushing_items_.clear();
+    }
+    batching_ = false;
+  }
+
+  EventLoop *loop_;
+  FlushCallback flush_callback_;
+
+  /** Posted in the loop */
+  Items loop_items_;
+  Items flushing_items_;
+  bool batching_;
+
+  /** Posted in the other threads */
+  MutexLock lock_;
+  Items items_ GUARDED_BY(lock_);
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_BATCH_QUEUE_H__
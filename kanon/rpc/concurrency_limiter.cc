@@ -0,0 +1,119 @@
+#include "concurrency_limiter.h"
+
+#include <vector>
+
+#include "kanon/util/time_stamp.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+/** The interval(in us) to adjust the limit */
+static constexpr int64_t kLimitInterval = 100 * 1000;
+
+static constexpr int64_t kNoDelay = INT64_MAX;
+
+ConcurrencyLimiter::ConcurrencyLimiter(size_t max_concurrency)
+  : ConcurrencyLimiter(max_concurrency, 0)
+{
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(size_t max_concurrency,
+                                       uint64_t target_delay_ms)
+  : max_concurrency_(max_concurrency)
+  , target_delay_((int64_t)target_delay_ms * 1000)
+  , running_(0)
+  , limit_(max_concurrency)
+  , shed_count_(0)
+  , overloaded_(false)
+  , interval_start_(0)
+  , min_delay_(kNoDelay)
+{
+}
+
+void ConcurrencyLimiter::Run(Task task)
+{
+  bool shed = false;
+  {
+    MutexGuard guard(lock_);
+    const auto limit = limit_.load(std::memory_order_relaxed);
+    if (running_ < limit && pending_tasks_.empty()) {
+      ++running_;
+      if (IsAdaptive()) UpdateLimit(TimeStamp::Now().GetMicroseconds(), 0);
+    } else if (overloaded_ && pending_tasks_.size() >= limit) {
+      // The queue is long enough to keep the limit busy
+      shed = true;
+    } else {
+      pending_tasks_.push_back(PendingTask{
+          std::move(task),
+          IsAdaptive() ? TimeStamp::Now().GetMicroseconds() : 0});
+      return;
+    }
+  }
+
+  if (shed) shed_count_.fetch_add(1, std::memory_order_relaxed);
+  task(shed);
+}
+
+void ConcurrencyLimiter::Complete()
+{
+  Task task;
+  std::vector<Task> shed_tasks;
+  {
+    MutexGuard guard(lock_);
+    --running_;
+
+    const auto now = IsAdaptive() ? TimeStamp::Now().GetMicroseconds() : 0;
+    while (!pending_tasks_.empty() &&
+           running_ < limit_.load(std::memory_order_relaxed))
+    {
+      auto pending_task = std::move(pending_tasks_.front());
+      pending_tasks_.pop_front();
+
+      if (IsAdaptive()) {
+        const auto delay = now - pending_task.enqueue_time;
+        UpdateLimit(now, delay);
+
+        if (overloaded_ && delay > target_delay_) {
+          shed_tasks.push_back(std::move(pending_task.task));
+          continue;
+        }
+      }
+
+      // The slot is taken by the pending task
+      ++running_;
+      task = std::move(pending_task.task);
+      break;
+    }
+  }
+
+  if (!shed_tasks.empty()) {
+    shed_count_.fetch_add(shed_tasks.size(), std::memory_order_relaxed);
+    for (auto &shed_task : shed_tasks)
+      shed_task(true);
+  }
+
+  if (task) task(false);
+}
+
+void ConcurrencyLimiter::UpdateLimit(int64_t now, int64_t delay)
+{
+  if (delay < min_delay_) min_delay_ = delay;
+
+  if (interval_start_ == 0) interval_start_ = now;
+  if (now - interval_start_ < kLimitInterval) return;
+
+  // The queue is not drained in the whole interval
+  auto limit = limit_.load(std::memory_order_relaxed);
+  overloaded_ = min_delay_ > target_delay_;
+  if (overloaded_) {
+    // Decrease by one at least, otherwise the limit less than 4 is fixed
+    limit -= limit / 4 > 0 ? limit / 4 : 1;
+    if (limit == 0) limit = 1;
+  } else if (limit < max_concurrency_) {
+    ++limit;
+  }
+  limit_.store(limit, std::memory_order_relaxed);
+
+  interval_start_ = now;
+  min_delay_ = kNoDelay;
+}
@@ -0,0 +1,109 @@
+#ifndef KANON_RPC_CONCURRENCY_LIMITER_H__
+#define KANON_RPC_CONCURRENCY_LIMITER_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+
+#include "kanon/thread/mutex_lock.h"
+#include "kanon/util/noncopyable.h"
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Limit the number of the running calls of a method(or service)
+ *
+ * The call exceeding the limit is pending until a running call is completed.
+ *
+ * In the adaptive mode, the limit is adjusted in [1, max_concurrency]
+ * according to the queue delay(i.e. the time that the call is pending),
+ * like CoDel:
+ * - If the minimum queue delay in an interval exceeds the target, the
+ *   limiter is overloaded, the limit is decreased and the pending calls
+ *   whose queue delay exceeds the target are shed.
+ * - Otherwise, the limit is increased by one.
+ *
+ * \note Thread-safe, the call may be completed in any thread
+ */
+class ConcurrencyLimiter : noncopyable {
+ public:
+  /**
+   * Dispatch the call to where it is executed
+   * \param shed true indicates the call is shed, i.e. it must not run
+   *             and Complete() must not be called for it
+   */
+  using Task = std::function<void(bool shed)>;
+
+  /** The limit is fixed, the call is never shed */
+  explicit ConcurrencyLimiter(size_t max_concurrency);
+
+  /**
+   * Adaptive mode
+   * \param target_delay_ms The acceptable queue delay in ms
+   */
+  ConcurrencyLimiter(size_t max_concurrency, uint64_t target_delay_ms);
+
+  /**
+   * Run the \p task in the current thread if the number of running calls
+   * is less than the limit, otherwise it is pending(or shed if overloaded).
+   */
+  void Run(Task task);
+
+  /**
+   * Called when a running call is completed,
+   * run a pending task in the current thread if any
+   */
+  void Complete();
+
+  size_t max_concurrency() const noexcept { return max_concurrency_; }
+  bool IsAdaptive() const noexcept { return target_delay_ != 0; }
+
+  /** The current limit */
+  size_t GetLimit() const noexcept
+  {
+    return limit_.load(std::memory_order_relaxed);
+  }
+
+  /** The number of the calls shed */
+  uint64_t GetShedCount() const noexcept
+  {
+    return shed_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct PendingTask {
+    Task task;
+    int64_t enqueue_time; //!< in us
+  };
+
+  /**
+   * Update the limit with the queue \p delay of the call that will run
+   */
+  void UpdateLimit(int64_t now, int64_t delay) REQUIRES(lock_);
+
+  size_t max_concurrency_;
+
+  /** in us, 0 indicates the limit is fixed */
+  int64_t target_delay_;
+
+  MutexLock lock_;
+  size_t running_ GUARDED_BY(lock_);
+  std::deque<PendingTask> pending_tasks_ GUARDED_BY(lock_);
+
+  std::atomic<size_t> limit_;
+  std::atomic<uint64_t> shed_count_;
+
+  bool overloaded_ GUARDED_BY(lock_);
+  int64_t interval_start_ GUARDED_BY(lock_);
+  int64_t min_delay_ GUARDED_BY(lock_);
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_CONCURRENCY_LIMITER_H__
@@ -0,0 +1,62 @@
+#include "deadline_wheel.h"
+
+#include <assert.h>
+
+using namespace kanon::protobuf::rpc;
+
+DeadlineWheel::DeadlineWheel(uint64_t tick_ms, size_t bucket_num)
+  : tick_ms_(tick_ms)
+  , buckets_(bucket_num)
+  , current_tick_(0)
+  , size_(0)
+{
+  assert(tick_ms > 0 && bucket_num > 0);
+}
+
+void DeadlineWheel::Add(uint64_t id, uint64_t deadline)
+{
+  auto tick = deadline / tick_ms_;
+
+  // The bucket has been checked, put it to the next one
+  if (tick < current_tick_) tick = current_tick_;
+
+  buckets_[tick % buckets_.size()].push_back(Entry{id, deadline});
+  ++size_;
+}
+
+void DeadlineWheel::Advance(uint64_t now, ExpireCallback const &cb)
+{
+  const auto end_tick = now / tick_ms_ + 1;
+
+  // All buckets are checked once at most even if the time jumps
+  if (end_tick - current_tick_ > buckets_.size())
+    current_tick_ = end_tick - buckets_.size();
+
+  for (; current_tick_ < end_tick; ++current_tick_) {
+    ExpireBucket(buckets_[current_tick_ % buckets_.size()], now);
+  }
+
+  // The current tick may receive the deadlines later
+  --current_tick_;
+
+  // The callback may add deadline, call it after the buckets are checked
+  expired_ids_.swap(expired_);
+  for (auto id : expired_ids_)
+    cb(id);
+  expired_ids_.clear();
+}
+
+void DeadlineWheel::ExpireBucket(Bucket &bucket, uint64_t now)
+{
+  // The entries beyond this round are kept
+  size_t kept = 0;
+  for (size_t i = 0; i < bucket.size(); ++i) {
+    if (bucket[i].deadline <= now) {
+      expired_.push_back(bucket[i].id);
+    } else {
+      bucket[kept++] = bucket[i];
+    }
+  }
+  size_ -= bucket.size() - kept;
+  bucket.resize(kept);
+}
@@ -0,0 +1,78 @@
+#ifndef KANON_RPC_DEADLINE_WHEEL_H__
+#define KANON_RPC_DEADLINE_WHEEL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "kanon/util/noncopyable.h"
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Coarse timing wheel of the call deadlines
+ *
+ * The deadline(in ms) is put into the bucket of its tick, and
+ * the buckets are checked in Advance() that called periodically by
+ * a single timer, instead of a timer per call.
+ *
+ * The entry is not removed when the call is completed, the callback
+ * of Advance() should ignore the id that is not in flight.
+ *
+ * \note Not thread-safe
+ */
+class DeadlineWheel : noncopyable {
+ public:
+  using ExpireCallback = std::function<void(uint64_t id)>;
+
+  /**
+   * \param tick_ms The precision of deadline
+   * \param bucket_num The number of buckets, the deadline
+   *                   beyond a round is checked in later rounds
+   */
+  explicit DeadlineWheel(uint64_t tick_ms = 10, size_t bucket_num = 256);
+
+  void Add(uint64_t id, uint64_t deadline);
+
+  /**
+   * Call \p cb with the id of each expired entry(i.e. deadline <= \p now)
+   * and remove it
+   * \param now The current time in ms
+   */
+  void Advance(uint64_t now, ExpireCallback const &cb);
+
+  uint64_t tick_ms() const noexcept { return tick_ms_; }
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+ private:
+  struct Entry {
+    uint64_t id;
+    uint64_t deadline;
+  };
+
+  using Bucket = std::vector<Entry>;
+
+  void ExpireBucket(Bucket &bucket, uint64_t now);
+
+  uint64_t tick_ms_;
+  std::vector<Bucket> buckets_;
+
+  /** The next tick to be checked */
+  uint64_t current_tick_;
+  size_t size_;
+
+  /** Reuse the memory of the expired ids */
+  std::vector<uint64_t> expired_;
+  std::vector<uint64_t> expired_ids_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_DEADLINE_WHEEL_H__
@@ -0,0 +1,69 @@
+#include "flow_control.h"
+
+#include <google/protobuf/stubs/callback.h>
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+FlowControl::FlowControl(size_t high_water_mark) noexcept
+  : high_water_mark_(high_water_mark)
+  , queued_(0)
+  , blocked_(false)
+  , has_waiters_(false)
+{
+}
+
+FlowControl::~FlowControl() noexcept
+{
+  // The writers of the closed connection are abandoned
+  for (auto waiter : waiters_)
+    delete waiter;
+}
+
+bool FlowControl::Acquire(size_t size) noexcept
+{
+  const auto queued = queued_.fetch_add(size) + size;
+  return !blocked_.load() && queued < high_water_mark_;
+}
+
+void FlowControl::Release(size_t size)
+{
+  if (size == 0) return;
+  queued_.fetch_sub(size);
+  WakeUp();
+}
+
+void FlowControl::Unblock()
+{
+  blocked_.store(false);
+  WakeUp();
+}
+
+void FlowControl::NotifyOnWritable(PROTOBUF::Closure *cb)
+{
+  {
+    MutexGuard guard(lock_);
+    has_waiters_.store(true);
+    if (!IsWritable()) {
+      waiters_.push_back(cb);
+      return;
+    }
+  }
+
+  cb->Run();
+}
+
+void FlowControl::WakeUp()
+{
+  if (!has_waiters_.load() || !IsWritable()) return;
+
+  std::vector<PROTOBUF::Closure *> waiters;
+  {
+    MutexGuard guard(lock_);
+    waiters.swap(waiters_);
+    has_waiters_.store(false);
+  }
+
+  for (auto waiter : waiters)
+    waiter->Run();
+}
@@ -0,0 +1,104 @@
+#ifndef KANON_RPC_FLOW_CONTROL_H__
+#define KANON_RPC_FLOW_CONTROL_H__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+#include "kanon/thread/mutex_lock.h"
+#include "kanon/util/noncopyable.h"
+
+#define PROTOBUF ::google::protobuf
+
+namespace google {
+namespace protobuf {
+
+class Closure;
+
+} // namespace protobuf
+} // namespace google
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief The flow control of the stream messages in a connection
+ *
+ * The stream is writable if:
+ * - the bytes of the messages queued but not handed to the connection
+ *   are less than the high water mark, and
+ * - the output buffer of the connection don't exceed the high water mark,
+ *   i.e. it is blocked by the high water mark callback of the connection
+ *   and unblocked by the write complete callback
+ *
+ * Then the memory of a stream is bounded if the writer waits by
+ * NotifyOnWritable() once the stream is not writable.
+ *
+ * \note Thread-safe
+ */
+class FlowControl : noncopyable {
+ public:
+  explicit FlowControl(size_t high_water_mark) noexcept;
+  ~FlowControl() noexcept;
+
+  /**
+   * Account the \p size bytes queued by the writer
+   * \return
+   *   Whether the stream is still writable
+   */
+  bool Acquire(size_t size) noexcept;
+
+  /**
+   * The \p size bytes queued are handed to the connection
+   */
+  void Release(size_t size);
+
+  /** The output buffer of the connection exceeds the high water mark */
+  void Block() noexcept { blocked_.store(true); }
+
+  /** The output buffer of the connection is drained */
+  void Unblock();
+
+  bool IsBlocked() const noexcept { return blocked_.load(); }
+
+  bool IsWritable() const noexcept
+  {
+    return !blocked_.load() && queued_.load() < high_water_mark_;
+  }
+
+  /**
+   * Run \p cb once the stream is writable
+   *
+   * \note
+   *   The \p cb is run in the caller thread if the stream is writable now,
+   *   otherwise in the loop thread of the connection
+   */
+  void NotifyOnWritable(PROTOBUF::Closure *cb);
+
+  size_t high_water_mark() const noexcept { return high_water_mark_; }
+
+ private:
+  /** Run the waiters if the stream is writable */
+  void WakeUp();
+
+  const size_t high_water_mark_;
+  std::atomic<size_t> queued_;
+  std::atomic<bool> blocked_;
+
+  /**
+   * The writer sets has_waiters_ then checks the state, and the waker
+   * changes the state then checks has_waiters_(all in seq_cst),
+   * so at least one of them sees the other and the wake up is not missed.
+   */
+  MutexLock lock_;
+  std::vector<PROTOBUF::Closure *> waiters_ GUARDED_BY(lock_);
+  std::atomic<bool> has_waiters_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_FLOW_CONTROL_H__
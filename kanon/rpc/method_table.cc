@@ -0,0 +1,51 @@
+#include "method_table.h"
+
+#include <google/protobuf/descriptor.h>
+
+using namespace kanon::protobuf::rpc;
+
+constexpr uint32_t MethodTable::kNoMethodId;
+
+void MethodTable::AddService(PROTOBUF::Service *service, ThreadPool *pool)
+{
+  auto descriptor = service->GetDescriptor();
+  auto &old_service = services_[descriptor->full_name()];
+  const bool added = old_service != nullptr;
+  old_service = service;
+
+  for (int i = 0; i < descriptor->method_count(); ++i) {
+    auto method = descriptor->method(i);
+    auto name = descriptor->full_name() + '/' + method->name();
+
+    if (added) {
+      auto &entry = methods_[ids_[name] - 1];
+      entry.service = service;
+      entry.pool = pool;
+      continue;
+    }
+
+    const auto id = (uint32_t)methods_.size() + 1;
+    methods_.push_back(MethodEntry{service, method,
+                                   &service->GetRequestPrototype(method),
+                                   &service->GetResponsePrototype(method), pool,
+                                   name, nullptr, id});
+    ids_.emplace(std::move(name), id);
+  }
+}
+
+MethodEntry const *MethodTable::Find(std::string const &name) const
+{
+  auto it = ids_.find(name);
+  return it != ids_.end() ? &methods_[it->second - 1] : nullptr;
+}
+
+MethodEntry *MethodTable::Find(std::string const &name)
+{
+  auto it = ids_.find(name);
+  return it != ids_.end() ? &methods_[it->second - 1] : nullptr;
+}
+
+bool MethodTable::HasService(StringView service_name) const
+{
+  return services_.find(service_name.ToString()) != services_.end();
+}
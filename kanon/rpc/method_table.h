@@ -0,0 +1,112 @@
+#ifndef KANON_RPC_METHOD_TABLE_H__
+#define KANON_RPC_METHOD_TABLE_H__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/service.h>
+
+#include "concurrency_limiter.h"
+#include "kanon/string/string_view.h"
+#include "kanon/util/noncopyable.h"
+
+#define PROTOBUF ::google::protobuf
+
+namespace kanon {
+
+class ThreadPool;
+
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Method of service and its execution policy
+ *
+ * The method is executed in:
+ * - pool if it is not NULL
+ * - the shared pool of server if it is not NULL
+ * - the IO loop of the connection(i.e. inline)
+ */
+struct MethodEntry {
+  PROTOBUF::Service *service;
+  PROTOBUF::MethodDescriptor const *method;
+  PROTOBUF::Message const *request_prototype;
+  PROTOBUF::Message const *response_prototype;
+  ThreadPool *pool;
+
+  /** "service/method" */
+  std::string name;
+
+  /**
+   * NULL indicates the concurrency is not limited
+   * Shared by all methods of service if the service is limited
+   */
+  std::shared_ptr<ConcurrencyLimiter> limiter;
+
+  /** The method id, i.e. the index in the table + 1 */
+  uint32_t id;
+};
+
+/**
+ * \brief Dispatch table of the methods of the services
+ *
+ * Each method is assigned a numeric id(starting from 1) when the service is
+ * added, the client can get the table in handshake and send the id instead
+ * of the service and method name.
+ *
+ * \note
+ *   Not thread-safe, the table must be built before the server starts,
+ *   then it is read-only.
+ */
+class MethodTable : noncopyable {
+ public:
+  /** 0 indicates the method is specified by name */
+  static constexpr uint32_t kNoMethodId = 0;
+
+  MethodTable() = default;
+
+  /**
+   * Add all methods of \p service
+   * If the service has been added, update the service and pool only,
+   * i.e. the method ids are not changed.
+   */
+  void AddService(PROTOBUF::Service *service, ThreadPool *pool);
+
+  /**
+   * \return
+   *   NULL if no such method
+   */
+  MethodEntry const *Find(uint32_t id) const noexcept
+  {
+    return (id != kNoMethodId && id <= methods_.size()) ? &methods_[id - 1]
+                                                         : nullptr;
+  }
+
+  /**
+   * \param name "service/method"
+   * \return
+   *   NULL if no such method
+   */
+  MethodEntry const *Find(std::string const &name) const;
+  MethodEntry *Find(std::string const &name);
+
+  bool HasService(StringView service_name) const;
+
+  /** The entry of method id is methods[id-1] */
+  std::vector<MethodEntry> const &methods() const noexcept { return methods_; }
+
+ private:
+  std::vector<MethodEntry> methods_;
+
+  /** "service/method" -> id */
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::unordered_map<std::string, PROTOBUF::Service *> services_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_METHOD_TABLE_H__
@@ -0,0 +1,101 @@
+#include "outstanding_calls.h"
+
+#include <assert.h>
+
+using namespace kanon::protobuf::rpc;
+
+static constexpr size_t kInitSlotNum = 64;
+
+OutstandingCalls::OutstandingCalls()
+  : slots_(kInitSlotNum,
+           OutstandingCall{0, nullptr, nullptr, nullptr, -1, 0, 0})
+  , size_(0)
+{
+}
+
+void OutstandingCalls::Add(OutstandingCall const &call)
+{
+  assert(call.done);
+
+  auto &slot = GetSlot(call.id);
+  if (!slot.done) {
+    slot = call;
+    ++size_;
+    return;
+  }
+
+  // The slot is occupied by an older call
+  if (size_ * 2 >= slots_.size()) {
+    Grow();
+    Add(call);
+    return;
+  }
+
+  overflow_.emplace(slot.id, slot);
+  slot = call;
+}
+
+bool OutstandingCalls::Remove(uint64_t id, OutstandingCall &call)
+{
+  auto &slot = GetSlot(id);
+  if (slot.done && slot.id == id) {
+    call = slot;
+    slot.done = nullptr;
+    --size_;
+    return true;
+  }
+
+  if (overflow_.empty()) return false;
+
+  auto it = overflow_.find(id);
+  if (it == overflow_.end()) return false;
+  call = it->second;
+  overflow_.erase(it);
+  return true;
+}
+
+OutstandingCall *OutstandingCalls::Find(uint64_t id) noexcept
+{
+  auto &slot = GetSlot(id);
+  if (slot.done && slot.id == id) return &slot;
+
+  if (overflow_.empty()) return nullptr;
+
+  auto it = overflow_.find(id);
+  return it != overflow_.end() ? &it->second : nullptr;
+}
+
+void OutstandingCalls::TakeAll(std::vector<OutstandingCall> &calls)
+{
+  for (auto &slot : slots_) {
+    if (!slot.done) continue;
+    calls.push_back(slot);
+    slot.done = nullptr;
+  }
+  size_ = 0;
+
+  for (auto const &call : overflow_)
+    calls.push_back(call.second);
+  overflow_.clear();
+}
+
+void OutstandingCalls::Grow()
+{
+  std::vector<OutstandingCall> slots(slots_.size() << 1,
+                                     OutstandingCall{0, nullptr, nullptr,
+                                                     nullptr, -1, 0, 0});
+  slots.swap(slots_);
+  size_ = 0;
+
+  for (auto const &call : slots) {
+    if (!call.done) continue;
+
+    auto &slot = GetSlot(call.id);
+    if (slot.done) {
+      overflow_.emplace(call.id, call);
+    } else {
+      slot = call;
+      ++size_;
+    }
+  }
+}
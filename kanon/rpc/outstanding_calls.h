@@ -0,0 +1,117 @@
+#ifndef KANON_RPC_OUTSTANDING_CALLS_H__
+#define KANON_RPC_OUTSTANDING_CALLS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "kanon/util/macro.h"
+#include "kanon/util/noncopyable.h"
+
+#define PROTOBUF ::google::protobuf
+
+namespace google {
+namespace protobuf {
+
+class Message;
+class Closure;
+
+} // namespace protobuf
+} // namespace google
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+class RpcController;
+
+/**
+ * response and done are setted by client
+ *
+ * Store response since rpc message is the internal
+ * message, we must parse it in the OnMessage handler.
+ *
+ * Store the done since this is a asynchronous callback
+ */
+struct OutstandingCall {
+  uint64_t id;
+  PROTOBUF::Message *response;
+  PROTOBUF::Closure *done; //!< NULL indicates the slot is free
+  RpcController *controller;
+
+  /** The index in RpcMetrics, -1 indicates no metrics */
+  int metric;
+  uint64_t start_us; //!< Calling
+  uint64_t sent_us;  //!< Sending
+};
+
+/**
+ * \brief The calls in flight of a client channel
+ *
+ * The call is stored in the slot indexed by the low bits of the call id,
+ * and the full id in slot is the generation tag, i.e. the response
+ * of the call completed(or expired) is rejected by comparing the id.
+ *
+ * Since the ids are increasing, the calls in flight occupy a sliding
+ * window of the slots. If the slot is still occupied by a call from an
+ * older generation:
+ * - the slots are doubled if they are dense
+ * - the older call is moved to the overflow map otherwise,
+ *   i.e. a long outstanding call don't make the slots grow forever
+ *
+ * \note Not thread-safe, used in the loop of channel
+ */
+class OutstandingCalls : noncopyable {
+ public:
+  OutstandingCalls();
+
+  /**
+   * \param call The id must be unique among the calls in flight
+   */
+  void Add(OutstandingCall const &call);
+
+  /**
+   * Take the call of \p id out
+   * \return
+   *   false if no such call, e.g. the call has completed or expired
+   */
+  bool Remove(uint64_t id, OutstandingCall &call);
+
+  /**
+   * Find the call of \p id without taking it out,
+   * e.g. the call receives a message of the response stream
+   * \return
+   *   NULL if no such call
+   */
+  OutstandingCall *Find(uint64_t id) noexcept;
+
+  /**
+   * Take all calls out to \p calls
+   */
+  void TakeAll(std::vector<OutstandingCall> &calls);
+
+  size_t size() const noexcept { return size_ + overflow_.size(); }
+  bool empty() const noexcept { return size() == 0; }
+
+ private:
+  KANON_INLINE OutstandingCall &GetSlot(uint64_t id) noexcept
+  {
+    return slots_[id & (slots_.size() - 1)];
+  }
+
+  void Grow();
+
+  /** The size is power of 2 */
+  std::vector<OutstandingCall> slots_;
+  size_t size_; //!< The number of calls in slots_
+
+  std::unordered_map<uint64_t, OutstandingCall> overflow_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_OUTSTANDING_CALLS_H__
@@ -1,5 +1,8 @@
 #include <functional>
+#include <thread>
 
+#include <google/protobuf/arena.h>
+#include <google/protobuf/descriptor.h>
 #include <google/protobuf/service.h>
 #include <google/protobuf/stubs/callback.h>
 
@@ -7,12 +10,18 @@
 #include "kanon/rpc/logger.h"
 #include "kanon/net/connection/tcp_connection.h"
 #include "kanon/net/event_loop.h"
+#include "kanon/thread/thread_pool.h"
+#include "kanon/thread/waiter.h"
 #include "kanon/util/macro.h"
 
+#include "arena_pool.h"
 #include "rpc_channel.h"
 #include "rpc_controller.h"
+#include "rpc_frame.h"
 
+using PROTOBUF::Arena;
 using PROTOBUF::Closure;
+using PROTOBUF::DescriptorPool;
 using PROTOBUF::Message;
 using PROTOBUF::MethodDescriptor;
 using PROTOBUF::Service;
@@ -21,20 +30,451 @@ using namespace kanon::protobuf::rpc;
 
 static char const *GetRpcErrorString(RpcMessage::ErrorCode error) noexcept;
 
-RpcChannel::RpcChannel() = default;
+static constexpr uint64_t kNoNegotiation = (uint64_t)-1;
+static constexpr uint64_t kNoRequestStream = (uint64_t)-1;
+
+static KANON_INLINE uint64_t
+GetDeadline(RpcController const *controller) noexcept
+{
+  return controller ? controller->deadline() : INVALID_DEADLINE;
+}
+
+static KANON_INLINE uint64_t NowUs() noexcept
+{
+  return (uint64_t)kanon::TimeStamp::Now().GetMicroseconds();
+}
+
+static KANON_INLINE bool IsExpired(uint64_t deadline) noexcept
+{
+  return deadline != INVALID_DEADLINE &&
+         (uint64_t)kanon::TimeStamp::Now().GetMilliseconds() > deadline;
+}
+
+/**
+ * Block the streams until the output buffer of \p conn is drained
+ */
+static void BlockStreams(kanon::TcpConnectionPtr const &conn,
+                         std::shared_ptr<FlowControl> const &flow_control)
+{
+  // The callback has been installed
+  if (flow_control->IsBlocked()) return;
+
+  flow_control->Block();
+
+  // Set it lazily since it costs a functor per write completion,
+  // and the callback set by user is restored once the buffer is drained
+  auto previous = conn->GetWriteCompleteCallback();
+  conn->SetWriteCompleteCallback(
+      [flow_control, previous](kanon::TcpConnectionPtr const &conn) {
+        // This functor is destroyed by the restoration, don't touch
+        // the captures after it
+        auto fc = flow_control;
+        auto cb = previous;
+        conn->SetWriteCompleteCallback(previous);
+        fc->Unblock();
+        return cb ? cb(conn) : true;
+      });
+}
+
+/**
+ * Hand the \p frames to \p conn, then release the \p stream_size bytes
+ * queued by the stream writers
+ */
+static void SendStreamFrames(kanon::TcpConnectionPtr const &conn,
+                             kanon::ChunkList &frames, size_t stream_size,
+                             std::shared_ptr<FlowControl> const &flow_control)
+{
+  conn->Send(frames);
+  if (stream_size == 0) return;
+
+  // Check the output buffer immediately instead of waiting the high water
+  // mark callback, otherwise the writers in the loop are woken up by the
+  // release and fill the buffer repeatedly
+  if (conn->GetOutputBuffer()->GetReadableSize() >=
+      flow_control->high_water_mark())
+  {
+    BlockStreams(conn, flow_control);
+  }
+  flow_control->Release(stream_size);
+}
+
+class RpcChannel::ServerCall
+  : public Closure
+  , public StreamWriter {
+ public:
+  ServerCall(std::shared_ptr<ResponseQueue> const &queue,
+             std::shared_ptr<FlowControl> const &flow_control,
+             MethodEntry const &entry, RpcController *controller,
+             Message const *request, Message *response, uint64_t id,
+             bool binary_wire, ShedCounters *counters, RpcMetrics *metrics,
+             uint64_t receive_us)
+    : queue_(queue)
+    , flow_control_(flow_control)
+    , service_(entry.service)
+    , method_(entry.method)
+    , controller_(controller)
+    , request_(request)
+    , response_(response)
+    , id_(id)
+    , limiter_(entry.limiter.get())
+    , binary_wire_(binary_wire)
+    , counters_(counters)
+    , metrics_(metrics)
+    , metric_((int)entry.id - 1)
+    , receive_us_(receive_us)
+    , invoke_us_(0)
+    , heap_request_(false)
+  {
+    // The method writes the response stream by the controller
+    controller_->SetStreamWriter(this);
+  }
+
+  void SetRequestStream(std::shared_ptr<RequestStream> stream) noexcept
+  {
+    request_stream_ = std::move(stream);
+  }
+
+  /**
+   * The request is not in the arena, it is handed to the method,
+   * or deleted if the method is not called
+   */
+  void SetHeapRequest() noexcept { heap_request_ = true; }
+
+  /**
+   * Call the method of service, this is the done of it
+   *
+   * The call is dropped if it is expired when pending in the pool
+   * or limiter
+   *
+   * \param queued
+   *   false if the call is invoked when it is received, then the
+   *   queue time is not measured(i.e. zero) to avoid reading the clock
+   */
+  void Invoke(bool queued = true)
+  {
+    if (IsExpired(controller_->deadline())) {
+      if (counters_) counters_->expired.fetch_add(1, std::memory_order_relaxed);
+      Finish(RpcMessage::kDeadlineExceeded, true);
+      return;
+    }
+
+    if (metrics_) {
+      invoke_us_ = queued ? NowUs() : receive_us_;
+      metrics_->OnQueued(metric_, invoke_us_ - receive_us_);
+    }
+
+    // Owned by the service now
+    heap_request_ = false;
+    service_->CallMethod(method_, controller_, request_, response_, this);
+  }
+
+  /**
+   * The call is shed by the limiter or the full pool
+   * \param complete The slot of limiter is taken, i.e. release it
+   */
+  void Shed(bool complete = false)
+  {
+    if (counters_)
+      counters_->overloaded.fetch_add(1, std::memory_order_relaxed);
+    Finish(RpcMessage::kOverloaded, complete);
+  }
+
+  /**
+   * The method is completed, send the response
+   */
+  void Run() override { Finish(RpcMessage::kNoError, true); }
+
+  /**
+   * Write the message of the response stream
+   * \note The response is serialized in the current thread
+   */
+  bool Write(Message const &message) override
+  {
+    ChunkStream stream;
+    if (binary_wire_) {
+      EncodeRpcFrame(stream,
+                     RpcFrameHeader{id_, INVALID_DEADLINE, 0,
+                                    RpcMessage::kStreamResponseMessage,
+                                    RpcMessage::kNoError},
+                     StringView(), &message);
+    } else {
+      RpcMessage wrapper;
+      wrapper.set_id(id_);
+      wrapper.set_type(RpcMessage::kStreamResponseMessage);
+      message.SerializeToString(wrapper.mutable_response());
+      EncodeRpcMessage(stream, wrapper);
+    }
+
+    const auto size = stream.chunk_list.GetReadableSize();
+    const bool writable = flow_control_->Acquire(size);
+    queue_->Post(PendingResponse{std::move(stream.chunk_list), nullptr, size,
+                                 kNoRequestStream});
+    return writable;
+  }
+
+  /** The response stream is ended by the done */
+  void Close() override {}
+
+  void NotifyOnWritable(Closure *cb) override
+  {
+    flow_control_->NotifyOnWritable(cb);
+  }
+
+ private:
+  /**
+   * Send the response or \p error
+   *
+   * \param complete Complete the limiter, i.e. release the slot
+   * \note
+   *   The response is serialized in the current thread
+   *   The call is freed with the arena after the response is posted
+   */
+  void Finish(ErrorCode error, bool complete)
+  {
+    // The messages of the request stream are not parsed to the request
+    // after this, since the arena may be released
+    if (request_stream_) request_stream_->finished.store(true);
+
+    // The method is not called
+    if (heap_request_) {
+      delete request_;
+      heap_request_ = false;
+    }
+
+    if (metrics_) {
+      const auto now = NowUs();
+      if (invoke_us_) metrics_->OnExecuted(metric_, now - invoke_us_);
+      metrics_->OnCompleted(metric_, error, now - receive_us_);
+    }
+
+    // The arena is reset in Post(), don't access the members after it
+    auto queue = std::move(queue_);
+    auto limiter = complete ? limiter_ : nullptr;
+    auto arena = response_->GetArena();
+    auto payload = error == RpcMessage::kNoError ? response_ : nullptr;
+
+    ChunkStream stream;
+    if (binary_wire_) {
+      // Serialize the response into the frame directly
+      EncodeRpcFrame(stream,
+                     RpcFrameHeader{id_, INVALID_DEADLINE, 0,
+                                    RpcMessage::kResponse, (uint8_t)error},
+                     StringView(), payload);
+    } else {
+      // The method is completed, fill RpcMessae and send
+      auto message = Arena::CreateMessage<RpcMessage>(arena);
+      message->set_id(id_);
+      if (payload) {
+        payload->SerializeToString(message->mutable_response());
+      } else {
+        message->set_error(error);
+      }
+      message->set_type(RpcMessage::kResponse);
+      EncodeRpcMessage(stream, *message);
+    }
+
+    queue->Post(PendingResponse{std::move(stream.chunk_list), arena, 0,
+                                request_stream_ ? id_ : kNoRequestStream});
+
+    // Run the pending call of the method
+    if (limiter) limiter->Complete();
+  }
+
+ private:
+  std::shared_ptr<ResponseQueue> queue_;
+  std::shared_ptr<FlowControl> flow_control_;
+  std::shared_ptr<RequestStream> request_stream_;
+  Service *service_;
+  MethodDescriptor const *method_;
+  RpcController *controller_;
+  Message const *request_;
+  Message *response_;
+  uint64_t id_;
+  ConcurrencyLimiter *limiter_;
+  bool binary_wire_;
+  ShedCounters *counters_;
+  RpcMetrics *metrics_;
+  int metric_;
+  uint64_t receive_us_;
+  uint64_t invoke_us_; //!< 0 indicates the method is not invoked
+  bool heap_request_;  //!< The request is in heap and not handed to method
+};
+
+/**
+ * The writer may outlive the channel, so it shares the queue and flow
+ * control instead of referring the channel
+ */
+class RpcChannel::ClientStream : public StreamWriter {
+ public:
+  ClientStream(std::shared_ptr<RequestQueue> const &queue,
+               std::shared_ptr<FlowControl> const &flow_control,
+               std::weak_ptr<bool> const &alive, uint64_t id,
+               bool binary_wire) noexcept
+    : queue_(queue)
+    , flow_control_(flow_control)
+    , alive_(alive)
+    , id_(id)
+    , binary_wire_(binary_wire)
+  {
+  }
+
+  bool Write(Message const &message) override { return Post(&message); }
+
+  void Close() override { Post(nullptr); }
+
+  void NotifyOnWritable(Closure *cb) override
+  {
+    flow_control_->NotifyOnWritable(cb);
+  }
+
+ private:
+  /**
+   * Post the message of the request stream
+   * \param payload NULL indicates the end of stream
+   * \return
+   *   Whether the stream is writable
+   */
+  bool Post(Message const *payload)
+  {
+    // The channel is destroyed, the message can't be sent.
+    // Don't account it, otherwise the writer waits forever.
+    if (alive_.expired()) return true;
+
+    const auto type = payload ? RpcMessage::kStreamRequestMessage
+                              : RpcMessage::kStreamRequestEnd;
+
+    // The server handles the frame and RpcMessage regardless of the wire
+    // mode, so the mode of the call is used even if it is changed later
+    ChunkStream stream;
+    if (binary_wire_) {
+      EncodeRpcFrame(stream,
+                     RpcFrameHeader{id_, INVALID_DEADLINE, 0, (uint8_t)type,
+                                    RpcMessage::kNoError},
+                     StringView(), payload);
+    } else {
+      RpcMessage message;
+      message.set_id(id_);
+      message.set_type(type);
+      if (payload) payload->SerializeToString(message.mutable_request());
+      EncodeRpcMessage(stream, message);
+    }
+
+    // The message is not a call, i.e. done is NULL
+    const auto size = stream.chunk_list.GetReadableSize();
+    const bool writable = flow_control_->Acquire(size);
+    queue_->Post(PendingRequest{std::move(stream.chunk_list), id_, nullptr,
+                                nullptr, nullptr, size, -1, 0});
+    return writable;
+  }
+
+  std::shared_ptr<RequestQueue> queue_;
+  std::shared_ptr<FlowControl> flow_control_;
+  std::weak_ptr<bool> alive_;
+  uint64_t id_;
+  bool binary_wire_;
+};
+
+RpcChannel::RpcChannel()
+  : alive_(std::make_shared<bool>(true))
+  , id_(0)
+  , binary_wire_(false)
+  , negotiation_id_(kNoNegotiation)
+  , method_table_id_(kNoNegotiation)
+  , methods_(nullptr)
+  , shared_pool_(nullptr)
+  , shed_counters_(nullptr)
+  , use_arena_(false)
+  , metrics_(nullptr)
+  , arena_(nullptr)
+  , loop_(nullptr)
+  , pending_calls_(0)
+  , deadline_timer_running_(false)
+{
+}
 
 // Constructor does not recommended to do many thing except for initial work
 RpcChannel::RpcChannel(TcpConnectionPtr const &conn)
-  : id_(0)
+  : alive_(std::make_shared<bool>(true))
+  , id_(0)
+  , binary_wire_(false)
+  , negotiation_id_(kNoNegotiation)
+  , method_table_id_(kNoNegotiation)
   , codec_()
+  , methods_(nullptr)
+  , shared_pool_(nullptr)
+  , shed_counters_(nullptr)
+  , use_arena_(false)
+  , metrics_(nullptr)
+  , arena_(nullptr)
+  , loop_(nullptr)
+  , pending_calls_(0)
+  , deadline_timer_running_(false)
 {
   SetConnection(conn);
 }
 
-RpcChannel::~RpcChannel() = default;
+RpcChannel::~RpcChannel()
+{
+  // The functors queued to the loop and the tick of deadline_timer_
+  // don't access this after it
+  alive_.reset();
+
+  // The timer is canceled in the loop when the connection is closed
+  // (see CancelOutstandingCalls()), this is the case the channel is
+  // destroyed when connected
+  if (deadline_timer_running_) loop_->CancelTimer(deadline_timer_);
+
+  // The arena is got but the message is not complete or invalid.
+  // The server channel is destroyed in the loop thread.
+  if (arena_) ArenaPool::GetLoopPool().Put(arena_);
+}
+
+void RpcChannel::SetServices(MethodTable const &methods,
+                             ThreadPool *shared_pool,
+                             ShedCounters *counters,
+                             RpcMetrics *metrics) noexcept
+{
+  KANON_ASSERT(conn_, "SetServices() must be called after SetConnection()");
+  methods_ = &methods;
+  shared_pool_ = shared_pool;
+  shed_counters_ = counters;
+  metrics_ = metrics;
+
+  // The responses in a loop iteration are sent at once
+  auto conn = conn_;
+  auto flow_control = flow_control_;
+  auto request_streams = request_streams_ = std::make_shared<RequestStreams>();
+  response_queue_ = std::make_shared<ResponseQueue>(
+      loop_, [conn, flow_control,
+              request_streams](std::vector<PendingResponse> &responses) {
+        ChunkList frames;
+        size_t stream_size = 0;
+        for (auto &response : responses) {
+          frames.AppendChunkList(&response.frame);
+          if (response.arena) ArenaPool::GetLoopPool().Put(response.arena);
+          stream_size += response.stream_size;
+          // The call is finished without the end of the request stream
+          if (response.request_stream_id != kNoRequestStream)
+            request_streams->erase(response.request_stream_id);
+        }
+        SendStreamFrames(conn, frames, stream_size, flow_control);
+      });
+
+  codec_.SetArenaCallback([this]() {
+    if (!arena_) arena_ = ArenaPool::GetLoopPool().Get();
+    return arena_;
+  });
+}
 
 void RpcChannel::ErrorHandle(uint64_t id, ErrorCode error_code)
 {
+  if (binary_wire_.load(std::memory_order_relaxed)) {
+    SendRpcFrame(RpcFrameHeader{id, INVALID_DEADLINE, 0, RpcMessage::kResponse,
+                                (uint8_t)error_code},
+                 nullptr);
+    return;
+  }
+
   RpcMessage message;
   message.set_id(id);
   message.set_type(RpcMessage::kResponse);
@@ -49,26 +489,149 @@ void RpcChannel::CallMethod(MethodDescriptor const *method,
 {
   RpcController *contr = kanon::down_pointer_cast<RpcController>(controller);
 
+  auto id = id_.fetch_add(1, std::memory_order_relaxed);
+  const auto method_id = GetMethodId(method);
+  if (done) pending_calls_.fetch_add(1, std::memory_order_relaxed);
+
+  // The notification(i.e. done is NULL) is not recorded
+  // since it is never completed
+  const int metric = metrics_ && done ? metrics_->FindMethod(method) : -1;
+  const auto start_us = metric >= 0 ? NowUs() : 0;
+  if (metric >= 0) metrics_->OnRequest(metric);
+
+  // The writer must be ready before the call returns
+  const bool request_stream = contr && contr->IsRequestStream();
+  const auto type =
+      request_stream ? RpcMessage::kStreamRequest : RpcMessage::kRequest;
+  const bool binary_wire = binary_wire_.load(std::memory_order_relaxed);
+  if (request_stream) {
+    contr->SetStreamWriter(std::unique_ptr<StreamWriter>(new ClientStream(
+        request_queue_, flow_control_, alive_, id, binary_wire)));
+  }
+
+  if (binary_wire) {
+    // Serialize the request into the frame directly
+    ChunkStream stream;
+    const RpcFrameHeader header{id, GetDeadline(contr), method_id,
+                                (uint8_t)type, RpcMessage::kNoError};
+    if (method_id != MethodTable::kNoMethodId) {
+      EncodeRpcFrame(stream, header, StringView(), request);
+    } else {
+      EncodeRpcFrame(stream, header,
+                     method->service()->full_name() + '/' + method->name(),
+                     request);
+    }
+
+    request_queue_->Post(PendingRequest{std::move(stream.chunk_list), id,
+                                        response, done, contr, 0, metric,
+                                        start_us});
+    return;
+  }
+
   RpcMessage message;
-  auto id = id_.load(std::memory_order_relaxed);
   message.set_id(id);
-  id_.fetch_add(1, std::memory_order_relaxed);
 
-  message.set_type(RpcMessage::kRequest);
+  message.set_type(type);
   message.set_request(request->SerializeAsString());
 
-  // FIXME fullname()?
-  message.set_method(method->name());
-  message.set_service(method->service()->full_name());
+  if (method_id != MethodTable::kNoMethodId) {
+    message.set_method_id(method_id);
+  } else {
+    // FIXME fullname()?
+    message.set_method(method->name());
+    message.set_service(method->service()->full_name());
+  }
+
+  const auto deadline = GetDeadline(contr);
+  if (deadline != INVALID_DEADLINE) message.set_deadline(deadline);
+
+  ChunkStream stream;
+  EncodeRpcMessage(stream, message);
+  request_queue_->Post(PendingRequest{std::move(stream.chunk_list), id,
+                                      response, done, contr, 0, metric,
+                                      start_us});
+}
+
+namespace {
+
+/**
+ * The done of the sync calls, reused by the calls of a thread
+ */
+class SyncDone : public Closure {
+ public:
+  void Run() override { waiter.Notify(); }
+
+  kanon::Waiter waiter;
+};
+
+} // namespace
 
-  conn_->GetLoop()->RunInLoop(std::bind(&RpcChannel::SendRpcRequest, this,
-                                        std::move(message), response, done,
-                                        contr));
+static int GetSyncSpinCount() noexcept
+{
+  // Spinning is meaningful only if the loop can run in the other CPU
+  // at the same time
+  static const int s_spin_count =
+      std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+  return s_spin_count;
 }
 
-void RpcChannel::SendRpcRequest(RpcMessage &message, Message *response,
-                                Closure *done, RpcController *controller)
+void RpcChannel::CallMethodSync(MethodDescriptor const *method,
+                                PROTOBUF::RpcController *controller,
+                                Message const *request, Message *response)
 {
+  KANON_ASSERT(!loop_ || !loop_->IsLoopInThread(),
+               "The sync call can't be called in the loop of connection");
+  KANON_ASSERT(
+      !controller ||
+          !kanon::down_pointer_cast<RpcController>(controller)
+               ->IsRequestStream(),
+      "The sync call don't support request stream");
+
+  static thread_local SyncDone t_done;
+
+  t_done.waiter.Reset();
+  CallMethod(method, controller, request, response, &t_done);
+  t_done.waiter.Wait(GetSyncSpinCount());
+}
+
+void RpcChannel::SendRequests(std::vector<PendingRequest> &requests)
+{
+  size_t stream_size = 0;
+  if (!conn_->IsConnected()) {
+    for (auto &request : requests) {
+      if (request.metric >= 0) {
+        metrics_->OnCompleted(request.metric,
+                              MethodMetricsSnapshot::kLocalError,
+                              NowUs() - request.start_us);
+      }
+      CompleteCall(request.done, request.controller, "Connection closed");
+      stream_size += request.stream_size;
+    }
+    flow_control_->Release(stream_size);
+    return;
+  }
+
+  // The requests in a loop iteration are sent at once
+  const auto sent_us = metrics_ ? NowUs() : 0;
+  ChunkList frames;
+  for (auto &request : requests) {
+    if (request.metric >= 0)
+      metrics_->OnQueued(request.metric, sent_us - request.start_us);
+    AddOutstandingCall(request, sent_us);
+    frames.AppendChunkList(&request.frame);
+    stream_size += request.stream_size;
+  }
+  SendStreamFrames(conn_, frames, stream_size, flow_control_);
+}
+
+void RpcChannel::AddOutstandingCall(PendingRequest const &request,
+                                    uint64_t sent_us)
+{
+  const auto id = request.id;
+  const auto response = request.response;
+  const auto done = request.done;
+  const auto controller = request.controller;
+
   // Must insert <id, outstanding_call> into outstanding_calls_ first
   // There are maybe server response reach but outstanding_call is not
   // registered.
@@ -78,42 +641,144 @@ void RpcChannel::SendRpcRequest(RpcMessage &message, Message *response,
   //
   // If done is NULL, indicates the user don't expect response
   // i.e. void return procedure
-  if (done) {
-    // outstanding_calls_.emplace_hint(outstanding_calls_.end(), message.id(),
-    //                                 OutstandingCall{response, done});
-    outstanding_calls_.emplace(message.id(), OutstandingCall{response, done});
-  } else {
+  if (!done) {
     KANON_ASSERT(!response,
                  "Notifiction(done is NULL) no need to set response");
+    return;
   }
 
-  if (controller->deadline() != INVALID_DEADLINE)
-    message.set_deadline(controller->deadline());
+  outstanding_calls_.Add(OutstandingCall{id, response, done, controller,
+                                         request.metric, request.start_us,
+                                         sent_us});
 
-  codec_.Send(conn_, &message);
+  const auto deadline = GetDeadline(controller);
+  if (deadline == INVALID_DEADLINE) return;
 
-  if (controller->deadline() != INVALID_DEADLINE) {
-    auto id = message.id();
-    conn_->GetLoop()->RunAt(
-        [this, id]() {
-          outstanding_calls_.erase(id);
+  // The entry is not removed if the response is received before deadline,
+  // OnDeadlineTick() ignores it since the id is not outstanding
+  deadline_wheel_.Add(id, deadline);
+  if (!deadline_timer_running_) {
+    deadline_timer_running_ = true;
+    // The tick may be dispatched before the timer is canceled
+    // in the destructor
+    std::weak_ptr<bool> alive = alive_;
+    deadline_timer_ = loop_->RunEvery(
+        [this, alive]() {
+          if (alive.expired()) return;
+          OnDeadlineTick();
         },
-        TimeStamp((int64_t)controller->deadline() * 1000));
+        (double)deadline_wheel_.tick_ms() / 1000);
+  }
+}
+
+void RpcChannel::OnDeadlineTick()
+{
+  const auto now = TimeStamp::Now().GetMilliseconds();
+  deadline_wheel_.Advance(now, [this](uint64_t id) {
+    OutstandingCall call;
+    if (!outstanding_calls_.Remove(id, call)) return;
+
+    // The response is not filled, the done must check the controller
+    LOG_DEBUG_KANON_PROTOBUF_RPC << "The call is expired, id = " << id;
+    CompleteCall(call, "Deadline exceeded", RpcMessage::kDeadlineExceeded);
+  });
+
+  // Don't tick if no deadline
+  if (deadline_wheel_.empty()) {
+    deadline_timer_running_ = false;
+    loop_->CancelTimer(deadline_timer_);
+  }
+}
+
+void RpcChannel::CompleteCall(Closure *done, RpcController *controller,
+                              char const *error)
+{
+  if (!done) return;
+
+  if (error && controller) controller->SetFailed(error);
+  pending_calls_.fetch_sub(1, std::memory_order_relaxed);
+  done->Run();
+}
+
+void RpcChannel::CompleteCall(OutstandingCall const &call, char const *error,
+                              size_t error_slot, bool responded)
+{
+  if (call.metric >= 0) {
+    const auto now = NowUs();
+    if (responded) metrics_->OnExecuted(call.metric, now - call.sent_us);
+    metrics_->OnCompleted(call.metric, error_slot, now - call.start_us);
+  }
+  CompleteCall(call.done, call.controller, error);
+}
+
+void RpcChannel::CancelOutstandingCalls()
+{
+  std::vector<OutstandingCall> calls;
+  outstanding_calls_.TakeAll(calls);
+
+  // No call is outstanding, stop the timer in the loop
+  if (deadline_timer_running_) {
+    deadline_timer_running_ = false;
+    loop_->CancelTimer(deadline_timer_);
   }
+
+  for (auto &call : calls)
+    CompleteCall(call, "Connection closed", MethodMetricsSnapshot::kLocalError);
 }
 
-void RpcChannel::SendRpcResponse(Message *response, uint64_t id)
+void RpcChannel::NegotiateBinaryWire()
 {
-  // The method is completed, fill RpcMessae and send
   RpcMessage message;
-  message.set_id(id);
-  message.set_response(response->SerializeAsString());
-  message.set_type(RpcMessage::kResponse);
+  message.set_id(id_.fetch_add(1, std::memory_order_relaxed));
+  message.set_type(RpcMessage::kRequest);
+  message.set_wire_mode(RpcMessage::kBinaryWire);
 
-  codec_.Send(conn_, &message);
-  // The response is new by Service::GetResponsePrototype().
-  // Must delete it to avoid memory leak.
-  delete response;
+  loop_->RunInLoop(std::bind(
+      [this](RpcMessage &message) {
+        negotiation_id_ = message.id();
+        codec_.Send(conn_, &message);
+      },
+      std::move(message)));
+}
+
+void RpcChannel::NegotiateMethodIds()
+{
+  RpcMessage message;
+  message.set_id(id_.fetch_add(1, std::memory_order_relaxed));
+  message.set_type(RpcMessage::kRequest);
+  message.set_method_table(true);
+
+  loop_->RunInLoop(std::bind(
+      [this](RpcMessage &message) {
+        method_table_id_ = message.id();
+        codec_.Send(conn_, &message);
+      },
+      std::move(message)));
+}
+
+uint32_t RpcChannel::GetMethodId(MethodDescriptor const *method) const
+{
+  const auto method_ids = std::atomic_load(&method_ids_);
+  if (!method_ids) return MethodTable::kNoMethodId;
+
+  auto it = method_ids->find(method);
+  return it != method_ids->end() ? it->second : MethodTable::kNoMethodId;
+}
+
+void RpcChannel::SendRpcFrame(RpcFrameHeader const &header,
+                              Message const *payload)
+{
+  ChunkStream stream;
+  EncodeRpcFrame(stream, header, StringView(), payload);
+  conn_->Send(stream.chunk_list);
+}
+
+void RpcChannel::ReleaseArena(Arena *arena)
+{
+  // The response may be sent in other thread
+  conn_->GetLoop()->RunInLoop([arena]() {
+    ArenaPool::GetLoopPool().Put(arena);
+  });
 }
 
 static char const *GetRpcErrorString(RpcMessage::ErrorCode error) noexcept
@@ -131,6 +796,10 @@ static char const *GetRpcErrorString(RpcMessage::ErrorCode error) noexcept
       return "Invalid Request";
     case RpcMessage::kInvalidResponse:
       return "Invalid Response";
+    case RpcMessage::kDeadlineExceeded:
+      return "Deadline exceeded";
+    case RpcMessage::kOverloaded:
+      return "Overloaded";
     default:
       return "Unknown Error";
   }
@@ -151,13 +820,29 @@ void RpcChannel::OnRpcMessage(TcpConnectionPtr const &conn,
                "The type and id field is required, the protobuf of peer must "
                "ensure them are setted");
 
-  if (message->type() == RpcMessage::kResponse) {
-    OnRpcMessageForResponse(conn, message, receive_time);
-  } else if (message->type() == RpcMessage::kRequest) {
-    OnRpcMessageForRequest(conn, message, receive_time);
-  } else {
-    KANON_ASSERT(false, "RpcMessage Type Error occurred impossible, it is must "
-                        "be internal error");
+  switch (message->type()) {
+    case RpcMessage::kResponse:
+      OnRpcMessageForResponse(conn, message, receive_time);
+      break;
+    case RpcMessage::kRequest:
+    case RpcMessage::kStreamRequest:
+      OnRpcMessageForRequest(conn, message, receive_time);
+      break;
+    case RpcMessage::kStreamResponseMessage:
+      OnStreamResponse(message->id(), message->response());
+      break;
+    case RpcMessage::kStreamRequestMessage:
+    case RpcMessage::kStreamRequestEnd:
+      OnStreamRequest(message->id(),
+                      message->type() == RpcMessage::kStreamRequestEnd,
+                      message->request());
+
+      // The message is not taken by a call, reuse the arena
+      if (arena_ && message->GetArena() == arena_) arena_->Reset();
+      break;
+    default:
+      KANON_ASSERT(false, "RpcMessage Type Error occurred impossible, it is "
+                          "must be internal error");
   }
 }
 
@@ -166,6 +851,32 @@ void RpcChannel::OnRpcMessageForResponse(TcpConnectionPtr const &conn,
 {
   KANON_UNUSED(conn);
   KANON_UNUSED(stamp);
+
+  if (message->id() == negotiation_id_) {
+    // The server that don't support negotiation response with error
+    OnNegotiationResponse(!message->has_error() && message->has_wire_mode()
+                              ? message->wire_mode()
+                              : RpcMessage::kProtobufWire);
+    return;
+  }
+
+  if (message->id() == method_table_id_) {
+    method_table_id_ = kNoNegotiation;
+    // The server that don't support method table response with error
+    if (!message->has_error() && message->method_table())
+      OnMethodTableResponse(*message);
+    return;
+  }
+
+  // The response must be setted in RpcServer
+  KANON_ASSERT(message->has_error() || message->has_response(),
+               "Server Internal error or unknown error");
+
+  OnResponse(message->id(), message->error(), message->response());
+}
+
+void RpcChannel::OnResponse(uint64_t id, ErrorCode error, StringView payload)
+{
   /**
    * Receive the response from the RpcServer
    * 0. Check error, response
@@ -175,32 +886,18 @@ void RpcChannel::OnRpcMessageForResponse(TcpConnectionPtr const &conn,
    * 2. Fill(/Parse) the response
    * 3. Call done with the response, it will process the response
    */
-  if (!message->has_error()) {
-    // The response must be setted in RpcServer
-    KANON_ASSERT(message->has_response(),
-                 "Server Internal error or unknown error");
-
-    const uint64_t id = message->id();
-
+  if (error == RpcMessage::kNoError) {
     KANON_ASSERT(id <= id_, "The id in response should be not greater than the "
                             "id_ maintained by client");
 
     // Thread safe since the CallMethod()
     // insert the outstanding_calls in the loop.
-    OutstandingCall outstanding_call{nullptr, nullptr};
-
-    auto it = outstanding_calls_.find(id);
+    OutstandingCall outstanding_call;
 
-    // KANON_ASSERT(it != outstanding_calls_.end(),
-    //              "The outstanding_call must be setted before the RpcMessage "
-    //              "on_message Callback");
-
-    // If deadline is setted, may the done is erased
-    if (it == outstanding_calls_.end()) {
+    // The call may be expired(i.e. the response is late)
+    if (!outstanding_calls_.Remove(id, outstanding_call)) {
       return;
     }
-    outstanding_call = it->second;
-    outstanding_calls_.erase(it);
 
     // done and response is setted by client
     KANON_ASSERT(outstanding_call.response != nullptr,
@@ -212,8 +909,8 @@ void RpcChannel::OnRpcMessageForResponse(TcpConnectionPtr const &conn,
     // i.e. self-delete
     // std::unique_ptr<Closure> done_wrapper(outstanding_call.done);
 
-    const auto res =
-        outstanding_call.response->ParseFromString(message->response());
+    const auto res = outstanding_call.response->ParseFromArray(
+        payload.data(), (int)payload.size());
     KANON_UNUSED(res);
 
     KANON_ASSERT(
@@ -221,17 +918,111 @@ void RpcChannel::OnRpcMessageForResponse(TcpConnectionPtr const &conn,
              "Server error or probobuf internal error");
 
     // done manage the lifetime of response
-    outstanding_call.done->Run();
+    CompleteCall(outstanding_call, nullptr, RpcMessage::kNoError, true);
   } else {
     // Response with error setted
-    const auto n = outstanding_calls_.erase(message->id());
-    KANON_UNUSED(n);
-    assert(n == 1);
+    OutstandingCall outstanding_call;
+    const auto found = outstanding_calls_.Remove(id, outstanding_call);
+
+    // The request is dropped by server, this is not a logic error,
+    // the done must check the controller
+    if (error == RpcMessage::kDeadlineExceeded ||
+        error == RpcMessage::kOverloaded)
+    {
+      if (!found) return;
+      CompleteCall(outstanding_call, GetRpcErrorString(error), error, true);
+      return;
+    }
 
     // Since this error is logic error(i.e. ensure it don't happened)
-    LOG_FATAL << "Rpc error message from server: "
-              << GetRpcErrorString(message->error());
+    LOG_FATAL << "Rpc error message from server: " << GetRpcErrorString(error);
+  }
+}
+
+void RpcChannel::OnStreamResponse(uint64_t id, StringView payload)
+{
+  // The call may be expired
+  auto call = outstanding_calls_.Find(id);
+  if (!call) return;
+
+  if (!call->controller || !call->controller->HasStreamCallback()) {
+    LOG_WARN_KANON_PROTOBUF_RPC
+        << "The message of response stream is dropped since no stream "
+           "callback, id = "
+        << id;
+    return;
   }
+
+  if (!call->response->ParseFromArray(payload.data(), (int)payload.size())) {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "Invalid message of response stream";
+    return;
+  }
+
+  call->controller->OnStreamMessage(false);
+}
+
+void RpcChannel::OnStreamRequest(uint64_t id, bool end, StringView payload)
+{
+  if (!request_streams_) return;
+
+  auto it = request_streams_->find(id);
+  if (it == request_streams_->end()) return;
+
+  // The call has been finished, the arena may be released
+  auto stream = it->second;
+  if (stream->finished.load()) {
+    request_streams_->erase(it);
+    return;
+  }
+
+  if (end) {
+    request_streams_->erase(it);
+  } else if (!stream->request->ParseFromArray(payload.data(),
+                                              (int)payload.size()))
+  {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "Invalid message of request stream";
+    return;
+  }
+
+  // The method may call done in the callback
+  stream->controller->OnStreamMessage(end);
+}
+
+void RpcChannel::OnNegotiationResponse(RpcMessage::WireMode mode)
+{
+  negotiation_id_ = kNoNegotiation;
+
+  // The requests after this are sent in binary frame
+  binary_wire_.store(mode == RpcMessage::kBinaryWire,
+                     std::memory_order_relaxed);
+  LOG_DEBUG_KANON_PROTOBUF_RPC << "Wire mode: "
+                               << (binary_wire_ ? "binary" : "protobuf");
+}
+
+void RpcChannel::OnMethodTableResponse(RpcMessage const &message)
+{
+  // The map is read in other threads without lock, so a new snapshot
+  // is built and published instead of modifying the current one
+  std::shared_ptr<MethodIds> method_ids(new MethodIds());
+  auto pool = DescriptorPool::generated_pool();
+  for (int i = 0; i < message.method_names_size(); ++i) {
+    StringView name = message.method_names(i);
+    const auto slash_pos = name.rfind('/');
+    if (slash_pos == StringView::npos) continue;
+
+    // The service is not used by this client
+    auto service = pool->FindServiceByName(name.substr(0, slash_pos).ToString());
+    if (!service) continue;
+    auto method =
+        service->FindMethodByName(name.substr(slash_pos + 1).ToString());
+    if (!method) continue;
+
+    method_ids->emplace(method, (uint32_t)(i + 1));
+  }
+
+  LOG_DEBUG_KANON_PROTOBUF_RPC << "Method ids: " << method_ids->size();
+  std::atomic_store(&method_ids_,
+                    std::shared_ptr<MethodIds const>(std::move(method_ids)));
 }
 
 void RpcChannel::OnRpcMessageForRequest(TcpConnectionPtr const &conn,
@@ -261,56 +1052,50 @@ void RpcChannel::OnRpcMessageForRequest(TcpConnectionPtr const &conn,
    * request->ParseFromString(input);
    * service->CallMethod(method, *request, response, callback);
    */
+  // The RpcMessage is created on arena_ by codec, take it for this call
+  Arena *arena = message->GetArena();
+  if (arena == arena_) arena_ = nullptr;
+
   RpcMessage::ErrorCode error_code = RpcMessage::kNoError;
-  if (message->has_request() && message->has_service() && message->has_method())
+  if (message->has_wire_mode()) {
+    // Negotiation, response the wire mode accepted
+    RpcMessage negotiation;
+    negotiation.set_id(message->id());
+    negotiation.set_type(RpcMessage::kResponse);
+    negotiation.set_wire_mode(message->wire_mode());
+    codec_.Send(conn_, &negotiation);
+
+    // The responses after this are sent in binary frame
+    binary_wire_.store(message->wire_mode() == RpcMessage::kBinaryWire,
+                       std::memory_order_relaxed);
+  } else if (message->method_table()) {
+    // Handshake, response the "service/method" in the order of id
+    RpcMessage table;
+    table.set_id(message->id());
+    table.set_type(RpcMessage::kResponse);
+    table.set_method_table(true);
+    if (methods_) {
+      for (auto const &entry : methods_->methods())
+        table.add_method_names(entry.name);
+    }
+    codec_.Send(conn_, &table);
+  } else if (message->has_request() &&
+             (message->has_method_id() ||
+              (message->has_service() && message->has_method())))
   {
-    const auto it = services_->find(message->service());
-
-    if (it != services_->end()) {
-      Service *service = it->second;
-      MethodDescriptor const *method =
-          service->GetDescriptor()->FindMethodByName(message->method());
-
-      if (method) {
-        // request only used in specific method
-        // but the response will used in "done" callback
-        // then free it in SendRpcResponse
-        auto request = service->GetRequestPrototype(method).New();
-
-        // response's lifetime managed by SendRpcResponse()
-        // prototype pattern
-        Message *response = service->GetResponsePrototype(method).New();
-
-        if (request->ParseFromString(message->request())) {
-          // Closure see google/protobuf/stubs/callback.h
-          // NewCallback() support one or two argument
-          // NewCallback() accept type should be perfect match, i.e. don't allow
-          // implicit cast e.g. void Foo(std::string); NewCallback(&Foo, "a");
-          // // Don't works
-          //
-          // The Service::CallMethod is a virtual function,
-          // will call the named overrided function in the concrete
-          // derived class of Service.
-          //
-          // The request need managed by concrete service function
-          RpcController *controller = new RpcController;
-          if (message->has_deadline()) {
-            controller->SetDeadline(message->deadline());
-            LOG_DEBUG_KANON_PROTOBUF_RPC << "deadline=" << controller->deadline() << " Ms";
-          }
-          service->CallMethod(
-              method, controller, request, response,
-              PROTOBUF::NewCallback(this, &RpcChannel::SendRpcResponse,
-                                    response, message->id()));
-        } else {
-          error_code = RpcMessage::kInvalidRequest;
-        }
-      } else {
-        error_code = RpcMessage::kNoMethod;
-      }
+    MethodEntry const *entry = nullptr;
+    error_code = FindMethod(message->method_id(), message->service(),
+                            message->method(), entry);
 
-    } else {
-      error_code = RpcMessage::kNoService;
+    if (error_code == RpcMessage::kNoError) {
+      error_code = CallServiceMethod(
+          *entry, arena, message->id(),
+          message->has_deadline() ? message->deadline() : INVALID_DEADLINE,
+          message->request(), message->type() == RpcMessage::kStreamRequest);
+
+      // If done is called in CallMethod(), the arena has been reset,
+      // i.e. the message can't be accessed after dispatching
+      if (error_code == RpcMessage::kNoError) return;
     }
   } else {
     // The Message indicates the rpc message wrapper(warp request)
@@ -321,17 +1106,279 @@ void RpcChannel::OnRpcMessageForRequest(TcpConnectionPtr const &conn,
   if (error_code != RpcMessage::kNoError) {
     ErrorHandle(message->id(), error_code);
   }
+
+  if (arena) ReleaseArena(arena);
+}
+
+void RpcChannel::OnRpcFrame(TcpConnectionPtr const &conn, char const *body,
+                            size_t size, TimeStamp stamp)
+{
+  KANON_UNUSED(stamp);
+
+  RpcFrameHeader header;
+  StringView name;
+  StringView payload;
+  if (!DecodeRpcFrame(body, size, header, name, payload)) {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "Invalid binary rpc frame";
+    conn->ShutdownWrite();
+    return;
+  }
+
+  switch (header.type) {
+    case RpcMessage::kResponse:
+      OnResponse(header.id, (ErrorCode)header.error, payload);
+      return;
+    case RpcMessage::kStreamResponseMessage:
+      OnStreamResponse(header.id, payload);
+      return;
+    case RpcMessage::kStreamRequestMessage:
+    case RpcMessage::kStreamRequestEnd:
+      OnStreamRequest(header.id, header.type == RpcMessage::kStreamRequestEnd,
+                      payload);
+      return;
+    case RpcMessage::kRequest:
+    case RpcMessage::kStreamRequest:
+      break;
+    default:
+      ErrorHandle(header.id, RpcMessage::kInvalidMessage);
+      return;
+  }
+
+  MethodEntry const *entry = nullptr;
+  ErrorCode error_code = RpcMessage::kNoError;
+  if (header.method_id != MethodTable::kNoMethodId) {
+    error_code = FindMethod(header.method_id, StringView(), StringView(), entry);
+  } else {
+    const auto slash_pos = name.rfind('/');
+    error_code = slash_pos == StringView::npos
+                     ? RpcMessage::kInvalidMessage
+                     : FindMethod(header.method_id, name.substr(0, slash_pos),
+                                  name.substr(slash_pos + 1), entry);
+  }
+
+  if (error_code == RpcMessage::kNoError) {
+    // The request is parsed from the frame in place
+    auto arena = ArenaPool::GetLoopPool().Get();
+    error_code =
+        CallServiceMethod(*entry, arena, header.id, header.deadline, payload,
+                          header.type == RpcMessage::kStreamRequest);
+    if (error_code != RpcMessage::kNoError) ReleaseArena(arena);
+  }
+
+  if (error_code != RpcMessage::kNoError) {
+    ErrorHandle(header.id, error_code);
+  }
+}
+
+auto RpcChannel::FindMethod(uint32_t id, StringView service_name,
+                            StringView method_name, MethodEntry const *&entry)
+    -> ErrorCode
+{
+  if (!methods_) return RpcMessage::kNoService;
+
+  // The id is got from the handshake, index the table directly
+  if (id != MethodTable::kNoMethodId) {
+    entry = methods_->Find(id);
+    return entry ? RpcMessage::kNoError : RpcMessage::kNoMethod;
+  }
+
+  std::string name;
+  name.reserve(service_name.size() + 1 + method_name.size());
+  name.append(service_name.data(), service_name.size());
+  name += '/';
+  name.append(method_name.data(), method_name.size());
+
+  entry = methods_->Find(name);
+  if (entry) return RpcMessage::kNoError;
+  return methods_->HasService(service_name) ? RpcMessage::kNoMethod
+                                            : RpcMessage::kNoService;
+}
+
+auto RpcChannel::CallServiceMethod(MethodEntry const &entry, Arena *arena,
+                                   uint64_t id, uint64_t deadline,
+                                   StringView request_data,
+                                   bool request_stream) -> ErrorCode
+{
+  KANON_ASSERT(arena, "The call of server must have arena");
+
+  const int metric = (int)entry.id - 1;
+  const auto receive_us = metrics_ ? NowUs() : 0;
+  if (metrics_) metrics_->OnRequest(metric);
+
+  // The caller has given up, don't waste time on it
+  if (IsExpired(deadline)) {
+    if (shed_counters_)
+      shed_counters_->expired.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_) {
+      metrics_->OnCompleted(metric, RpcMessage::kDeadlineExceeded,
+                            NowUs() - receive_us);
+    }
+    return RpcMessage::kDeadlineExceeded;
+  }
+
+  // request only used in specific method
+  // but the response will used in "done" callback
+  // then free them(i.e. reset the arena) after sending response.
+  // The request is owned by the service unless use_arena_ is set
+  const bool heap_request = !use_arena_ && !request_stream;
+  auto request =
+      entry.request_prototype->New(heap_request ? nullptr : arena);
+
+  if (!request->ParseFromArray(request_data.data(), (int)request_data.size()))
+  {
+    if (heap_request) delete request;
+    if (metrics_) {
+      metrics_->OnCompleted(metric, RpcMessage::kInvalidRequest,
+                            NowUs() - receive_us);
+    }
+    return RpcMessage::kInvalidRequest;
+  }
+
+  // response's lifetime managed by the call
+  // prototype pattern
+  Message *response = entry.response_prototype->New(arena);
+
+  // The Service::CallMethod is a virtual function,
+  // will call the named overrided function in the concrete
+  // derived class of Service.
+  //
+  // The controller is freed with the arena
+  RpcController *controller = Arena::Create<RpcController>(arena);
+  if (deadline != INVALID_DEADLINE) {
+    controller->SetDeadline(deadline);
+    LOG_DEBUG_KANON_PROTOBUF_RPC << "deadline=" << controller->deadline()
+                                 << " Ms";
+  }
+
+  // The call is also the done of the method
+  auto limiter = entry.limiter.get();
+  auto call = Arena::Create<ServerCall>(
+      arena, response_queue_, flow_control_, entry, controller, request,
+      response, id, binary_wire_.load(std::memory_order_relaxed),
+      shed_counters_, metrics_, receive_us);
+  if (heap_request) call->SetHeapRequest();
+
+  // The method sets the stream callback when it is called, so the
+  // messages of stream can't arrive before it, i.e. it is called in the
+  // loop immediately regardless of the pool and limiter
+  if (request_stream) {
+    controller->EnableRequestStream();
+    auto stream = std::make_shared<RequestStream>(controller, request);
+    (*request_streams_)[id] = stream;
+    call->SetRequestStream(std::move(stream));
+    call->Invoke(false);
+    return RpcMessage::kNoError;
+  }
+
+  // The queue of pool is bounded, Push() blocks the loop if it is full,
+  // so the call is shed instead
+  auto pool = entry.pool ? entry.pool : shared_pool_;
+  if (!limiter) {
+    if (pool) {
+      if (!pool->TryPush([call]() {
+            call->Invoke();
+          }))
+      {
+        call->Shed();
+      }
+    } else {
+      call->Invoke(false);
+    }
+  } else if (pool) {
+    limiter->Run([pool, call](bool shed) {
+      if (shed) {
+        call->Shed();
+        return;
+      }
+      if (!pool->TryPush([call]() {
+            call->Invoke();
+          }))
+      {
+        call->Shed(true);
+      }
+    });
+  } else {
+    // The pending call may be run in the other thread
+    auto loop = conn_->GetLoop();
+    limiter->Run([loop, call](bool shed) {
+      if (shed) {
+        call->Shed();
+        return;
+      }
+      loop->RunInLoop([call]() {
+        call->Invoke();
+      });
+    });
+  }
+
+  return RpcMessage::kNoError;
 }
 
 void RpcChannel::SetConnection(const TcpConnectionPtr &conn) noexcept
 {
+  KANON_ASSERT(!loop_ || loop_ == conn->GetLoop(),
+               "The new connection must be in the same loop");
   conn_ = conn;
+  if (!loop_) {
+    loop_ = conn->GetLoop();
+    // The flush queued to the loop may run after the channel is destroyed
+    std::weak_ptr<bool> alive = alive_;
+    request_queue_ = std::make_shared<RequestQueue>(
+        loop_, [this, alive](std::vector<PendingRequest> &requests) {
+          if (alive.expired()) return;
+          SendRequests(requests);
+        });
+  }
+
+  SetUpFlowControl();
+
+  // The ids may be invalid in the new server
+  std::atomic_store(&method_ids_, std::shared_ptr<MethodIds const>());
+  method_table_id_ = kNoNegotiation;
+
+  // The peer may be a different server, negotiate again
+  binary_wire_.store(false, std::memory_order_relaxed);
+  negotiation_id_ = kNoNegotiation;
 
   // Forward to codec to process raw-format message
-  conn_->SetMessageCallback(std::bind(&Codec::OnMessage, &codec_, _1, _2, _3));
+  conn_->SetMessageCallback([this](TcpConnectionPtr const &conn, Buffer &buffer,
+                                   TimeStamp receive_time) {
+    // The requests(or responses) in the buffer are decoded and dispatched,
+    // and the responses(or the requests issued in done) are sent at once
+    if (response_queue_) response_queue_->BeginBatch();
+    request_queue_->BeginBatch();
+    codec_.OnMessage(conn, buffer, receive_time);
+    request_queue_->EndBatch();
+    if (response_queue_) response_queue_->EndBatch();
+  });
 
   // Handle the protobuf-format RpcMessage(i.e. the payload after the codec_
   // parsing)
   codec_.SetMessageCallback(
       std::bind(&RpcChannel::OnRpcMessage, this, _1, _2, _3));
+
+  // Handle the binary frame after the negotiation, the frame and RpcMessage
+  // can be mixed since the peer may not receive the negotiation response
+  codec_.SetRawMessageCallback(
+      krpc_frame_tag, [this](TcpConnectionPtr const &conn, char const *body,
+                             size_t size, TimeStamp receive_time) {
+        OnRpcFrame(conn, body, size, receive_time);
+      });
+}
+
+void RpcChannel::SetUpFlowControl()
+{
+  // Shared by the connections if reconnecting, since the
+  // queued bytes are released later
+  if (!flow_control_) flow_control_.reset(new FlowControl(kStreamHighWaterMark));
+
+  // The output buffer of the new connection is empty
+  flow_control_->Unblock();
+
+  auto flow_control = flow_control_;
+  conn_->SetHighWaterMarkCallback(
+      [flow_control](TcpConnectionPtr const &conn, size_t) {
+        BlockStreams(conn, flow_control);
+      },
+      kStreamHighWaterMark);
 }
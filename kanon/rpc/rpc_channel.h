@@ -2,29 +2,70 @@
 #define KANON_KRPC_RPCHANNLE_H_
 
 #include <atomic>
+#include <memory>
 #include <unordered_map>
 
 // ProtobufCodec<> need class definition for following reasons:
 // 1. std::is_base_of<>
 // 2. constructor of ConcreMessage
+#include "batch_queue.h"
 #include "callable.h"
 #include "kanon/net/callback.h"
 #include "kanon/protobuf/protobuf_codec.h"
+#include "kanon/string/string_view.h"
 #include "kanon/rpc/rpc.pb.h"
 #include "kanon/thread/mutex_lock.h"
 #include "kanon/util/noncopyable.h"
+#include "deadline_wheel.h"
+#include "flow_control.h"
+#include "kanon/net/timer/timer_id.h"
+#include "method_table.h"
+#include "outstanding_calls.h"
 #include "rpc_codec.h"
+#include "rpc_metrics.h"
 
 #include <google/protobuf/service.h>
 
 namespace kanon {
+
+class EventLoop;
+class ThreadPool;
+
 namespace protobuf {
 namespace rpc {
 
 class RpcController;
+struct RpcFrameHeader;
 
 /**
+ * \brief The counters of the requests dropped by server
+ */
+struct ShedCounters {
+  ShedCounters()
+    : expired(0)
+    , overloaded(0)
+  {
+  }
+
+  /** The deadline is exceeded before the method runs */
+  std::atomic<uint64_t> expired;
+
+  /** Shed by the adaptive concurrency limiter */
+  std::atomic<uint64_t> overloaded;
+};
+
+/**
+ * \brief The channel of the calls in a connection
+ *
+ * Besides the unary call, the call can stream(see RpcController):
+ * - response stream: the server writes the messages of the call by
+ *   RpcController::WriteStream() before the done, and the done
+ *   sends the final response which ends the stream.
+ * - request stream: the client enables it in the controller, then writes
+ *   the messages after the call and ends them by CloseStream().
  *
+ * The stream messages are flow controlled by the high water mark of the
+ * connection, i.e. the writer should wait once the stream is not writable.
  */
 class RpcChannel
   : public noncopyable
@@ -35,20 +76,62 @@ class RpcChannel
   using RpcMessagePtr = RpcMessage *;
 
  public:
-  using ServiceMap = std::unordered_map<std::string, PROTOBUF::Service *>;
-
   /** Used for client */
   RpcChannel();
   /** Used for server */
   explicit RpcChannel(TcpConnectionPtr const &conn);
   ~RpcChannel();
 
+  /**
+   * The connection can be reset after reconnecting, but it must be in
+   * the same loop. The wire mode and method ids are reset, i.e. the
+   * client needs to negotiate again.
+   */
   void SetConnection(TcpConnectionPtr const &conn) noexcept;
-  /** Used for server */
-  void SetServices(ServiceMap const &services) noexcept
-  {
-    services_ = &services;
-  }
+  /**
+   * Used for server
+   *
+   * The messages of each call(RpcMessage, response, controller) are
+   * allocated in an arena got from the arena pool of the loop, and the
+   * arena is reset and recycled after the response is sent. The request
+   * is also allocated in the arena if SetUseArena() is called.
+   *
+   * If the method is executed in the pool, the response is serialized
+   * in the thread that call done, then posted to the loop in batch.
+   *
+   * The request whose deadline is exceeded before the method runs
+   * (including the time pending in the pool or limiter) is dropped with
+   * kDeadlineExceeded, and the request shed by limiter or the full pool
+   * is responsed with kOverloaded.
+   *
+   * \param shared_pool The pool used by the services don't specify pool
+   * \param counters Count the dropped requests if not NULL
+   * \param metrics Record the calls if not NULL, the methods are added
+   *                in the order of \p methods
+   * \note
+   *   The request is owned by the service(e.g. deleted by DeferDelete)
+   *   unless SetUseArena() is called.
+   */
+  void SetServices(MethodTable const &methods,
+                   ThreadPool *shared_pool = nullptr,
+                   ShedCounters *counters = nullptr,
+                   RpcMetrics *metrics = nullptr) noexcept;
+
+  /**
+   * Record the calls of the methods added in \p metrics,
+   * the other methods are not recorded
+   * \note Used for client, must be called before any call
+   */
+  void SetMetrics(RpcMetrics *metrics) noexcept { metrics_ = metrics; }
+
+  /**
+   * Allocate the request in the arena of the call, then the service
+   * must not delete it.
+   * The request of the method with request stream is always owned by
+   * the call since it is refilled after the method returns.
+   * \note Used for server, must be called before any call
+   */
+  void SetUseArena(bool on) noexcept { use_arena_ = on; }
 
   /**
    * \param request the lifetime is managed by user
@@ -60,22 +143,181 @@ class RpcChannel
                   PROTOBUF::Message const *request, PROTOBUF::Message *response,
                   PROTOBUF::Closure *done) override;
 
+  /**
+   * Call the method and block until the call is completed, i.e. the
+   * response is received or the call is failed(see the controller)
+   *
+   * The done of the call is a thread-local object of the calling thread,
+   * so no closure and latch are allocated per call, and the caller only
+   * sleeps(futex) if the call is not completed after spinning briefly.
+   *
+   * \note
+   *   Must not be called in the loop of the connection since the
+   *   response is received in it.
+   *   The request stream is not supported.
+   */
+  void CallMethodSync(PROTOBUF::MethodDescriptor const *method,
+                      PROTOBUF::RpcController *controller,
+                      PROTOBUF::Message const *request,
+                      PROTOBUF::Message *response);
+
+  /**
+   * Request the server to use the binary wire mode(see rpc_frame.h),
+   * i.e. the request and response are serialized into the frame directly
+   * instead of wrapping in the RpcMessage.
+   *
+   * The calls are sent in RpcMessage until the server accepts it.
+   * If the server don't support it, the wire mode is not changed.
+   *
+   * \note Used for client, must be called after SetConnection()
+   */
+  void NegotiateBinaryWire();
+
+  bool IsBinaryWire() const noexcept
+  {
+    return binary_wire_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Request the method table of server, then the calls of the methods
+   * in the table are sent with the numeric method id instead of the
+   * service and method name.
+   *
+   * The calls are sent with name until the table is received.
+   * If the server don't support it, the names are always used.
+   *
+   * \note Used for client, must be called after SetConnection()
+   */
+  void NegotiateMethodIds();
+
+  bool HasMethodIds() const noexcept
+  {
+    return std::atomic_load(&method_ids_) != nullptr;
+  }
+
+  /**
+   * Complete the outstanding calls with the error "Connection closed",
+   * and stop the deadline timer
+   * \note Used for client, must be called in the loop when the connection
+   *       is closed
+   */
+  void CancelOutstandingCalls();
+
+  /**
+   * The number of calls that are not completed(including the calls
+   * not sent yet), used for load balancing
+   */
+  size_t GetPendingCallCount() const noexcept
+  {
+    return pending_calls_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The stream is not writable if the bytes queued or the output buffer
+   * of the connection exceeds this
+   */
+  static constexpr size_t kStreamHighWaterMark = 1 << 20;
+
  private:
   /**
-   * Wrapper of the callback that running in the loop
-   * since c++11 don't allow variable initialization in capture list
+   * The request encoded in the caller thread, which is sent in the loop
+   */
+  struct PendingRequest {
+    ChunkList frame;
+    uint64_t id;
+    PROTOBUF::Message *response;
+    PROTOBUF::Closure *done; //!< NULL for the message of request stream
+    RpcController *controller;
+    size_t stream_size; //!< Accounted in the flow control if not 0
+    int metric;         //!< The index in metrics_, -1 indicates no metrics
+    uint64_t start_us;
+  };
+
+  /**
+   * The response serialized in the thread that call done
    */
-  void SendRpcRequest(RpcMessage &message, PROTOBUF::Message *response,
-                      PROTOBUF::Closure *done, RpcController *controller);
+  struct PendingResponse {
+    ChunkList frame;
+    PROTOBUF::Arena *arena; //!< Released after the frame is sent if not NULL
+    size_t stream_size;     //!< Accounted in the flow control if not 0
+    /** The call of the request stream is finished, or (uint64_t)-1 */
+    uint64_t request_stream_id;
+  };
+
+  /**
+   * The request stream of the call in server
+   * The controller and request are valid until the call is finished.
+   */
+  struct RequestStream {
+    RequestStream(RpcController *c, PROTOBUF::Message *r) noexcept
+      : finished(false)
+      , controller(c)
+      , request(r)
+    {
+    }
+
+    /** Setted by the done, then the arena may be released in the loop */
+    std::atomic<bool> finished;
+    RpcController *controller;
+    PROTOBUF::Message *request;
+  };
+
+  /**
+   * The writer of the request stream in client
+   */
+  class ClientStream;
+
+  using RequestStreams =
+      std::unordered_map<uint64_t, std::shared_ptr<RequestStream>>;
+  using RequestQueue = BatchQueue<PendingRequest>;
+  using ResponseQueue = BatchQueue<PendingResponse>;
+
+  /**
+   * Register the \p requests as outstanding calls and send them at once
+   */
+  void SendRequests(std::vector<PendingRequest> &requests);
+
+  /**
+   * Let the flow control know the output buffer of connection
+   */
+  void SetUpFlowControl();
+
+  void AddOutstandingCall(PendingRequest const &request, uint64_t sent_us);
+
+  /**
+   * Complete the expired calls with the timeout error
+   */
+  void OnDeadlineTick();
+
+  /**
+   * Run the \p done of client
+   * \param error Set to the controller if not NULL
+   */
+  void CompleteCall(PROTOBUF::Closure *done, RpcController *controller,
+                    char const *error);
+
+  /**
+   * Same as the above, but record the metrics of the \p call
+   * \param error_slot The index in MethodMetricsSnapshot::errors
+   * \param responded The response is received, i.e. record exec time
+   */
+  void CompleteCall(OutstandingCall const &call, char const *error,
+                    size_t error_slot, bool responded = false);
+
+  /**
+   * Encode the binary frame with \p payload and send it
+   */
+  void SendRpcFrame(RpcFrameHeader const &header,
+                    PROTOBUF::Message const *payload);
   /**
    * This call the Service::CallMethod(), the logic is
    * fill the response according to the request
    * defined in the derived class of Service.
    *
-   * The lifetime of request is managed by user.
-   * The lifetime of response is managed by SendRpcResponse().
+   * The lifetime of request and response are managed by the arena
+   * of the call, which is released after the response is sent.
    *
-   * This allow user fill request and call SendRpcResponse()
+   * This allow user fill response and call done(i.e. ServerCall::Run())
    * in the other thread
    */
   void OnRpcMessageForRequest(TcpConnectionPtr const &conn,
@@ -87,51 +329,195 @@ class RpcChannel
   void OnRpcMessage(TcpConnectionPtr const &conn, RpcMessagePtr message,
                     TimeStamp stamp);
 
+  /**
+   * Handle the binary frame(i.e. the frame with krpc_frame_tag)
+   */
+  void OnRpcFrame(TcpConnectionPtr const &conn, char const *body, size_t size,
+                  TimeStamp stamp);
+
+  /**
+   * Parse the response from \p payload and call the done of client
+   */
+  void OnResponse(uint64_t id, ErrorCode error, StringView payload);
+
+  /**
+   * Parse the message of response stream to the response of the call
+   */
+  void OnStreamResponse(uint64_t id, StringView payload);
+
+  /**
+   * Parse the message of request stream to the request of the call
+   * \param end The request stream is ended
+   */
+  void OnStreamRequest(uint64_t id, bool end, StringView payload);
+
+  void OnNegotiationResponse(RpcMessage::WireMode mode);
+
+  /**
+   * Map the method names in the table to the method descriptors
+   * generated in this process
+   */
+  void OnMethodTableResponse(RpcMessage const &message);
+
+  /**
+   * \return
+   *   The id got in handshake, or MethodTable::kNoMethodId
+   */
+  uint32_t GetMethodId(PROTOBUF::MethodDescriptor const *method) const;
+
+  /**
+   * Find the method in methods_ by \p id, or the name if \p id is 0
+   */
+  ErrorCode FindMethod(uint32_t id, StringView service_name,
+                       StringView method_name, MethodEntry const *&entry);
+
+  /**
+   * Parse the request from \p request_data in \p arena and
+   * call the Service::CallMethod() according to the execution policy
+   *
+   * \param request_stream The request is the first of the stream,
+   *                       the method is called in the loop
+   * \return
+   *   kNoError indicates the method is dispatched, the \p arena is
+   *   released after the response is sent
+   */
+  ErrorCode CallServiceMethod(MethodEntry const &entry,
+                              PROTOBUF::Arena *arena, uint64_t id,
+                              uint64_t deadline, StringView request_data,
+                              bool request_stream);
+
+  /**
+   * The call in server, also the "done" of Service::CallMethod()
+   */
+  class ServerCall;
+
   /**
    * Fill error message and send
    */
   void ErrorHandle(uint64_t id, ErrorCode error_code);
 
   /**
-   * Fill response and send
-   * Used for server side
+   * Reset and recycle the \p arena in the loop
    */
-  void SendRpcResponse(PROTOBUF::Message *response, uint64_t id);
+  void ReleaseArena(PROTOBUF::Arena *arena);
 
  private:
+  /**
+   * Expired when the channel is destroyed, checked by the functors
+   * capturing this that may run in the loop after it
+   * (e.g. the flush of request_queue_, the tick of deadline_timer_)
+   */
+  std::shared_ptr<bool> alive_;
+
   TcpConnectionPtr conn_;
   std::atomic<uint64_t> id_;
+
+  /**
+   * Send the requests(client) or responses(server) in binary frame
+   * The frames received are handled regardless of this.
+   */
+  std::atomic<bool> binary_wire_;
+
+  /**
+   * The id of the negotiation request is not responsed
+   * ! Used for client side
+   */
+  uint64_t negotiation_id_;
+
+  /**
+   * The id of the method table request is not responsed
+   * ! Used for client side
+   */
+  uint64_t method_table_id_;
+
+  /**
+   * Method descriptor -> method id of server
+   * The snapshot is read by the callers without lock and replaced
+   * by std::atomic_store() when the table is received or the connection
+   * is reset(NULL), so the ids can be negotiated again after reconnecting
+   * ! Used for client side
+   */
+  using MethodIds =
+      std::unordered_map<PROTOBUF::MethodDescriptor const *, uint32_t>;
+  std::shared_ptr<MethodIds const> method_ids_;
+
   Codec codec_;
 
   /**
    * xxxServiceImpl is a concrete class, can use raw pointer
-   * According the service string from the request get the specific service
+   * According the method id or name from the request get the specific service
    * then call Service::CallMethod()
    * ! Used for server side
    */
-  ServiceMap const *services_;
+  MethodTable const *methods_;
+  ThreadPool *shared_pool_;
+  ShedCounters *shed_counters_;
+  bool use_arena_; //!< The request is allocated in the arena
 
   /**
-   * response and done are setted by client
-   *
-   * Store response since rpc message is the internal
-   * message, we must parse it in the OnMessage handler.
-   *
-   * Store the done since this is a asynchronous callback
-   *
+   * Server: indexed by the method id - 1
+   * Client: indexed by RpcMetrics::FindMethod()
    */
-  struct OutstandingCall {
-    PROTOBUF::Message *response;
-    PROTOBUF::Closure *done;
-  };
+  RpcMetrics *metrics_;
+
+  /**
+   * Send the responses of the channel, the calls in flight share it
+   * since the channel may be destroyed before the call is completed
+   */
+  std::shared_ptr<ResponseQueue> response_queue_;
+
+  /**
+   * The request streams in progress
+   * Shared with the flush of response_queue_, which erases the stream
+   * once the response of its call is sent
+   * ! Used for server side
+   */
+  std::shared_ptr<RequestStreams> request_streams_;
+
+  /**
+   * Shared with the stream writers and the calls in flight, which may
+   * outlive the channel
+   */
+  std::shared_ptr<FlowControl> flow_control_;
+
+  /**
+   * The arena of the incoming message
+   * Taken by the request then got from the pool again
+   * ! Used for server side
+   */
+  PROTOBUF::Arena *arena_;
+
+  /**
+   * The loop of connection, it is not changed after reconnecting
+   * ! Used for client side
+   */
+  EventLoop *loop_;
+
+  /**
+   * Coalesce the requests issued in the same batch
+   * Shared with the stream writers, which may outlive the channel
+   * ! Used for client side
+   */
+  std::shared_ptr<RequestQueue> request_queue_;
+
+  std::atomic<size_t> pending_calls_;
 
   using IdType = uint64_t;
   /**
-   * OutstandingCall is a pair of <response, done>
+   * OutstandingCall is a tuple of <response, done, controller>
    * response and done is filled by client
    * ! Used for client side
    */
-  std::unordered_map<IdType, OutstandingCall> outstanding_calls_;
+  OutstandingCalls outstanding_calls_;
+
+  /**
+   * The deadlines of the outstanding calls, checked by deadline_timer_
+   * which is running only if there are deadlines
+   * ! Used for client side
+   */
+  DeadlineWheel deadline_wheel_;
+  TimerId deadline_timer_;
+  bool deadline_timer_running_;
 
   std::unordered_map<IdType, OutstandingCall> canceling_calls_;
 };
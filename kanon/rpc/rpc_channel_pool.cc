@@ -0,0 +1,138 @@
+#include "rpc_channel_pool.h"
+
+#include <google/protobuf/stubs/callback.h>
+
+#include "kanon/net/connection/tcp_connection.h"
+#include "kanon/net/event_loop_pool.h"
+#include "kanon/net/tcp_client.h"
+#include "kanon/rpc/logger.h"
+#include "rpc_controller.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+/**
+ * xorshift, the quality is enough for choosing connections
+ */
+static KANON_INLINE uint64_t NextRandom() noexcept
+{
+  static thread_local uint64_t t_state =
+      (uint64_t)(uintptr_t)&t_state ^ TimeStamp::Now().GetMicroseconds();
+
+  t_state ^= t_state << 13;
+  t_state ^= t_state >> 7;
+  t_state ^= t_state << 17;
+  return t_state;
+}
+
+RpcChannelPool::RpcChannelPool(EventLoopPool *loops)
+  : loops_(loops)
+  , binary_wire_(false)
+{
+}
+
+RpcChannelPool::~RpcChannelPool() noexcept
+{
+  for (auto &member : members_)
+    member->client->Disconnect();
+}
+
+void RpcChannelPool::AddServer(InetAddr const &addr, int conn_num)
+{
+  for (int i = 0; i < conn_num; ++i) {
+    AddMember(NewTcpClient(loops_->GetNextLoop(), addr,
+                           "RpcChannelPool-" + addr.ToIpPort() + '-' +
+                               std::to_string(i)));
+  }
+}
+
+void RpcChannelPool::AddServer(UnixAddr const &addr, int conn_num)
+{
+  for (int i = 0; i < conn_num; ++i) {
+    AddMember(NewTcpClient(loops_->GetNextLoop(), addr,
+                           "RpcChannelPool-" + addr.ToString() + '-' +
+                               std::to_string(i)));
+  }
+}
+
+void RpcChannelPool::AddMember(TcpClientPtr client)
+{
+  std::unique_ptr<Member> member(new Member());
+  member->client = std::move(client);
+  member->channel.reset(new rpc::RpcChannel());
+  member->connected = false;
+
+  auto p = member.get();
+  const bool binary_wire = binary_wire_;
+  member->client->SetConnectionCallback(
+      [p, binary_wire](TcpConnectionPtr const &conn) {
+        if (conn->IsConnected()) {
+          p->channel->SetConnection(conn);
+          if (binary_wire) p->channel->NegotiateBinaryWire();
+          p->connected.store(true, std::memory_order_release);
+        } else {
+          p->connected.store(false, std::memory_order_release);
+          p->channel->CancelOutstandingCalls();
+        }
+      });
+  member->client->EnableRetry();
+  member->client->Connect();
+
+  members_.emplace_back(std::move(member));
+}
+
+void RpcChannelPool::CallMethod(PROTOBUF::MethodDescriptor const *method,
+                                PROTOBUF::RpcController *controller,
+                                PROTOBUF::Message const *request,
+                                PROTOBUF::Message *response,
+                                PROTOBUF::Closure *done)
+{
+  auto member = Pick();
+  if (member) {
+    member->channel->CallMethod(method, controller, request, response, done);
+    return;
+  }
+
+  LOG_ERROR_KANON_PROTOBUF_RPC << "No connection in the channel pool";
+  if (controller) controller->SetFailed("No connection");
+  if (done) done->Run();
+}
+
+size_t RpcChannelPool::GetConnectedCount() const noexcept
+{
+  size_t count = 0;
+  for (auto const &member : members_)
+    count += member->connected.load(std::memory_order_relaxed) ? 1 : 0;
+  return count;
+}
+
+auto RpcChannelPool::Pick() noexcept -> Member *
+{
+  const auto size = members_.size();
+  if (size == 0) return nullptr;
+
+  const auto random = NextRandom();
+  auto first = members_[random % size].get();
+  auto second = members_[(random >> 32) % size].get();
+
+  const bool first_connected =
+      first->connected.load(std::memory_order_acquire);
+  const bool second_connected =
+      second->connected.load(std::memory_order_acquire);
+
+  if (first_connected && second_connected) {
+    return first->channel->GetPendingCallCount() <=
+                   second->channel->GetPendingCallCount()
+               ? first
+               : second;
+  }
+  if (first_connected) return first;
+  if (second_connected) return second;
+
+  // Most connections are closed, find any one
+  for (size_t i = 0; i < size; ++i) {
+    auto member = members_[(random + i) % size].get();
+    if (member->connected.load(std::memory_order_acquire)) return member;
+  }
+  return nullptr;
+}
@@ -0,0 +1,110 @@
+#ifndef KANON_RPC_RPC_CHANNEL_POOL_H__
+#define KANON_RPC_RPC_CHANNEL_POOL_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <google/protobuf/service.h>
+
+#include "kanon/net/inet_addr.h"
+#include "kanon/net/tcp_client.h"
+#include "kanon/net/unix_addr.h"
+#include "kanon/util/noncopyable.h"
+#include "rpc_channel.h"
+
+namespace kanon {
+
+class EventLoopPool;
+
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief Spread the calls over multiple connections
+ *
+ * The connections may connect to several servers, and are distributed
+ * in the loops of EventLoopPool(round-robin).
+ *
+ * The call is sent in the connection chosen by power-of-two-choices,
+ * i.e. choose two connections randomly, then pick the one with less
+ * pending calls.
+ *
+ * The connection is reconnected automatically once it is closed by peer,
+ * and the outstanding calls in it are completed with the error
+ * "Connection closed". If no connection is available, the call is
+ * completed with the error "No connection" immediately.
+ *
+ * Usage:
+ * \code
+ *   RpcChannelPool pool(&loop_pool);
+ *   pool.AddServer(InetAddr("127.0.0.1:9998"), 4);
+ *   XXXService::Stub stub(&pool);
+ * \endcode
+ */
+class RpcChannelPool
+  : noncopyable
+  , public ::google::protobuf::RpcChannel {
+ public:
+  /**
+   * \param loops Must be started
+   */
+  explicit RpcChannelPool(EventLoopPool *loops);
+  ~RpcChannelPool() noexcept;
+
+  /**
+   * Negotiate the binary wire mode in each connection
+   * \note Must be called before AddServer()
+   */
+  void EnableBinaryWire() noexcept { binary_wire_ = true; }
+
+  /**
+   * Add \p conn_num connections to the server \p addr
+   * \note
+   *   Must be called in the thread that owns the \p loops
+   *   and before any call
+   */
+  void AddServer(InetAddr const &addr, int conn_num = 1);
+
+  /**
+   * Add \p conn_num connections to the server listening in the unix
+   * domain socket \p addr, i.e. the server in the same host
+   * \note Same as the above
+   */
+  void AddServer(UnixAddr const &addr, int conn_num = 1);
+
+  void CallMethod(PROTOBUF::MethodDescriptor const *method,
+                  PROTOBUF::RpcController *controller,
+                  PROTOBUF::Message const *request, PROTOBUF::Message *response,
+                  PROTOBUF::Closure *done) override;
+
+  /** The number of connections that are established */
+  size_t GetConnectedCount() const noexcept;
+
+  size_t GetSize() const noexcept { return members_.size(); }
+
+ private:
+  struct Member {
+    TcpClientPtr client;
+    std::unique_ptr<rpc::RpcChannel> channel;
+    std::atomic<bool> connected;
+  };
+
+  /**
+   * \return
+   *   NULL if no connection is established
+   */
+  Member *Pick() noexcept;
+
+  void AddMember(TcpClientPtr client);
+
+  EventLoopPool *loops_;
+  bool binary_wire_;
+  std::vector<std::unique_ptr<Member>> members_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_RPC_CHANNEL_POOL_H__
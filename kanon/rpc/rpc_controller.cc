@@ -10,6 +10,8 @@ using namespace kanon;
 
 RpcController::RpcController()
   : deadline_((Deadline)-1)
+  , request_stream_(false)
+  , stream_writer_(nullptr)
 {
 }
 
@@ -18,20 +20,28 @@ RpcController::~RpcController() noexcept {}
 void RpcController::Reset()
 {
   deadline_ = (Deadline)-1;
+  error_text_.clear();
+  request_stream_ = false;
+  stream_callback_ = nullptr;
+  stream_writer_ = nullptr;
+  owned_stream_writer_.reset();
 }
 
 bool RpcController::Failed() const
 {
-  return false;
+  return !error_text_.empty();
 }
 
 void RpcController::StartCancel() {}
 
-void RpcController::SetFailed(std::string const & /*reason*/) {}
+void RpcController::SetFailed(std::string const &reason)
+{
+  error_text_ = reason;
+}
 
 std::string RpcController::ErrorText() const
 {
-  return "";
+  return error_text_;
 }
 
 bool RpcController::IsCanceled() const
@@ -50,3 +60,21 @@ void RpcController::NotifyOnCancel(::google::protobuf::Closure *cb)
 {
   KANON_UNUSED(cb);
 }
+
+bool RpcController::WriteStream(::google::protobuf::Message const &message)
+{
+  KANON_ASSERT(stream_writer_, "The call is not in progress");
+  return stream_writer_->Write(message);
+}
+
+void RpcController::CloseStream()
+{
+  KANON_ASSERT(stream_writer_, "The call is not in progress");
+  stream_writer_->Close();
+}
+
+void RpcController::NotifyOnWritable(::google::protobuf::Closure *cb)
+{
+  KANON_ASSERT(stream_writer_, "The call is not in progress");
+  stream_writer_->NotifyOnWritable(cb);
+}
@@ -1,6 +1,9 @@
 #ifndef KANON_RPC_CONTROLLER_H__
 #define KANON_RPC_CONTROLLER_H__
 
+#include <functional>
+#include <memory>
+
 #include <google/protobuf/service.h>
 
 #include "kanon/net/connection/tcp_connection.h"
@@ -12,9 +15,35 @@ namespace protobuf {
 namespace rpc {
 
 class RpcMessage;
+class RpcChannel;
 
 #define INVALID_DEADLINE ((size_t)-1)
 
+/**
+ * \brief Write the messages of a stream
+ *
+ * Implemented by the rpc channel:
+ * - server: write the response stream of the call
+ * - client: write the request stream of the call
+ */
+class StreamWriter {
+ public:
+  virtual ~StreamWriter() = default;
+
+  /**
+   * \return
+   *   false indicates the stream is not writable, the writer should wait
+   *   by NotifyOnWritable() before writing the next message.
+   *   The message is always sent.
+   */
+  virtual bool Write(PROTOBUF::Message const &message) = 0;
+
+  /** End the stream */
+  virtual void Close() = 0;
+
+  virtual void NotifyOnWritable(PROTOBUF::Closure *cb) = 0;
+};
+
 class RpcController : public ::google::protobuf::RpcController {
  public:
   /* kanon support double(seconds), ms(integer), us(integer) */
@@ -56,6 +85,58 @@ class RpcController : public ::google::protobuf::RpcController {
     return deadline_;
   }
 
+  /**
+   * Stream the requests of the call, i.e. the request passed to the
+   * call is the first one, the others are written by WriteStream(),
+   * then CloseStream() ends the stream.
+   *
+   * \note Must be called before the call
+   */
+  void EnableRequestStream() KANON_NOEXCEPT { request_stream_ = true; }
+
+  /*--------------------*/
+  /* Streaming          */
+  /*--------------------*/
+
+  /**
+   * Called in the loop when a message of the stream is received:
+   * - client: the response is filled with the message of the response
+   *   stream, and the done is called with the final response
+   * - server: the request is refilled with the message of the request
+   *   stream, \p end is true when the request stream is ended(the request
+   *   is not refilled)
+   *
+   * \note
+   *   The server must set it in the method of the request stream,
+   *   which is called in the loop always.
+   */
+  using StreamCallback = std::function<void(bool end)>;
+
+  void SetStreamCallback(StreamCallback cb) { stream_callback_ = std::move(cb); }
+
+  bool IsRequestStream() const KANON_NOEXCEPT { return request_stream_; }
+
+  /**
+   * Write a message to the response stream(server) or request
+   * stream(client), it is sent in the order of writing.
+   *
+   * \return
+   *   false indicates the output of the connection exceeds the high water
+   *   mark, the writer should wait by NotifyOnWritable()
+   * \note
+   *   Server: must be called before the done
+   *   Client: must be called after the call, and in the same thread
+   */
+  bool WriteStream(PROTOBUF::Message const &message);
+
+  /** End the request stream(client only) */
+  void CloseStream();
+
+  /**
+   * Run \p cb once the stream is writable, maybe in the current thread
+   */
+  void NotifyOnWritable(PROTOBUF::Closure *cb);
+
   /*--------------------*/
   /* Server side        */
   /*--------------------*/
@@ -71,7 +152,37 @@ class RpcController : public ::google::protobuf::RpcController {
   /*-------------------*/
 
  private:
+  friend class RpcChannel;
+
+  /** Set by the channel in the call */
+  void SetStreamWriter(StreamWriter *writer) KANON_NOEXCEPT
+  {
+    stream_writer_ = writer;
+  }
+
+  /** The writer is owned by the controller(client) */
+  void SetStreamWriter(std::unique_ptr<StreamWriter> writer) KANON_NOEXCEPT
+  {
+    owned_stream_writer_ = std::move(writer);
+    stream_writer_ = owned_stream_writer_.get();
+  }
+
+  void OnStreamMessage(bool end)
+  {
+    if (stream_callback_) stream_callback_(end);
+  }
+
+  bool HasStreamCallback() const KANON_NOEXCEPT { return !!stream_callback_; }
+
   Deadline deadline_;
+
+  /** Empty indicates the call is not failed */
+  std::string error_text_;
+
+  bool request_stream_;
+  StreamCallback stream_callback_;
+  StreamWriter *stream_writer_;
+  std::unique_ptr<StreamWriter> owned_stream_writer_;
 };
 } // namespace rpc
 } // namespace protobuf
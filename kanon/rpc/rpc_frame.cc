@@ -0,0 +1,92 @@
+#include "rpc_frame.h"
+
+#include <string.h>
+
+#include <google/protobuf/message.h>
+
+#include "kanon/net/endian_api.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+char const kanon::protobuf::rpc::krpc_frame_tag[] = "krpb";
+
+static_assert(sizeof(krpc_frame_tag) == sizeof("krpc"),
+              "The binary frame tag must have the same length with krpc_tag");
+
+template <typename T>
+static KANON_INLINE char *WriteInteger(char *p, T i) noexcept
+{
+  ::memcpy(p, &i, sizeof i);
+  return p + sizeof i;
+}
+
+template <typename T>
+static KANON_INLINE char const *ReadInteger(char const *p, T &i) noexcept
+{
+  ::memcpy(&i, p, sizeof i);
+  return p + sizeof i;
+}
+
+void kanon::protobuf::rpc::EncodeRpcFrame(ChunkStream &stream,
+                                          RpcFrameHeader const &header,
+                                          StringView name,
+                                          PROTOBUF::Message const *payload)
+{
+  assert(name.size() <= UINT16_MAX);
+
+  char buf[kRpcFrameHeaderLength];
+  auto p = WriteInteger(buf, sock::ToNetworkByteOrder64(header.id));
+  p = WriteInteger(p, sock::ToNetworkByteOrder64(header.deadline));
+  p = WriteInteger(p, sock::ToNetworkByteOrder32(header.method_id));
+  p = WriteInteger(p, header.type);
+  p = WriteInteger(p, header.error);
+  p = WriteInteger(p, sock::ToNetworkByteOrder16(uint16_t(name.size())));
+  assert(p == buf + sizeof buf);
+
+  auto &frame = stream.chunk_list;
+  frame.Append(krpc_frame_tag, sizeof(krpc_frame_tag) - 1);
+  frame.Append(buf, sizeof buf);
+  if (!name.empty()) frame.Append(name);
+
+  // Serialize the payload into the frame directly
+  if (payload) payload->SerializePartialToZeroCopyStream(&stream);
+
+  RpcCodec::SealFrame(frame);
+}
+
+void kanon::protobuf::rpc::EncodeRpcMessage(ChunkStream &stream,
+                                            RpcMessage const &message)
+{
+  auto &frame = stream.chunk_list;
+  frame.Append(krpc_tag, sizeof("krpc") - 1);
+  message.SerializePartialToZeroCopyStream(&stream);
+  RpcCodec::SealFrame(frame);
+}
+
+bool kanon::protobuf::rpc::DecodeRpcFrame(char const *body, size_t size,
+                                          RpcFrameHeader &header,
+                                          StringView &name,
+                                          StringView &payload) noexcept
+{
+  if (size < kRpcFrameHeaderLength) return false;
+
+  uint16_t name_size = 0;
+  auto p = ReadInteger(body, header.id);
+  p = ReadInteger(p, header.deadline);
+  p = ReadInteger(p, header.method_id);
+  p = ReadInteger(p, header.type);
+  p = ReadInteger(p, header.error);
+  p = ReadInteger(p, name_size);
+
+  header.id = sock::ToHostByteOrder64(header.id);
+  header.deadline = sock::ToHostByteOrder64(header.deadline);
+  header.method_id = sock::ToHostByteOrder32(header.method_id);
+  name_size = sock::ToHostByteOrder16(name_size);
+
+  if (size < kRpcFrameHeaderLength + name_size) return false;
+
+  name = StringView(p, name_size);
+  payload = StringView(p + name_size, size - kRpcFrameHeaderLength - name_size);
+  return true;
+}
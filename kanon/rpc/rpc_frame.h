@@ -0,0 +1,83 @@
+#ifndef KANON_RPC_FRAME_H__
+#define KANON_RPC_FRAME_H__
+
+#include "kanon/protobuf/chunk_stream.h"
+#include "kanon/string/string_view.h"
+#include "rpc_codec.h"
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * Tag of the binary rpc frame
+ * Has the same length with the krpc_tag
+ */
+extern char const krpc_frame_tag[];
+
+/**
+ * The fixed header of binary rpc frame
+ *
+ * Binary frame(i.e. the body of frame with krpc_frame_tag in RpcCodec):
+ * +-----------------+
+ * | id        | 8B  |
+ * +-----------------+
+ * | deadline  | 8B  |
+ * +-----------------+
+ * | method id | 4B  |
+ * +-----------------+
+ * | type      | 1B  |
+ * +-----------------+
+ * | error     | 1B  |
+ * +-----------------+
+ * | name size | 2B  |
+ * +-----------------+
+ * | name      | NB  |
+ * +-----------------+
+ * | payload   | MB  |
+ * +-----------------+
+ *
+ * \note
+ * 1. All integers are in big endian
+ * 2. The name is "service/method", which is empty if method id is not 0
+ * 3. The payload is the request or response serialized directly
+ *    i.e. it is not wrapped in the RpcMessage
+ */
+struct RpcFrameHeader {
+  uint64_t id;
+  uint64_t deadline;
+  uint32_t method_id;
+  uint8_t type;  //!< RpcMessage::MessageType
+  uint8_t error; //!< RpcMessage::ErrorCode
+};
+
+constexpr size_t kRpcFrameHeaderLength = 8 + 8 + 4 + 1 + 1 + 2;
+
+/**
+ * Write the binary frame to \p stream, then it can be sent directly
+ * \param name The name of method, "service/method"
+ * \param payload The request or response, NULL indicates empty
+ */
+void EncodeRpcFrame(ChunkStream &stream, RpcFrameHeader const &header,
+                    StringView name, PROTOBUF::Message const *payload);
+
+/**
+ * Write the frame of RpcMessage to \p stream, i.e. the same with
+ * RpcCodec::Send() but don't send it
+ */
+void EncodeRpcMessage(ChunkStream &stream, RpcMessage const &message);
+
+/**
+ * Parse the \p body of the binary frame
+ * The \p name and \p payload point to the memory in \p body.
+ * \return
+ *   false if the body is malformed
+ */
+bool DecodeRpcFrame(char const *body, size_t size, RpcFrameHeader &header,
+                    StringView &name, StringView &payload) noexcept;
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_FRAME_H__
@@ -0,0 +1,285 @@
+#include "rpc_metrics.h"
+
+#include <string.h>
+
+#include <google/protobuf/descriptor.h>
+
+#include "kanon/util/macro.h"
+
+using namespace kanon::protobuf::rpc;
+
+constexpr size_t LatencySnapshot::kBucketNum;
+constexpr size_t MethodMetricsSnapshot::kErrorSlotNum;
+constexpr size_t MethodMetricsSnapshot::kLocalError;
+
+/**
+ * The maximum number of recording threads owning a shard,
+ * the other threads share the last shard
+ */
+static constexpr size_t kShardNum = 64;
+
+/**
+ * The bitmap of the shard indices owned by the living threads(except the
+ * shared one). The index is returned when the thread exits, so the
+ * short-lived threads don't use up the shards.
+ */
+static std::atomic<uint64_t> g_owned_shards(0);
+
+struct ShardIndex {
+  ShardIndex() noexcept
+    : index(kShardNum - 1)
+  {
+    auto owned = g_owned_shards.load(std::memory_order_relaxed);
+    for (;;) {
+      const auto free = ~owned & ((uint64_t(1) << (kShardNum - 1)) - 1);
+      if (free == 0) return;
+
+      const auto bit = free & -free;
+      // Acquire the counters stored by the last owner
+      if (g_owned_shards.compare_exchange_weak(owned, owned | bit,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+      {
+        index = (size_t)__builtin_ctzll(bit);
+        return;
+      }
+    }
+  }
+
+  ~ShardIndex() noexcept
+  {
+    if (index != kShardNum - 1) {
+      g_owned_shards.fetch_and(~(uint64_t(1) << index),
+                               std::memory_order_release);
+    }
+  }
+
+  size_t index;
+};
+
+/**
+ * The owner is the only writer of the counter, so the read-modify-write
+ * don't need the lock prefix, the relaxed store is enough for the
+ * snapshot reading in the other thread
+ */
+template <typename T>
+static inline void Increase(std::atomic<T> &counter, T n,
+                            bool exclusive) noexcept
+{
+  if (KANON_LIKELY(exclusive))
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  else
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+struct LatencyHistogram {
+  void Record(uint64_t us, bool exclusive) noexcept
+  {
+    Increase<uint64_t>(buckets[LatencySnapshot::GetBucket(us)], 1, exclusive);
+    Increase(sum_us, us, exclusive);
+  }
+
+  void AddTo(LatencySnapshot &snapshot) const noexcept
+  {
+    for (size_t i = 0; i < LatencySnapshot::kBucketNum; ++i) {
+      const auto n = buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += n;
+      snapshot.count += n;
+    }
+    snapshot.sum_us += sum_us.load(std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> sum_us;
+  std::atomic<uint64_t> buckets[LatencySnapshot::kBucketNum];
+};
+
+struct MethodCounters {
+  std::atomic<uint64_t> requests;
+  std::atomic<uint64_t> errors[MethodMetricsSnapshot::kErrorSlotNum];
+  std::atomic<int64_t> in_flight;
+  LatencyHistogram queue_time;
+  LatencyHistogram exec_time;
+  LatencyHistogram total_time;
+};
+
+struct RpcMetrics::Shard {
+  Shard(size_t method_num, bool is_exclusive)
+    // Value-initialization zeroes the atomics
+    : methods(new MethodCounters[method_num]())
+    , exclusive(is_exclusive)
+  {
+  }
+
+  std::unique_ptr<MethodCounters[]> methods;
+  bool exclusive;
+};
+
+LatencySnapshot::LatencySnapshot()
+  : count(0)
+  , sum_us(0)
+{
+  ::memset(buckets, 0, sizeof buckets);
+}
+
+size_t LatencySnapshot::GetBucket(uint64_t us) noexcept
+{
+  if (us < 4) return (size_t)us;
+
+  const size_t msb = 63 - __builtin_clzll(us);
+  const size_t bucket = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+  return bucket < kBucketNum ? bucket : kBucketNum - 1;
+}
+
+uint64_t LatencySnapshot::GetBucketUpperBound(size_t bucket) noexcept
+{
+  if (bucket < 4) return bucket + 1;
+
+  const size_t msb = bucket / 4 + 1;
+  return (uint64_t)(4 + bucket % 4 + 1) << (msb - 2);
+}
+
+uint64_t LatencySnapshot::Percentile(double p) const noexcept
+{
+  if (count == 0) return 0;
+
+  const auto rank = (uint64_t)(p * count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketNum; ++i) {
+    seen += buckets[i];
+    if (seen > rank) return GetBucketUpperBound(i);
+  }
+  return GetBucketUpperBound(kBucketNum - 1);
+}
+
+MethodMetricsSnapshot::MethodMetricsSnapshot()
+  : requests(0)
+  , in_flight(0)
+{
+  ::memset(errors, 0, sizeof errors);
+}
+
+uint64_t MethodMetricsSnapshot::GetErrorCount() const noexcept
+{
+  uint64_t count = 0;
+  for (size_t i = 0; i < kErrorSlotNum; ++i)
+    count += errors[i];
+  return count;
+}
+
+RpcMetrics::RpcMetrics()
+  : shards_(new std::atomic<Shard *>[kShardNum])
+{
+  for (size_t i = 0; i < kShardNum; ++i)
+    shards_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+RpcMetrics::~RpcMetrics() noexcept
+{
+  for (size_t i = 0; i < kShardNum; ++i)
+    delete shards_[i].load(std::memory_order_relaxed);
+}
+
+int RpcMetrics::AddMethod(PROTOBUF::MethodDescriptor const *method)
+{
+  auto it = indices_.find(method);
+  if (it != indices_.end()) return it->second;
+
+  const int index = (int)names_.size();
+  names_.push_back(method->service()->full_name() + '/' + method->name());
+  indices_.emplace(method, index);
+  return index;
+}
+
+void RpcMetrics::AddService(PROTOBUF::ServiceDescriptor const *service)
+{
+  for (int i = 0; i < service->method_count(); ++i)
+    AddMethod(service->method(i));
+}
+
+int RpcMetrics::FindMethod(
+    PROTOBUF::MethodDescriptor const *method) const noexcept
+{
+  auto it = indices_.find(method);
+  return it != indices_.end() ? it->second : -1;
+}
+
+auto RpcMetrics::GetShard() noexcept -> Shard &
+{
+  // The threads share the last shard if there are too many threads,
+  // so the counters of it are updated atomically
+  static thread_local ShardIndex t_shard_index;
+  const auto t_shard = t_shard_index.index;
+
+  auto &slot = shards_[t_shard];
+  auto shard = slot.load(std::memory_order_acquire);
+  if (KANON_LIKELY(shard)) return *shard;
+
+  // The first recording of this thread
+  std::unique_ptr<Shard> new_shard(
+      new Shard(names_.size(), t_shard != kShardNum - 1));
+  if (slot.compare_exchange_strong(shard, new_shard.get(),
+                                   std::memory_order_acq_rel))
+  {
+    return *new_shard.release();
+  }
+  return *shard;
+}
+
+void RpcMetrics::OnRequest(int method) noexcept
+{
+  auto &shard = GetShard();
+  auto &counters = shard.methods[method];
+  Increase<uint64_t>(counters.requests, 1, shard.exclusive);
+  Increase<int64_t>(counters.in_flight, 1, shard.exclusive);
+}
+
+void RpcMetrics::OnQueued(int method, uint64_t us) noexcept
+{
+  auto &shard = GetShard();
+  shard.methods[method].queue_time.Record(us, shard.exclusive);
+}
+
+void RpcMetrics::OnExecuted(int method, uint64_t us) noexcept
+{
+  auto &shard = GetShard();
+  shard.methods[method].exec_time.Record(us, shard.exclusive);
+}
+
+void RpcMetrics::OnCompleted(int method, size_t error_slot,
+                             uint64_t total_us) noexcept
+{
+  auto &shard = GetShard();
+  auto &counters = shard.methods[method];
+  // The in_flight of a shard may be negative since the call may be
+  // completed in the other thread, the sum is right
+  Increase<int64_t>(counters.in_flight, -1, shard.exclusive);
+  if (error_slot != RpcMessage::kNoError)
+    Increase<uint64_t>(counters.errors[error_slot], 1, shard.exclusive);
+  counters.total_time.Record(total_us, shard.exclusive);
+}
+
+void RpcMetrics::Snapshot(std::vector<MethodMetricsSnapshot> &methods) const
+{
+  methods.clear();
+  methods.resize(names_.size());
+  for (size_t i = 0; i < names_.size(); ++i)
+    methods[i].name = names_[i];
+
+  for (size_t s = 0; s < kShardNum; ++s) {
+    auto shard = shards_[s].load(std::memory_order_acquire);
+    if (!shard) continue;
+
+    for (size_t i = 0; i < names_.size(); ++i) {
+      auto const &counters = shard->methods[i];
+      auto &snapshot = methods[i];
+      snapshot.requests += counters.requests.load(std::memory_order_relaxed);
+      snapshot.in_flight += counters.in_flight.load(std::memory_order_relaxed);
+      for (size_t e = 0; e < MethodMetricsSnapshot::kErrorSlotNum; ++e)
+        snapshot.errors[e] += counters.errors[e].load(std::memory_order_relaxed);
+      counters.queue_time.AddTo(snapshot.queue_time);
+      counters.exec_time.AddTo(snapshot.exec_time);
+      counters.total_time.AddTo(snapshot.total_time);
+    }
+  }
+}
@@ -0,0 +1,156 @@
+#ifndef KANON_RPC_RPC_METRICS_H__
+#define KANON_RPC_RPC_METRICS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kanon/rpc/rpc.pb.h"
+#include "kanon/util/noncopyable.h"
+
+#define PROTOBUF ::google::protobuf
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief The snapshot of a latency histogram in microseconds
+ *
+ * The buckets are log-linear, i.e. each power of 2 is divided into 4
+ * buckets, so the relative error of percentile is less than 25%.
+ */
+struct LatencySnapshot {
+  static constexpr size_t kBucketNum = 4 * 40;
+
+  LatencySnapshot();
+
+  /** \return The upper bound of the bucket that the \p p(0~1) falls in */
+  uint64_t Percentile(double p) const noexcept;
+
+  double Mean() const noexcept { return count ? (double)sum_us / count : 0; }
+
+  static size_t GetBucket(uint64_t us) noexcept;
+  static uint64_t GetBucketUpperBound(size_t bucket) noexcept;
+
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t buckets[kBucketNum];
+};
+
+/**
+ * \brief The snapshot of the metrics of a method
+ */
+struct MethodMetricsSnapshot {
+  /**
+   * The errors are counted by RpcMessage::ErrorCode,
+   * and the last slot counts the errors not from the peer,
+   * e.g. connection closed
+   */
+  static constexpr size_t kErrorSlotNum = RpcMessage::ErrorCode_ARRAYSIZE + 1;
+  static constexpr size_t kLocalError = kErrorSlotNum - 1;
+
+  MethodMetricsSnapshot();
+
+  uint64_t GetErrorCount() const noexcept;
+
+  /** "service/method" */
+  std::string name;
+
+  uint64_t requests;
+  uint64_t errors[kErrorSlotNum];
+
+  /** The calls are not completed */
+  int64_t in_flight;
+
+  /**
+   * Server: receiving -> running the method(pending in the pool or limiter)
+   * Client: calling -> sending
+   */
+  LatencySnapshot queue_time;
+
+  /**
+   * Server: running the method -> done
+   * Client: sending -> the response is received
+   */
+  LatencySnapshot exec_time;
+
+  /**
+   * Server: receiving -> the response is posted
+   * Client: calling -> done
+   */
+  LatencySnapshot total_time;
+};
+
+/**
+ * \brief The per-method metrics of rpc server or client
+ *
+ * The recording is lock-free: the counters are sharded by the recording
+ * thread(e.g. the loops and the pool threads), i.e. each thread updates
+ * the counters in its own shard by the plain relaxed stores, and the
+ * snapshot sums the shards up. The shard of the exited thread is reused
+ * by the new thread, and the threads beyond 63 living ones share a shard
+ * updated by the atomic increments.
+ *
+ * \note
+ *   The methods must be added before recording, then the metrics
+ *   can be recorded and snapshotted in any thread.
+ */
+class RpcMetrics : noncopyable {
+ public:
+  RpcMetrics();
+  ~RpcMetrics() noexcept;
+
+  /**
+   * \return
+   *   The index of method used in the recording
+   */
+  int AddMethod(PROTOBUF::MethodDescriptor const *method);
+
+  /** Add all methods of \p service */
+  void AddService(PROTOBUF::ServiceDescriptor const *service);
+
+  /**
+   * \return
+   *   -1 if the method is not added
+   */
+  int FindMethod(PROTOBUF::MethodDescriptor const *method) const noexcept;
+
+  size_t GetMethodCount() const noexcept { return names_.size(); }
+
+  /** A call of the \p method is started */
+  void OnRequest(int method) noexcept;
+
+  void OnQueued(int method, uint64_t us) noexcept;
+
+  void OnExecuted(int method, uint64_t us) noexcept;
+
+  /**
+   * A call of the \p method is completed
+   * \param error_slot The index in MethodMetricsSnapshot::errors
+   */
+  void OnCompleted(int method, size_t error_slot, uint64_t total_us) noexcept;
+
+  void Snapshot(std::vector<MethodMetricsSnapshot> &methods) const;
+
+ private:
+  struct Shard;
+
+  Shard &GetShard() noexcept;
+
+  std::vector<std::string> names_;
+  std::unordered_map<PROTOBUF::MethodDescriptor const *, int> indices_;
+
+  std::unique_ptr<std::atomic<Shard *>[]> shards_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_RPC_METRICS_H__
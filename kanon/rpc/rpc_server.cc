@@ -1,6 +1,9 @@
 #include "rpc_server.h"
 
+#include <google/protobuf/descriptor.h>
+
 #include "kanon/net/connection/tcp_connection.h"
+#include "kanon/rpc/logger.h"
 #include "kanon/util/any.h"
 
 using namespace kanon::protobuf::rpc;
@@ -8,11 +11,28 @@ using namespace kanon::protobuf::rpc;
 RpcServer::RpcServer(EventLoop *loop, InetAddr const &addr, StringArg name,
                      bool reuseport)
   : TcpServer(loop, addr, name, reuseport)
+  , shared_pool_(nullptr)
+  , use_arena_(false)
+{
+  Init();
+}
+
+RpcServer::RpcServer(EventLoop *loop, UnixAddr const &addr, StringArg name)
+  : TcpServer(loop, addr, name)
+  , shared_pool_(nullptr)
+  , use_arena_(false)
+{
+  Init();
+}
+
+void RpcServer::Init()
 {
   SetConnectionCallback([this](TcpConnectionPtr const &conn) {
     if (conn->IsConnected()) {
       auto channel = new RpcChannel(conn);
-      channel->SetServices(services_);
+      channel->SetServices(methods_, shared_pool_, &shed_counters_,
+                           metrics_.get());
+      channel->SetUseArena(use_arena_);
       conn->SetContext(*channel);
     } else {
       auto p = AnyCast<RpcChannel>(conn->GetContext());
@@ -23,3 +43,55 @@ RpcServer::RpcServer(EventLoop *loop, InetAddr const &addr, StringArg name,
 }
 
 RpcServer::~RpcServer() = default;
+
+bool RpcServer::SetMaxConcurrency(PROTOBUF::Service *service,
+                                  std::string const &method,
+                                  size_t max_concurrency)
+{
+  auto const &service_name = service->GetDescriptor()->full_name();
+  if (!methods_.HasService(service_name)) {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "The service is not added: "
+                                 << service_name;
+    return false;
+  }
+
+  auto entry = methods_.Find(service_name + '/' + method);
+  if (!entry) {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "No method: " << method;
+    return false;
+  }
+
+  entry->limiter.reset(new ConcurrencyLimiter(max_concurrency));
+  return true;
+}
+
+bool RpcServer::SetAdaptiveConcurrency(PROTOBUF::Service *service,
+                                       size_t max_concurrency,
+                                       uint64_t target_delay_ms)
+{
+  auto descriptor = service->GetDescriptor();
+  if (!methods_.HasService(descriptor->full_name())) {
+    LOG_ERROR_KANON_PROTOBUF_RPC << "The service is not added: "
+                                 << descriptor->full_name();
+    return false;
+  }
+
+  // All methods share the limiter
+  std::shared_ptr<ConcurrencyLimiter> limiter(
+      new ConcurrencyLimiter(max_concurrency, target_delay_ms));
+  for (int i = 0; i < descriptor->method_count(); ++i) {
+    auto entry = methods_.Find(descriptor->full_name() + '/' +
+                               descriptor->method(i)->name());
+    assert(entry);
+    entry->limiter = limiter;
+  }
+  return true;
+}
+
+void RpcServer::EnableMetrics()
+{
+  // The index of method is the method id - 1
+  metrics_.reset(new RpcMetrics());
+  for (auto const &entry : methods_.methods())
+    metrics_->AddMethod(entry.method);
+}
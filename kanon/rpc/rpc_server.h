@@ -1,15 +1,41 @@
 #ifndef KANON_RPC_KRPC_SERVER_H_
 #define KANON_RPC_KRPC_SERVER_H_
 
+#include <memory>
+
 #include <google/protobuf/message.h>
 
 #include "rpc_channel.h"
 #include "kanon/net/tcp_server.h"
+#include "kanon/net/unix_addr.h"
 
 namespace kanon {
 namespace protobuf {
 namespace rpc {
 
+/**
+ * \brief Rpc server
+ *
+ * Execution policy of the service methods:
+ * - inline: run in the IO loop of the connection(default)
+ * - shared pool: run in the pool set by SetThreadPool()
+ * - per-service pool: run in the pool specified in AddServices()
+ *
+ * The request expired before running is dropped, and the calls can be
+ * shed under overload, see SetAdaptiveConcurrency().
+ *
+ * The methods are assigned numeric ids in AddServices(), the client
+ * can get them by RpcChannel::NegotiateMethodIds().
+ *
+ * \note
+ *   The call is shed with kOverloaded if the queue of pool is full,
+ *   the IO loop is never blocked by the pool.
+ *   The concurrency limit of method can bound the queue.
+ * \warning
+ *   The max queue size of ThreadPool is 5 by default, i.e. the calls are
+ *   shed once 5 calls are queued. Set it by the constructor or
+ *   ThreadPool::SetMaxQueueSize() according to the expected burst.
+ */
 class RpcServer : public TcpServer {
 public:
   RpcServer(
@@ -18,16 +44,112 @@ public:
     StringArg name,
     bool reuseport = false);
 
+  /**
+   * Serve in the unix domain socket \p addr, e.g. for the clients in the
+   * same host. The services can be shared with the server in tcp, i.e.
+   * add the same services to both servers.
+   */
+  RpcServer(
+    EventLoop* loop,
+    UnixAddr const& addr,
+    StringArg name);
+
   ~RpcServer();
 
-  inline void AddServices(PROTOBUF::Service* service);
+  /**
+   * \param pool The pool that the methods of \p service are executed in.
+   *             NULL indicates the shared pool(or inline if no shared pool)
+   * \note Must be called before StartRun()
+   * \warning The queue size of \p pool bounds the queued calls, the
+   *          exceeded calls are shed, see the warning of RpcServer.
+   *          \p pool must be started by ThreadPool::StartRun().
+   */
+  inline void AddServices(PROTOBUF::Service* service, ThreadPool* pool = nullptr);
+
+  /**
+   * Set the shared pool of the services that don't specify pool
+   * \note Must be called before StartRun()
+   * \warning The queue size of \p pool bounds the queued calls, the
+   *          exceeded calls are shed, see the warning of RpcServer.
+   *          \p pool must be started by ThreadPool::StartRun().
+   */
+  void SetThreadPool(ThreadPool* pool) noexcept { shared_pool_ = pool; }
+
+  /**
+   * Allocate the requests in the arena of the calls, which saves the
+   * heap allocations of them.
+   * \warning
+   *   The request is owned by the arena then, the service must not
+   *   delete it(e.g. by DeferDelete), otherwise the request is owned by
+   *   the service as before(default).
+   * \note Must be called before StartRun()
+   */
+  void SetUseArena(bool on) noexcept { use_arena_ = on; }
+
+  /**
+   * Limit the number of running calls of the \p method in \p service,
+   * the exceeded calls are pending until the running calls are completed.
+   * \return
+   *   false if the service or method is not found
+   * \note Must be called after AddServices() and before StartRun()
+   */
+  bool SetMaxConcurrency(PROTOBUF::Service* service,
+                         std::string const& method,
+                         size_t max_concurrency);
+
+  /**
+   * Limit the number of running calls of all methods in \p service,
+   * the limit is adjusted in [1, max_concurrency] according to the
+   * queue delay of calls, and the calls are shed(i.e. responsed with
+   * kOverloaded) if the queue delay keeps exceeding \p target_delay_ms.
+   *
+   * This overrides the limit set by SetMaxConcurrency().
+   * \return
+   *   false if the service is not found
+   * \note Must be called after AddServices() and before StartRun()
+   */
+  bool SetAdaptiveConcurrency(PROTOBUF::Service* service,
+                              size_t max_concurrency,
+                              uint64_t target_delay_ms);
+
+  /** The number of requests dropped since the deadline is exceeded */
+  uint64_t GetExpiredCount() const noexcept
+  {
+    return shed_counters_.expired.load(std::memory_order_relaxed);
+  }
+
+  /** The number of requests shed by the adaptive limiter or the full pool */
+  uint64_t GetShedCount() const noexcept
+  {
+    return shed_counters_.overloaded.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Record the per-method metrics of the calls,
+   * see RpcMetrics and MethodMetricsSnapshot
+   * \note Must be called after AddServices() and before StartRun()
+   */
+  void EnableMetrics();
+
+  /**
+   * \return
+   *   NULL if the metrics is not enabled.
+   *   RpcMetrics::Snapshot() can be called in any thread.
+   */
+  RpcMetrics const* GetMetrics() const noexcept { return metrics_.get(); }
 private:
-  RpcChannel::ServiceMap services_;
+  void Init();
+
+  MethodTable methods_;
+  ShedCounters shed_counters_;
+  ThreadPool* shared_pool_;
+  bool use_arena_;
+  std::unique_ptr<RpcMetrics> metrics_;
 };
 
-void RpcServer::AddServices(PROTOBUF::Service* service)
+void RpcServer::AddServices(PROTOBUF::Service* service, ThreadPool* pool)
 {
-  services_.emplace(service->GetDescriptor()->full_name(), service);
+  methods_.AddService(service, pool);
 }
 
 } // namespace rpc
@@ -0,0 +1,57 @@
+#ifndef KANON_RPC_SYNC_RPC_CHANNEL_H__
+#define KANON_RPC_SYNC_RPC_CHANNEL_H__
+
+#include <google/protobuf/service.h>
+
+#include "kanon/util/noncopyable.h"
+#include "rpc_channel.h"
+
+namespace kanon {
+namespace protobuf {
+namespace rpc {
+
+/**
+ * \brief The synchronous stub mode of RpcChannel
+ *
+ * The method of the stub blocks until the call is completed,
+ * see RpcChannel::CallMethodSync(). The done can be NULL, otherwise it
+ * is called in the calling thread after the call is completed.
+ *
+ * Usage:
+ * \code
+ *   SyncRpcChannel sync_chan(&chan);
+ *   XXXService::Stub stub(&sync_chan);
+ *   stub.Method(&controller, &request, &response, nullptr);
+ *   if (controller.Failed()) { ... }
+ * \endcode
+ */
+class SyncRpcChannel
+  : noncopyable
+  , public ::google::protobuf::RpcChannel {
+ public:
+  /**
+   * \param channel The lifetime is managed by user
+   */
+  explicit SyncRpcChannel(rpc::RpcChannel *channel) noexcept
+    : channel_(channel)
+  {
+  }
+
+  void CallMethod(PROTOBUF::MethodDescriptor const *method,
+                  PROTOBUF::RpcController *controller,
+                  PROTOBUF::Message const *request, PROTOBUF::Message *response,
+                  PROTOBUF::Closure *done) override
+  {
+    channel_->CallMethodSync(method, controller, request, response);
+    if (done) done->Run();
+  }
+
+ private:
+  rpc::RpcChannel *channel_;
+};
+
+} // namespace rpc
+} // namespace protobuf
+} // namespace kanon
+
+#endif // KANON_RPC_SYNC_RPC_CHANNEL_H__
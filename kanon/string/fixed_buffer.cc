@@ -32,8 +32,9 @@ unsigned ptrToHexStr(char *buf, uintptr_t p)
   return unsigned(end - buf);
 }
 
-template class FixedBuffer<kSmallStreamSize>;
-template class FixedBuffer<kLargeStreamSize>;
+template class BasicFixedBuffer<InlineBufferStorage<kSmallStreamSize>>;
+template class BasicFixedBuffer<InlineBufferStorage<kLargeStreamSize>>;
+template class BasicFixedBuffer<ExternalBufferStorage>;
 
 } // namespace detail
 } // namespace kanon
@@ -10,30 +10,73 @@
 
 #include "kanon/string/stream_common.h"
 #include "kanon/string/string_view.h"
+#include "kanon/string/numeric_format.h"
 
 namespace kanon {
 namespace detail {
 
-template <typename T,
-          typename = typename std::enable_if<std::is_integral<T>::value>::type>
-unsigned int2Str(char *buf, T integer);
-
 KANON_CORE_API unsigned ptrToHexStr(char *buf, uintptr_t p);
 
 /**
- * \tparam SZ size of buffer
+ * The memory of FixedBuffer is a member array
+ */
+template <unsigned SZ>
+class InlineBufferStorage {
+ public:
+  char *buf() KANON_NOEXCEPT { return data_; }
+  char const *buf() const KANON_NOEXCEPT { return data_; }
+  constexpr unsigned capacity() const KANON_NOEXCEPT { return SZ; }
+
+  void swap(InlineBufferStorage &other) KANON_NOEXCEPT
+  {
+    std::swap(data_, other.data_);
+  }
+
+ private:
+  char data_[SZ];
+};
+
+/**
+ * The memory of FixedBuffer is provided by others,
+ * e.g. the buffer of AsyncLog
+ */
+class ExternalBufferStorage {
+ public:
+  char *buf() KANON_NOEXCEPT { return data_; }
+  char const *buf() const KANON_NOEXCEPT { return data_; }
+  unsigned capacity() const KANON_NOEXCEPT { return capacity_; }
+
+  void SetStorage(char *data, unsigned capacity) KANON_NOEXCEPT
+  {
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  void swap(ExternalBufferStorage &other) KANON_NOEXCEPT
+  {
+    std::swap(data_, other.data_);
+    std::swap(capacity_, other.capacity_);
+  }
+
+ private:
+  char *data_ = nullptr;
+  unsigned capacity_ = 0;
+};
+
+/**
+ * \tparam Storage InlineBufferStorage or ExternalBufferStorage
  * Presents a fixed-size buffer
  *
  * This is an internal class
  */
-template <unsigned SZ>
-class FixedBuffer {
-  using Self = FixedBuffer;
+template <typename Storage>
+class BasicFixedBuffer : public Storage {
+  using Self = BasicFixedBuffer;
 
  public:
   using size_type = unsigned;
 
-  FixedBuffer()
+  BasicFixedBuffer()
     : len_(0)
   {
   }
@@ -41,7 +84,7 @@ class FixedBuffer {
   // prohibit modify througt data()
   char const *data() const KANON_NOEXCEPT
   {
-    return data_;
+    return this->buf();
   }
 
   // length, avaliable space
@@ -52,7 +95,7 @@ class FixedBuffer {
 
   StringView ToStringView() const KANON_NOEXCEPT
   {
-    return StringView(data_, len_);
+    return StringView(data(), len_);
   }
 
   bool empty() const KANON_NOEXCEPT
@@ -62,12 +105,12 @@ class FixedBuffer {
 
   unsigned avali() const KANON_NOEXCEPT
   {
-    return SZ - len_;
+    return this->capacity() - len_;
   }
 
   char const *end() const KANON_NOEXCEPT
   {
-    return data_ + SZ;
+    return data() + this->capacity();
   }
 
   // append
@@ -108,10 +151,19 @@ class FixedBuffer {
     Append(&c, 1);
   }
 
+  //! The shortest round-trip representation, \see detail::double2Str()
   void appendFloat(double d) KANON_NOEXCEPT
   {
-    if (avali() > kMaxFloatingSize) {
-      AdvanceRead(::snprintf(cur(), kMaxFloatingSize, "%.12g", d));
+    if (avali() > kMaxShortestDoubleSize) {
+      AdvanceRead(detail::double2Str(cur(), d));
+    }
+  }
+
+  //! Same as "%.<precision>f"
+  void appendFloat(double d, int precision) KANON_NOEXCEPT
+  {
+    if (avali() > 0) {
+      AdvanceRead(detail::double2FixedStr(cur(), avali(), d, precision));
       *cur() = 0;
     }
   }
@@ -136,7 +188,7 @@ class FixedBuffer {
   // cur() -> set()
   char *cur() KANON_NOEXCEPT
   {
-    return data_ + len_;
+    return this->buf() + len_;
   }
 
   void reset() KANON_NOEXCEPT
@@ -147,67 +199,45 @@ class FixedBuffer {
   void AdvanceRead(unsigned diff) KANON_NOEXCEPT
   {
     len_ += diff;
-    assert(len_ < SZ);
+    assert(len_ < this->capacity());
   }
 
   void swap(Self &other) KANON_NOEXCEPT
   {
-    std::swap(data_, other.data_);
+    Storage::swap(other);
     std::swap(len_, other.len_);
   }
 
   void zero() KANON_NOEXCEPT
   {
-    ::memset(data_, 0, SZ);
+    ::memset(this->buf(), 0, this->capacity());
   }
 
  private:
   static constexpr unsigned kMaxIntSize = 32;
-  static constexpr unsigned kMaxFloatingSize = 324;
 
-  char data_[SZ];
   unsigned len_;
 };
 
+template <unsigned SZ>
+using FixedBuffer = BasicFixedBuffer<InlineBufferStorage<SZ>>;
+
+//! Call SetStorage() before appending
+using ExternalFixedBuffer = BasicFixedBuffer<ExternalBufferStorage>;
+
 // template<unsigned SZ>
 // constexpr unsigned FixedBuffer<SZ>::kMaxFloatingSize;
 
 // template<unsigned SZ>
 // constexpr unsigned FixedBuffer<SZ>::kMaxIntSize;
 
-template <unsigned SZ>
-void swap(FixedBuffer<SZ> &lhs, FixedBuffer<SZ> &rhs)
+template <typename Storage>
+void swap(BasicFixedBuffer<Storage> &lhs, BasicFixedBuffer<Storage> &rhs)
     KANON_NOEXCEPT_OP(KANON_NOEXCEPT_OP(lhs.swap(rhs)))
 {
   lhs.swap(rhs);
 }
 
-template <typename T, typename>
-unsigned int2Str(char *buf, T integer)
-{
-  static char const digits[] = "9876543210123456789";
-  static_assert(sizeof digits == 20, "digits size should be 20");
-
-  static char const *pzero = digits + 9;
-
-  char *end = buf;
-
-  bool negative = integer < 0;
-
-  do {
-    T left = integer % 10;
-    integer /= 10;
-    *(end++) = *(pzero + left);
-  } while (integer != 0);
-
-  if (negative) *(end++) = '-';
-
-  *end = 0;
-  std::reverse(buf, end);
-
-  return unsigned(end - buf);
-}
-
 } // namespace detail
 } // namespace kanon
 
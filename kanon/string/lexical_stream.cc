@@ -2,8 +2,9 @@
 
 namespace kanon {
 
-template class LexicalStream<kSmallStreamSize>;
-template class LexicalStream<kLargeStreamSize>;
-template class LexicalStream<kCastStreamSize>;
+template class BasicLexicalStream<detail::FixedBuffer<kSmallStreamSize>>;
+template class BasicLexicalStream<detail::FixedBuffer<kLargeStreamSize>>;
+template class BasicLexicalStream<detail::FixedBuffer<kCastStreamSize>>;
+template class BasicLexicalStream<detail::ExternalFixedBuffer>;
 
 } // namespace kanon
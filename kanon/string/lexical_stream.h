@@ -15,15 +15,34 @@
 
 namespace kanon {
 
-template <unsigned SZ>
-class LexicalStream : noncopyable {
-  using Self = LexicalStream;
-  using Buffer = detail::FixedBuffer<SZ>;
+/**
+ * Output the floating-point in fixed notation, i.e. "%.<precision>f"
+ * e.g. stream << FixedFloat(3.14159, 2); // 3.14
+ */
+struct FixedFloat {
+  FixedFloat(double v, int p) KANON_NOEXCEPT
+    : value(v)
+    , precision(p)
+  {
+  }
+
+  double value;
+  int precision;
+};
+
+/**
+ * \tparam B FixedBuffer or ExternalFixedBuffer
+ * \see LexicalStream, LogStream
+ */
+template <typename B>
+class BasicLexicalStream : noncopyable {
+  using Self = BasicLexicalStream;
+  using Buffer = B;
 
  public:
-  LexicalStream() = default;
-  LexicalStream(LexicalStream &&) KANON_NOEXCEPT;
-  LexicalStream &operator=(LexicalStream &&) KANON_NOEXCEPT;
+  BasicLexicalStream() = default;
+  BasicLexicalStream(BasicLexicalStream &&) KANON_NOEXCEPT;
+  BasicLexicalStream &operator=(BasicLexicalStream &&) KANON_NOEXCEPT;
 
   void Append(char const *buf, unsigned len) KANON_NOEXCEPT
   {
@@ -38,7 +57,7 @@ class LexicalStream : noncopyable {
 
   unsigned size() const KANON_NOEXCEPT { return buffer_.len(); }
 
-  unsigned maxsize() const KANON_NOEXCEPT { return SZ; }
+  unsigned maxsize() const KANON_NOEXCEPT { return buffer_.capacity(); }
 
   KANON_INLINE Self &operator<<(bool);
   KANON_INLINE Self &operator<<(char);
@@ -59,6 +78,7 @@ class LexicalStream : noncopyable {
   Self &operator<<(float f) { return *this << static_cast<double>(f); }
 
   KANON_INLINE Self &operator<<(double);
+  KANON_INLINE Self &operator<<(FixedFloat);
 
   KANON_INLINE Self &operator<<(char const *);
   KANON_INLINE Self &operator<<(std::string const &str);
@@ -70,40 +90,44 @@ class LexicalStream : noncopyable {
   Buffer buffer_;
 };
 
+template <unsigned SZ>
+using LexicalStream = BasicLexicalStream<detail::FixedBuffer<SZ>>;
+
 /**
  * To KANON_INLINE, we don't put them to source file
  */
-template <unsigned SZ>
-LexicalStream<SZ>::LexicalStream(LexicalStream &&other) KANON_NOEXCEPT
+template <typename B>
+BasicLexicalStream<B>::BasicLexicalStream(BasicLexicalStream &&other)
+    KANON_NOEXCEPT
   : buffer_(other.buffer())
 {
 }
 
-template <unsigned SZ>
-LexicalStream<SZ> &
-LexicalStream<SZ>::operator=(LexicalStream &&other) KANON_NOEXCEPT
+template <typename B>
+BasicLexicalStream<B> &
+BasicLexicalStream<B>::operator=(BasicLexicalStream &&other) KANON_NOEXCEPT
 {
   buffer_.swap(other.buffer_);
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(char c) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(char c) -> Self &
 {
   Append(&c, 1);
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(bool b) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(bool b) -> Self &
 {
   buffer_.appendBool(b);
   return *this;
 }
 
 #define LEXICALSTREAM_OPERATOR_LEFT_SHIFT(type)                                \
-  template <unsigned SZ>                                                       \
-  auto LexicalStream<SZ>::operator<<(type i)->Self &                           \
+  template <typename B>                                                        \
+  auto BasicLexicalStream<B>::operator<<(type i)->Self &                       \
   {                                                                            \
     buffer_.appendInt(i);                                                      \
     return *this;                                                              \
@@ -119,44 +143,51 @@ LEXICALSTREAM_OPERATOR_LEFT_SHIFT(unsigned long)
 LEXICALSTREAM_OPERATOR_LEFT_SHIFT(long long)
 LEXICALSTREAM_OPERATOR_LEFT_SHIFT(unsigned long long)
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(double d) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(double d) -> Self &
 {
   buffer_.appendFloat(d);
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(char const *str) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(FixedFloat f) -> Self &
+{
+  buffer_.appendFloat(f.value, f.precision);
+  return *this;
+}
+
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(char const *str) -> Self &
 {
   buffer_.Append(str, (unsigned)strlen(str));
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(std::string const &str) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(std::string const &str) -> Self &
 {
   buffer_.Append(str.data(), (unsigned)str.size());
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(StringView sv) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(StringView sv) -> Self &
 {
   buffer_.Append(sv);
   return *this;
 }
 
-template <unsigned SZ>
-auto LexicalStream<SZ>::operator<<(void const *p) -> Self &
+template <typename B>
+auto BasicLexicalStream<B>::operator<<(void const *p) -> Self &
 {
   buffer_.appendPtr(p);
   return *this;
 }
 
-template <unsigned SZ>
+template <typename B>
 template <unsigned N>
-auto LexicalStream<SZ>::operator<<(FmtStream<N> const &fmt_stream) -> Self &
+auto BasicLexicalStream<B>::operator<<(FmtStream<N> const &fmt_stream) -> Self &
 {
   buffer_.Append(fmt_stream.ToStringView());
   return *this;
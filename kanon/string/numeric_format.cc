@@ -0,0 +1,444 @@
+#include "kanon/string/numeric_format.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+namespace kanon {
+namespace detail {
+
+char const kDigitPairs[201] = "00010203040506070809"
+                              "10111213141516171819"
+                              "20212223242526272829"
+                              "30313233343536373839"
+                              "40414243444546474849"
+                              "50515253545556575859"
+                              "60616263646566676869"
+                              "70717273747576777879"
+                              "80818283848586878889"
+                              "90919293949596979899";
+
+uint64_t const kZeroOrPowersOf10[20] = {0,
+                                        10ull,
+                                        100ull,
+                                        1000ull,
+                                        10000ull,
+                                        100000ull,
+                                        1000000ull,
+                                        10000000ull,
+                                        100000000ull,
+                                        1000000000ull,
+                                        10000000000ull,
+                                        100000000000ull,
+                                        1000000000000ull,
+                                        10000000000000ull,
+                                        100000000000000ull,
+                                        1000000000000000ull,
+                                        10000000000000000ull,
+                                        100000000000000000ull,
+                                        1000000000000000000ull,
+                                        10000000000000000000ull};
+
+namespace {
+
+/*
+ * The shortest representation is produced by the Grisu2 algorithm
+ * (Florian Loitsch, Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers). The result is always round-trip and is the shortest one
+ * in almost all cases(otherwise one more digit).
+ */
+
+#define DOUBLE_SIGNIFICAND_SIZE 52
+#define DOUBLE_EXPONENT_BIAS    (0x3FF + DOUBLE_SIGNIFICAND_SIZE)
+#define DOUBLE_HIDDEN_BIT       (uint64_t(1) << DOUBLE_SIGNIFICAND_SIZE)
+#define DOUBLE_SIGNIFICAND_MASK (DOUBLE_HIDDEN_BIT - 1)
+
+/**
+ * "Do-it-yourself floating-point": f * 2^e
+ */
+struct DiyFp {
+  DiyFp() = default;
+
+  DiyFp(uint64_t ff, int ee) KANON_NOEXCEPT
+    : f(ff)
+    , e(ee)
+  {
+  }
+
+  explicit DiyFp(double d) KANON_NOEXCEPT
+  {
+    uint64_t bits;
+    ::memcpy(&bits, &d, sizeof bits);
+    const int biased_e = (int)((bits >> DOUBLE_SIGNIFICAND_SIZE) & 0x7FF);
+    const uint64_t significand = bits & DOUBLE_SIGNIFICAND_MASK;
+
+    if (biased_e != 0) {
+      f = significand + DOUBLE_HIDDEN_BIT;
+      e = biased_e - DOUBLE_EXPONENT_BIAS;
+    } else {
+      // Subnormal
+      f = significand;
+      e = 1 - DOUBLE_EXPONENT_BIAS;
+    }
+  }
+
+  DiyFp operator-(DiyFp const &rhs) const KANON_NOEXCEPT
+  {
+    return DiyFp(f - rhs.f, e);
+  }
+
+  //! The upper 64 bits of the product(rounded)
+  DiyFp operator*(DiyFp const &rhs) const KANON_NOEXCEPT
+  {
+    const uint64_t M32 = 0xFFFFFFFF;
+    const uint64_t a = f >> 32;
+    const uint64_t b = f & M32;
+    const uint64_t c = rhs.f >> 32;
+    const uint64_t d = rhs.f & M32;
+    const uint64_t ac = a * c;
+    const uint64_t bc = b * c;
+    const uint64_t ad = a * d;
+    const uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1U << 31;
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+  }
+
+  DiyFp Normalize() const KANON_NOEXCEPT
+  {
+    DiyFp res = *this;
+#if defined(__GNUC__) || defined(__clang__)
+    const int shift = __builtin_clzll(res.f);
+    res.f <<= shift;
+    res.e -= shift;
+#else
+    while (!(res.f & (DOUBLE_HIDDEN_BIT << 11))) {
+      res.f <<= 1;
+      res.e--;
+    }
+#endif
+    return res;
+  }
+
+  /**
+   * The boundaries m- and m+ of the value, i.e. the middle of it and its
+   * neighbors, any number in (m-, m+) is read as the value.
+   */
+  void NormalizedBoundaries(DiyFp *minus, DiyFp *plus) const KANON_NOEXCEPT
+  {
+    const DiyFp pl = DiyFp((f << 1) + 1, e - 1).Normalize();
+
+    // The lower neighbor is closer if the value is power of 2
+    DiyFp mi = (f == DOUBLE_HIDDEN_BIT) ? DiyFp((f << 2) - 1, e - 2)
+                                        : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *minus = mi;
+    *plus = pl;
+  }
+
+  uint64_t f;
+  int e;
+};
+
+/**
+ * The normalized 10^k, k = -348, -340, ..., 340
+ */
+static uint64_t const kCachedPowersF[] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+    0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+    0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+    0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+    0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+    0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+    0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+    0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+    0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+    0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+    0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+    0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+    0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+    0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+    0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+    0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+    0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+    0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+    0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+    0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+    0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+    0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+};
+
+static int16_t const kCachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+/**
+ * Get the cached 10^-k such that the exponent of the product with
+ * 2^e is in [-60, -32], then the integral part fits in uint32_t
+ */
+static DiyFp GetCachedPower(int e, int *K) KANON_NOEXCEPT
+{
+  // 1 / lg(10) = 0.30102999566398114
+  const double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = (int)dk;
+  if (dk - k > 0.0) k++;
+
+  const unsigned index = (unsigned)((k >> 3) + 1);
+  *K = -(-348 + (int)(index << 3));
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+static void GrisuRound(char *buffer, int len, uint64_t delta, uint64_t rest,
+                       uint64_t ten_kappa, uint64_t wp_w) KANON_NOEXCEPT
+{
+  // Move the last digit closer to the value while still in the boundaries
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+  {
+    buffer[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+/**
+ * Generate the shortest digits in (Mp - delta, Mp)
+ * The value is buffer * 10^K
+ */
+static void DigitGen(DiyFp const &W, DiyFp const &Mp, uint64_t delta,
+                     char *buffer, int *len, int *K) KANON_NOEXCEPT
+{
+  static uint32_t const kPow10[] = {1,         10,        100,     1000,
+                                    10000,     100000,    1000000, 10000000,
+                                    100000000, 1000000000};
+
+  const DiyFp one(uint64_t(1) << -Mp.e, Mp.e);
+  const DiyFp wp_w = Mp - W;
+  uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = (int)CountDigits(p1);
+  *len = 0;
+
+  // The integral part
+  while (kappa > 0) {
+    const uint32_t d = p1 / kPow10[kappa - 1];
+    p1 %= kPow10[kappa - 1];
+    if (d || *len) buffer[(*len)++] = (char)('0' + d);
+    kappa--;
+
+    const uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      GrisuRound(buffer, *len, delta, tmp, (uint64_t)kPow10[kappa] << -one.e,
+                 wp_w.f);
+      return;
+    }
+  }
+
+  // The fractional part
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    const char d = (char)(p2 >> -one.e);
+    if (d || *len) buffer[(*len)++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+
+    if (p2 < delta) {
+      *K += kappa;
+      const int index = -kappa;
+      GrisuRound(buffer, *len, delta, p2, one.f,
+                 wp_w.f * (index < 20 ? kZeroOrPowersOf10[index] : 0));
+      return;
+    }
+  }
+}
+
+//! d must be positive and finite
+static void Grisu2(double d, char *buffer, int *len, int *K) KANON_NOEXCEPT
+{
+  const DiyFp v(d);
+  DiyFp w_m, w_p;
+  v.NormalizedBoundaries(&w_m, &w_p);
+
+  const DiyFp c_mk = GetCachedPower(w_p.e, K);
+  const DiyFp W = v.Normalize() * c_mk;
+  DiyFp Wp = w_p * c_mk;
+  DiyFp Wm = w_m * c_mk;
+  // Be conservative since the products are not exact
+  Wm.f++;
+  Wp.f--;
+  DigitGen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+//! Write "e+XX" or "e-XX"(at least two digits as printf)
+static char *WriteExponent(char *p, int exp) KANON_NOEXCEPT
+{
+  *p++ = 'e';
+  if (exp < 0) {
+    *p++ = '-';
+    exp = -exp;
+  } else {
+    *p++ = '+';
+  }
+
+  if (exp >= 100) {
+    *p++ = (char)('0' + exp / 100);
+    exp %= 100;
+  }
+  ::memcpy(p, kDigitPairs + exp * 2, 2);
+  return p + 2;
+}
+
+/**
+ * Layout the digits as "%.17g" does
+ * \param digits The value is 0.digits * 10^point
+ */
+static char *Prettify(char *p, char const *digits, int len,
+                      int point) KANON_NOEXCEPT
+{
+  // The exponent of the first digit
+  const int exp = point - 1;
+
+  if (exp < -4 || exp >= 17) {
+    *p++ = digits[0];
+    if (len > 1) {
+      *p++ = '.';
+      ::memcpy(p, digits + 1, len - 1);
+      p += len - 1;
+    }
+    return WriteExponent(p, exp);
+  }
+
+  if (point <= 0) {
+    // 0.000ddd
+    *p++ = '0';
+    *p++ = '.';
+    ::memset(p, '0', -point);
+    p += -point;
+    ::memcpy(p, digits, len);
+    return p + len;
+  }
+
+  if (point >= len) {
+    // ddd000
+    ::memcpy(p, digits, len);
+    p += len;
+    ::memset(p, '0', point - len);
+    return p + point - len;
+  }
+
+  // dd.ddd
+  ::memcpy(p, digits, point);
+  p += point;
+  *p++ = '.';
+  ::memcpy(p, digits + point, len - point);
+  return p + len - point;
+}
+
+} // namespace
+
+unsigned double2Str(char *buf, double d) KANON_NOEXCEPT
+{
+  char *p = buf;
+
+  if (::signbit(d)) {
+    *p++ = '-';
+    d = -d;
+  }
+
+  if (KANON_UNLIKELY(!::isfinite(d))) {
+    ::memcpy(p, ::isnan(d) ? "nan" : "inf", 4);
+    return (unsigned)(p - buf) + 3;
+  }
+
+  if (d == 0) {
+    *p++ = '0';
+  } else {
+    char digits[kMaxShortestDoubleSize];
+    int len = 0;
+    int K = 0;
+    Grisu2(d, digits, &len, &K);
+
+    // Strip the trailing zeros
+    while (len > 1 && digits[len - 1] == '0') {
+      --len;
+      ++K;
+    }
+    p = Prettify(p, digits, len, len + K);
+  }
+
+  *p = 0;
+  return (unsigned)(p - buf);
+}
+
+unsigned double2FixedStr(char *buf, unsigned size, double d,
+                         int precision) KANON_NOEXCEPT
+{
+  assert(precision >= 0);
+
+  // The scaled value must be exact in integer and the fraction part
+  // should be large enough to determine the rounding
+  if (precision < 16 && ::isfinite(d)) {
+    const uint64_t scale = precision == 0 ? 1 : kZeroOrPowersOf10[precision];
+    const double scaled = ::fabs(d) * (double)scale;
+
+    if (scaled < 1e15) {
+      const double integral = ::floor(scaled);
+      const double fraction = scaled - integral;
+      // The error of the multiplication is half ulp at most,
+      // fallback to snprintf() if it may make the rounding wrong
+      // (also the tie, which is rounded to even by snprintf())
+      const double ulp = scaled * 2.220446049250313e-16;
+
+      if (::fabs(fraction - 0.5) > ulp + 1e-300) {
+        const uint64_t n = (uint64_t)integral + (fraction > 0.5);
+        const uint64_t int_part = n / scale;
+        const uint64_t frac_part = n % scale;
+        const unsigned int_len = CountDigits(int_part);
+        // sign, integral part, '.', fraction part, '\0'
+        const unsigned len = 1 + int_len + 1 + (unsigned)precision + 1;
+
+        if (len > size) return 0;
+
+        char *p = buf;
+        if (::signbit(d)) *p++ = '-';
+        p += int_len;
+        FormatDecimal(p, int_part);
+
+        if (precision > 0) {
+          *p++ = '.';
+          const unsigned frac_len = CountDigits(frac_part);
+          ::memset(p, '0', precision - frac_len);
+          p += precision;
+          FormatDecimal(p, frac_part);
+        }
+
+        *p = 0;
+        return (unsigned)(p - buf);
+      }
+    }
+  }
+
+  const int ret = ::snprintf(buf, size, "%.*f", precision, d);
+  return (ret < 0 || (unsigned)ret >= size) ? 0 : (unsigned)ret;
+}
+
+} // namespace detail
+} // namespace kanon
@@ -0,0 +1,125 @@
+#ifndef KANON_STRING_NUMERIC_FORMAT_H
+#define KANON_STRING_NUMERIC_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "kanon/util/macro.h"
+
+namespace kanon {
+namespace detail {
+
+//! "00" "01" ... "99"
+KANON_CORE_API extern char const kDigitPairs[201];
+
+//! 0, 10, 100, ..., 10^19(the first is 0 instead of 1 for CountDigits())
+KANON_CORE_API extern uint64_t const kZeroOrPowersOf10[20];
+
+/**
+ * \return The number of decimal digits of n(0 has one digit)
+ */
+KANON_INLINE unsigned CountDigits(uint64_t n) KANON_NOEXCEPT
+{
+#if defined(__GNUC__) || defined(__clang__)
+  // bits * log10(2) is the digits number or less one
+  const unsigned t = (unsigned)((64 - __builtin_clzll(n | 1)) * 1233) >> 12;
+  return t + 1 - (n < kZeroOrPowersOf10[t]);
+#else
+  unsigned count = 1;
+  for (; n >= 100; n /= 100)
+    count += 2;
+  return count + (n >= 10);
+#endif
+}
+
+/**
+ * Write the digits of n to [end - CountDigits(n), end)
+ * Two digits are produced per division to halve the divisions.
+ */
+template <typename U>
+KANON_INLINE void FormatDecimal(char *end, U n) KANON_NOEXCEPT
+{
+  while (n >= 100) {
+    const unsigned index = (unsigned)(n % 100) * 2;
+    n /= 100;
+    end -= 2;
+    ::memcpy(end, kDigitPairs + index, 2);
+  }
+
+  if (n < 10) {
+    *--end = (char)('0' + n);
+  } else {
+    end -= 2;
+    ::memcpy(end, kDigitPairs + (unsigned)n * 2, 2);
+  }
+}
+
+template <typename T>
+KANON_INLINE bool IsNegative(T i, std::true_type) KANON_NOEXCEPT
+{
+  return i < 0;
+}
+
+template <typename T>
+KANON_INLINE bool IsNegative(T, std::false_type) KANON_NOEXCEPT
+{
+  return false;
+}
+
+/**
+ * Convert the integer to decimal string(terminated with '\0')
+ * \return The length of string(not include the '\0')
+ */
+template <typename T,
+          typename = typename std::enable_if<std::is_integral<T>::value>::type>
+KANON_INLINE unsigned int2Str(char *buf, T integer) KANON_NOEXCEPT
+{
+  // The division of 32-bit integer is faster than 64-bit one
+  using U = typename std::conditional<sizeof(T) <= sizeof(uint32_t), uint32_t,
+                                      uint64_t>::type;
+  U u = (U)integer;
+  char *p = buf;
+
+  if (IsNegative(integer, std::is_signed<T>{})) {
+    *p++ = '-';
+    // The absolute value of minimum is also correct in unsigned
+    u = 0 - u;
+  }
+
+  const unsigned n = CountDigits(u);
+  FormatDecimal(p + n, u);
+  p[n] = 0;
+
+  return (unsigned)(p - buf) + n;
+}
+
+/**
+ * Convert the double to the shortest decimal string that can be
+ * converted back to the same double(terminated with '\0').
+ * The layout is same as "%.17g", e.g. 0.1, 100, 1e+100, 1.5e-05,
+ * but the digits are the shortest instead of the 17 digits.
+ *
+ * \param buf At least kMaxShortestDoubleSize bytes
+ * \return The length of string(not include the '\0')
+ */
+KANON_CORE_API unsigned double2Str(char *buf, double d) KANON_NOEXCEPT;
+
+/**
+ * Same as snprintf(buf, size, "%.*f", precision, d)
+ * If the value is not too large, it is converted without snprintf().
+ *
+ * \param size The size of buf, it should be more than 310 + precision
+ *             to hold any double
+ * \return The length of string, 0 if buf is too small
+ */
+KANON_CORE_API unsigned double2FixedStr(char *buf, unsigned size, double d,
+                                        int precision) KANON_NOEXCEPT;
+
+//! The max length of double2Str() including '\0'
+constexpr unsigned kMaxShortestDoubleSize = 32;
+
+} // namespace detail
+} // namespace kanon
+
+#endif // KANON_STRING_NUMERIC_FORMAT_H
@@ -1,5 +1,7 @@
 #include "kanon/thread/thread_pool.h"
 
+#include <assert.h>
+
 #include "kanon/thread/thread.h"
 
 using namespace kanon;
@@ -10,10 +12,17 @@ ThreadPool::ThreadPool(int max_queue_size,
   , not_full_{ mutex_ }
   , not_empty_{ mutex_ }
   , max_queue_size_{ max_queue_size }
+  , running_{ false }
   , name_{ name }
 { }
 
 ThreadPool::~ThreadPool() KANON_NOEXCEPT {
+  {
+    MutexGuard guard{ mutex_ };
+    running_ = false;
+    not_empty_.NotifyAll();
+  }
+
   for (auto& thr : threads_) {
     thr->Join();
   }
@@ -21,12 +30,12 @@ ThreadPool::~ThreadPool() KANON_NOEXCEPT {
 
 void ThreadPool::StartRun(int thread_num) {
   MutexGuard guard{ mutex_ };
+  running_ = true;
 
   for (int i = 0; i != thread_num; ++i) {
     auto up_thr = kanon::make_unique<Thread>([this]() {
-      auto task = Pop();
-
-      if (task) {
+      // Empty task indicates the pool is stopped
+      while (auto task = Pop()) {
         // Exception is handled by Thread
         task();
       }
@@ -49,11 +58,27 @@ void ThreadPool::Push(Task task) {
   not_empty_.Notify();
 }
 
+bool ThreadPool::TryPush(Task task) {
+  MutexGuard guard{ mutex_ };
+
+  // The caller doesn't wait, the task would be pending forever
+  assert(!threads_.empty() && "TryPush() is called before StartRun()");
+  if (threads_.empty() ||
+      static_cast<int>(tasks_.size()) == max_queue_size_) {
+    return false;
+  }
+
+  tasks_.emplace(std::move(task));
+  not_empty_.Notify();
+  return true;
+}
+
 auto ThreadPool::Pop() -> Task
 {
   MutexGuard guard{ mutex_ };
 
   while (tasks_.size() == 0) {
+    if (!running_) return Task();
     not_empty_.Wait();
   }
 
@@ -30,6 +30,7 @@ class ThreadPool : noncopyable {
 
   /**
    * \brief join all thread to reclaim their resource
+   * \note The remaining tasks are run before the threads exit
    */
   KANON_CORE_API ~ThreadPool() KANON_NOEXCEPT;
 
@@ -44,6 +45,15 @@ class ThreadPool : noncopyable {
    */
   KANON_CORE_API void Push(Task task);
 
+  /**
+   * \brief push task to task queue if it is not full
+   * \return false if the queue is full, i.e. the task is not pushed
+   * \note Don't block, used in the IO thread which can't wait consumer
+   * \warning Must be called after StartRun(), otherwise no thread runs the
+   *          task and it is not pushed
+   */
+  KANON_CORE_API bool TryPush(Task task);
+
   void SetMaxQueueSize(int num) KANON_NOEXCEPT
   {
     if (num > 0) max_queue_size_ = num;
@@ -53,6 +63,7 @@ class ThreadPool : noncopyable {
   /**
    * \brief pop the task from queue, and notify Push() to produce which can
    * produce more task
+   * \return empty task if the pool is stopped and no task
    */
   Task Pop();
 
@@ -61,6 +72,7 @@ class ThreadPool : noncopyable {
   Condition not_empty_ GUARDED_BY(mutex_);
 
   int max_queue_size_;
+  bool running_ GUARDED_BY(mutex_);
 
   std::vector<std::unique_ptr<kanon::Thread>> threads_;
   std::queue<Task> tasks_;
@@ -0,0 +1,88 @@
+#include "kanon/thread/waiter.h"
+
+#ifdef KANON_ON_LINUX
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace kanon {
+
+#ifdef KANON_ON_LINUX
+static KANON_INLINE void FutexWait(std::atomic<int> *addr, int value) KANON_NOEXCEPT
+{
+  // std::atomic<int> has the same representation as int
+  ::syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAIT_PRIVATE,
+            value, NULL, NULL, 0);
+}
+
+static KANON_INLINE void FutexWakeOne(std::atomic<int> *addr) KANON_NOEXCEPT
+{
+  ::syscall(SYS_futex, reinterpret_cast<int *>(addr), FUTEX_WAKE_PRIVATE, 1,
+            NULL, NULL, 0);
+}
+#endif
+
+static KANON_INLINE void CpuRelax() KANON_NOEXCEPT
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+Waiter::Waiter()
+  : state_(kNotNotified)
+#ifndef KANON_ON_LINUX
+  , mutex_()
+  , cond_(mutex_)
+#endif
+{
+}
+
+Waiter::~Waiter() KANON_NOEXCEPT = default;
+
+void Waiter::Notify() KANON_NOEXCEPT
+{
+#ifdef KANON_ON_LINUX
+  // Only wake up the waiter when it is sleeping, the futex word may be
+  // reused by the next event after the exchange, but a spurious wakeup
+  // is harmless since the waiter checks the state again
+  if (state_.exchange(kNotified, std::memory_order_acq_rel) == kSleeping) {
+    FutexWakeOne(&state_);
+  }
+#else
+  MutexGuard guard(mutex_);
+  state_.store(kNotified, std::memory_order_release);
+  cond_.Notify();
+#endif
+}
+
+void Waiter::Wait(int spin_count) KANON_NOEXCEPT
+{
+  for (int i = 0; i < spin_count; ++i) {
+    if (IsNotified()) return;
+    CpuRelax();
+  }
+
+#ifdef KANON_ON_LINUX
+  int state = kNotNotified;
+  if (state_.compare_exchange_strong(state, kSleeping,
+                                     std::memory_order_acq_rel))
+  {
+    state = kSleeping;
+  }
+
+  while (state != kNotified) {
+    FutexWait(&state_, kSleeping);
+    state = state_.load(std::memory_order_acquire);
+  }
+#else
+  MutexGuard guard(mutex_);
+  while (!IsNotified())
+    cond_.Wait();
+#endif
+}
+
+} // namespace kanon
@@ -0,0 +1,82 @@
+#ifndef KANON_THREAD_WAITER_H
+#define KANON_THREAD_WAITER_H
+
+#include <atomic>
+
+#include "kanon/util/macro.h"
+#include "kanon/util/noncopyable.h"
+
+#ifndef KANON_ON_LINUX
+#  include "kanon/thread/condition.h"
+#  include "kanon/thread/mutex_lock.h"
+#endif
+
+namespace kanon {
+
+/**
+ * \brief Wait an one-shot event that is notified by the other thread
+ *
+ * Unlike the CountDownLatch, the notifier and the waiter don't take
+ * any lock: the state is an atomic word, and the waiter only sleeps
+ * in the futex(Linux) when the event is not notified after spinning,
+ * i.e. the notifier only wakes up when the waiter is sleeping.
+ *
+ * The waiter can be reused by Reset(), so it is suitable to be a
+ * thread-local object of the caller that waits a result frequently.
+ *
+ * Usage:
+ * \code
+ *   waiter.Reset();
+ *   PostTask([&waiter]() { ...; waiter.Notify(); });
+ *   waiter.Wait();
+ * \endcode
+ */
+class KANON_CORE_API Waiter : noncopyable {
+ public:
+  Waiter();
+  ~Waiter() KANON_NOEXCEPT;
+
+  /**
+   * Prepare waiting a new event
+   * \note Must not be called when the last event is not notified
+   */
+  void Reset() KANON_NOEXCEPT
+  {
+    state_.store(kNotNotified, std::memory_order_relaxed);
+  }
+
+  /**
+   * \note Thread-safe
+   */
+  void Notify() KANON_NOEXCEPT;
+
+  /**
+   * Wait until Notify() is called
+   * \param spin_count
+   *   The number of checks of the state before sleeping
+   */
+  void Wait(int spin_count = 0) KANON_NOEXCEPT;
+
+  bool IsNotified() const KANON_NOEXCEPT
+  {
+    return state_.load(std::memory_order_acquire) == kNotified;
+  }
+
+ private:
+  enum State : int {
+    kNotNotified = 0,
+    kNotified,
+    kSleeping, //!< The waiter is(or will be) sleeping
+  };
+
+  std::atomic<int> state_;
+
+#ifndef KANON_ON_LINUX
+  MutexLock mutex_;
+  Condition cond_;
+#endif
+};
+
+} // namespace kanon
+
+#endif // KANON_THREAD_WAITER_H
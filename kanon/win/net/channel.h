@@ -12,6 +12,7 @@
 
 #include "kanon/net/macro.h"
 #include "kanon/net/event.h"
+#include "kanon/net/channel_handler.h"
 
 namespace kanon {
 
@@ -138,6 +139,28 @@ class KANON_NET_NO_API Channel {
   void SetErrorCallback(EventCallback cb) { error_callback_ = std::move(cb); }
   void SetCloseCallback(EventCallback cb) { close_callback_ = std::move(cb); }
 
+  /**
+   * \brief Set the handler of all events
+   *
+   * The completion context refer to the callbacks,
+   * so the handler is adapted to them here.
+   */
+  void SetHandler(ChannelHandler *handler)
+  {
+    read_callback_ = [handler](TimeStamp receive_time) {
+      handler->OnChannelRead(receive_time);
+    };
+    write_callback_ = [handler]() {
+      handler->OnChannelWrite();
+    };
+    error_callback_ = [handler]() {
+      handler->OnChannelError();
+    };
+    close_callback_ = [handler]() {
+      handler->OnChannelClose();
+    };
+  }
+
   void RegisterCompletionContext(CompletionContext *ctx);
 
   //!@} // events handler resgiter
@@ -23,7 +23,7 @@ void ConnectionBase<D>::HandleRead(TimeStamp recv_time)
   }
 
   if (message_callback_) {
-    message_callback_(shared_from_this(), input_buffer_, recv_time);
+    message_callback_(self_, input_buffer_, recv_time);
   } else {
     input_buffer_.AdvanceAll();
     LOG_WARN_KANON << "If user want to process message from peer, should set "
@@ -116,7 +116,7 @@ void ConnectionBase<D>::HandleReadImmediately(size_t readn)
 
   if (message_callback_) {
     auto recv_time = TimeStamp::Now();
-    message_callback_(shared_from_this(), input_buffer_, recv_time);
+    message_callback_(self_, input_buffer_, recv_time);
     if (input_buffer_.GetWritableSize() == 0) {
       input_buffer_.ReserveWriteSpace(1024);
     }
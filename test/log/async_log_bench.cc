@@ -1,65 +1,112 @@
-#include "kanon/thread/thread_pool.h"
-#include "kanon/thread/count_down_latch.h"
+/**
+ * Throughput of AsyncLog with 1, 8 and 32 producer threads,
+ * and LogFile with 1 thread as the baseline.
+ * The stats of AsyncLog(e.g. discarded lines) are also reported.
+ *
+ * Usage:
+ *   async_log_bench [lines per round(=10000000)] [prefix(=/root/.log/async-log-bench/)] [mmap(=0)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include "kanon/thread/thread.h"
 
 #include "kanon/log/log_file.h"
 #include "kanon/log/async_log.h"
 
-#include "kanon/util/measure_time.h"
+#include "kanon/util/time_stamp.h"
 
 using namespace kanon;
 
 namespace detail {
 
-static inline void
-AsyncLog_bench_impl(int num) {
-  int pool_size = 10;
-  CountDownLatch latch(pool_size);
-
-  ThreadPool pool{ pool_size, "AsyncLog" };
-  
-  pool.StartRun(pool_size);
-  
-  int thread_log_num = num / pool_size;
-
-  for (int i = 0; i != pool_size; ++i) {
-    pool.Push([&latch, thread_log_num]() {
-      for (auto i = 0; i != thread_log_num; ++i) {
-        LOG_INFO << "AsyncLog_bench";
-      }
-
-      latch.Countdown();
-    });
+static inline void AsyncLog_bench_impl(int num, int thread_num)
+{
+  std::vector<std::unique_ptr<Thread>> producers;
+  const int thread_log_num = num / thread_num;
+
+  for (int i = 0; i != thread_num; ++i) {
+    producers.emplace_back(new Thread(
+        [thread_log_num]() {
+          for (auto i = 0; i != thread_log_num; ++i) {
+            LOG_INFO << "AsyncLog_bench " << i;
+          }
+        },
+        "AsyncLog"));
   }
 
-  latch.Wait();
+  for (auto &producer : producers)
+    producer->StartRun();
+  for (auto &producer : producers)
+    producer->Join();
 }
 
-
-static inline void
-LogFile_bench_impl(int num) {
+static inline void LogFile_bench_impl(int num)
+{
   for (int i = 0; i != num; ++i) {
-    LOG_INFO << "AsyncLog_bench";
+    LOG_INFO << "AsyncLog_bench " << i;
   }
 }
 
+static inline void Report(char const *name, int thread_num, int num,
+                          TimeStamp start)
+{
+  const auto elapsed = (double)(TimeStamp::Now().GetMicroseconds() -
+                                start.GetMicroseconds()) /
+                       1000000;
+  ::fprintf(stderr, "%s, threads: %d, lines: %d, elapsed: %.3fs, lines/s: %.0f\n",
+            name, thread_num, num, elapsed, num / elapsed);
+}
+
 } // namespace detail
 
-static inline void
-AsyncLog_bench(int num) {
-  SetupAsyncLog("async_log", 200000, "/root/.log/async-log-bench");
-  ::detail::AsyncLog_bench_impl(num);
+static inline void AsyncLog_bench(int num, StringView prefix, bool mmap)
+{
+  SetupAsyncLog("async_log", 200000, prefix, UINT_MAX, 86400, 3, mmap);
+
+  for (int thread_num : {1, 8, 32}) {
+    const auto start = TimeStamp::Now();
+    ::detail::AsyncLog_bench_impl(num, thread_num);
+    ::detail::Report("AsyncLog", thread_num, num, start);
+
+    // Accumulated from the first round
+    const auto stats = g_binary_log_output->GetStats();
+    ::fprintf(stderr,
+              "  discarded lines: %llu, max pending bytes: %llu, "
+              "max write time: %lluus\n",
+              (unsigned long long)stats.discarded_lines,
+              (unsigned long long)stats.max_pending_bytes,
+              (unsigned long long)stats.max_write_time_us);
+  }
 }
 
-static inline void
-LogFile_bench(int num) {
-  LogFile<> log("log_file", 200000, "/root/.log/async-log-bench/");
+template <typename File>
+static inline void LogFile_bench(int num, StringView prefix)
+{
+  LogFile<false, File> log("log_file", 200000, prefix);
   SetupLogFile(log);
+
+  const auto start = TimeStamp::Now();
   ::detail::LogFile_bench_impl(num);
+  ::detail::Report("LogFile", 1, num, start);
 }
 
-#define N 10000000
+int main(int argc, char *argv[])
+{
+  const int num = argc > 1 ? ::atoi(argv[1]) : 10000000;
+  const StringView prefix = argc > 2 ? argv[2] : "/root/.log/async-log-bench/";
+
+  const bool mmap = argc > 3 ? ::atoi(argv[3]) : false;
 
-int main() {
-  MEASURE_TIME(AsyncLog_bench, N);
-  MEASURE_TIME(LogFile_bench, N);
+  AsyncLog_bench(num, prefix, mmap);
+#ifdef KANON_ON_UNIX
+  if (mmap) {
+    LogFile_bench<MmapAppendFile>(num, prefix);
+    return 0;
+  }
+#endif
+  LogFile_bench<AppendFile>(num, prefix);
 }
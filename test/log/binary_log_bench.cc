@@ -0,0 +1,68 @@
+/**
+ * Cost of a log line in the calling thread when AsyncLog is used:
+ * LOG_INFO(text), FMT_LOG_INFO(text) and BIN_LOG_INFO(binary)
+ *
+ * Each round logs a burst of lines which fits in the buffer of the thread,
+ * then sleeps to let the back thread write them, so only the cost of
+ * the calling thread is measured.
+ *
+ * Usage:
+ *   binary_log_bench [rounds(=20)] [prefix(=/root/.log/binary-log-bench/)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "kanon/log/async_log.h"
+#include "kanon/log/binary_log.h"
+
+#include "kanon/util/time_stamp.h"
+
+using namespace kanon;
+
+#define BURST_LINES 10000
+
+template <typename F>
+static void Bench(char const *name, int rounds, F log)
+{
+  std::vector<double> costs;
+  const std::string peer = "127.0.0.1:9999";
+
+  for (int r = 0; r != rounds; ++r) {
+    const auto start = TimeStamp::Now();
+    for (int i = 0; i != BURST_LINES; ++i) {
+      log(i, peer);
+    }
+    costs.push_back((double)(TimeStamp::Now().GetMicroseconds() -
+                             start.GetMicroseconds()) *
+                    1000 / BURST_LINES);
+    ::usleep(100 * 1000);
+  }
+
+  std::sort(costs.begin(), costs.end());
+  ::fprintf(stderr, "%-12s median: %.1fns/line, min: %.1fns/line\n", name,
+            costs[costs.size() / 2], costs[0]);
+}
+
+int main(int argc, char *argv[])
+{
+  const int rounds = argc > 1 ? ::atoi(argv[1]) : 20;
+  const StringView prefix = argc > 2 ? argv[2] : "/root/.log/binary-log-bench/";
+
+  SetupAsyncLog("binary_log", 200000, prefix);
+
+  Bench("LOG_INFO", rounds, [](int i, std::string const &peer) {
+    LOG_INFO << "Request " << i << " from " << peer << " cost " << 1.5
+             << "ms";
+  });
+  Bench("FMT_LOG_INFO", rounds, [](int i, std::string const &peer) {
+    FMT_LOG_INFO("Request % from % cost %ms", i, StringView(peer), 1.5);
+  });
+  Bench("BIN_LOG_INFO", rounds, [](int i, std::string const &peer) {
+    BIN_LOG_INFO("Request % from % cost %ms", i, peer, 1.5);
+  });
+}
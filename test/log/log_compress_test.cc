@@ -0,0 +1,61 @@
+// The rolled files of LogFile are compressed by GzipCompressor in background,
+// then check them by gzip -t(if gzip is installed).
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "kanon/log/log_file.h"
+
+using namespace kanon;
+
+#define SECONDS 5
+
+int main(int, char *argv[])
+{
+  char const *basename = ::basename(argv[0]);
+
+  // The log files are in the new directory of current directory
+  std::string prefix = basename;
+  prefix += ".";
+  prefix += std::to_string(::getpid());
+  prefix += "/";
+
+  {
+    // roll per second since the roll size is small
+    LogFile<> lf(basename, 1 << 20, prefix);
+    lf.SetCompressor(std::unique_ptr<LogCompressor>(new GzipCompressor()),
+                     16 << 20);
+    SetupLogFile(lf);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; std::chrono::steady_clock::now() - start <
+                    std::chrono::seconds(SECONDS);
+         ++i)
+    {
+      LOG_INFO << "LogCompress_test " << i;
+      if (i % 1000 == 0) ::usleep(10000);
+    }
+
+    // Wait the last rolled file is compressed
+    ::sleep(2);
+  }
+
+  int compressed_num = 0;
+  int failed_num = 0;
+  auto dir = ::opendir(prefix.c_str());
+  while (auto entry = ::readdir(dir)) {
+    const StringView name(entry->d_name);
+    if (!name.ends_with(".gz")) continue;
+
+    ++compressed_num;
+    const std::string cmd = "gzip -t " + prefix + entry->d_name;
+    if (::system(cmd.c_str()) != 0) ++failed_num;
+  }
+  ::closedir(dir);
+
+  ::printf("compressed: %d, failed to decompress: %d\n", compressed_num,
+           failed_num);
+  return (compressed_num > 0 && failed_num == 0) ? 0 : 1;
+}
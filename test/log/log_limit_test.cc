@@ -0,0 +1,27 @@
+#include "kanon/log/log_limit.h"
+
+#include <unistd.h>
+
+using namespace kanon;
+
+#define N 1000
+
+int main()
+{
+  // 2 lines per second, the next second prints "(suppressed 998 lines)"
+  for (int r = 0; r != 3; ++r) {
+    for (int i = 0; i != N; ++i) {
+      LOG_WARN_RATE_LIMITED(2) << "rate limited " << i;
+    }
+    ::sleep(1);
+  }
+
+  // The 1st, 101th, ... lines
+  for (int i = 0; i != N; ++i) {
+    LOG_INFO_EVERY_N(100) << "sampled " << i;
+  }
+
+  for (int i = 0; i != N; ++i) {
+    LOG_EVERY_N(LOG_DEBUG, 100) << "sampled debug " << i;
+  }
+}
@@ -0,0 +1,72 @@
+// Each thread logs to its own file, then merge them by timestamp
+// and check the merged file.
+#include <dirent.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "kanon/log/thread_log_file.h"
+#include "kanon/log/log_merge.h"
+#include "kanon/thread/thread.h"
+
+using namespace kanon;
+
+#define THREAD_NUM 4
+#define N 100000
+
+int main(int, char *argv[])
+{
+  char const *basename = ::basename(argv[0]);
+
+  // The log files are in the new directory of current directory
+  std::string prefix = basename;
+  prefix += ".";
+  prefix += std::to_string(::getpid());
+  prefix += "/";
+
+  {
+    ThreadLogFile<> lf(basename, 1 << 30, prefix);
+    SetupLogFile(lf);
+
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < THREAD_NUM; ++i) {
+      threads.emplace_back(new Thread("Worker" + std::to_string(i)));
+      threads.back()->StartRun([]() {
+        for (int j = 0; j < N; ++j) {
+          LOG_INFO << "ThreadLogFile_test " << j;
+        }
+      });
+    }
+
+    for (auto &thread : threads) {
+      thread->Join();
+    }
+  }
+
+  std::vector<std::string> inputs;
+  auto dir = ::opendir(prefix.c_str());
+  while (auto entry = ::readdir(dir)) {
+    if (entry->d_name[0] != '.') inputs.emplace_back(prefix + entry->d_name);
+  }
+  ::closedir(dir);
+
+  const auto output = prefix + "merged.log";
+  if (!MergeLogFiles(inputs, output)) return 1;
+
+  std::ifstream in(output);
+  std::string line;
+  std::string last;
+  size_t lines = 0;
+  bool ordered = true;
+  while (std::getline(in, line)) {
+    ++lines;
+    if (line.compare(0, 22, last) < 0) ordered = false;
+    last = line.substr(0, 22);
+  }
+
+  ::printf("files: %zu, lines: %zu(expected: %d), ordered: %d\n",
+           inputs.size(), lines, THREAD_NUM * N, ordered);
+  return (ordered && lines == THREAD_NUM * N) ? 0 : 1;
+}
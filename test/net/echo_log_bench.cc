@@ -0,0 +1,149 @@
+// Echo round trip over loopback to observe the per-message cost of
+// the disabled logs of kanon library in the hot path.
+//
+// * Echo/HotLogOff: the hot path logs(LOG_XXX_KANON_HOT) are disabled
+//                   by SetKanonHotLog(false)(default)
+// * Echo/HotLogOn:  the hot path logs are enabled but filtered by the
+//                   log level(INFO), i.e. the cost of LOG_XXX_KANON
+//                   (load g_kanon_log and log level, then branch)
+//
+// Build with cmake -DKANON_LOG_MIN_LEVEL=INFO to compare with the logs
+// stripped in compile time, then the two are same.
+//
+// If the PMU is available, the number of the instructions per message in
+// the IO thread is also reported. In the virtual machine, it is usually
+// unavailable.
+#include <arpa/inet.h>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <string.h>
+#include <atomic>
+
+#include <benchmark/benchmark.h>
+
+#include "kanon/net/user_server.h"
+#include "kanon/net/event_loop_thread.h"
+
+using namespace kanon;
+using namespace benchmark;
+
+static constexpr int kMessageSize = 64;
+static constexpr uint16_t kPort = 9995;
+
+static int OpenInstructionCounter() KANON_NOEXCEPT
+{
+  struct perf_event_attr attr;
+  ::memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t ReadCounter(int fd) KANON_NOEXCEPT
+{
+  uint64_t value = 0;
+  if (fd >= 0 && ::read(fd, &value, sizeof value) != sizeof value) value = 0;
+  return value;
+}
+
+static int ConnectTo(uint16_t port)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  while (::connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+    ::usleep(1000);
+  }
+
+  int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  return fd;
+}
+
+struct EchoServer {
+  EchoServer()
+    : loop(loop_thr.StartRun())
+    , server(loop, InetAddr(kPort), "EchoLog")
+    , counter_fd(-2)
+  {
+    server.SetMessageCallback(
+        [](TcpConnectionPtr const &conn, Buffer &buffer, TimeStamp) {
+          conn->Send(buffer);
+          buffer.AdvanceAll();
+        });
+    server.StartRun();
+
+    loop->RunInLoop([this]() {
+      counter_fd = OpenInstructionCounter();
+    });
+
+    fd = ConnectTo(kPort);
+    while (counter_fd == -2) {
+    }
+  }
+
+  EventLoopThread loop_thr;
+  EventLoop *loop;
+  TcpServer server;
+  std::atomic<int> counter_fd;
+  int fd;
+};
+
+static void EchoBench(State &state, bool hot_log)
+{
+  // Don't destroy it in exit since the loop thread is running
+  static EchoServer *echo_server = new EchoServer();
+
+  // The logs are not output, only the cost of checking is measured
+  Logger::SetLogLevel(Logger::KANON_LL_INFO);
+  echo_server->loop->RunInLoop([hot_log]() {
+    SetKanonHotLog(hot_log);
+  });
+
+  int fd = echo_server->fd;
+  int counter_fd = echo_server->counter_fd;
+  char msg[kMessageSize];
+  ::memset(msg, 'a', sizeof msg);
+
+  uint64_t start_instructions = ReadCounter(counter_fd);
+  for (auto _ : state) {
+    if (::write(fd, msg, sizeof msg) != sizeof msg) {
+      state.SkipWithError("write error");
+      break;
+    }
+
+    size_t readn = 0;
+    while (readn < sizeof msg) {
+      auto n = ::read(fd, msg + readn, sizeof msg - readn);
+      if (n <= 0) break;
+      readn += n;
+    }
+  }
+  uint64_t end_instructions = ReadCounter(counter_fd);
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["min_level"] = KANON_LOG_MIN_LEVEL;
+  if (counter_fd >= 0) {
+    state.counters["instructions/msg"] = Counter(
+        (double)(end_instructions - start_instructions) / state.iterations());
+  }
+}
+
+static void Echo_HotLogOff(State &state) { EchoBench(state, false); }
+static void Echo_HotLogOn(State &state) { EchoBench(state, true); }
+
+BENCHMARK(Echo_HotLogOff)->UseRealTime();
+BENCHMARK(Echo_HotLogOn)->UseRealTime();
@@ -0,0 +1,109 @@
+// Echo round trip over loopback to observe the per-message cost of
+// the connection reference passed to the message callback.
+//
+// * Echo/Borrowed: callback use the borrowed reference directly
+// * Echo/Retained: callback copy the reference per message,
+//                  i.e. the cost before the borrowed reference
+//                  (shared_from_this() per message)
+//
+// Only the round trip time is reported, the number of atomic operations
+// on the control block is not measured.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string.h>
+#include <atomic>
+
+#include <benchmark/benchmark.h>
+
+#include "kanon/net/user_server.h"
+#include "kanon/net/event_loop_thread.h"
+
+using namespace kanon;
+using namespace benchmark;
+
+static constexpr int kMessageSize = 64;
+static constexpr uint16_t kPort = 9996;
+
+static int ConnectTo(uint16_t port)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  while (::connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+    ::usleep(1000);
+  }
+
+  int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  return fd;
+}
+
+struct EchoServer {
+  EchoServer()
+    : loop(loop_thr.StartRun())
+    , server(loop, InetAddr(kPort), "EchoRefcount")
+    , retain(false)
+  {
+    server.SetMessageCallback(
+        [this](TcpConnectionPtr const &conn, Buffer &buffer, TimeStamp) {
+          if (retain.load(std::memory_order_relaxed)) {
+            // Emulate shared_from_this() per message
+            auto const guard = conn;
+            guard->Send(buffer);
+          } else {
+            conn->Send(buffer);
+          }
+          buffer.AdvanceAll();
+        });
+    server.StartRun();
+
+    fd = ConnectTo(kPort);
+  }
+
+  EventLoopThread loop_thr;
+  EventLoop *loop;
+  TcpServer server;
+  std::atomic<bool> retain;
+  int fd;
+};
+
+static void EchoBench(State &state, bool retain)
+{
+  // Don't destroy it in exit since the loop thread is running
+  static EchoServer *echo_server = new EchoServer();
+  echo_server->retain = retain;
+
+  int fd = echo_server->fd;
+  char msg[kMessageSize];
+  ::memset(msg, 'a', sizeof msg);
+
+  for (auto _ : state) {
+    if (::write(fd, msg, sizeof msg) != sizeof msg) {
+      state.SkipWithError("write error");
+      break;
+    }
+
+    size_t readn = 0;
+    while (readn < sizeof msg) {
+      auto n = ::read(fd, msg + readn, sizeof msg - readn);
+      if (n <= 0) break;
+      readn += n;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void Echo_Borrowed(State &state) { EchoBench(state, false); }
+static void Echo_Retained(State &state) { EchoBench(state, true); }
+
+BENCHMARK(Echo_Borrowed)->UseRealTime();
+BENCHMARK(Echo_Retained)->UseRealTime();
@@ -0,0 +1,161 @@
+#include "kanon/protobuf/input_stream.h"
+#include "kanon/protobuf/chunk_stream.h"
+#include "kanon/protobuf/protobuf_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+
+#include "../rpc/pb/echo.pb.h"
+
+using namespace kanon;
+using namespace kanon::protobuf;
+
+char buf[4096 * 10];
+
+char const echo_tag[] = "Echo";
+
+// Don't use CHECK() since it is removed in the release build
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      ::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+                #cond);                                                        \
+      ::exit(1);                                                               \
+    }                                                                          \
+  } while (0)
+
+int main()
+{
+  for (size_t i = 0; i < sizeof buf; ++i) {
+    buf[i] = 'a' + i % 26;
+  }
+
+  EchoArgs args;
+  args.set_msg(buf, sizeof buf);
+
+  // Message span chunks
+  ChunkStream stream;
+  args.SerializeToZeroCopyStream(&stream);
+  auto &chunk_list = stream.chunk_list;
+  std::cout << "chunk count: " << chunk_list.GetChunkSize() << "\n";
+
+  {
+    EchoArgs parsed;
+    ChunkInputStream input(chunk_list);
+    const bool parsed_ok = parsed.ParseFromZeroCopyStream(&input);
+    CHECK(parsed_ok);
+    CHECK(parsed.msg() == args.msg());
+    CHECK((size_t)input.ByteCount() == chunk_list.GetReadableSize());
+  }
+
+  {
+    Buffer buffer;
+    auto content = args.SerializeAsString();
+    buffer.Append(content);
+    buffer.Append("trailing");
+
+    EchoArgs parsed;
+    BufferInputStream input(buffer, content.size());
+    const bool parsed_ok = parsed.ParseFromZeroCopyStream(&input);
+    CHECK(parsed_ok);
+    CHECK(parsed.msg() == args.msg());
+  }
+
+  {
+    ChunkInputStream input(chunk_list);
+    const bool skipped = input.Skip(4097);
+    CHECK(skipped);
+    char c;
+    const bool read = ReadFromStream(&input, &c, 1);
+    CHECK(read);
+    CHECK(c == buf[4097 - 4]); // The tag and length of field take 4 bytes
+    CHECK(input.ByteCount() == 4098);
+  }
+
+  // Codec: frame span chunks
+  {
+    // Two frames
+    ChunkList frames;
+    ChunkStream frame_stream;
+    for (int i = 0; i < 2; ++i) {
+      auto &frame = frame_stream.chunk_list;
+      frame.Append(echo_tag, sizeof(echo_tag) - 1);
+      args.SerializeToZeroCopyStream(&frame_stream);
+
+      uint32_t checksum;
+      {
+        ChunkInputStream input(frame);
+        checksum = ChecksumOfStream(&input, frame.GetReadableSize());
+      }
+      frame.Append32(checksum);
+      frame.Prepend32(uint32_t(frame.GetReadableSize()));
+
+      if (i == 0) {
+        frames.swap(frame);
+      } else {
+        frames.AppendChunkList(&frame);
+      }
+    }
+
+    ProtobufCodec<EchoArgs, echo_tag> codec;
+    int count = 0;
+    codec.SetMessageCallback(
+        [&args, &count](TcpConnectionPtr const &, EchoArgs *message,
+                        TimeStamp) {
+          CHECK(message->msg() == args.msg());
+          ++count;
+        });
+
+    codec.OnMessage(TcpConnectionPtr(), frames, TimeStamp::Now());
+    CHECK(count == 2);
+    CHECK(!frames.HasReadable() || frames.GetReadableSize() == 0);
+  }
+
+  // Codec: raw frame mixed with message frame
+  {
+    ChunkList frames;
+    {
+      ChunkList raw;
+      raw.Append("Raw!", 4);
+      raw.Append("payload", 7);
+      ProtobufCodec<EchoArgs, echo_tag>::SealFrame(raw);
+      frames.swap(raw);
+    }
+    {
+      ChunkStream frame_stream;
+      auto &frame = frame_stream.chunk_list;
+      frame.Append(echo_tag, sizeof(echo_tag) - 1);
+      args.SerializeToZeroCopyStream(&frame_stream);
+      ProtobufCodec<EchoArgs, echo_tag>::SealFrame(frame);
+      frames.AppendChunkList(&frame);
+    }
+
+    Buffer buffer;
+    for (auto const &chunk : frames)
+      buffer.Append(StringView(chunk.GetReadBegin(), chunk.GetReadableSize()));
+
+    ProtobufCodec<EchoArgs, echo_tag> codec;
+    int raw_count = 0;
+    int count = 0;
+    codec.SetMessageCallback(
+        [&args, &count](TcpConnectionPtr const &, EchoArgs *message,
+                        TimeStamp) {
+          CHECK(message->msg() == args.msg());
+          ++count;
+        });
+    codec.SetRawMessageCallback(
+        "Raw!", [&raw_count](TcpConnectionPtr const &, char const *body,
+                             size_t size, TimeStamp) {
+          CHECK(StringView(body, size) == StringView("payload"));
+          ++raw_count;
+        });
+
+    codec.OnMessage(TcpConnectionPtr(), frames, TimeStamp::Now());
+    codec.OnMessage(TcpConnectionPtr(), buffer, TimeStamp::Now());
+    CHECK(count == 2 && raw_count == 2);
+    CHECK(buffer.GetReadableSize() == 0);
+  }
+
+  std::cout << "OK" << std::endl;
+}
@@ -0,0 +1,117 @@
+#include "kanon/rpc/batch_queue.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+using Queue = BatchQueue<int>;
+using Batches = std::vector<std::vector<int>>;
+
+static std::shared_ptr<Queue> MakeQueue(EventLoop *loop, Batches &batches)
+{
+  return std::make_shared<Queue>(loop, [loop, &batches](Queue::Items &items) {
+    EXPECT_TRUE(loop->IsLoopInThread());
+    batches.push_back(items);
+  });
+}
+
+TEST(batch_queue, post_out_of_batch)
+{
+  EventLoop loop;
+  Batches batches;
+  auto queue = MakeQueue(&loop, batches);
+
+  // Flushed immediately
+  queue->Post(1);
+  queue->Post(2);
+  EXPECT_EQ(batches, (Batches{{1}, {2}}));
+}
+
+TEST(batch_queue, post_in_batch)
+{
+  EventLoop loop;
+  Batches batches;
+  auto queue = MakeQueue(&loop, batches);
+
+  queue->BeginBatch();
+  queue->Post(1);
+  queue->Post(2);
+  queue->Post(3);
+  EXPECT_TRUE(batches.empty());
+  queue->EndBatch();
+  EXPECT_EQ(batches, (Batches{{1, 2, 3}}));
+
+  // Empty batch
+  queue->BeginBatch();
+  queue->EndBatch();
+  EXPECT_EQ(batches.size(), 1);
+}
+
+TEST(batch_queue, post_in_callback)
+{
+  EventLoop loop;
+  Batches batches;
+  std::shared_ptr<Queue> queue;
+  queue = std::make_shared<Queue>(&loop, [&](Queue::Items &items) {
+    batches.push_back(items);
+    if (items.front() < 3) queue->Post(items.front() + 1);
+  });
+
+  // The items posted in the callback are flushed in the next round
+  queue->Post(1);
+  EXPECT_EQ(batches, (Batches{{1}, {2}, {3}}));
+}
+
+TEST(batch_queue, post_in_other_thread)
+{
+  EventLoop loop;
+  Batches batches;
+  auto queue = MakeQueue(&loop, batches);
+
+  // Only the first posting queues a functor to the loop
+  std::thread thr([&]() {
+    for (int i = 0; i < 100; ++i)
+      queue->Post(int(i));
+    loop.QueueToLoop([&loop]() {
+      loop.Quit();
+    });
+  });
+  thr.join();
+  EXPECT_TRUE(batches.empty());
+
+  loop.StartLoop();
+  ASSERT_EQ(batches.size(), 1);
+  ASSERT_EQ(batches[0].size(), 100);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(batches[0][i], i);
+}
+
+TEST(batch_queue, post_in_other_thread_in_batch)
+{
+  EventLoop loop;
+  Batches batches;
+  auto queue = MakeQueue(&loop, batches);
+
+  loop.QueueToLoop([&]() {
+    queue->BeginBatch();
+    queue->Post(1);
+  });
+
+  // The items of other threads are flushed at EndBatch() if in batch
+  std::thread thr([&]() {
+    queue->Post(2);
+  });
+  thr.join();
+
+  loop.QueueToLoop([&]() {
+    EXPECT_TRUE(batches.empty());
+    queue->EndBatch();
+    loop.Quit();
+  });
+
+  loop.StartLoop();
+  EXPECT_EQ(batches, (Batches{{1, 2}}));
+}
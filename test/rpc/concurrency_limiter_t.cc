@@ -0,0 +1,119 @@
+#include "kanon/rpc/concurrency_limiter.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace kanon::protobuf::rpc;
+
+struct Record {
+  std::vector<std::string> run;
+  std::vector<std::string> shed;
+
+  ConcurrencyLimiter::Task Task(std::string name)
+  {
+    return [this, name](bool is_shed) {
+      (is_shed ? shed : run).push_back(name);
+    };
+  }
+};
+
+using Names = std::vector<std::string>;
+
+// The interval to adjust the limit is 100ms
+static void SleepInterval() { ::usleep(110 * 1000); }
+
+TEST(concurrency_limiter, fixed_limit)
+{
+  ConcurrencyLimiter limiter(2);
+  EXPECT_FALSE(limiter.IsAdaptive());
+
+  Record record;
+  limiter.Run(record.Task("a"));
+  limiter.Run(record.Task("b"));
+  limiter.Run(record.Task("c"));
+  limiter.Run(record.Task("d"));
+  EXPECT_EQ(record.run, (Names{"a", "b"}));
+
+  // The pending tasks run in order
+  limiter.Complete();
+  EXPECT_EQ(record.run, (Names{"a", "b", "c"}));
+  limiter.Complete();
+  EXPECT_EQ(record.run, (Names{"a", "b", "c", "d"}));
+
+  limiter.Complete();
+  limiter.Complete();
+  limiter.Run(record.Task("e"));
+  EXPECT_EQ(record.run.back(), "e");
+  EXPECT_TRUE(record.shed.empty());
+  EXPECT_EQ(limiter.GetLimit(), 2);
+}
+
+TEST(concurrency_limiter, fixed_limit_never_shed)
+{
+  ConcurrencyLimiter limiter(1);
+
+  Record record;
+  for (int i = 0; i < 100; ++i)
+    limiter.Run(record.Task(std::to_string(i)));
+  EXPECT_EQ(record.run.size(), 1);
+
+  SleepInterval();
+  for (int i = 0; i < 100; ++i)
+    limiter.Complete();
+  EXPECT_EQ(record.run.size(), 100);
+  EXPECT_EQ(record.run.back(), "99");
+  EXPECT_TRUE(record.shed.empty());
+  EXPECT_EQ(limiter.GetShedCount(), 0);
+}
+
+TEST(concurrency_limiter, adaptive_bounds)
+{
+  ConcurrencyLimiter limiter(2, 1);
+  EXPECT_TRUE(limiter.IsAdaptive());
+
+  Record record;
+  limiter.Run(record.Task("a"));
+  limiter.Run(record.Task("b"));
+  limiter.Run(record.Task("c"));
+  limiter.Run(record.Task("d"));
+  limiter.Run(record.Task("e"));
+  limiter.Run(record.Task("f"));
+
+  // The calls run without delay in the first interval
+  SleepInterval();
+  limiter.Complete();
+  EXPECT_EQ(record.run, (Names{"a", "b", "c"}));
+  EXPECT_EQ(limiter.GetLimit(), 2);
+
+  // Overloaded, the limit is decreased and the delayed call is shed
+  SleepInterval();
+  limiter.Complete();
+  EXPECT_EQ(limiter.GetLimit(), 1);
+  EXPECT_EQ(record.shed, (Names{"d"}));
+
+  // The limit is 1 at least
+  SleepInterval();
+  limiter.Complete();
+  EXPECT_EQ(limiter.GetLimit(), 1);
+  EXPECT_EQ(record.shed, (Names{"d", "e", "f"}));
+  EXPECT_EQ(limiter.GetShedCount(), 3);
+
+  limiter.Run(record.Task("g"));
+  EXPECT_EQ(record.run.back(), "g");
+  limiter.Complete();
+
+  // The limit is increased if not overloaded, up to max_concurrency
+  SleepInterval();
+  limiter.Run(record.Task("h"));
+  EXPECT_EQ(record.run.back(), "h");
+  EXPECT_EQ(limiter.GetLimit(), 2);
+  limiter.Complete();
+
+  SleepInterval();
+  limiter.Run(record.Task("i"));
+  EXPECT_EQ(limiter.GetLimit(), 2);
+}
@@ -0,0 +1,104 @@
+#include "kanon/rpc/deadline_wheel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace kanon::protobuf::rpc;
+
+static std::vector<uint64_t> Advance(DeadlineWheel &wheel, uint64_t now)
+{
+  std::vector<uint64_t> ids;
+  wheel.Advance(now, [&ids](uint64_t id) {
+    ids.push_back(id);
+  });
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(deadline_wheel, expire_due_entries_only)
+{
+  DeadlineWheel wheel(10, 8);
+  wheel.Add(1, 15);
+  wheel.Add(2, 25);
+  wheel.Add(3, 20);
+  EXPECT_EQ(wheel.size(), 3);
+
+  EXPECT_TRUE(Advance(wheel, 9).empty());
+  // The deadline equal to now is expired
+  EXPECT_EQ(Advance(wheel, 20), (std::vector<uint64_t>{1, 3}));
+  EXPECT_EQ(wheel.size(), 1);
+  EXPECT_EQ(Advance(wheel, 25), (std::vector<uint64_t>{2}));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(deadline_wheel, same_tick_not_due)
+{
+  DeadlineWheel wheel(10, 8);
+  wheel.Add(1, 19);
+
+  // The bucket of tick 1 is checked but the deadline is not reached
+  EXPECT_TRUE(Advance(wheel, 15).empty());
+  EXPECT_EQ(wheel.size(), 1);
+  EXPECT_EQ(Advance(wheel, 19), (std::vector<uint64_t>{1}));
+}
+
+TEST(deadline_wheel, beyond_round)
+{
+  // A round is 40ms
+  DeadlineWheel wheel(10, 4);
+  wheel.Add(1, 100);
+  wheel.Add(2, 20);
+
+  // The bucket of 100 is also the bucket of 20
+  EXPECT_EQ(Advance(wheel, 25), (std::vector<uint64_t>{2}));
+  EXPECT_EQ(wheel.size(), 1);
+  EXPECT_TRUE(Advance(wheel, 65).empty());
+  EXPECT_TRUE(Advance(wheel, 99).empty());
+  EXPECT_EQ(Advance(wheel, 100), (std::vector<uint64_t>{1}));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(deadline_wheel, add_past_deadline)
+{
+  DeadlineWheel wheel(10, 8);
+  EXPECT_TRUE(Advance(wheel, 500).empty());
+
+  // The bucket has been checked, it is expired in the next advance
+  wheel.Add(1, 10);
+  wheel.Add(2, 500);
+  EXPECT_EQ(Advance(wheel, 500), (std::vector<uint64_t>{1, 2}));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(deadline_wheel, time_jump)
+{
+  DeadlineWheel wheel(1, 16);
+  for (uint64_t i = 0; i < 100; ++i)
+    wheel.Add(i, i * 7);
+
+  // All buckets are checked once
+  const auto ids = Advance(wheel, 1000000);
+  ASSERT_EQ(ids.size(), 100);
+  for (uint64_t i = 0; i < 100; ++i)
+    EXPECT_EQ(ids[i], i);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(deadline_wheel, add_in_callback)
+{
+  DeadlineWheel wheel(10, 8);
+  wheel.Add(1, 10);
+
+  std::vector<uint64_t> ids;
+  wheel.Advance(30, [&wheel, &ids](uint64_t id) {
+    ids.push_back(id);
+    if (id == 1) wheel.Add(2, 30);
+  });
+
+  // The deadline added by the callback is checked in the next advance
+  EXPECT_EQ(ids, (std::vector<uint64_t>{1}));
+  EXPECT_EQ(wheel.size(), 1);
+  EXPECT_EQ(Advance(wheel, 30), (std::vector<uint64_t>{2}));
+}
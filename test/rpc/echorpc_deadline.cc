@@ -0,0 +1,134 @@
+/**
+ * Echo rpc with deadline
+ *
+ * The server responses the "slow" message after \p delay ms,
+ * the client sets the timeout of each call to \p timeout ms.
+ * The slow calls are expected to complete with the timeout error,
+ * and their late responses are dropped.
+ *
+ * Usage:
+ *   echorpc_deadline [calls(=1000)] [timeout(=50)] [delay(=200)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class SlowEchoServiceImpl : public EchoService {
+ public:
+  SlowEchoServiceImpl(EventLoop *loop, uint64_t delay)
+    : loop_(loop)
+    , delay_(delay)
+  {
+  }
+
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    reply->set_msg(args->msg());
+
+    if (args->msg() == "slow") {
+      loop_->RunAfterMs([done]() {
+        done->Run();
+      }, delay_);
+    } else {
+      done->Run();
+    }
+  }
+
+ private:
+  EventLoop *loop_;
+  uint64_t delay_;
+};
+
+struct Call {
+  EchoArgs args;
+  EchoReply reply;
+  RpcController controller;
+};
+
+int main(int argc, char *argv[])
+{
+  const int call_num = argc > 1 ? ::atoi(argv[1]) : 1000;
+  const int timeout = argc > 2 ? ::atoi(argv[2]) : 50;
+  const int delay = argc > 3 ? ::atoi(argv[3]) : 200;
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the server and client in exit since the loop
+  // threads are running
+  auto server = new RpcServer(server_loop, InetAddr(9996), "EchoRpcServer");
+  server->SetUseArena(true);
+  server->AddServices(new SlowEchoServiceImpl(server_loop, delay));
+  server->StartRun();
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  CountDownLatch latch(1);
+  auto chan = new RpcChannel();
+  EchoService::Stub stub(chan);
+  auto cli = new TcpClientPtr(
+      NewTcpClient(client_loop, InetAddr("127.0.0.1:9996"), "EchoRpcClient"));
+  (*cli)->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  (*cli)->Connect();
+  latch.Wait();
+
+  std::atomic<int> ok_num(0);
+  std::atomic<int> timeout_num(0);
+  std::atomic<int> error_num(0);
+  CountDownLatch done_latch(call_num);
+  std::vector<Call> calls(call_num);
+
+  for (int i = 0; i < call_num; ++i) {
+    auto &call = calls[i];
+    const bool slow = i % 2 == 0;
+    call.args.set_msg(slow ? "slow" : "fast");
+    call.controller.SetTimeout(slow ? timeout : 10 * delay);
+
+    auto p = &call;
+    stub.Echo(&call.controller, &call.args, &call.reply,
+              NewCallable([p, slow, &ok_num, &timeout_num, &error_num,
+                           &done_latch]() {
+                if (p->controller.Failed()) {
+                  ++(slow ? timeout_num : error_num);
+                } else if (!slow && p->reply.msg() == "fast") {
+                  ++ok_num;
+                } else {
+                  ++error_num;
+                }
+                done_latch.Countdown();
+              }));
+  }
+
+  done_latch.Wait();
+
+  // Wait the late responses
+  ::usleep(2 * delay * 1000);
+
+  ::printf("calls: %d, ok: %d, timeout: %d, error: %d\n", call_num,
+           ok_num.load(), timeout_num.load(), error_num.load());
+
+  ::fflush(stdout);
+  ::_exit(error_num == 0 ? 0 : 1);
+}
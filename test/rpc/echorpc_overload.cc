@@ -0,0 +1,127 @@
+/**
+ * Echo rpc under overload
+ *
+ * The service takes \p cost ms per call in a single thread pool, and the
+ * client sends \p calls calls at once with the timeout \p timeout ms.
+ * The server sheds the calls by the adaptive concurrency limiter
+ * and drops the calls expired in the queue.
+ *
+ * Usage:
+ *   echorpc_overload [calls(=2000)] [timeout(=200)] [cost(=1)]
+ *                    [target delay(=5, 0 indicates no limiter)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+#include "kanon/thread/thread_pool.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class BusyEchoServiceImpl : public EchoService {
+ public:
+  explicit BusyEchoServiceImpl(int cost)
+    : cost_(cost)
+  {
+  }
+
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    ::usleep(cost_ * 1000);
+    reply->set_msg(args->msg());
+    done->Run();
+  }
+
+ private:
+  int cost_;
+};
+
+struct Call {
+  EchoArgs args;
+  EchoReply reply;
+  RpcController controller;
+};
+
+int main(int argc, char *argv[])
+{
+  const int call_num = argc > 1 ? ::atoi(argv[1]) : 2000;
+  const int timeout = argc > 2 ? ::atoi(argv[2]) : 200;
+  const int cost = argc > 3 ? ::atoi(argv[3]) : 1;
+  const int target_delay = argc > 4 ? ::atoi(argv[4]) : 5;
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the server and client in exit since the loop
+  // threads are running
+  auto server = new RpcServer(server_loop, InetAddr(9995), "EchoRpcServer");
+  server->SetUseArena(true);
+  auto service = new BusyEchoServiceImpl(cost);
+  auto pool = new ThreadPool(INT32_MAX, "EchoRpcService");
+  pool->StartRun(1);
+  server->AddServices(service, pool);
+  if (target_delay > 0) server->SetAdaptiveConcurrency(service, 8, target_delay);
+  server->StartRun();
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  CountDownLatch latch(1);
+  auto chan = new RpcChannel();
+  EchoService::Stub stub(chan);
+  auto cli = new TcpClientPtr(
+      NewTcpClient(client_loop, InetAddr("127.0.0.1:9995"), "EchoRpcClient"));
+  (*cli)->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  (*cli)->Connect();
+  latch.Wait();
+
+  std::atomic<int> ok_num(0);
+  std::atomic<int> failed_num(0);
+  CountDownLatch done_latch(call_num);
+  std::vector<Call> calls(call_num);
+
+  const auto start = TimeStamp::Now();
+  for (auto &call : calls) {
+    call.args.set_msg("a");
+    call.controller.SetTimeout(timeout);
+
+    auto p = &call;
+    stub.Echo(&call.controller, &call.args, &call.reply,
+              NewCallable([p, &ok_num, &failed_num, &done_latch]() {
+                ++(p->controller.Failed() ? failed_num : ok_num);
+                done_latch.Countdown();
+              }));
+  }
+
+  done_latch.Wait();
+  const auto elapsed = (TimeStamp::Now().GetMicroseconds() -
+                        start.GetMicroseconds()) / 1000;
+
+  ::printf("calls: %d, ok: %d, failed: %d, elapsed: %lldms\n", call_num,
+           ok_num.load(), failed_num.load(), (long long)elapsed);
+  ::printf("server expired: %llu, shed: %llu\n",
+           (unsigned long long)server->GetExpiredCount(),
+           (unsigned long long)server->GetShedCount());
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
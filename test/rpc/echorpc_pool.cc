@@ -0,0 +1,136 @@
+/**
+ * Echo rpc throughput through RpcChannelPool
+ *
+ * \p servers servers run in the different loop threads of this process,
+ * the pool connects \p conns connections to each server in \p loops
+ * client loops, and keeps \p depth outstanding calls.
+ *
+ * Usage:
+ *   echorpc_pool [seconds(=5)] [depth(=64)] [servers(=2)] [conns(=2)]
+ *                [loops(=2)] [wire(=pb|bin)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/event_loop_pool.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel_pool.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class EchoServiceImpl : public EchoService {
+ public:
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    reply->set_msg(args->msg());
+    done->Run();
+  }
+};
+
+struct Call {
+  EchoArgs args;
+  EchoReply reply;
+  RpcController controller;
+  PROTOBUF::Closure *done = nullptr;
+};
+
+int main(int argc, char *argv[])
+{
+  const int seconds = argc > 1 ? ::atoi(argv[1]) : 5;
+  const int depth = argc > 2 ? ::atoi(argv[2]) : 64;
+  const int server_num = argc > 3 ? ::atoi(argv[3]) : 2;
+  const int conn_num = argc > 4 ? ::atoi(argv[4]) : 2;
+  const int loop_num = argc > 5 ? ::atoi(argv[5]) : 2;
+  const bool binary_wire = argc > 6 && ::strcmp(argv[6], "bin") == 0;
+
+  SetKanonLog(false);
+
+  // Don't destroy the servers and clients in exit since the loop
+  // threads are running
+  std::vector<InetAddr> addrs;
+  for (int i = 0; i < server_num; ++i) {
+    auto server_thr = new EventLoopThread("EchoRpcServer");
+    auto server_loop = server_thr->StartRun();
+    addrs.emplace_back(9990 - i);
+    auto server =
+        new RpcServer(server_loop, addrs.back(), "EchoRpcServer");
+    server->SetUseArena(true);
+    server->AddServices(new EchoServiceImpl());
+    server->StartRun();
+  }
+
+  EventLoop base_loop;
+  auto loops = new EventLoopPool(&base_loop, "EchoRpcClient");
+  loops->SetLoopNum(loop_num);
+  loops->StartRun();
+
+  auto pool = new RpcChannelPool(loops);
+  if (binary_wire) pool->EnableBinaryWire();
+  for (auto const &addr : addrs)
+    pool->AddServer(addr, conn_num);
+
+  while (pool->GetConnectedCount() != pool->GetSize())
+    ::usleep(1000);
+  EchoService::Stub stub(pool);
+
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> calls(0);
+  std::atomic<uint64_t> failed_calls(0);
+  CountDownLatch done_latch(depth);
+  std::vector<Call> call_slots(depth);
+
+  for (auto &call : call_slots) {
+    call.args.set_msg(std::string(64, 'a'));
+    auto p = &call;
+    call.done = NewPermanentCallable(
+        [p, &stub, &running, &calls, &failed_calls, &done_latch]() {
+          calls.fetch_add(1, std::memory_order_relaxed);
+          if (p->controller.Failed()) {
+            failed_calls.fetch_add(1, std::memory_order_relaxed);
+            p->controller.Reset();
+          }
+
+          if (running.load(std::memory_order_relaxed)) {
+            stub.Echo(&p->controller, &p->args, &p->reply, p->done);
+          } else {
+            done_latch.Countdown();
+          }
+        });
+  }
+
+  const auto start = TimeStamp::Now();
+  for (auto &call : call_slots)
+    stub.Echo(&call.controller, &call.args, &call.reply, call.done);
+
+  ::sleep(seconds);
+  running = false;
+  done_latch.Wait();
+
+  const auto elapsed = (double)(TimeStamp::Now().GetMicroseconds() -
+                                start.GetMicroseconds()) /
+                       1000000;
+  const auto total_calls = calls.load();
+
+  ::printf("servers: %d, connections: %d, loops: %d, wire: %s\n", server_num,
+           server_num * conn_num, loop_num, binary_wire ? "binary" : "protobuf");
+  ::printf("calls: %llu, failed: %llu, elapsed: %.3fs\n",
+           (unsigned long long)total_calls,
+           (unsigned long long)failed_calls.load(), elapsed);
+  ::printf("QPS: %.0f\n", total_calls / elapsed);
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
@@ -0,0 +1,218 @@
+/**
+ * Echo rpc throughput based on echorpc_server
+ *
+ * The server and client run in the different loop threads of
+ * this process, the client keeps \p depth outstanding calls
+ * in the connection.
+ *
+ * Report:
+ * * QPS
+ * * The heap allocations per call in the server loop thread
+ *   (operator new is counted)
+ * * The per-method metrics of server and client if \p metrics is 1
+ *
+ * Usage:
+ *   echorpc_qps [seconds(=5)] [depth(=1)] [message size(=64)] [wire(=pb|bin)]
+ *               [service threads(=0, i.e. inline)] [max concurrency(=0)]
+ *               [method id(=0|1)] [metrics(=0|1)]
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+#include "kanon/thread/thread_pool.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+static void PrintMetrics(char const *side, RpcMetrics const &metrics)
+{
+  std::vector<MethodMetricsSnapshot> methods;
+  metrics.Snapshot(methods);
+  for (auto const &method : methods) {
+    ::printf("%s %s: requests: %llu, errors: %llu, in flight: %lld\n", side,
+             method.name.c_str(), (unsigned long long)method.requests,
+             (unsigned long long)method.GetErrorCount(),
+             (long long)method.in_flight);
+    ::printf("  p50/p99(us): queue: %llu/%llu, exec: %llu/%llu, "
+             "total: %llu/%llu\n",
+             (unsigned long long)method.queue_time.Percentile(0.5),
+             (unsigned long long)method.queue_time.Percentile(0.99),
+             (unsigned long long)method.exec_time.Percentile(0.5),
+             (unsigned long long)method.exec_time.Percentile(0.99),
+             (unsigned long long)method.total_time.Percentile(0.5),
+             (unsigned long long)method.total_time.Percentile(0.99));
+  }
+}
+
+static KANON_TLS bool t_count_alloc = false;
+static std::atomic<uint64_t> g_alloc_count(0);
+
+void *operator new(size_t n)
+{
+  if (t_count_alloc) g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+  auto p = ::malloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { ::free(p); }
+void operator delete(void *p, size_t) noexcept { ::free(p); }
+
+class EchoServiceImpl : public EchoService {
+ public:
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    // args is owned by the arena of the call, don't delete it
+    reply->set_msg(args->msg());
+
+    done->Run();
+  }
+};
+
+struct Call {
+  EchoArgs args;
+  EchoReply reply;
+  RpcController controller;
+  PROTOBUF::Closure *done = nullptr;
+};
+
+int main(int argc, char *argv[])
+{
+  const int seconds = argc > 1 ? ::atoi(argv[1]) : 5;
+  const int depth = argc > 2 ? ::atoi(argv[2]) : 1;
+  const int msg_size = argc > 3 ? ::atoi(argv[3]) : 64;
+  const bool binary_wire = argc > 4 && ::strcmp(argv[4], "bin") == 0;
+  const int thread_num = argc > 5 ? ::atoi(argv[5]) : 0;
+  const int max_concurrency = argc > 6 ? ::atoi(argv[6]) : 0;
+  const bool method_id = argc > 7 && ::atoi(argv[7]) != 0;
+  const bool metrics = argc > 8 && ::atoi(argv[8]) != 0;
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the server and client in exit since the loop
+  // threads are running
+  auto server = new RpcServer(server_loop, InetAddr(9997), "EchoRpcServer");
+  server->SetUseArena(true);
+  auto service = new EchoServiceImpl();
+  server->AddServices(service);
+  if (thread_num > 0) {
+    auto pool = new ThreadPool(INT_MAX, "EchoRpcService");
+    pool->StartRun(thread_num);
+    server->SetThreadPool(pool);
+  }
+  if (max_concurrency > 0) {
+    server->SetMaxConcurrency(service, "Echo", max_concurrency);
+  }
+  if (metrics) server->EnableMetrics();
+  server->StartRun();
+  server_loop->RunInLoop([]() {
+    t_count_alloc = true;
+  });
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  CountDownLatch latch(1);
+  auto chan = new RpcChannel();
+  EchoService::Stub stub(chan);
+  RpcMetrics client_metrics;
+  if (metrics) {
+    client_metrics.AddService(EchoService::descriptor());
+    chan->SetMetrics(&client_metrics);
+  }
+  auto cli = new TcpClientPtr(
+      NewTcpClient(client_loop, InetAddr("127.0.0.1:9997"), "EchoRpcClient"));
+  (*cli)->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  (*cli)->Connect();
+  latch.Wait();
+
+  if (binary_wire) {
+    chan->NegotiateBinaryWire();
+    while (!chan->IsBinaryWire())
+      ::usleep(1000);
+  }
+
+  if (method_id) {
+    chan->NegotiateMethodIds();
+    while (!chan->HasMethodIds())
+      ::usleep(1000);
+  }
+
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> calls(0);
+  CountDownLatch done_latch(depth);
+  std::vector<Call> call_slots(depth);
+
+  for (auto &call : call_slots) {
+    call.args.set_msg(std::string(msg_size, 'a'));
+    auto p = &call;
+    call.done = NewPermanentCallable([p, &stub, &running, &calls, &done_latch]() {
+      calls.fetch_add(1, std::memory_order_relaxed);
+      if (running.load(std::memory_order_relaxed)) {
+        stub.Echo(&p->controller, &p->args, &p->reply, p->done);
+      } else {
+        done_latch.Countdown();
+      }
+    });
+  }
+
+  const auto start_allocs = g_alloc_count.load();
+  const auto start = TimeStamp::Now();
+  client_loop->RunInLoop([&call_slots, &stub]() {
+    for (auto &call : call_slots)
+      stub.Echo(&call.controller, &call.args, &call.reply, call.done);
+  });
+
+  ::sleep(seconds);
+  running = false;
+  done_latch.Wait();
+
+  const auto elapsed = (double)(TimeStamp::Now().GetMicroseconds() -
+                                start.GetMicroseconds()) /
+                       1000000;
+  const auto total_calls = calls.load();
+  const auto total_allocs = g_alloc_count.load() - start_allocs;
+
+  ::printf("wire: %s, method id: %d, service threads: %d, max concurrency: %d\n",
+           binary_wire ? "binary" : "protobuf", (int)method_id, thread_num,
+           max_concurrency);
+  ::printf("calls: %llu, elapsed: %.3fs\n", (unsigned long long)total_calls,
+           elapsed);
+  ::printf("QPS: %.0f\n", total_calls / elapsed);
+  ::printf("server allocations/call: %.2f\n",
+           (double)total_allocs / total_calls);
+
+  if (metrics) {
+    PrintMetrics("server", *server->GetMetrics());
+    PrintMetrics("client", client_metrics);
+  }
+
+  for (auto &call : call_slots)
+    delete call.done;
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
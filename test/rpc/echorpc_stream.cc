@@ -0,0 +1,235 @@
+/**
+ * Echo rpc streaming
+ *
+ * Response stream: the client requests \p messages replies of
+ * \p size bytes in one call, the server writes them by the stream writer
+ * and waits once the stream is not writable.
+ *
+ * Request stream: the client writes \p messages args of \p size bytes
+ * in one call, the server counts them and responses the count at the end.
+ *
+ * The max RSS is reported to show the memory is bounded by the
+ * flow control instead of the size of stream.
+ *
+ * Usage:
+ *   echorpc_stream [messages(=100000)] [size(=1024)] [wire(=pb|bin)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+/**
+ * Write the replies of the response stream until it is not writable,
+ * then resume once it is writable
+ */
+class ReplyWriter {
+ public:
+  ReplyWriter(RpcController *controller, EchoReply *reply,
+              PROTOBUF::Closure *done, long count, size_t size)
+    : controller_(controller)
+    , reply_(reply)
+    , done_(done)
+    , remaining_(count)
+  {
+    message_.set_msg(std::string(size, 'a'));
+  }
+
+  void Run()
+  {
+    while (remaining_ > 0) {
+      --remaining_;
+      if (!controller_->WriteStream(message_) && remaining_ > 0) {
+        controller_->NotifyOnWritable(NewCallable([this]() {
+          Run();
+        }));
+        return;
+      }
+    }
+
+    // The final response ends the stream
+    reply_->set_msg("end");
+    auto done = done_;
+    delete this;
+    done->Run();
+  }
+
+ private:
+  RpcController *controller_;
+  EchoReply *reply_;
+  PROTOBUF::Closure *done_;
+  long remaining_;
+  EchoReply message_;
+};
+
+class StreamEchoServiceImpl : public EchoService {
+ public:
+  void Echo(PROTOBUF::RpcController *controller, EchoArgs const *args,
+            EchoReply *reply, PROTOBUF::Closure *done) override
+  {
+    auto contr = static_cast<RpcController *>(controller);
+
+    if (contr->IsRequestStream()) {
+      // The args is refilled with the message of stream
+      auto count = new long(1);
+      contr->SetStreamCallback([count, reply, done](bool end) {
+        if (!end) {
+          ++*count;
+          return;
+        }
+
+        reply->set_msg(std::to_string(*count));
+        delete count;
+        done->Run();
+      });
+      return;
+    }
+
+    // "count size"
+    long count = 0;
+    size_t size = 0;
+    ::sscanf(args->msg().c_str(), "%ld %zu", &count, &size);
+    (new ReplyWriter(contr, reply, done, count, size))->Run();
+  }
+};
+
+static long GetMaxRss() noexcept
+{
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static double GetElapsed(TimeStamp start) noexcept
+{
+  return (double)(TimeStamp::Now().GetMicroseconds() -
+                  start.GetMicroseconds()) /
+         1000000;
+}
+
+int main(int argc, char *argv[])
+{
+  const long messages = argc > 1 ? ::atol(argv[1]) : 100000;
+  const size_t size = argc > 2 ? (size_t)::atol(argv[2]) : 1024;
+  const bool binary_wire = argc > 3 && ::strcmp(argv[3], "bin") == 0;
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the server and client in exit since the loop
+  // threads are running
+  auto server = new RpcServer(server_loop, InetAddr(9994), "EchoRpcServer");
+  server->AddServices(new StreamEchoServiceImpl());
+  server->StartRun();
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  CountDownLatch latch(1);
+  auto chan = new RpcChannel();
+  EchoService::Stub stub(chan);
+  auto cli = new TcpClientPtr(
+      NewTcpClient(client_loop, InetAddr("127.0.0.1:9994"), "EchoRpcClient"));
+  (*cli)->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  (*cli)->Connect();
+  latch.Wait();
+
+  if (binary_wire) {
+    chan->NegotiateBinaryWire();
+    while (!chan->IsBinaryWire())
+      ::usleep(1000);
+  }
+
+  ::printf("messages: %ld, size: %zu, wire: %s\n", messages, size,
+           binary_wire ? "binary" : "protobuf");
+
+  // Response stream
+  {
+    RpcController controller;
+    EchoArgs args;
+    EchoReply reply;
+    args.set_msg(std::to_string(messages) + ' ' + std::to_string(size));
+
+    // Accessed in the loop only, read after the done
+    long received = 0;
+    size_t received_bytes = 0;
+    controller.SetStreamCallback([&reply, &received, &received_bytes](bool) {
+      ++received;
+      received_bytes += reply.msg().size();
+    });
+
+    CountDownLatch done_latch(1);
+    const auto start = TimeStamp::Now();
+    stub.Echo(&controller, &args, &reply, NewCallable([&done_latch]() {
+                done_latch.Countdown();
+              }));
+    done_latch.Wait();
+    const auto elapsed = GetElapsed(start);
+
+    ::printf("response stream: received: %ld(%s), final: %s, elapsed: "
+             "%.3fs, %.1f MB/s\n",
+             received, received == messages ? "ok" : "mismatch",
+             reply.msg().c_str(), elapsed,
+             received_bytes / elapsed / (1024 * 1024));
+  }
+
+  // Request stream
+  {
+    RpcController controller;
+    EchoArgs args;
+    EchoReply reply;
+    args.set_msg(std::string(size, 'a'));
+    controller.EnableRequestStream();
+
+    CountDownLatch done_latch(1);
+    const auto start = TimeStamp::Now();
+    stub.Echo(&controller, &args, &reply, NewCallable([&done_latch]() {
+                done_latch.Countdown();
+              }));
+
+    for (long i = 1; i < messages; ++i) {
+      if (!controller.WriteStream(args)) {
+        CountDownLatch writable_latch(1);
+        controller.NotifyOnWritable(NewCallable([&writable_latch]() {
+          writable_latch.Countdown();
+        }));
+        writable_latch.Wait();
+      }
+    }
+    controller.CloseStream();
+
+    done_latch.Wait();
+    const auto elapsed = GetElapsed(start);
+
+    ::printf("request stream: counted by server: %s(%s), elapsed: %.3fs, "
+             "%.1f MB/s\n",
+             reply.msg().c_str(),
+             reply.msg() == std::to_string(messages) ? "ok" : "mismatch",
+             elapsed, messages * size / elapsed / (1024 * 1024));
+  }
+
+  ::printf("max rss: %ld KB\n", GetMaxRss());
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
@@ -0,0 +1,145 @@
+/**
+ * Echo rpc latency of the synchronous callers
+ *
+ * The server and client run in the different loop threads of
+ * this process, \p threads caller threads call the method
+ * synchronously one by one in the same connection:
+ * * sync: SyncRpcChannel, i.e. RpcChannel::CallMethodSync()
+ * * latch: the async stub with a CountDownLatch waited per call
+ *
+ * echorpc_qps with depth 1 is the latency of the async callers.
+ *
+ * Usage:
+ *   echorpc_sync [seconds(=5)] [threads(=1)] [mode(=sync|latch)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/rpc/sync_rpc_channel.h"
+#include "kanon/thread/count_down_latch.h"
+#include "kanon/thread/thread.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class EchoServiceImpl : public EchoService {
+ public:
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    reply->set_msg(args->msg());
+    done->Run();
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  const int seconds = argc > 1 ? ::atoi(argv[1]) : 5;
+  const int thread_num = argc > 2 ? ::atoi(argv[2]) : 1;
+  const bool latch_mode = argc > 3 && ::strcmp(argv[3], "latch") == 0;
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the server and client in exit since the loop
+  // threads are running
+  auto server = new RpcServer(server_loop, InetAddr(9993), "EchoRpcServer");
+  server->SetUseArena(true);
+  server->AddServices(new EchoServiceImpl());
+  server->StartRun();
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  CountDownLatch latch(1);
+  auto chan = new RpcChannel();
+  auto cli = new TcpClientPtr(
+      NewTcpClient(client_loop, InetAddr("127.0.0.1:9993"), "EchoRpcClient"));
+  (*cli)->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  (*cli)->Connect();
+  latch.Wait();
+
+  SyncRpcChannel sync_chan(chan);
+  EchoService::Stub sync_stub(&sync_chan);
+  EchoService::Stub async_stub(chan);
+
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> calls(0);
+  std::atomic<uint64_t> failed_calls(0);
+  std::vector<std::unique_ptr<Thread>> callers;
+
+  for (int i = 0; i < thread_num; ++i) {
+    callers.emplace_back(new Thread(
+        [&, latch_mode]() {
+          EchoArgs args;
+          EchoReply reply;
+          RpcController controller;
+          CountDownLatch done_latch(1);
+          args.set_msg(std::string(64, 'a'));
+
+          while (running.load(std::memory_order_relaxed)) {
+            if (latch_mode) {
+              done_latch.Reset(1);
+              async_stub.Echo(&controller, &args, &reply,
+                              NewCallable([&done_latch]() {
+                                done_latch.Countdown();
+                              }));
+              done_latch.Wait();
+            } else {
+              sync_stub.Echo(&controller, &args, &reply, nullptr);
+            }
+
+            if (controller.Failed()) {
+              failed_calls.fetch_add(1, std::memory_order_relaxed);
+              controller.Reset();
+            }
+            calls.fetch_add(1, std::memory_order_relaxed);
+          }
+        },
+        "EchoRpcCaller"));
+  }
+
+  const auto start = TimeStamp::Now();
+  for (auto &caller : callers)
+    caller->StartRun();
+
+  ::sleep(seconds);
+  running = false;
+  for (auto &caller : callers)
+    caller->Join();
+
+  const auto elapsed = (double)(TimeStamp::Now().GetMicroseconds() -
+                                start.GetMicroseconds()) /
+                       1000000;
+  const auto total_calls = calls.load();
+
+  ::printf("mode: %s, threads: %d\n", latch_mode ? "latch" : "sync",
+           thread_num);
+  ::printf("calls: %llu, failed: %llu, elapsed: %.3fs\n",
+           (unsigned long long)total_calls,
+           (unsigned long long)failed_calls.load(), elapsed);
+  ::printf("QPS: %.0f, latency: %.1fus\n", total_calls / elapsed,
+           elapsed * 1000000 * thread_num / total_calls);
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
@@ -0,0 +1,148 @@
+/**
+ * Echo rpc throughput in tcp loopback and unix domain socket
+ *
+ * The same service is served by two servers in the same loop thread,
+ * one in tcp and the other in unix domain socket. Then the client
+ * keeps \p depth outstanding calls in each transport in turn.
+ *
+ * Usage:
+ *   echorpc_uds [seconds(=5)] [depth(=1)] [message size(=64)]
+ *               [path(=@kanon-echorpc)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "pb/echo.pb.h"
+#include "kanon/net/unix_addr.h"
+#include "kanon/net/user_client.h"
+#include "kanon/net/user_server.h"
+#include "kanon/rpc/callable.h"
+#include "kanon/rpc/rpc_channel.h"
+#include "kanon/rpc/rpc_controller.h"
+#include "kanon/rpc/rpc_server.h"
+#include "kanon/thread/count_down_latch.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class EchoServiceImpl : public EchoService {
+ public:
+  void Echo(PROTOBUF::RpcController *, EchoArgs const *args, EchoReply *reply,
+            PROTOBUF::Closure *done) override
+  {
+    reply->set_msg(args->msg());
+    done->Run();
+  }
+};
+
+struct Call {
+  EchoArgs args;
+  EchoReply reply;
+  RpcController controller;
+  PROTOBUF::Closure *done = nullptr;
+};
+
+/**
+ * \return QPS
+ */
+static double RunClient(TcpClientPtr const &cli, int seconds, int depth,
+                        int msg_size)
+{
+  CountDownLatch latch(1);
+  // Don't destroy the channel in exit since the loop thread is running
+  auto chan = new RpcChannel();
+  cli->SetConnectionCallback([chan, &latch](TcpConnectionPtr const &conn) {
+    if (conn->IsConnected()) {
+      chan->SetConnection(conn);
+      latch.Countdown();
+    }
+  });
+  cli->Connect();
+  latch.Wait();
+
+  EchoService::Stub stub(chan);
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> calls(0);
+  CountDownLatch done_latch(depth);
+  std::vector<Call> call_slots(depth);
+
+  for (auto &call : call_slots) {
+    call.args.set_msg(std::string(msg_size, 'a'));
+    auto p = &call;
+    call.done = NewPermanentCallable([p, &stub, &running, &calls, &done_latch]() {
+      calls.fetch_add(1, std::memory_order_relaxed);
+      if (running.load(std::memory_order_relaxed)) {
+        stub.Echo(&p->controller, &p->args, &p->reply, p->done);
+      } else {
+        done_latch.Countdown();
+      }
+    });
+  }
+
+  const auto start = TimeStamp::Now();
+  cli->GetLoop()->RunInLoop([&call_slots, &stub]() {
+    for (auto &call : call_slots)
+      stub.Echo(&call.controller, &call.args, &call.reply, call.done);
+  });
+
+  ::sleep(seconds);
+  running = false;
+  done_latch.Wait();
+
+  const auto elapsed = (double)(TimeStamp::Now().GetMicroseconds() -
+                                start.GetMicroseconds()) /
+                       1000000;
+  for (auto &call : call_slots)
+    delete call.done;
+
+  return calls.load() / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+  const int seconds = argc > 1 ? ::atoi(argv[1]) : 5;
+  const int depth = argc > 2 ? ::atoi(argv[2]) : 1;
+  const int msg_size = argc > 3 ? ::atoi(argv[3]) : 64;
+  const UnixAddr unix_addr(argc > 4 ? argv[4] : "@kanon-echorpc");
+
+  SetKanonLog(false);
+
+  EventLoopThread server_thr("EchoRpcServer");
+  auto server_loop = server_thr.StartRun();
+  // Don't destroy the servers and clients in exit since the loop
+  // threads are running
+  auto service = new EchoServiceImpl();
+  auto tcp_server =
+      new RpcServer(server_loop, InetAddr(9992), "EchoRpcServer-tcp");
+  tcp_server->SetUseArena(true);
+  tcp_server->AddServices(service);
+  tcp_server->StartRun();
+  auto unix_server = new RpcServer(server_loop, unix_addr, "EchoRpcServer-uds");
+  unix_server->SetUseArena(true);
+  unix_server->AddServices(service);
+  unix_server->StartRun();
+
+  EventLoopThread client_thr("EchoRpcClient");
+  auto client_loop = client_thr.StartRun();
+  auto tcp_cli = new TcpClientPtr(NewTcpClient(
+      client_loop, InetAddr("127.0.0.1:9992"), "EchoRpcClient-tcp"));
+  auto unix_cli = new TcpClientPtr(
+      NewTcpClient(client_loop, unix_addr, "EchoRpcClient-uds"));
+
+  const auto tcp_qps = RunClient(*tcp_cli, seconds, depth, msg_size);
+  const auto unix_qps = RunClient(*unix_cli, seconds, depth, msg_size);
+
+  ::printf("depth: %d, message size: %d, unix socket: %s\n", depth, msg_size,
+           unix_addr.GetPath().c_str());
+  ::printf("tcp loopback QPS: %.0f\n", tcp_qps);
+  ::printf("unix socket QPS: %.0f (%+.1f%%)\n", unix_qps,
+           (unix_qps / tcp_qps - 1) * 100);
+
+  ::fflush(stdout);
+  ::_exit(0);
+}
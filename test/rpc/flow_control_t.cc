@@ -0,0 +1,160 @@
+#include "kanon/rpc/flow_control.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/stubs/callback.h>
+#include <gtest/gtest.h>
+
+using namespace kanon::protobuf::rpc;
+
+/** Record the run and deletion of the closure */
+class Waiter : public PROTOBUF::Closure {
+ public:
+  Waiter(std::vector<int> &runs, int &deleted, int id)
+    : runs_(runs)
+    , deleted_(deleted)
+    , id_(id)
+  {
+  }
+
+  ~Waiter() override { ++deleted_; }
+
+  void Run() override
+  {
+    runs_.push_back(id_);
+    delete this;
+  }
+
+ private:
+  std::vector<int> &runs_;
+  int &deleted_;
+  int id_;
+};
+
+TEST(flow_control, acquire_release)
+{
+  FlowControl flow(10);
+  EXPECT_TRUE(flow.IsWritable());
+
+  EXPECT_TRUE(flow.Acquire(5));
+  EXPECT_TRUE(flow.Acquire(4));
+
+  // Reach the high water mark
+  EXPECT_FALSE(flow.Acquire(1));
+  EXPECT_FALSE(flow.IsWritable());
+  EXPECT_FALSE(flow.Acquire(0));
+
+  flow.Release(0);
+  EXPECT_FALSE(flow.IsWritable());
+  flow.Release(1);
+  EXPECT_TRUE(flow.IsWritable());
+  flow.Release(9);
+  EXPECT_TRUE(flow.IsWritable());
+
+  // Exceed the high water mark at once
+  EXPECT_FALSE(flow.Acquire(100));
+  flow.Release(91);
+  EXPECT_TRUE(flow.IsWritable());
+}
+
+TEST(flow_control, block)
+{
+  FlowControl flow(10);
+  EXPECT_FALSE(flow.IsBlocked());
+
+  flow.Block();
+  EXPECT_TRUE(flow.IsBlocked());
+  EXPECT_FALSE(flow.IsWritable());
+  EXPECT_FALSE(flow.Acquire(1));
+
+  flow.Unblock();
+  EXPECT_FALSE(flow.IsBlocked());
+  EXPECT_TRUE(flow.IsWritable());
+  EXPECT_TRUE(flow.Acquire(1));
+}
+
+TEST(flow_control, notify_on_writable)
+{
+  std::vector<int> runs;
+  int deleted = 0;
+  FlowControl flow(10);
+
+  // Run immediately if writable
+  flow.NotifyOnWritable(new Waiter(runs, deleted, 0));
+  EXPECT_EQ(runs, std::vector<int>{0});
+
+  flow.Acquire(20);
+  flow.Block();
+  flow.NotifyOnWritable(new Waiter(runs, deleted, 1));
+  flow.NotifyOnWritable(new Waiter(runs, deleted, 2));
+
+  // Both the queued bytes and the blocking must be released
+  flow.Release(5);
+  flow.Unblock();
+  EXPECT_EQ(runs.size(), 1);
+  flow.Block();
+  flow.Release(10);
+  EXPECT_EQ(runs.size(), 1);
+  flow.Unblock();
+  EXPECT_EQ(runs, (std::vector<int>{0, 1, 2}));
+  EXPECT_EQ(deleted, 3);
+
+  // Run once only
+  flow.Release(5);
+  EXPECT_EQ(runs.size(), 3);
+}
+
+TEST(flow_control, abandon_waiters)
+{
+  std::vector<int> runs;
+  int deleted = 0;
+  {
+    FlowControl flow(1);
+    flow.Acquire(1);
+    flow.NotifyOnWritable(new Waiter(runs, deleted, 0));
+    flow.NotifyOnWritable(new Waiter(runs, deleted, 1));
+  }
+
+  EXPECT_TRUE(runs.empty());
+  EXPECT_EQ(deleted, 2);
+}
+
+static void SetPromise(std::promise<void> *promise) { promise->set_value(); }
+
+TEST(flow_control, no_missed_wake_up)
+{
+  static constexpr size_t kCount = 100000;
+  FlowControl flow(4);
+  std::atomic<size_t> acquired(0);
+
+  std::thread writer([&]() {
+    for (size_t i = 0; i < kCount; ++i) {
+      const bool writable = flow.Acquire(1);
+      acquired.fetch_add(1);
+      if (writable) continue;
+
+      std::promise<void> promise;
+      auto future = promise.get_future();
+      flow.NotifyOnWritable(PROTOBUF::NewCallback(&SetPromise, &promise));
+      ASSERT_EQ(future.wait_for(std::chrono::seconds(10)),
+                std::future_status::ready);
+    }
+  });
+
+  size_t released = 0;
+  while (released < kCount) {
+    if (released < acquired.load()) {
+      flow.Release(1);
+      ++released;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  writer.join();
+  EXPECT_TRUE(flow.IsWritable());
+}
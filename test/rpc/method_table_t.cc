@@ -0,0 +1,91 @@
+#include "kanon/rpc/method_table.h"
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include "kanon/thread/thread_pool.h"
+#include "pb/echo.pb.h"
+#include "pb/simple.pb.h"
+
+using namespace kanon;
+using namespace kanon::protobuf::rpc;
+
+class EchoServiceImpl : public EchoService {};
+class SimpleServiceImpl : public SimpleService {};
+
+TEST(method_table, find_by_id)
+{
+  EchoServiceImpl echo;
+  SimpleServiceImpl simple;
+  MethodTable table;
+
+  EXPECT_EQ(table.Find(MethodTable::kNoMethodId), nullptr);
+  EXPECT_EQ(table.Find(1), nullptr);
+
+  table.AddService(&echo, nullptr);
+  table.AddService(&simple, nullptr);
+  ASSERT_EQ(table.methods().size(), 2);
+
+  // The id starts from 1 and is continuous across services
+  auto entry = table.Find(1);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->id, 1);
+  EXPECT_EQ(entry->name, "EchoService/Echo");
+  EXPECT_EQ(entry->service, &echo);
+  EXPECT_EQ(entry->request_prototype, &EchoArgs::default_instance());
+  EXPECT_EQ(entry->response_prototype, &EchoReply::default_instance());
+  EXPECT_EQ(entry->limiter, nullptr);
+
+  entry = table.Find(2);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->id, 2);
+  EXPECT_EQ(entry->name, "SimpleService/simple");
+  EXPECT_EQ(entry->service, &simple);
+
+  EXPECT_EQ(table.Find(MethodTable::kNoMethodId), nullptr);
+  EXPECT_EQ(table.Find(3), nullptr);
+  EXPECT_EQ(table.Find(UINT32_MAX), nullptr);
+}
+
+TEST(method_table, find_by_name)
+{
+  EchoServiceImpl echo;
+  MethodTable table;
+  table.AddService(&echo, nullptr);
+
+  auto entry = table.Find(std::string("EchoService/Echo"));
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry, table.Find(1));
+
+  EXPECT_EQ(table.Find(std::string("EchoService/echo")), nullptr);
+  EXPECT_EQ(table.Find(std::string("EchoService")), nullptr);
+  EXPECT_EQ(table.Find(std::string("")), nullptr);
+
+  EXPECT_TRUE(table.HasService("EchoService"));
+  EXPECT_FALSE(table.HasService("SimpleService"));
+  EXPECT_FALSE(table.HasService("EchoService/Echo"));
+}
+
+TEST(method_table, readd_service)
+{
+  EchoServiceImpl echo1;
+  EchoServiceImpl echo2;
+  SimpleServiceImpl simple;
+  MethodTable table;
+
+  table.AddService(&echo1, nullptr);
+  table.AddService(&simple, nullptr);
+
+  // The service and pool are updated but the id is not changed
+  ThreadPool pool;
+  table.AddService(&echo2, &pool);
+  ASSERT_EQ(table.methods().size(), 2);
+
+  auto entry = table.Find(std::string("EchoService/Echo"));
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->id, 1);
+  EXPECT_EQ(entry->service, &echo2);
+  EXPECT_EQ(entry->pool, &pool);
+  EXPECT_EQ(table.Find(2)->service, &simple);
+}
@@ -0,0 +1,138 @@
+#include "kanon/rpc/outstanding_calls.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace kanon::protobuf::rpc;
+
+// The done is only used as the mark of the occupied slot
+static char g_done;
+
+static OutstandingCall MakeCall(uint64_t id)
+{
+  return OutstandingCall{id, nullptr,
+                         reinterpret_cast<PROTOBUF::Closure *>(&g_done),
+                         nullptr, -1, 0, 0};
+}
+
+TEST(outstanding_calls, add_remove)
+{
+  OutstandingCalls calls;
+  EXPECT_TRUE(calls.empty());
+
+  calls.Add(MakeCall(1));
+  calls.Add(MakeCall(2));
+  EXPECT_EQ(calls.size(), 2);
+  ASSERT_TRUE(calls.Find(1));
+  EXPECT_EQ(calls.Find(1)->id, 1);
+
+  OutstandingCall call;
+  ASSERT_TRUE(calls.Remove(1, call));
+  EXPECT_EQ(call.id, 1);
+  EXPECT_EQ(calls.size(), 1);
+
+  // Completed already
+  EXPECT_FALSE(calls.Remove(1, call));
+  EXPECT_FALSE(calls.Find(1));
+  // Never added
+  EXPECT_FALSE(calls.Remove(3, call));
+}
+
+TEST(outstanding_calls, reject_other_generation)
+{
+  OutstandingCalls calls;
+  calls.Add(MakeCall(1));
+
+  // The same slot but the id is different
+  OutstandingCall call;
+  EXPECT_FALSE(calls.Find(1 + 64));
+  EXPECT_FALSE(calls.Remove(1 + 64, call));
+  EXPECT_FALSE(calls.Remove(1 + 1024, call));
+  EXPECT_EQ(calls.size(), 1);
+}
+
+TEST(outstanding_calls, overflow_sparse)
+{
+  OutstandingCalls calls;
+  // A long outstanding call
+  calls.Add(MakeCall(0));
+
+  OutstandingCall call;
+  for (uint64_t id = 1; id < 64; ++id) {
+    calls.Add(MakeCall(id));
+    ASSERT_TRUE(calls.Remove(id, call));
+  }
+
+  // Take the slot of 0, which is moved to the overflow map
+  calls.Add(MakeCall(64));
+  EXPECT_EQ(calls.size(), 2);
+  ASSERT_TRUE(calls.Find(0));
+  ASSERT_TRUE(calls.Find(64));
+
+  ASSERT_TRUE(calls.Remove(0, call));
+  EXPECT_EQ(call.id, 0);
+  ASSERT_TRUE(calls.Remove(64, call));
+  EXPECT_EQ(call.id, 64);
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST(outstanding_calls, grow_dense)
+{
+  OutstandingCalls calls;
+  for (uint64_t id = 0; id < 1000; ++id)
+    calls.Add(MakeCall(id));
+  EXPECT_EQ(calls.size(), 1000);
+
+  OutstandingCall call;
+  for (uint64_t id = 0; id < 1000; ++id) {
+    ASSERT_TRUE(calls.Remove(id, call)) << id;
+    EXPECT_EQ(call.id, id);
+  }
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST(outstanding_calls, id_wraparound)
+{
+  OutstandingCalls calls;
+  const uint64_t max = UINT64_MAX;
+  calls.Add(MakeCall(max - 1));
+  calls.Add(MakeCall(max));
+  calls.Add(MakeCall(0));
+  calls.Add(MakeCall(1));
+  EXPECT_EQ(calls.size(), 4);
+
+  OutstandingCall call;
+  EXPECT_TRUE(calls.Remove(max, call));
+  EXPECT_EQ(call.id, max);
+  EXPECT_TRUE(calls.Remove(0, call));
+  EXPECT_EQ(call.id, 0);
+  EXPECT_TRUE(calls.Find(max - 1));
+  EXPECT_TRUE(calls.Find(1));
+}
+
+TEST(outstanding_calls, take_all)
+{
+  OutstandingCalls calls;
+  calls.Add(MakeCall(0));
+  OutstandingCall call;
+  for (uint64_t id = 1; id < 64; ++id) {
+    calls.Add(MakeCall(id));
+    ASSERT_TRUE(calls.Remove(id, call));
+  }
+  calls.Add(MakeCall(64));
+  calls.Add(MakeCall(65));
+
+  std::vector<OutstandingCall> taken;
+  calls.TakeAll(taken);
+  EXPECT_TRUE(calls.empty());
+  ASSERT_EQ(taken.size(), 3);
+
+  std::vector<uint64_t> ids;
+  for (auto const &c : taken)
+    ids.push_back(c.id);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, (std::vector<uint64_t>{0, 64, 65}));
+  EXPECT_FALSE(calls.Remove(64, call));
+}
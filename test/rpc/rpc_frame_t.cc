@@ -0,0 +1,146 @@
+#include "kanon/rpc/rpc_frame.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "pb/echo.pb.h"
+
+using namespace kanon;
+using namespace kanon::protobuf;
+using namespace kanon::protobuf::rpc;
+
+/**
+ * Encode the frame and return the body,
+ * i.e. strip the size header, tag and checksum
+ */
+static std::string EncodeBody(RpcFrameHeader const &header, StringView name,
+                              PROTOBUF::Message const *payload)
+{
+  ChunkStream stream;
+  EncodeRpcFrame(stream, header, name, payload);
+
+  std::string frame;
+  for (auto const &chunk : stream.chunk_list)
+    frame.append(chunk.ToStringView().data(), chunk.ToStringView().size());
+
+  // Has the same length with krpc_tag
+  const size_t tag_len = sizeof("krpc") - 1;
+  EXPECT_GE(frame.size(), 4 + tag_len + kRpcFrameHeaderLength + 4);
+  EXPECT_EQ(frame.substr(4, tag_len), krpc_frame_tag);
+  return frame.substr(4 + tag_len, frame.size() - 4 - tag_len - 4);
+}
+
+static std::string ToString(StringView s)
+{
+  return std::string(s.data(), s.size());
+}
+
+TEST(rpc_frame, round_trip)
+{
+  RpcFrameHeader header;
+  header.id = 0x0102030405060708;
+  header.deadline = UINT64_MAX;
+  header.method_id = 0;
+  header.type = RpcMessage::kRequest;
+  header.error = RpcMessage::kNoError;
+
+  EchoArgs args;
+  args.set_msg("hello");
+  auto body = EncodeBody(header, "EchoService/Echo", &args);
+  ASSERT_EQ(body.size(), kRpcFrameHeaderLength + 16 + args.ByteSizeLong());
+
+  // Big endian
+  EXPECT_EQ(body[0], 0x01);
+  EXPECT_EQ(body[7], 0x08);
+
+  RpcFrameHeader decoded;
+  StringView name;
+  StringView payload;
+  ASSERT_TRUE(DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+  EXPECT_EQ(decoded.id, header.id);
+  EXPECT_EQ(decoded.deadline, header.deadline);
+  EXPECT_EQ(decoded.method_id, header.method_id);
+  EXPECT_EQ(decoded.type, header.type);
+  EXPECT_EQ(decoded.error, header.error);
+  EXPECT_EQ(ToString(name), "EchoService/Echo");
+
+  EchoArgs decoded_args;
+  ASSERT_TRUE(decoded_args.ParseFromArray(payload.data(), payload.size()));
+  EXPECT_EQ(decoded_args.msg(), "hello");
+}
+
+TEST(rpc_frame, empty_name_and_payload)
+{
+  RpcFrameHeader header;
+  header.id = 1;
+  header.deadline = 0;
+  header.method_id = UINT32_MAX;
+  header.type = RpcMessage::kResponse;
+  header.error = RpcMessage::kDeadlineExceeded;
+
+  auto body = EncodeBody(header, "", nullptr);
+  ASSERT_EQ(body.size(), kRpcFrameHeaderLength);
+
+  RpcFrameHeader decoded;
+  StringView name("x");
+  StringView payload("x");
+  ASSERT_TRUE(DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+  EXPECT_EQ(decoded.method_id, UINT32_MAX);
+  EXPECT_EQ(decoded.error, RpcMessage::kDeadlineExceeded);
+  EXPECT_TRUE(name.empty());
+  EXPECT_TRUE(payload.empty());
+}
+
+TEST(rpc_frame, truncated)
+{
+  RpcFrameHeader header{};
+  auto body = EncodeBody(header, "EchoService/Echo", nullptr);
+  ASSERT_EQ(body.size(), kRpcFrameHeaderLength + 16);
+
+  RpcFrameHeader decoded;
+  StringView name;
+  StringView payload;
+
+  // The header or name is truncated
+  for (size_t size = 0; size < body.size(); ++size)
+    EXPECT_FALSE(DecodeRpcFrame(body.data(), size, decoded, name, payload))
+        << "size = " << size;
+
+  EXPECT_TRUE(DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+  EXPECT_EQ(ToString(name), "EchoService/Echo");
+  EXPECT_TRUE(payload.empty());
+}
+
+TEST(rpc_frame, malformed_name_size)
+{
+  RpcFrameHeader header{};
+  auto body = EncodeBody(header, "", nullptr);
+  std::string payload_data(100, 'p');
+  body += payload_data;
+
+  RpcFrameHeader decoded;
+  StringView name;
+  StringView payload;
+  ASSERT_TRUE(DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+  EXPECT_EQ(ToString(payload), payload_data);
+
+  // The name size exceeds the body
+  body[kRpcFrameHeaderLength - 2] = '\xff';
+  body[kRpcFrameHeaderLength - 1] = '\xff';
+  EXPECT_FALSE(
+      DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+
+  // The name takes the whole body
+  body[kRpcFrameHeaderLength - 2] = 0;
+  body[kRpcFrameHeaderLength - 1] = 100;
+  ASSERT_TRUE(DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+  EXPECT_EQ(ToString(name), payload_data);
+  EXPECT_TRUE(payload.empty());
+
+  body[kRpcFrameHeaderLength - 1] = 101;
+  EXPECT_FALSE(
+      DecodeRpcFrame(body.data(), body.size(), decoded, name, payload));
+}
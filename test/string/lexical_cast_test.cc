@@ -9,6 +9,11 @@ TEST(LexicalCastTest, Int) {
   EXPECT_EQ(0, strcmp(buf, "322222222"));
 }
 
+TEST(LexicalCastTest, Double) {
+  EXPECT_EQ(lexical_cast<std::string>(0.25), "0.25");
+  EXPECT_EQ(lexical_cast<std::string>(-1e100), "-1e+100");
+}
+
 TEST(LexicalCastTest, Str2Long) {
   auto opt_long = lexical_cast<long>(MakeStringView("11111"));
   
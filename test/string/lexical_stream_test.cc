@@ -67,6 +67,43 @@ TEST(LexicalStreamTest, IntEQ) {
   EXPECT_EQ(0, memcmp(ac, stream.data(), stream.size()));
 }
 
+TEST(LexicalStreamTest, IntLimits) {
+  SmallLexicalStream stream;
+  stream << INT64_MIN << ' ' << UINT64_MAX << ' ' << 0 << ' ' << (short)-32768;
+  EXPECT_STREQ("-9223372036854775808 18446744073709551615 0 -32768",
+               stream.data());
+}
+
+TEST(LexicalStreamTest, DoubleEQ) {
+  SmallLexicalStream stream;
+  stream << 0.1 << ' ' << (0.1 + 0.2) << ' ' << 100.0 << ' ' << 1e-5 << ' '
+         << -1.5e300 << ' ' << 0.0;
+  EXPECT_STREQ("0.1 0.30000000000000004 100 1e-05 -1.5e+300 0", stream.data());
+}
+
+TEST(LexicalStreamTest, DoubleRoundTrip) {
+  SmallLexicalStream stream;
+  double d = 1.0 / 3;
+  for (unsigned i = 0; i != 1000; ++i) {
+    stream.reset();
+    stream << d;
+    EXPECT_EQ(d, strtod(stream.data(), nullptr));
+    d *= -1.7;
+  }
+}
+
+TEST(LexicalStreamTest, FixedFloat) {
+  SmallLexicalStream stream;
+  char buf[64];
+  double const values[] = {3.14159, -0.001, 2.5, 0.125, 1e20};
+  for (auto d : values) {
+    stream.reset();
+    stream << FixedFloat(d, 2);
+    snprintf(buf, sizeof buf, "%.2f", d);
+    EXPECT_STREQ(buf, stream.data());
+  }
+}
+
 TEST(snprintfTest, Int) {
   char buf[64];
   for(unsigned i = 0; i != N; ++i)
@@ -1,3 +1,5 @@
+#include <stdio.h>
+#include <algorithm>
 #include <sstream>
 
 #include <gtest/gtest.h>
@@ -42,6 +44,118 @@ TEST(bench, fmt_stream) {
   }
 }
 
+// Integer and floating-point formatting:
+// lexical_stream(two digits per division, Grisu2) vs the implementation
+// before(one digit per division, snprintf("%.12g")) vs snprintf()
+static unsigned LegacyInt2Str(char *buf, long integer)
+{
+  static char const digits[] = "9876543210123456789";
+  static char const *pzero = digits + 9;
+
+  char *end = buf;
+  bool negative = integer < 0;
+
+  do {
+    long left = integer % 10;
+    integer /= 10;
+    *(end++) = *(pzero + left);
+  } while (integer != 0);
+
+  if (negative) *(end++) = '-';
+
+  *end = 0;
+  std::reverse(buf, end);
+  return unsigned(end - buf);
+}
+
+static long GetInteger(unsigned i)
+{
+  return (long)i * 2654435761u;
+}
+
+static double GetDouble(unsigned i)
+{
+  return (double)(GetInteger(i) % 100000000) / 1000.0;
+}
+
+TEST(bench, int_lexical_stream) {
+  SmallLexicalStream stream;
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    stream.reset();
+    stream << GetInteger(i);
+    total += stream.size();
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, int_legacy) {
+  char buf[64];
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    total += LegacyInt2Str(buf, GetInteger(i));
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, int_snprintf) {
+  char buf[64];
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    total += ::snprintf(buf, sizeof buf, "%ld", GetInteger(i));
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, double_lexical_stream) {
+  SmallLexicalStream stream;
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    stream.reset();
+    stream << GetDouble(i);
+    total += stream.size();
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, double_legacy) {
+  char buf[64];
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    total += ::snprintf(buf, sizeof buf, "%.12g", GetDouble(i));
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, double_snprintf) {
+  char buf[64];
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    total += ::snprintf(buf, sizeof buf, "%.17g", GetDouble(i));
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, fixed_double_lexical_stream) {
+  SmallLexicalStream stream;
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    stream.reset();
+    stream << FixedFloat(GetDouble(i), 3);
+    total += stream.size();
+  }
+  EXPECT_GT(total, 0);
+}
+
+TEST(bench, fixed_double_snprintf) {
+  char buf[64];
+  size_t total = 0;
+  for (unsigned i = 0; i < NUM; ++i) {
+    total += ::snprintf(buf, sizeof buf, "%.3f", GetDouble(i));
+  }
+  EXPECT_GT(total, 0);
+}
+
 int main()
 {
   ::testing::InitGoogleTest();